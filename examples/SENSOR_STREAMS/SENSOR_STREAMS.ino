@@ -0,0 +1,32 @@
+#include <LEADER.h>
+
+OSCFollower node;
+
+// Value sources: sampled from a timer at each stream's max rate
+float readPot() { return analogRead(34) / 4095.0f; }
+int readButton() { return digitalRead(0) == LOW; }
+
+void setup() {
+  pinMode(0, INPUT_PULLUP);
+
+  // Channel 1, USB SLIP = false (Battery Mode)
+  node.begin(1, false);
+  node.enableHeartbeat(1000, 43);
+
+  // Address, source, keep-alive Hz, max Hz, deadband.
+  // The pot is sampled 100 times a second but only sent when it moves by
+  // more than 1%, or once a second so the host knows it is still there.
+  node.addStream("/sensor/pot", readPot, 1, 100, 0.01f);
+  // The button is sent on every change (and every 5 s as a keep-alive)
+  node.addStream("/sensor/button", readButton, 0.2f, 200);
+
+  // Never use more than 2% of the air, whatever the sensors do
+  node.setAirtimeBudget(20000);
+}
+
+void loop() {
+  // Sends the samples worth sending; nothing else to do here!
+  node.update();
+
+  // CIAO! :O)
+}
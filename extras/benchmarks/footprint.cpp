@@ -0,0 +1,71 @@
+// ==========================================
+// LEADER FOOTPRINT REPORT
+// ==========================================
+//
+// Prints the static RAM of OSCLeader and OSCFollower in a few LeaderConfig
+// shapes, split into the compile-time buffers and the fixed logic state.
+// Nothing is run, so only the headers are needed.
+//
+// Build from the repository root:
+//
+//   g++ -std=gnu++17 -Iextras/hostsim/shim -Isrc
+//       extras/benchmarks/footprint.cpp -o footprint
+//
+// With FEATURE_FRAGMENTS, the fragment reassembly slots and a Follower's
+// send buffer follow LEADER_MAX_MESSAGE, LEADER_REASSEMBLY_SLOTS and
+// LEADER_UPLOAD_SLOTS rather than the configured payload.
+//
+// Sizes are for the host ABI. Pointers and longs are 8 bytes here and 4 on
+// the ESP32, so the firmware figures are somewhat smaller; the differences
+// between configurations carry over.
+
+#include <LEADER.h>
+
+#include <cstdio>
+
+namespace {
+
+void row(const char *name, size_t total, size_t storage) {
+  std::printf("%-28s %8zu %8zu %8zu\n", name, total, storage,
+              total - storage);
+}
+
+template <class Config> void leader(const char *name) {
+  row(name, sizeof(BasicOSCLeader<Config>), sizeof(LeaderStorage<Config>));
+}
+
+template <class Config> void follower(const char *name) {
+  row(name, sizeof(BasicOSCFollower<Config>),
+      sizeof(FollowerStorage<Config>));
+}
+
+} // namespace
+
+int main() {
+  std::printf("%-28s %8s %8s %8s\n", "configuration", "bytes", "buffers",
+              "logic");
+
+  leader<LeaderDefaultConfig>("OSCLeader");
+  leader<LeaderConfig<LEADER_RX_QUEUE_SIZE, 128>>("Leader, 128 nodes");
+  leader<LeaderConfig<16>>("Leader, 16-frame queue");
+  leader<LeaderConfig<LEADER_RX_QUEUE_SIZE, LEADER_MAX_NODES,
+                      LEADER_MAX_PAYLOAD, FEATURE_ALL & ~FEATURE_REGISTRY>>(
+      "Leader, no registry");
+  leader<LeaderConfig<LEADER_RX_QUEUE_SIZE, LEADER_MAX_NODES,
+                      LEADER_MAX_PAYLOAD,
+                      FEATURE_ALL & ~(FEATURE_REGISTRY | FEATURE_COMPACT)>>(
+      "Leader, broadcast only");
+
+  follower<LeaderDefaultConfig>("OSCFollower");
+  follower<LeaderConfig<LEADER_RX_QUEUE_SIZE, LEADER_MAX_NODES,
+                        LEADER_MAX_PAYLOAD, FEATURE_ALL & ~FEATURE_USB>>(
+      "Follower, no USB");
+  follower<LeaderConfig<4, 1, LEADER_V1_PAYLOAD,
+                        FEATURE_COMPACT | FEATURE_STREAMS>>(
+      "Follower, lean (C3)");
+  follower<LeaderConfig<4, 1, LEADER_V1_PAYLOAD, 0>>("Follower, no features");
+
+  std::printf("\nshared: HostOutput %zu, HostInput %zu\n", sizeof(HostOutput),
+              sizeof(HostInput));
+  return 0;
+}
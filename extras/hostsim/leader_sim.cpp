@@ -0,0 +1,2235 @@
+// ==========================================
+// LEADER HOST SIMULATOR
+// ==========================================
+//
+// Load-tests OSCLeader and OSCFollower without hardware. The library sources
+// are compiled unchanged against the shims in shim/, and N virtual devices
+// share a simulated ESP-NOW medium with loss, latency, per-byte airtime,
+// CSMA contention and channels.
+//
+// Build from the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Iextras/hostsim/shim -Isrc src/*.cpp
+//       extras/hostsim/*.cpp -o leader-sim
+//
+// Run:
+//
+//   ./leader-sim                          # every scenario, default settings
+//   ./leader-sim --scenario storm --nodes 100 --loss 0.02
+//   ./leader-sim --max-p99 5000 --max-drop-pct 1   # exit 1 on regression
+//
+// Scenarios:
+//
+//   fanout  Host -> Leader -> N Followers broadcast stream
+//   fanin   N Followers streaming sensor values -> Leader -> host
+//   hop     fanout + fanin while the host forces a channel hop
+//   storm   N Followers heartbeating at the same rate (default 100 nodes)
+//   slotted storm with the Leader handing every node its own heartbeat slot
+//   polled  N knob-like sensors sent on every loop() poll (default 40 nodes)
+//   streams The same sensors through OSCFollower::addStream() with a
+//           deadband and a 1 Hz keep-alive
+//   doze    Host unicasts to power-save Followers (100 ms check-ins, 10 ms
+//           windows) through "/leader/send"
+//   beats   N Followers heartbeating every 100 ms (default 30 nodes); a tenth
+//           of them switch off halfway. Measures how fast the Leader reports
+//           them gone, and host traffic with heartbeats absorbed vs passed
+//           through
+//   peer    Each Follower messages its neighbour directly with sendTo(),
+//           mirrored to the Leader; compared with the same message bounced
+//           through the host and "/leader/send"
+//   shard   fanin from N nodes (default 80, at 25 Hz) with two sharded Leaders
+//           on channels 5 apart; the host sheds load from the busier one
+//           until their airtime evens out. Compared with one Leader
+//   cues    The host cues N nodes at 5 Hz and each answers at 2 Hz, next to
+//           a 50 Hz sensor stream, at 5% loss unless --loss is given; "/cue*"
+//           acknowledged and repeated vs best-effort. The row is the
+//           reliable cues
+//   chatty  N nodes pressing buttons at 5 Hz (default 10) next to one IMU
+//           at 1000 Hz (--rate), into a Leader that runs update() every
+//           10 ms; then with the IMU capped at 200 Hz. The row is the
+//           buttons
+//   compact N accelerometers (default 10) streaming ",fff" at 100 Hz
+//           (--rate), standard and through OSCFollower::addCompact() with
+//           16-bit steps and deltas; the row is the compact run
+//   failover fanin (default 10 nodes at 50 Hz) into a primary and a standby
+//           Leader that boots first; the primary goes silent halfway.
+//           Reports the takeover time, messages lost, the registry the
+//           standby mirrored and the nodes that re-bound to it
+//   relay   N nodes (default 12) in radio range of the Leader, of relay A
+//           only, or of relay B only (which hears A), on a line. The host
+//           broadcasts at 20 Hz (--rate) and every node streams back. The
+//           row is the broadcast; reports delivery per hop count,
+//           duplicates passed on and whether "/leader/routes" is right
+//   fragment The host broadcasts 700-byte blobs and N nodes (default 8)
+//           send 600-byte ones back at 10 Hz (--rate), at 2% loss unless
+//           --loss is given and with fragments reordered. Checks every
+//           byte, reports the reassemblers' timeouts and evictions, and
+//           feeds FrameReassembler reordered, lost and evicted fragments
+//           directly. The row is the broadcast
+//   mixed   N devices (default 9): Followers taking the build's largest
+//           frames, Followers built for 250 bytes on a v1 radio, and plain
+//           ESP-NOW v1 sketches that never answer a CAPS query. The host
+//           broadcasts 600-byte blobs and unicasts 900-byte ones at 5 Hz
+//           (--rate), and every Follower sends 900 bytes back. Build with
+//           -DESP_NOW_MAX_DATA_LEN_V2=1470 for the v2 side to differ
+//
+// Each reports delivered msgs/s, p50/p99 end-to-end latency in simulated us
+// and drops, plus collisions and channel utilisation from the radio model.
+
+#include "sim.h"
+
+#include <LEADER.h>
+#include <MiniOSC.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+
+namespace {
+
+struct Options {
+  std::string scenario = "all";
+  int nodes = 0;   ///< 0 = scenario default
+  double rate = 0; ///< 0 = scenario default
+  double seconds = 5;
+  uint8_t channel = 1;
+  long baud = 1000000;
+  uint32_t seed = 1;
+  sim::RadioConfig radio;
+  double maxP99 = 0;
+  double maxDropPct = -1;
+};
+
+struct Result {
+  std::string name;
+  int nodes = 0;
+  double seconds = 0;
+  uint64_t expected = 0;
+  uint64_t received = 0;
+  sim::Latency latency;
+  sim::RadioStats radio;
+  uint8_t channel = 1;
+  std::string note;
+
+  double dropPct() const {
+    return expected ? 100.0 * (expected - std::min(received, expected)) /
+                          expected
+                    : 0;
+  }
+};
+
+// ==========================================
+// Test Bench
+// ==========================================
+
+constexpr uint64_t BOOT_US = 500000;  ///< Binding and warm-up before measuring
+constexpr uint64_t DRAIN_US = 500000; ///< Lets in-flight traffic land
+
+/**
+ * @brief One simulated installation: a Leader on a host, N Followers.
+ */
+class Bench {
+public:
+  Bench(const Options &options)
+      : sim(options.radio, options.seed), _options(options) {
+    result.channel = options.channel;
+    _current = this;
+  }
+  ~Bench() { _current = nullptr; }
+
+  sim::Simulator sim;
+  sim::Device *leaderDev = nullptr; ///< The first Leader
+  std::vector<sim::Device *> leaderDevs;
+  std::vector<sim::Device *> followerDevs;
+  Result result;
+  size_t hostLeader = 0; ///< Leader whose host link delivered this frame
+
+  /// Called for every OSC frame a Follower hands to its onReceive callback
+  std::function<void(sim::Device &, const uint8_t *, int)> onFollowerReceive;
+  /// Called for every frame the Leader writes to the host
+  std::function<void(const uint8_t *, int)> onHostReceive;
+
+  /// Adds a Leader with its own host link; channel 0 = --channel
+  template <class Leader = OSCLeader>
+  OSCLeaderCore &addLeader(uint8_t channel = 0) {
+    sim::Device &dev = sim.addDevice();
+    if (!leaderDev)
+      leaderDev = &dev;
+    leaderDevs.push_back(&dev);
+    auto owned = std::make_shared<Leader>();
+    _leaders.push_back(owned);
+    OSCLeaderCore *leader = owned.get();
+    dev.leader = leader;
+    dev.usb.setBaud(_options.baud);
+
+    uint8_t home = channel ? channel : _options.channel;
+    sim.runOn(dev, [&] {
+      leader->begin(dev.usb.device, _options.baud, home, false);
+    });
+    dev.loop = [leader] { leader->update(); };
+
+    _hosts.push_back(std::make_unique<HostLink>());
+    _hosts.back()->out.begin(&dev.usb.host);
+    _hosts.back()->out.setPolicy(FLUSH_IMMEDIATE, 0);
+    if (_hosts.size() == 1)
+      sim.every(0, 50, [this] {
+        pollHost();
+        return true;
+      });
+    return *leader;
+  }
+
+  /// Adds a Follower; any LeaderConfig, e.g. a v1 payload in a v2 build
+  template <class Follower = OSCFollower> Follower &addFollower() {
+    sim::Device &dev = sim.addDevice();
+    auto owned = std::make_shared<Follower>();
+    _followers.push_back(owned);
+    Follower *follower = owned.get();
+    dev.follower = follower;
+    followerDevs.push_back(&dev);
+
+    sim.runOn(dev, [&] {
+      follower->begin(_options.channel, false);
+      follower->onReceive(followerCallback);
+    });
+    dev.loop = [follower] { follower->update(); };
+    return *follower;
+  }
+
+  void hostSend(const uint8_t *data, int len, size_t leader = 0) {
+    _hosts[leader]->out.writeFrame(data, len);
+    _hosts[leader]->out.flush();
+  }
+
+  /// Broadcasts a message a few times so every Follower binds to the Leader
+  void bindFollowers(const uint8_t *data, int len) {
+    std::vector<uint8_t> msg(data, data + len);
+    for (uint64_t t = 100000; t <= 200000; t += 50000)
+      sim.at(t, [this, msg] { hostSend(msg.data(), (int)msg.size()); });
+  }
+
+  void run(uint64_t endUs) {
+    sim.runUntil(endUs + DRAIN_US);
+    result.radio = sim.stats;
+  }
+
+private:
+  static void followerCallback(const uint8_t *data, int len) {
+    if (_current && _current->onFollowerReceive)
+      _current->onFollowerReceive(*_current->sim.current(), data, len);
+  }
+
+  void pollHost() {
+    for (size_t i = 0; i < _hosts.size(); i++) {
+      sim::Port &port = leaderDevs[i]->usb.host;
+      HostInput &in = _hosts[i]->in;
+      while (port.available() > 0) {
+        int frameLen = in.feed((uint8_t)port.read());
+        hostLeader = i;
+        if (frameLen > 0 && onHostReceive)
+          onHostReceive(in.data(), frameLen);
+      }
+    }
+  }
+
+  /// Host side of one Leader's serial link
+  struct HostLink {
+    HostOutput out;
+    HostInput in;
+  };
+
+  static Bench *_current;
+  const Options &_options;
+  std::vector<std::shared_ptr<void>> _leaders; ///< Any LeaderConfig
+  std::vector<std::shared_ptr<void>> _followers; ///< Any LeaderConfig
+  std::vector<std::unique_ptr<HostLink>> _hosts;
+};
+
+Bench *Bench::_current = nullptr;
+
+/// Builds "/bench/... ,ii seq stamp" with the current simulated time
+int packProbe(uint8_t *buffer, const char *address, int32_t seq) {
+  OSCValue vals[2];
+  vals[0].type = 'i';
+  vals[0].i = seq;
+  vals[1].type = 'i';
+  vals[1].i = (int32_t)(uint32_t)micros();
+  return MiniOSC::pack(buffer, address, vals, 2);
+}
+
+/// Records the latency of a probe if the frame is one
+bool readProbe(const uint8_t *data, int len, const char *address,
+               Result &result) {
+  OSCValue vals[2];
+  if (MiniOSC::extract(data, len, address, vals, 2) != 2)
+    return false;
+  result.received++;
+  result.latency.add((uint32_t)micros() - (uint32_t)vals[1].i);
+  return true;
+}
+
+uint64_t periodFor(double rate) {
+  return rate > 0 ? (uint64_t)(1e6 / rate) : 1000000;
+}
+
+// ==========================================
+// Scenarios
+// ==========================================
+
+void startFanout(Bench &bench, double rate, uint64_t start, uint64_t end,
+                 int receivers) {
+  auto seq = std::make_shared<int32_t>(0);
+  bench.sim.every(start, periodFor(rate), [&bench, seq, end, receivers] {
+    if (bench.sim.now() >= end)
+      return false;
+    uint8_t buffer[64];
+    int len = packProbe(buffer, "/bench/fanout", (*seq)++);
+    bench.hostSend(buffer, len);
+    bench.result.expected += receivers;
+    return true;
+  });
+}
+
+void startFanin(Bench &bench, double rate, uint64_t start, uint64_t end) {
+  uint64_t period = periodFor(rate);
+  for (size_t i = 0; i < bench.followerDevs.size(); i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    uint64_t phase = start + bench.sim.randomUint((uint32_t)period);
+    auto next = std::make_shared<uint64_t>(phase);
+    auto seq = std::make_shared<int32_t>(0);
+
+    dev.loop = [&bench, follower, next, seq, period, end] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      // Sensor nodes use the in-place builder, as a real sketch would
+      OSCFrame &frame = follower->beginFrame("/bench/sensor", "ii");
+      frame.addInt((*seq)++).addInt((int32_t)(uint32_t)now);
+      follower->commitFrame(frame);
+      bench.result.expected++;
+    };
+  }
+}
+
+void bindWithHello(Bench &bench) {
+  uint8_t buffer[32];
+  int len = MiniOSC::pack(buffer, "/bench/hello", nullptr, 0);
+  bench.bindFollowers(buffer, len);
+}
+
+Result runFanout(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 200;
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  bench.onFollowerReceive = [&bench](sim::Device &, const uint8_t *data,
+                                     int len) {
+    readProbe(data, len, "/bench/fanout", bench.result);
+  };
+
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  startFanout(bench, rate, BOOT_US, end, nodes);
+  bench.run(end);
+
+  bench.result.name = "fanout";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+Result runFanin(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 20;
+  double rate = options.rate > 0 ? options.rate : 50;
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  bench.onHostReceive = [&bench](const uint8_t *data, int len) {
+    readProbe(data, len, "/bench/sensor", bench.result);
+  };
+
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  startFanin(bench, rate, BOOT_US, end);
+  bench.run(end);
+
+  bench.result.name = "fanin";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+Result runHop(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 200;
+
+  // Foreign networks on the home channel make the scan pick another one
+  bench.sim.ambientNetworks[options.channel] = 3;
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  bench.onFollowerReceive = [&bench](sim::Device &, const uint8_t *data,
+                                     int len) {
+    readProbe(data, len, "/bench/fanout", bench.result);
+  };
+  bench.onHostReceive = [&bench](const uint8_t *data, int len) {
+    readProbe(data, len, "/bench/sensor", bench.result);
+  };
+
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  startFanout(bench, rate, BOOT_US, end, nodes);
+  startFanin(bench, 20, BOOT_US, end);
+
+  uint64_t hopAt = BOOT_US + (end - BOOT_US) / 3;
+  bench.sim.at(hopAt, [&bench] {
+    uint8_t buffer[32];
+    int len = MiniOSC::pack(buffer, "/leader/hop", nullptr, 0);
+    bench.hostSend(buffer, len);
+  });
+  bench.run(end);
+
+  int moved = 0;
+  for (sim::Device *dev : bench.followerDevs)
+    if (dev->channel == bench.leaderDev->channel)
+      moved++;
+  bench.result.note = "leader now on ch " +
+                      std::to_string(bench.leaderDev->channel) + ", " +
+                      std::to_string(moved) + "/" + std::to_string(nodes) +
+                      " followers with it";
+  bench.result.channel = bench.leaderDev->channel;
+  bench.result.name = "hop";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+Result runStormOnce(const Options &options, bool slotted) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 100;
+  double rate = options.rate > 0 ? options.rate : 10;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+
+  // Latency is measured on the pongs themselves, so let them through
+  bench.sim.runOn(*bench.leaderDev, [&bench] {
+    bench.leaderDev->leader->setHeartbeatPassThrough(true);
+  });
+
+  // "/sys/ping ,i interval" binds every Follower and starts its heartbeat
+  OSCValue interval;
+  interval.type = 'i';
+  interval.i = (int32_t)(1000.0 / rate);
+  uint8_t buffer[32];
+  int len = MiniOSC::pack(buffer, "/sys/ping", &interval, 1);
+  bench.bindFollowers(buffer, len);
+
+  // One slot per node across the heartbeat interval, once all are bound
+  if (slotted) {
+    bench.sim.at(250000, [&bench, nodes] {
+      OSCValue count;
+      count.type = 'i';
+      count.i = nodes;
+      uint8_t slots[32];
+      bench.hostSend(slots, MiniOSC::pack(slots, "/leader/slots", &count, 1));
+    });
+  }
+
+  // Heartbeats carry no timestamp: pair each with its node's latest send
+  std::vector<uint64_t> lastPong(bench.sim.deviceCount(), 0);
+  bench.sim.onSend = [&](sim::Device &dev, const uint8_t *data, size_t size) {
+    if (size > 9 && memcmp(data, "/sys/pong", 9) == 0) {
+      lastPong[dev.index] = bench.sim.now();
+      uint64_t now = bench.sim.now();
+      if (now >= BOOT_US && now < end)
+        bench.result.expected++;
+    }
+  };
+  bench.onHostReceive = [&](const uint8_t *data, int size) {
+    OSCValue id[1];
+    if (MiniOSC::extract(data, size, "/sys/pong", id, 1) != 1)
+      return;
+    int index = id[0].i - 1; // Node IDs come from the MAC: index + 1
+    if (index <= 0 || index >= (int)lastPong.size())
+      return;
+    uint64_t sentAt = lastPong[index];
+    if (sentAt < BOOT_US || sentAt >= end)
+      return;
+    bench.result.received++;
+    bench.result.latency.add(bench.sim.now() - sentAt);
+  };
+
+  bench.run(end);
+
+  bench.result.name = slotted ? "slotted" : "storm";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+/// Adds the share of heartbeats lost to collisions: the drop rate minus
+/// that of the same run on a radio where simultaneous frames never collide
+Result runStormCompared(const Options &options, bool slotted) {
+  Result result = runStormOnce(options, slotted);
+  if (!options.radio.collisions)
+    return result;
+  Options ideal = options;
+  ideal.radio.collisions = false;
+  Result baseline = runStormOnce(ideal, slotted);
+
+  char note[160];
+  snprintf(note, sizeof(note),
+           "collision-attributable loss %.2f%% (%.2f%% drops without "
+           "collisions)",
+           std::max(0.0, result.dropPct() - baseline.dropPct()),
+           baseline.dropPct());
+  result.note = note;
+  return result;
+}
+
+Result runStorm(const Options &options) {
+  return runStormCompared(options, false);
+}
+Result runSlotted(const Options &options) {
+  return runStormCompared(options, true);
+}
+
+// ------------------------------------------
+// Sensor nodes: hand-rolled polling vs streams
+// ------------------------------------------
+
+/**
+ * @brief A knob per node: still most of the time, with sensor noise below
+ * the deadband, and a half-second gesture every few seconds.
+ */
+class Knobs {
+public:
+  static constexpr float NOISE = 0.002f;
+  static constexpr float DEADBAND = 0.01f;
+
+  Knobs(sim::Simulator &s, int count, uint64_t end) : _sim(s) {
+    _gestures.resize(count + 1);
+    for (int i = 0; i <= count; i++)
+      for (uint64_t t = s.randomUint(3000000); t < end;
+           t += 2000000 + s.randomUint(4000000))
+        _gestures[i].push_back(t);
+    _current = this;
+  }
+  ~Knobs() { _current = nullptr; }
+
+  /// True value of node i's knob at time t, noise excluded
+  float value(int i, uint64_t t) const {
+    float level = 0.5f;
+    const std::vector<uint64_t> &starts = _gestures[i];
+    for (size_t k = 0; k < starts.size() && starts[k] <= t; k++) {
+      float target = (k + i) % 2 ? 0.2f : 0.8f;
+      float phase = std::min(1.0f, (t - starts[k]) / 500000.0f);
+      level += (target - level) * phase;
+    }
+    return level;
+  }
+
+  /// What the node's ADC reads right now
+  float read(int i) {
+    return value(i, _sim.now()) + (_sim.randomUnit() * 2 - 1) * NOISE;
+  }
+
+  /// StreamSource for whichever node is sampling
+  static float source() {
+    sim::Device *dev = _current->_sim.current();
+    return _current->read(dev->index);
+  }
+
+private:
+  sim::Simulator &_sim;
+  std::vector<std::vector<uint64_t>> _gestures;
+  static Knobs *_current;
+};
+
+Knobs *Knobs::_current = nullptr;
+
+Result runSensors(const Options &options, bool streams) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 40;
+  double rate = options.rate > 0 ? options.rate : 50;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+
+  bench.addLeader();
+  std::vector<std::string> addresses;
+  for (int i = 0; i < nodes; i++)
+    addresses.push_back("/bench/knob/" + std::to_string(i + 1));
+  Knobs knobs(bench.sim, nodes + 1, end);
+
+  for (int i = 0; i < nodes; i++) {
+    OSCFollower &follower = bench.addFollower();
+    sim::Device &dev = *bench.followerDevs.back();
+    const char *address = addresses[i].c_str();
+    if (streams) {
+      // Keep-alive once a second, otherwise only moves beyond the deadband
+      bench.sim.runOn(dev, [&] {
+        follower.addStream(address, Knobs::source, 1, rate, Knobs::DEADBAND);
+      });
+      continue;
+    }
+    // The usual sketch: poll in loop() and send every reading
+    uint64_t period = periodFor(rate);
+    auto next = std::make_shared<uint64_t>(
+        BOOT_US + bench.sim.randomUint((uint32_t)period));
+    OSCFollower *f = &follower;
+    dev.loop = [f, next, period, address, &knobs, &dev] {
+      f->update();
+      if (micros() < *next)
+        return;
+      *next += period;
+      OSCFrame &frame = f->beginFrame(address, "f");
+      frame.addFloat(knobs.read(dev.index));
+      f->commitFrame(frame);
+    };
+  }
+  bindWithHello(bench);
+
+  // Host view of every knob; sampled each ms against the true value
+  std::vector<float> seen(bench.sim.deviceCount(), 0.5f);
+  uint64_t probes = 0, stale = 0;
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    if (len < 13 || memcmp(data, "/bench/knob/", 12) != 0)
+      return;
+    int index = atoi((const char *)data + 12); // Node i is device i
+    OSCValue v[1];
+    if (index <= 0 || index >= (int)seen.size() ||
+        MiniOSC::extract(data, len, (const char *)data, v, 1) != 1)
+      return;
+    seen[index] = v[0].f;
+    uint64_t now = bench.sim.now();
+    if (now >= BOOT_US && now < end)
+      bench.result.received++;
+  };
+  bench.sim.every(BOOT_US, 1000, [&] {
+    uint64_t now = bench.sim.now();
+    for (size_t i = 1; i < seen.size(); i++) {
+      probes++;
+      if (std::fabs(seen[i] - knobs.value((int)i, now)) > 2 * Knobs::DEADBAND)
+        stale++;
+    }
+    return now + 1000 < end;
+  });
+
+  bench.run(end);
+
+  // Unchanged samples are meant to go unsent: count only what was sent
+  bench.result.expected = bench.result.received;
+  char note[96];
+  snprintf(note, sizeof(note),
+           "host view off by more than 2x deadband %.2f%% of the time",
+           100.0 * stale / std::max<uint64_t>(probes, 1));
+  bench.result.note = note;
+  bench.result.name = streams ? "streams" : "polled";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+Result runPolled(const Options &options) { return runSensors(options, false); }
+Result runStreams(const Options &options) { return runSensors(options, true); }
+
+// ------------------------------------------
+// Power-save Followers
+// ------------------------------------------
+
+Result runDoze(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 5;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  const uint16_t intervalMs = 100, windowMs = 10;
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++) {
+    OSCFollower &follower = bench.addFollower();
+    bench.sim.runOn(*bench.followerDevs.back(), [&] {
+      follower.enablePowerSave(intervalMs, windowMs);
+    });
+  }
+  bindWithHello(bench);
+
+  bench.onFollowerReceive = [&bench](sim::Device &, const uint8_t *data,
+                                     int len) {
+    readProbe(data, len, "/bench/doze", bench.result);
+  };
+
+  // The host unicasts a probe to every node through "/leader/send"
+  uint64_t period = periodFor(rate * nodes);
+  auto seq = std::make_shared<int32_t>(0);
+  bench.sim.every(BOOT_US, period, [&bench, seq, nodes, end] {
+    uint8_t probe[64];
+    int32_t n = (*seq)++;
+    OSCValue args[2];
+    args[0].type = 'i';
+    args[0].i = n % nodes + 2; // Device index + 1; device 0 is the Leader
+    args[1].type = 'b';
+    args[1].s = (const char *)probe;
+    args[1].len = packProbe(probe, "/bench/doze", n);
+    uint8_t buffer[128];
+    bench.hostSend(buffer, MiniOSC::pack(buffer, "/leader/send", args, 2));
+    bench.result.expected++;
+    return bench.sim.now() + 1 < end;
+  });
+
+  // Radio-on time as the radio model saw it, over the measured period
+  std::vector<uint64_t> dozedAtBoot(bench.followerDevs.size());
+  auto dozed = [&bench](sim::Device &dev) {
+    return dev.dozedUs +
+           (dev.dozing ? dev.sleepUs(dev.dozeStart, bench.sim.now()) : 0);
+  };
+  bench.sim.at(BOOT_US, [&] {
+    for (size_t i = 0; i < bench.followerDevs.size(); i++)
+      dozedAtBoot[i] = dozed(*bench.followerDevs[i]);
+  });
+
+  int32_t holdP50 = 0, holdP99 = 0, expired = 0;
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[6];
+    if (MiniOSC::extract(data, len, "/sys/holdtime", v, 6) == 6) {
+      expired = v[1].i;
+      holdP50 = v[3].i;
+      holdP99 = v[5].i;
+    }
+  };
+  bench.sim.at(end + DRAIN_US / 2, [&bench] {
+    uint8_t buffer[32];
+    bench.hostSend(buffer, MiniOSC::pack(buffer, "/leader/powersave", nullptr, 0));
+  });
+
+  bench.run(end);
+
+  double measured = (double)(bench.sim.now() - BOOT_US);
+  double radioAwake = 0, reported = 0;
+  for (size_t i = 0; i < bench.followerDevs.size(); i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    radioAwake += 1.0 - (dozed(dev) - dozedAtBoot[i]) / measured;
+    reported += dev.follower->awakeRatio();
+  }
+  char note[160];
+  snprintf(note, sizeof(note),
+           "awake %.1f%% (radio model), %.1f%% (scheduled); leader hold "
+           "p50 %d us p99 %d us, %d expired",
+           100.0 * radioAwake / nodes, 100.0 * reported / nodes, holdP50,
+           holdP99, expired);
+  bench.result.note = note;
+  bench.result.name = "doze";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+// ------------------------------------------
+// Heartbeats absorbed by the Leader
+// ------------------------------------------
+
+struct HostTraffic {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  int registryNodes = -1; ///< Nodes in the "/sys/nodes" reply
+  int registryBytes = 0;
+};
+
+HostTraffic runBeatsOnce(const Options &options, int nodes, bool passThrough,
+                         Result *result) {
+  Bench bench(options);
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  uint64_t offAt = BOOT_US + (end - BOOT_US) / 2;
+  int leaving = std::max(1, nodes / 10);
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bench.sim.runOn(*bench.leaderDev, [&bench, passThrough] {
+    bench.leaderDev->leader->setHeartbeatPassThrough(passThrough);
+  });
+
+  OSCValue interval;
+  interval.type = 'i';
+  interval.i = 100;
+  uint8_t buffer[32];
+  int len = MiniOSC::pack(buffer, "/sys/ping", &interval, 1);
+  bench.bindFollowers(buffer, len);
+
+  // The last nodes switch off halfway through
+  bench.sim.at(offAt, [&bench, leaving] {
+    for (int i = 0; i < leaving; i++)
+      bench.followerDevs[bench.followerDevs.size() - 1 - i]->radioOn = false;
+  });
+
+  HostTraffic traffic;
+  Result &r = bench.result;
+  r.expected = nodes + leaving;
+  bench.onHostReceive = [&](const uint8_t *data, int size) {
+    uint64_t now = bench.sim.now();
+    if (now >= BOOT_US && now < end) {
+      traffic.frames++;
+      traffic.bytes += size;
+    }
+    OSCValue v[96];
+    if (size > 11 && memcmp(data, "/sys/nodes", 11) == 0) {
+      traffic.registryNodes =
+          MiniOSC::extract(data, size, "/sys/nodes", v, 96) / 3;
+      traffic.registryBytes = size;
+    } else if (MiniOSC::extract(data, size, "/sys/join", v, 1) == 1) {
+      r.received++;
+    } else if (MiniOSC::extract(data, size, "/sys/leave", v, 2) == 2) {
+      r.received++;
+      r.latency.add(now - offAt);
+    }
+  };
+
+  // Ask for the whole registry once traffic has settled
+  bench.sim.at(end + DRAIN_US / 2, [&bench] {
+    uint8_t query[32];
+    bench.hostSend(query, MiniOSC::pack(query, "/leader/nodes", nullptr, 0));
+  });
+
+  bench.run(end);
+  if (result)
+    *result = bench.result;
+  return traffic;
+}
+
+Result runBeats(const Options &options) {
+  int nodes = options.nodes > 0 ? options.nodes : 30;
+  Result result;
+  HostTraffic absorbed = runBeatsOnce(options, nodes, false, &result);
+  HostTraffic passed = runBeatsOnce(options, nodes, true, nullptr);
+
+  char note[200];
+  snprintf(note, sizeof(note),
+           "host frames/s absorbed %.1f (%.0f B/s), pass-through %.1f "
+           "(%.0f B/s); latency = leave detection; /leader/nodes: %d nodes "
+           "in one %d-byte message",
+           absorbed.frames / options.seconds, absorbed.bytes / options.seconds,
+           passed.frames / options.seconds, passed.bytes / options.seconds,
+           absorbed.registryNodes, absorbed.registryBytes);
+  result.note = note;
+  result.name = "beats";
+  result.nodes = nodes;
+  return result;
+}
+
+// ------------------------------------------
+// Follower-to-Follower messaging
+// ------------------------------------------
+
+Result runPeer(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 20;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  uint64_t period = periodFor(rate);
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+
+  // Node i talks to node i + 1, once directly and once through the host.
+  // Follower i is device i + 1, so its node ID is i + 2.
+  std::vector<std::string> echoAddresses;
+  for (int i = 0; i < nodes; i++)
+    echoAddresses.push_back("/bench/echo/" +
+                            std::to_string((i + 1) % nodes + 2));
+  Result echo;
+  for (int i = 0; i < nodes; i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    bench.sim.runOn(dev, [&] { follower->enablePeering(1, true); });
+
+    uint32_t target = (i + 1) % nodes + 2;
+    const char *echoAddress = echoAddresses[i].c_str();
+    auto next = std::make_shared<uint64_t>(
+        BOOT_US + bench.sim.randomUint((uint32_t)period));
+    auto seq = std::make_shared<int32_t>(0);
+    dev.loop = [&bench, &echo, follower, next, seq, period, end, target,
+                echoAddress] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      uint8_t buffer[64];
+      int len = packProbe(buffer, "/bench/peer", *seq);
+      follower->sendTo(target, buffer, len);
+      bench.result.expected++;
+      len = packProbe(buffer, echoAddress, (*seq)++);
+      follower->send(buffer, len);
+      echo.expected++;
+    };
+  }
+  bindWithHello(bench);
+
+  bench.onFollowerReceive = [&](sim::Device &, const uint8_t *data, int len) {
+    if (len > 12 && memcmp(data, "/bench/echo/", 12) == 0)
+      readProbe(data, len, (const char *)data, echo);
+    else
+      readProbe(data, len, "/bench/peer", bench.result);
+  };
+
+  // The host bounces echo probes to their target; mirrors are only counted
+  uint64_t mirrored = 0;
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    if (len > 9 && memcmp(data, "/sys/peer", 9) == 0) {
+      mirrored++;
+      return;
+    }
+    if (len < 13 || memcmp(data, "/bench/echo/", 12) != 0)
+      return;
+    OSCValue args[2];
+    args[0].type = 'i';
+    args[0].i = atoi((const char *)data + 12);
+    args[1].type = 'b';
+    args[1].s = (const char *)data;
+    args[1].len = len;
+    uint8_t buffer[128];
+    bench.hostSend(buffer, MiniOSC::pack(buffer, "/leader/send", args, 2));
+  };
+
+  bench.run(end);
+
+  char note[160];
+  snprintf(note, sizeof(note),
+           "via host: p50 %u us p99 %u us, %.2f%% drops; %llu mirrors "
+           "reported",
+           echo.latency.percentile(0.50), echo.latency.percentile(0.99),
+           echo.dropPct(), (unsigned long long)mirrored);
+  bench.result.note = note;
+  bench.result.name = "peer";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+// ------------------------------------------
+// Channel sharding across two Leaders
+// ------------------------------------------
+
+/// Large installations need a registry beyond the default 32 nodes
+using ShardLeader = BasicOSCLeader<LeaderConfig<LEADER_RX_QUEUE_SIZE, 128>>;
+
+struct ShardReport {
+  int shard = 0;
+  int channel = 0;
+  int nodes = 0;
+  int air = -1; ///< Permille, -1 until reported this round
+};
+
+/**
+ * @brief Fan-in from every node, first on one Leader's channel; with two
+ * shards, the host moves load to the second Leader until their airtime
+ * evens out, as extras/leader-bridge --balance does.
+ */
+Result runShardOnce(const Options &options, int nodes, double rate,
+                    int shards, std::string *note) {
+  Bench bench(options);
+  uint64_t settle = BOOT_US + 3000000; ///< Balancing before measuring
+  uint64_t end = settle + (uint64_t)(options.seconds * 1e6);
+  uint8_t channels[2] = {options.channel,
+                         (uint8_t)(options.channel > 8 ? options.channel - 5
+                                                       : options.channel + 5)};
+
+  for (int i = 0; i < shards; i++) {
+    OSCLeaderCore &leader = bench.addLeader<ShardLeader>(channels[i]);
+    if (shards > 1)
+      bench.sim.runOn(*bench.leaderDevs[i],
+                      [&leader, i] { leader.enableSharding(i + 1); });
+  }
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+
+  // Heartbeats give every node the ID the Leaders move it by
+  OSCValue interval;
+  interval.type = 'i';
+  interval.i = 500;
+  uint8_t buffer[32];
+  bench.bindFollowers(buffer, MiniOSC::pack(buffer, "/sys/ping", &interval, 1));
+
+  std::vector<ShardReport> reports(shards);
+  int moved = 0;
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[6];
+    if (MiniOSC::extract(data, len, "/sys/shard", v, 6) == 6) {
+      ShardReport &r = reports[bench.hostLeader];
+      r.shard = v[0].i;
+      r.channel = v[1].i;
+      r.nodes = v[2].i;
+      r.air = v[3].i;
+    } else if (MiniOSC::extract(data, len, "/sys/moved", v, 3) == 3) {
+      moved++;
+    } else {
+      readProbe(data, len, "/bench/sensor", bench.result);
+    }
+  };
+
+  // Poll both shards; shed half the gap from the busier one when they
+  // differ by more than 5 points, then let the moved nodes show up in the
+  // other shard's report before judging again
+  auto poll = [&bench, shards] {
+    uint8_t query[32];
+    int len = MiniOSC::pack(query, "/leader/shard", nullptr, 0);
+    for (int i = 0; i < shards; i++)
+      bench.hostSend(query, len, i);
+  };
+  int cooldown = 0;
+  bench.sim.every(BOOT_US, 250000, [&, shards, settle] {
+    if (cooldown > 0) {
+      cooldown--;
+    } else if (shards > 1 && reports[0].air >= 0 && reports[1].air >= 0) {
+      int busy = reports[0].air > reports[1].air ? 0 : 1;
+      int gap = reports[busy].air - reports[1 - busy].air;
+      if (gap > 50) {
+        OSCValue args[3];
+        args[0].type = args[1].type = args[2].type = 'i';
+        args[0].i = reports[1 - busy].channel;
+        args[1].i = reports[1 - busy].shard;
+        args[2].i = gap / 2;
+        uint8_t shed[64];
+        bench.hostSend(shed, MiniOSC::pack(shed, "/leader/shard/shed", args, 3),
+                       busy);
+        cooldown = 1;
+      }
+    }
+    for (ShardReport &r : reports)
+      r.air = -1;
+    poll();
+    return bench.sim.now() + 1 < settle;
+  });
+
+  startFanin(bench, rate, BOOT_US, end);
+  bench.sim.at(settle, [&] {
+    bench.result.expected = 0;
+    bench.result.received = 0;
+    bench.result.latency = sim::Latency();
+    poll(); // Opens the measured window of the final report
+  });
+  bench.sim.at(end, poll);
+  bench.run(end);
+
+  if (note) {
+    char text[200];
+    int len = 0;
+    for (int i = 0; i < shards; i++)
+      len += snprintf(text + len, sizeof(text) - len,
+                      "shard %d ch %d: %d nodes, %.1f%% air; ", reports[i].shard,
+                      reports[i].channel, reports[i].nodes,
+                      reports[i].air / 10.0);
+    snprintf(text + len, sizeof(text) - len, "%d moved", moved);
+    *note = text;
+  }
+  bench.result.seconds = options.seconds;
+  return bench.result;
+}
+
+Result runShard(const Options &options) {
+  int nodes = options.nodes > 0 ? options.nodes : 80;
+  double rate = options.rate > 0 ? options.rate : 25;
+  std::string shardNote;
+  Result single = runShardOnce(options, nodes, rate, 1, nullptr);
+  Result result = runShardOnce(options, nodes, rate, 2, &shardNote);
+
+  char note[360];
+  snprintf(note, sizeof(note),
+           "%s\n         one Leader: %.1f msgs/s, p99 %u us, %.2f%% drops",
+           shardNote.c_str(), single.received / options.seconds,
+           single.latency.percentile(0.99), single.dropPct());
+  result.note = note;
+  result.name = "shard";
+  result.nodes = nodes;
+  return result;
+}
+
+// ------------------------------------------
+// Acknowledged cues over a lossy channel
+// ------------------------------------------
+
+struct CueRun {
+  Result down;             ///< Host cues reaching each node
+  Result up;               ///< Node hits reaching the host
+  Result stream;           ///< Background sensor stream
+  uint64_t duplicates = 0; ///< Cues or hits passed on more than once
+  int retransmits = 0;     ///< Repeated frames, both directions
+  int failed = 0;          ///< Deliveries given up, both directions
+};
+
+/**
+ * @brief The host cues every node at 5 Hz and every node reports a hit at
+ * 2 Hz next to its sensor stream, with "/cue/" marked reliable on both
+ * sides or not at all.
+ */
+CueRun runCuesOnce(const Options &options, int nodes, double rate,
+                   bool reliable) {
+  Bench bench(options);
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  const uint64_t cuePeriod = 200000, hitPeriod = 500000;
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  if (reliable) {
+    OSCLeaderCore *leader = bench.leaderDev->leader;
+    bench.sim.runOn(*bench.leaderDev, [leader] { leader->addReliable("/cue*"); });
+    for (sim::Device *dev : bench.followerDevs)
+      bench.sim.runOn(*dev, [dev] { dev->follower->addReliable("/cue*"); });
+  }
+  bindWithHello(bench);
+
+  // Hits ride on top of the fan-in loop; their sequence numbers carry the
+  // node so the host can tell repeats apart
+  CueRun run;
+  startFanin(bench, rate, BOOT_US, end);
+  for (size_t i = 0; i < bench.followerDevs.size(); i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    auto fanin = dev.loop;
+    auto next = std::make_shared<uint64_t>(
+        BOOT_US + bench.sim.randomUint((uint32_t)hitPeriod));
+    auto seq = std::make_shared<int32_t>((int32_t)i << 20);
+    dev.loop = [&run, follower, fanin, next, seq, end, hitPeriod] {
+      fanin();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += hitPeriod;
+      uint8_t buffer[64];
+      follower->send(buffer, packProbe(buffer, "/cue/hit", (*seq)++));
+      run.up.expected++;
+    };
+  }
+
+  auto seq = std::make_shared<int32_t>(0);
+  bench.sim.every(BOOT_US, cuePeriod, [&bench, &run, seq, nodes, end] {
+    uint8_t buffer[64];
+    bench.hostSend(buffer, packProbe(buffer, "/cue/go", (*seq)++));
+    run.down.expected += nodes;
+    return bench.sim.now() + cuePeriod < end;
+  });
+
+  // A cue or hit reaching the application twice counts as a duplicate
+  std::set<std::pair<const void *, int32_t>> seen;
+  auto deliver = [&](const void *receiver, const uint8_t *data, int len,
+                     const char *address, Result &result) {
+    OSCValue v[2];
+    if (MiniOSC::extract(data, len, address, v, 2) != 2)
+      return false;
+    if (seen.insert({receiver, v[0].i}).second)
+      readProbe(data, len, address, result);
+    else
+      run.duplicates++;
+    return true;
+  };
+  bench.onFollowerReceive = [&](sim::Device &dev, const uint8_t *data,
+                                int len) {
+    deliver(&dev, data, len, "/cue/go", run.down);
+  };
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[8];
+    if (MiniOSC::extract(data, len, "/sys/reliable", v, 8) == 8) {
+      run.retransmits += v[2].i;
+      run.failed += v[3].i;
+    } else if (!deliver(nullptr, data, len, "/cue/hit", run.up)) {
+      readProbe(data, len, "/bench/sensor", bench.result);
+    }
+  };
+  bench.sim.at(end + DRAIN_US / 2, [&bench] {
+    uint8_t query[32];
+    bench.hostSend(query, MiniOSC::pack(query, "/leader/reliable", nullptr, 0));
+  });
+
+  bench.run(end);
+  for (sim::Device *dev : bench.followerDevs) {
+    run.retransmits += dev->follower->reliableRetransmitCount();
+    run.failed += dev->follower->reliableFailedCount();
+  }
+  run.stream = bench.result;
+  return run;
+}
+
+Result runCues(const Options &options) {
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 50;
+  Options lossy = options;
+  if (lossy.radio.loss == 0)
+    lossy.radio.loss = 0.05; // Nothing to recover from on a perfect channel
+  CueRun plain = runCuesOnce(lossy, nodes, rate, false);
+  CueRun acked = runCuesOnce(lossy, nodes, rate, true);
+
+  char note[400];
+  snprintf(note, sizeof(note),
+           "%.0f%% loss; reliable: hits %.2f%% drops p99 %u us, %d "
+           "retransmits, %d failed, %llu duplicates passed on, stream "
+           "%.2f%% drops\n         best-effort: cues %.2f%% drops p99 %u "
+           "us, hits %.2f%% drops, stream %.2f%% drops",
+           lossy.radio.loss * 100, acked.up.dropPct(),
+           acked.up.latency.percentile(0.99), acked.retransmits, acked.failed,
+           (unsigned long long)acked.duplicates, acked.stream.dropPct(),
+           plain.down.dropPct(), plain.down.latency.percentile(0.99),
+           plain.up.dropPct(), plain.stream.dropPct());
+  Result result = acked.down;
+  result.radio = acked.stream.radio;
+  result.note = note;
+  result.name = "cues";
+  result.nodes = nodes;
+  return result;
+}
+
+// ------------------------------------------
+// One chatty node among quiet ones
+// ------------------------------------------
+
+struct ChattyRun {
+  Result quiet;            ///< Button-like nodes reaching the host
+  uint64_t imuSent = 0;    ///< Frames the chatty node sent
+  uint64_t imuReceived = 0;
+  int64_t imuCapped = 0;   ///< From "/sys/rx"
+  int64_t imuOverflow = 0; ///< From "/sys/rx"
+  int64_t quietOverflow = 0; ///< From "/sys/rx", all button nodes
+};
+
+/**
+ * @brief N nodes press a button at 5 Hz while one IMU streams at rate Hz,
+ * into a Leader whose sketch only gets to update() every 10 ms; the IMU
+ * alone fills the receive queue between two calls. Optionally caps the
+ * IMU through "/leader/rx/cap".
+ */
+ChattyRun runChattyOnce(const Options &options, int nodes, double rate,
+                        int cap) {
+  Bench bench(options);
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+
+  bench.addLeader();
+  bench.leaderDev->loopPeriodUs = 10000;
+  for (int i = 0; i < nodes + 1; i++)
+    bench.addFollower();
+
+  bindWithHello(bench);
+
+  // Its heartbeat gives the IMU the ID it is capped by
+  const uint32_t imuID = 4242;
+  ChattyRun run;
+  sim::Device &imuDev = *bench.followerDevs.back();
+  bench.followerDevs.pop_back();
+  startFanin(bench, 5, BOOT_US, end);
+  OSCFollowerCore *imu = imuDev.follower;
+  bench.sim.runOn(imuDev, [imu, imuID] { imu->enableHeartbeat(100, imuID); });
+  uint64_t period = periodFor(rate);
+  auto next = std::make_shared<uint64_t>(BOOT_US);
+  auto seq = std::make_shared<int32_t>(0);
+  imuDev.loop = [&run, imu, next, seq, period, end] {
+    imu->update();
+    uint64_t now = micros();
+    if (now < *next || now >= end)
+      return;
+    *next += period;
+    uint8_t frame[64];
+    imu->send(frame, packProbe(frame, "/bench/imu", (*seq)++));
+    run.imuSent++;
+  };
+
+  if (cap > 0)
+    bench.sim.at(BOOT_US - 50000, [&bench, imuID, cap] {
+      OSCValue v[2];
+      v[0].type = 'i';
+      v[0].i = imuID;
+      v[1].type = 'i';
+      v[1].i = cap;
+      uint8_t msg[48];
+      bench.hostSend(msg, MiniOSC::pack(msg, "/leader/rx/cap", v, 2));
+    });
+
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    if (len >= 8 && memcmp(data, "/sys/rx", 8) == 0) {
+      OSCValue v[4 * 32];
+      int count = MiniOSC::extract(data, len, "/sys/rx", v, 4 * 32);
+      for (int i = 0; i + 3 < count; i += 4) {
+        if ((uint32_t)v[i].i == imuID) {
+          run.imuCapped += v[i + 2].i;
+          run.imuOverflow += v[i + 3].i;
+        } else {
+          run.quietOverflow += v[i + 3].i;
+        }
+      }
+      return;
+    }
+    OSCValue probe[2];
+    if (MiniOSC::extract(data, len, "/bench/imu", probe, 2) == 2)
+      run.imuReceived++;
+    else
+      readProbe(data, len, "/bench/sensor", bench.result);
+  };
+  bench.sim.at(end + DRAIN_US / 2, [&bench] {
+    uint8_t query[32];
+    bench.hostSend(query, MiniOSC::pack(query, "/leader/rx", nullptr, 0));
+  });
+
+  bench.run(end);
+  run.quiet = bench.result;
+  return run;
+}
+
+Result runChatty(const Options &options) {
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 1000;
+  ChattyRun open = runChattyOnce(options, nodes, rate, 0);
+  ChattyRun capped = runChattyOnce(options, nodes, rate, 200);
+
+  auto pct = [](uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+  };
+  char note[400];
+  snprintf(note, sizeof(note),
+           "imu at %.0f Hz: %.1f%% to host, %lld overflowed (buttons %lld); "
+           "capped at 200 Hz: %.1f%% to host, %lld capped, %lld overflowed, "
+           "quiet p99 %u us, %.2f%% drops",
+           rate, pct(open.imuReceived, open.imuSent),
+           (long long)open.imuOverflow, (long long)open.quietOverflow,
+           pct(capped.imuReceived, capped.imuSent),
+           (long long)capped.imuCapped, (long long)capped.imuOverflow,
+           capped.quiet.latency.percentile(0.99), capped.quiet.dropPct());
+  Result result = open.quiet;
+  result.note = note;
+  result.name = "chatty";
+  result.nodes = nodes;
+  return result;
+}
+
+// ------------------------------------------
+// Compact IMU streams
+// ------------------------------------------
+
+struct CompactRun {
+  Result imu;
+  double maxError = 0;   ///< Largest difference from the value sent
+  uint64_t sent = 0;     ///< Compact frames sent
+  uint64_t saved = 0;    ///< Bytes they saved
+};
+
+/**
+ * @brief Every node streams "/bench/accel/<n> ,fff" at rate Hz, either
+ * standard or as 16-bit compact steps of [-16, 16] with deltas. x counts
+ * frames in 0.05 steps, so the host can tell which one arrived and time it.
+ */
+CompactRun runCompactOnce(const Options &options, int nodes, double rate,
+                          bool compact) {
+  Bench bench(options);
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  uint64_t period = periodFor(rate);
+
+  bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  auto axes = [](int32_t seq, float *v) {
+    v[0] = (seq % 64 - 32) * 0.05f;
+    v[1] = 4 * sinf(seq * 0.01f);
+    v[2] = 9.81f + 0.1f * sinf(seq * 0.3f);
+  };
+
+  CompactRun run;
+  struct Track {
+    uint64_t sentAt[64] = {};
+    int32_t last = -1;
+  };
+  std::vector<Track> tracks(nodes);
+  for (int i = 0; i < nodes; i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    char address[32];
+    snprintf(address, sizeof(address), "/bench/accel/%d", i);
+    std::string addr = address;
+    if (compact)
+      bench.sim.runOn(dev, [follower, addr] {
+        follower->addCompact(addr.c_str(), "fff", -16, 16, 16, true);
+      });
+
+    auto next = std::make_shared<uint64_t>(
+        BOOT_US + bench.sim.randomUint((uint32_t)period));
+    Track *track = &tracks[i];
+    dev.loop = [&bench, follower, next, track, addr, period, end, axes] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      int32_t seq = ++track->last;
+      float v[3];
+      axes(seq, v);
+      OSCFrame &frame = follower->beginFrame(addr.c_str(), "fff");
+      frame.addFloat(v[0]).addFloat(v[1]).addFloat(v[2]);
+      follower->commitFrame(frame);
+      track->sentAt[seq % 64] = now;
+      bench.result.expected++;
+    };
+  }
+
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    int node;
+    if (len < 14 || sscanf((const char *)data, "/bench/accel/%d", &node) != 1 ||
+        node < 0 || node >= nodes)
+      return;
+    OSCValue v[3];
+    if (MiniOSC::extract(data, len, (const char *)data, v, 3) != 3 ||
+        v[0].type != 'f')
+      return;
+    // The latest frame sent with this x
+    Track &track = tracks[node];
+    int32_t k = (int32_t)lroundf(v[0].f / 0.05f) + 32;
+    int32_t seq = track.last - (((track.last - k) % 64) + 64) % 64;
+    if (seq < 0)
+      return;
+    float sent[3];
+    axes(seq, sent);
+    for (int a = 0; a < 3; a++)
+      run.maxError = std::max(run.maxError, (double)fabsf(v[a].f - sent[a]));
+    bench.result.received++;
+    bench.result.latency.add((uint32_t)(micros() - track.sentAt[seq % 64]));
+  };
+
+  bench.run(end);
+  for (sim::Device *dev : bench.followerDevs) {
+    run.sent += dev->follower->compactSentCount();
+    run.saved += dev->follower->compactSavedBytes();
+  }
+  run.imu = bench.result;
+  return run;
+}
+
+Result runCompact(const Options &options) {
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 100;
+  CompactRun plain = runCompactOnce(options, nodes, rate, false);
+  CompactRun packed = runCompactOnce(options, nodes, rate, true);
+
+  double seconds = options.seconds + (BOOT_US + DRAIN_US) / 1e6;
+  auto util = [&](const CompactRun &r) {
+    return 100.0 * r.imu.radio.airtimeUs[options.channel] / (seconds * 1e6);
+  };
+  uint8_t sample[64];
+  OSCValue zero[3] = {};
+  for (OSCValue &v : zero)
+    v.type = 'f';
+  int standard = MiniOSC::pack(sample, "/bench/accel/0", zero, 3);
+  double bytes =
+      packed.sent ? standard - (double)packed.saved / packed.sent : standard;
+  char note[400];
+  snprintf(note, sizeof(note),
+           "standard: %d B per message, util %.1f%%, %.2f%% drops, p99 %u "
+           "us\n         compact: %.1f B per message (%.1fx smaller), util "
+           "%.1f%%, largest error %.5f",
+           standard, util(plain), plain.imu.dropPct(),
+           plain.imu.latency.percentile(0.99), bytes, standard / bytes,
+           util(packed), packed.maxError);
+  Result result = packed.imu;
+  result.note = note;
+  result.name = "compact";
+  result.nodes = nodes;
+  return result;
+}
+
+// ------------------------------------------
+// Hot-standby failover
+// ------------------------------------------
+
+/**
+ * @brief fanin into a primary and a standby Leader; the primary goes silent
+ * halfway. The standby boots first, so its boot grace is tested too.
+ */
+Result runFailover(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 10;
+  double rate = options.rate > 0 ? options.rate : 50;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  uint64_t killAt = BOOT_US + (end - BOOT_US) / 2;
+
+  OSCLeaderCore &primary = bench.addLeader();
+  OSCLeaderCore &standby = bench.addLeader();
+  sim::Device &standbyDev = *bench.leaderDevs[1];
+  bench.sim.runOn(standbyDev, [&standby] { standby.enableFailover(true); });
+  bench.sim.at(200000, [&bench, &primary] {
+    bench.sim.runOn(*bench.leaderDev,
+                    [&primary] { primary.enableFailover(false); });
+  });
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  int takeovers = 0;
+  int early = 0; ///< Takeovers while the primary was alive
+  uint32_t takeoverUs = 0;
+  int mirrored = -1;
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[96];
+    if (MiniOSC::extract(data, len, "/leader/takeover", v, 2) == 2) {
+      takeovers++;
+      if (bench.sim.now() < killAt)
+        early++;
+      takeoverUs = v[1].i;
+    } else if (len > 11 && memcmp(data, "/sys/nodes", 11) == 0) {
+      mirrored = MiniOSC::extract(data, len, "/sys/nodes", v, 96) / 3;
+    } else {
+      readProbe(data, len, "/bench/sensor", bench.result);
+    }
+  };
+
+  startFanin(bench, rate, BOOT_US, end);
+  bench.sim.at(killAt, [&bench] {
+    bench.leaderDev->radioOn = false;
+    uint8_t query[32];
+    bench.hostSend(query, MiniOSC::pack(query, "/leader/nodes", nullptr, 0),
+                   1);
+  });
+  bench.run(end);
+
+  // A node sending to the standby has it in its peer table
+  int rebound = 0;
+  for (sim::Device *dev : bench.followerDevs)
+    if (dev->hasPeer(standbyDev.mac))
+      rebound++;
+
+  uint64_t lost = bench.result.expected -
+                  std::min(bench.result.received, bench.result.expected);
+  char note[240];
+  snprintf(note, sizeof(note),
+           "takeover %u us (%d takeovers, %d while the primary was up), "
+           "%llu messages lost; standby mirrored %d nodes, %d/%d re-bound",
+           takeoverUs, takeovers, early, (unsigned long long)lost, mirrored,
+           rebound, nodes);
+  bench.result.note = note;
+  bench.result.name = "failover";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+// ------------------------------------------
+// Multi-hop relays
+// ------------------------------------------
+
+/**
+ * @brief A line of devices with a radio range of 1.2: the Leader at 0, relay
+ * A at 1, relay B at 2, and the nodes in three groups. Near nodes (0.5) hear
+ * the Leader, mid nodes (1.8) only the relays, far nodes (2.8) only relay B.
+ * The host broadcasts to everyone and every node streams back.
+ */
+Result runRelay(const Options &options) {
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 12;
+  double rate = options.rate > 0 ? options.rate : 20;
+  uint64_t end = BOOT_US + 1000000 + (uint64_t)(options.seconds * 1e6);
+  uint64_t start = BOOT_US + 1000000; ///< Routes settle first
+  uint64_t period = periodFor(rate);
+
+  OSCLeaderCore &leader = bench.addLeader();
+  bench.sim.runOn(*bench.leaderDev, [&leader] { leader.enableRelay(2); });
+
+  // Relays first, then the nodes, near to far
+  static const double GROUP_AT[3] = {0.5, 1.8, 2.8};
+  std::vector<double> position = {0.0, 1.0, 2.0};
+  std::vector<int> group; ///< Per follower: -1 relay, else 0..2
+  for (int i = 0; i < 2 + nodes; i++) {
+    OSCFollower &follower = bench.addFollower();
+    uint32_t id = 100 + i;
+    int g = i < 2 ? -1 : (i - 2) * 3 / nodes;
+    if (i >= 2)
+      position.push_back(GROUP_AT[g]);
+    group.push_back(g);
+    sim::Device *dev = bench.followerDevs[i];
+    if (i < 2)
+      bench.sim.runOn(*dev, [&follower] { follower.enableRelay(); });
+    // Nodes boot at different times, so their heartbeats are spread out
+    bench.sim.at(bench.sim.randomUint(500000), [&bench, &follower, dev, id] {
+      bench.sim.runOn(*dev, [&follower, id] {
+        follower.enableHeartbeat(500, id);
+      });
+    });
+  }
+  bench.sim.inRange = [&position](const sim::Device &a,
+                                  const sim::Device &b) {
+    return fabs(position[a.index] - position[b.index]) <= 1.2;
+  };
+  bindWithHello(bench);
+
+  // Downstream: every message once per node, whatever the paths
+  struct Tally {
+    uint64_t expected = 0;
+    uint64_t received = 0;
+  };
+  Tally down[3], up[3];
+  uint64_t duplicates = 0;
+  std::vector<std::set<int32_t>> seen(bench.followerDevs.size());
+  // Half a period off the heartbeats, which fire together on Leader time
+  auto downSeq = std::make_shared<int32_t>(0);
+  bench.sim.every(start + period / 2, period, [&, downSeq, end] {
+    if (bench.sim.now() >= end)
+      return false;
+    uint8_t buffer[64];
+    bench.hostSend(buffer, packProbe(buffer, "/bench/fanout", (*downSeq)++));
+    for (int i = 2; i < (int)group.size(); i++)
+      down[group[i]].expected++;
+    bench.result.expected += nodes;
+    return true;
+  });
+  bench.onFollowerReceive = [&](sim::Device &dev, const uint8_t *data,
+                                int len) {
+    OSCValue v[2];
+    int f = dev.index - 1;
+    if (group[f] < 0 ||
+        MiniOSC::extract(data, len, "/bench/fanout", v, 2) != 2)
+      return;
+    if (!seen[f].insert(v[0].i).second) {
+      duplicates++;
+      return;
+    }
+    down[group[f]].received++;
+    bench.result.received++;
+    bench.result.latency.add((uint32_t)micros() - (uint32_t)v[1].i);
+  };
+
+  // Upstream: "/bench/up ,ii follower stamp"
+  for (int i = 2; i < (int)group.size(); i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    auto next = std::make_shared<uint64_t>(
+        start + bench.sim.randomUint((uint32_t)period));
+    Tally *tally = &up[group[i]];
+    dev.loop = [follower, next, period, end, tally, i] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      OSCFrame &frame = follower->beginFrame("/bench/up", "ii");
+      frame.addInt(i).addInt((int32_t)(uint32_t)now);
+      follower->commitFrame(frame);
+      tally->expected++;
+    };
+  }
+
+  // Routes as the Leader reports them, by node ID
+  std::map<int, std::pair<int, int>> routes; ///< ID -> hops, relay ID
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[4];
+    if (MiniOSC::extract(data, len, "/bench/up", v, 2) == 2) {
+      if (v[0].i >= 2 && v[0].i < (int)group.size())
+        up[group[v[0].i]].received++;
+    } else if (MiniOSC::extract(data, len, "/sys/route", v, 4) == 4) {
+      routes[v[0].i] = {v[1].i, v[2].i};
+    }
+  };
+  bench.sim.at(end, [&bench] {
+    uint8_t query[32];
+    bench.hostSend(query, MiniOSC::pack(query, "/leader/routes", nullptr, 0));
+  });
+  bench.run(end);
+
+  // Near nodes are direct, the others one or two hops away; the route names
+  // the relay next to the Leader, A, for both
+  static const int HOPS[3] = {0, 1, 2};
+  static const int VIA[3] = {0, 100, 100};
+  int correct = 0;
+  for (int i = 2; i < (int)group.size(); i++) {
+    auto route = routes.find(100 + i);
+    if (route != routes.end() && route->second.first == HOPS[group[i]] &&
+        route->second.second == VIA[group[i]])
+      correct++;
+  }
+
+  auto pct = [](const Tally &t) {
+    return t.expected ? 100.0 * t.received / t.expected : 0.0;
+  };
+  char note[320];
+  snprintf(note, sizeof(note),
+           "delivered down/up: near %.1f/%.1f%%, 1 hop %.1f/%.1f%%, 2 hops "
+           "%.1f/%.1f%%; %llu duplicates passed on, relays forwarded "
+           "%u+%u; /leader/routes right for %d/%d nodes",
+           pct(down[0]), pct(up[0]), pct(down[1]), pct(up[1]), pct(down[2]),
+           pct(up[2]), (unsigned long long)duplicates,
+           bench.followerDevs[0]->follower->relayedCount(),
+           bench.followerDevs[1]->follower->relayedCount(), correct, nodes);
+  bench.result.note = note;
+  bench.result.seconds = options.seconds;
+  bench.result.name = "relay";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+// ------------------------------------------
+// Fragmented messages
+// ------------------------------------------
+
+/// Byte i of blob number seq: every value occurs, zeros included
+uint8_t blobByte(int32_t seq, int i) {
+  return (uint8_t)(seq * 37 + i * 7 + (i >> 8));
+}
+
+bool blobMatches(const OSCValue &blob, int32_t seq, int size) {
+  if (blob.type != 'b' || blob.len != size)
+    return false;
+  for (int i = 0; i < size; i++)
+    if ((uint8_t)blob.s[i] != blobByte(seq, i))
+      return false;
+  return true;
+}
+
+/**
+ * @brief Feeds FrameReassembler directly, on simulated time: fragments in
+ * reverse order, a message that loses one and must expire, and one sender
+ * more than there are LEADER_REASSEMBLY_SLOTS.
+ * @return The checks that failed once the bench has run, empty when all
+ * passed.
+ */
+std::shared_ptr<const std::string> checkReassembler(Bench &bench) {
+  constexpr int SENDERS = 3 + LEADER_REASSEMBLY_SLOTS; ///< 1, 2, then 3..
+  constexpr int SIZE = 700;
+  struct State {
+    LeaderReassemblySlot slots[LEADER_REASSEMBLY_SLOTS] = {};
+    FrameReassembler reassembler{slots, LEADER_REASSEMBLY_SLOTS};
+    std::vector<std::vector<uint8_t>> frags[SENDERS + 1];
+    std::string failed;
+  };
+  auto state = std::make_shared<State>();
+  uint8_t blob[SIZE];
+  for (int s = 1; s <= SENDERS; s++) {
+    for (int i = 0; i < SIZE; i++)
+      blob[i] = blobByte(s, i);
+    fragmentFrame(blob, SIZE, LEADER_V1_PAYLOAD, (uint16_t)s,
+                  [&](const uint8_t *frame, int len) {
+                    state->frags[s].emplace_back(frame, frame + len);
+                    return true;
+                  });
+  }
+
+  // Feeds fragment i of sender s; true if that completed the message intact
+  auto feed = [state](int s, int i) {
+    uint8_t src[6] = {0x02, 0, 0, 0, 0, (uint8_t)s};
+    const std::vector<uint8_t> &f = state->frags[s][i];
+    const uint8_t *message = nullptr;
+    int len = state->reassembler.add(src, f.data(), (int)f.size(), message);
+    if (len != SIZE)
+      return false;
+    for (int b = 0; b < len; b++)
+      if (message[b] != blobByte(s, b))
+        return false;
+    return true;
+  };
+  auto expect = [state](bool ok, const char *check) {
+    if (!ok)
+      state->failed += state->failed.empty() ? check : std::string(", ") + check;
+  };
+
+  bench.sim.at(10000, [state, feed, expect] {
+    int count = (int)state->frags[1].size();
+    bool done = false;
+    for (int i = count - 1; i >= 0; i--)
+      done = feed(1, i);
+    expect(count == 3 && done, "reordered");
+    feed(2, 0); // Fragment 1 of sender 2 never arrives
+    feed(2, 2);
+  });
+  uint64_t later = 10000 + (LEADER_REASSEMBLY_TIMEOUT + 50) * 1000ULL;
+  bench.sim.at(later, [state, feed, expect] {
+    feed(3, 0); // Expires sender 2 and takes its slot
+    expect(state->reassembler.timeouts == 1, "timeout");
+  });
+  bench.sim.at(later + 1000, [state, feed, expect] {
+    // Every slot busy: the last sender pushes out sender 3, the oldest
+    for (int s = 4; s <= SENDERS; s++)
+      feed(s, 0);
+    expect(state->reassembler.evictions == 1, "eviction");
+    bool intact = true;
+    for (int s = 4; s <= SENDERS; s++)
+      intact = !feed(s, 1) && feed(s, 2) && intact;
+    expect(intact, "survivors intact");
+    expect(!feed(3, 1) && !feed(3, 2), "evicted stays incomplete");
+  });
+  return std::shared_ptr<const std::string>(state, &state->failed);
+}
+
+/**
+ * @brief Blobs larger than a v1 frame in both directions: the host
+ * broadcasts 700 bytes and every node sends 600 back, so three or four
+ * fragments each. Fragments get lost and, with the extra jitter, arrive out
+ * of order; several nodes fragmenting at once share the Leader's upload
+ * slots.
+ */
+Result runFragments(const Options &options) {
+  constexpr int DOWN_SIZE = 700;
+  constexpr int UP_SIZE = 600;
+  Options local = options;
+  if (local.radio.loss == 0)
+    local.radio.loss = 0.02;
+  if (local.radio.jitterUs < 3000)
+    local.radio.jitterUs = 3000; // Longer than a frame: fragments reorder
+  Bench bench(local);
+  int nodes = options.nodes > 0 ? options.nodes : 8;
+  double rate = options.rate > 0 ? options.rate : 10;
+  uint64_t end = BOOT_US + (uint64_t)(options.seconds * 1e6);
+  uint64_t period = periodFor(rate);
+
+  auto failed = checkReassembler(bench);
+  OSCLeaderCore &leader = bench.addLeader();
+  for (int i = 0; i < nodes; i++)
+    bench.addFollower();
+  bindWithHello(bench);
+
+  uint64_t corrupt = 0;
+  std::vector<uint64_t> sentAt; ///< Per broadcast blob
+  bench.sim.every(BOOT_US, period, [&bench, &sentAt, end, nodes] {
+    if (bench.sim.now() >= end)
+      return false;
+    int32_t seq = (int32_t)sentAt.size();
+    sentAt.push_back(bench.sim.now());
+    uint8_t blob[DOWN_SIZE];
+    for (int i = 0; i < DOWN_SIZE; i++)
+      blob[i] = blobByte(seq, i);
+    OSCValue v[2];
+    v[0].type = 'i';
+    v[0].i = seq;
+    v[1].type = 'b';
+    v[1].s = (const char *)blob;
+    v[1].len = DOWN_SIZE;
+    uint8_t buffer[LEADER_MAX_MESSAGE];
+    bench.hostSend(buffer, MiniOSC::pack(buffer, "/bench/blob", v, 2));
+    bench.result.expected += nodes;
+    return true;
+  });
+  bench.onFollowerReceive = [&](sim::Device &, const uint8_t *data, int len) {
+    OSCValue v[2];
+    if (MiniOSC::extract(data, len, "/bench/blob", v, 2) != 2)
+      return;
+    if (!blobMatches(v[1], v[0].i, DOWN_SIZE) || v[0].i < 0 ||
+        v[0].i >= (int32_t)sentAt.size()) {
+      corrupt++;
+      return;
+    }
+    bench.result.received++;
+    bench.result.latency.add(bench.sim.now() - sentAt[v[0].i]);
+  };
+
+  // Upstream: "/bench/big ,iib follower seq blob", the blob keyed by both
+  uint64_t upExpected = 0, upReceived = 0;
+  for (int i = 0; i < nodes; i++) {
+    sim::Device &dev = *bench.followerDevs[i];
+    OSCFollowerCore *follower = dev.follower;
+    auto next = std::make_shared<uint64_t>(
+        BOOT_US + bench.sim.randomUint((uint32_t)period));
+    auto seq = std::make_shared<int32_t>(0);
+    dev.loop = [follower, next, seq, period, end, i, &upExpected] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      uint8_t blob[UP_SIZE];
+      for (int b = 0; b < UP_SIZE; b++)
+        blob[b] = blobByte(*seq * 64 + i, b);
+      OSCFrame &frame = follower->beginFrame("/bench/big", "iib");
+      frame.addInt(i).addInt((*seq)++).addBlob(blob, UP_SIZE);
+      follower->commitFrame(frame);
+      upExpected++;
+    };
+  }
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[3];
+    if (MiniOSC::extract(data, len, "/bench/big", v, 3) != 3)
+      return;
+    if (blobMatches(v[2], v[1].i * 64 + v[0].i, UP_SIZE))
+      upReceived++;
+    else
+      corrupt++;
+  };
+  bench.run(end);
+
+  uint32_t timeouts = 0, evictions = 0;
+  for (sim::Device *dev : bench.followerDevs) {
+    timeouts += dev->follower->reassemblyTimeoutCount();
+    evictions += dev->follower->reassemblyEvictionCount();
+  }
+  char note[320];
+  snprintf(note, sizeof(note),
+           "up %.1f%% of %llu; %llu corrupt; leader reassembly %u timeouts, "
+           "%u evictions, nodes %u/%u; reassembler checks %s%s",
+           upExpected ? 100.0 * upReceived / upExpected : 0.0,
+           (unsigned long long)upExpected, (unsigned long long)corrupt,
+           leader.reassemblyTimeoutCount(), leader.reassemblyEvictionCount(),
+           timeouts, evictions, failed->empty() ? "passed" : "FAILED: ",
+           failed->c_str());
+  bench.result.note = note;
+  bench.result.name = "fragment";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+// ------------------------------------------
+// Mixed ESP-NOW v1 and v2 nodes
+// ------------------------------------------
+
+/// A Follower built for 250-byte frames, whatever the build allows
+using V1FollowerConfig =
+    LeaderConfig<LEADER_RX_QUEUE_SIZE, LEADER_MAX_NODES, LEADER_V1_PAYLOAD>;
+
+/**
+ * @brief N devices in three kinds: Followers taking the largest frames of
+ * the build, Followers built for 250 bytes on a v1 radio, and plain
+ * ESP-NOW v1 sketches that stream to the Leader and never answer a CAPS
+ * query. Every Follower gets 600-byte broadcasts and 900-byte unicasts
+ * and sends 900-byte blobs back. Build with -DESP_NOW_MAX_DATA_LEN_V2=1470
+ * for the v2 side to differ.
+ */
+Result runMixed(const Options &options) {
+  constexpr int DOWN_SIZE = 600;
+  constexpr int BIG_SIZE = 900;
+  enum Kind { V2, V1, PLAIN };
+  Bench bench(options);
+  int nodes = options.nodes > 0 ? options.nodes : 9;
+  double rate = options.rate > 0 ? options.rate : 5;
+  uint64_t start = BOOT_US + 1000000; ///< Every node has sent its ID
+  uint64_t end = start + (uint64_t)(options.seconds * 1e6);
+  uint64_t period = periodFor(rate);
+
+  OSCLeaderCore &leader = bench.addLeader();
+  std::vector<Kind> kind; ///< Per device; the Leader counts as v2
+  kind.push_back(V2);
+  for (int i = 0; i < nodes; i++) {
+    Kind k = (Kind)(i % 3);
+    OSCFollowerCore *follower = nullptr;
+    if (k == V2) {
+      follower = &bench.addFollower();
+    } else if (k == V1) {
+      follower = &bench.addFollower<BasicOSCFollower<V1FollowerConfig>>();
+      bench.followerDevs.back()->maxFrame = LEADER_V1_PAYLOAD;
+    } else {
+      // Streams "/bench/plain" to the Leader at 20 Hz, hears nothing
+      sim::Device &dev = bench.sim.addDevice();
+      dev.maxFrame = LEADER_V1_PAYLOAD;
+      const uint8_t *to = bench.leaderDev->mac;
+      bench.sim.runOn(dev, [to] {
+        esp_now_init();
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, to, 6);
+        esp_now_add_peer(&peer);
+      });
+      auto next = std::make_shared<uint64_t>(bench.sim.randomUint(50000));
+      auto seq = std::make_shared<int32_t>(0);
+      dev.loop = [next, seq, to] {
+        if (micros() < *next)
+          return;
+        *next += 50000;
+        uint8_t buffer[32];
+        esp_now_send(to, buffer, packProbe(buffer, "/bench/plain", (*seq)++));
+      };
+    }
+    kind.push_back(k);
+    if (!follower)
+      continue;
+    // Heartbeats give the node the ID "/leader/send" addresses: index + 1
+    sim::Device *dev = bench.followerDevs.back();
+    uint32_t id = dev->index + 1;
+    bench.sim.runOn(*dev, [follower, id] {
+      follower->enableHeartbeat(1000, id);
+    });
+  }
+  bindWithHello(bench);
+
+  // Per kind of receiver: {expected, received}
+  uint64_t down[2][2] = {}, unicast[2][2] = {}, up[2][2] = {};
+  uint64_t corrupt = 0, plainReceived = 0, upFrames[2] = {};
+  auto blobArgs = [](OSCValue *v, int32_t seq, uint8_t *blob, int size) {
+    for (int i = 0; i < size; i++)
+      blob[i] = blobByte(seq, i);
+    v->type = 'b';
+    v->s = (const char *)blob;
+    v->len = size;
+  };
+
+  // Host: a broadcast to all, and a unicast to each Follower spread over
+  // the period so the Leader's send queue never overflows
+  auto seq = std::make_shared<int32_t>(0);
+  bench.sim.every(start, period, [&, seq] {
+    if (bench.sim.now() >= end)
+      return false;
+    int32_t n = (*seq)++;
+    uint8_t blob[DOWN_SIZE], buffer[LEADER_MAX_MESSAGE];
+    OSCValue v[2];
+    v[0].type = 'i';
+    v[0].i = n;
+    blobArgs(&v[1], n, blob, DOWN_SIZE);
+    bench.hostSend(buffer, MiniOSC::pack(buffer, "/bench/blob", v, 2));
+    for (size_t d = 1; d < kind.size(); d++)
+      if (kind[d] != PLAIN)
+        down[kind[d]][0]++;
+    return true;
+  });
+  for (size_t d = 1; d < kind.size(); d++) {
+    if (kind[d] == PLAIN)
+      continue;
+    auto n = std::make_shared<int32_t>(0);
+    uint64_t phase = period * d / kind.size();
+    bench.sim.every(start + phase, period, [&, n, d] {
+      if (bench.sim.now() >= end)
+        return false;
+      uint8_t blob[BIG_SIZE], message[LEADER_MAX_MESSAGE];
+      OSCValue v[2];
+      v[0].type = 'i';
+      v[0].i = (*n)++ * 256 + (int32_t)d;
+      blobArgs(&v[1], v[0].i, blob, BIG_SIZE);
+      OSCValue send[2];
+      send[0].type = 'i';
+      send[0].i = (int32_t)d + 1;
+      send[1].type = 'b';
+      send[1].s = (const char *)message;
+      send[1].len = MiniOSC::pack(message, "/bench/unicast", v, 2);
+      uint8_t buffer[LEADER_MAX_MESSAGE];
+      bench.hostSend(buffer, MiniOSC::pack(buffer, "/leader/send", send, 2));
+      unicast[kind[d]][0]++;
+      return true;
+    });
+  }
+  bench.onFollowerReceive = [&](sim::Device &dev, const uint8_t *data,
+                                int len) {
+    OSCValue v[2];
+    Kind k = kind[dev.index];
+    if (MiniOSC::extract(data, len, "/bench/blob", v, 2) == 2) {
+      if (blobMatches(v[1], v[0].i, DOWN_SIZE))
+        down[k][1]++;
+      else
+        corrupt++;
+    } else if (MiniOSC::extract(data, len, "/bench/unicast", v, 2) == 2) {
+      if (v[0].i % 256 == dev.index && blobMatches(v[1], v[0].i, BIG_SIZE))
+        unicast[k][1]++;
+      else
+        corrupt++;
+    }
+  };
+
+  // Followers: "/bench/big ,iib device seq blob"
+  for (sim::Device *dev : bench.followerDevs) {
+    OSCFollowerCore *follower = dev->follower;
+    int d = dev->index;
+    auto next = std::make_shared<uint64_t>(
+        start + bench.sim.randomUint((uint32_t)period));
+    auto n = std::make_shared<int32_t>(0);
+    uint64_t *expected = &up[kind[d]][0];
+    dev->loop = [follower, next, n, period, end, d, expected] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += period;
+      uint8_t blob[BIG_SIZE];
+      for (int b = 0; b < BIG_SIZE; b++)
+        blob[b] = blobByte(*n * 256 + d, b);
+      OSCFrame &frame = follower->beginFrame("/bench/big", "iib");
+      frame.addInt(d).addInt((*n)++).addBlob(blob, BIG_SIZE);
+      follower->commitFrame(frame);
+      (*expected)++;
+    };
+  }
+  bench.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue v[3];
+    if (MiniOSC::extract(data, len, "/bench/plain", v, 2) == 2) {
+      plainReceived++;
+    } else if (MiniOSC::extract(data, len, "/bench/big", v, 3) == 3) {
+      int d = v[0].i;
+      if (d > 0 && d < (int)kind.size() && kind[d] != PLAIN &&
+          blobMatches(v[2], v[1].i * 256 + d, BIG_SIZE))
+        up[kind[d]][1]++;
+      else
+        corrupt++;
+    }
+  };
+
+  // CAPS queries from the Leader, and radio frames per upstream blob;
+  // heartbeats and CAPS answers are far smaller than a fragment
+  int capsQueries = 0;
+  bench.sim.onSend = [&](sim::Device &dev, const uint8_t *data, size_t len) {
+    if (&dev == bench.leaderDev) {
+      if (len >= sizeof(LeaderCapsFrame) && data[0] == LEADER_CTRL_MAGIC &&
+          data[1] == CTRL_CAPS)
+        capsQueries++;
+      return;
+    }
+    uint64_t now = bench.sim.now();
+    if (kind[dev.index] != PLAIN && now >= start && now < end &&
+        len > LEADER_V1_PAYLOAD / 2)
+      upFrames[kind[dev.index]]++;
+  };
+  bench.run(end);
+
+  for (int k = 0; k < 2; k++) {
+    bench.result.expected += down[k][0] + unicast[k][0] + up[k][0];
+    bench.result.received += down[k][1] + unicast[k][1] + up[k][1];
+  }
+  auto pct = [](const uint64_t *t) { return t[0] ? 100.0 * t[1] / t[0] : 0.0; };
+  auto perBlob = [&](int k) {
+    return up[k][0] ? (double)upFrames[k] / up[k][0] : 0.0;
+  };
+  char note[400];
+  snprintf(note, sizeof(note),
+           "%s; delivered down/unicast/up: v2 %.1f/%.1f/%.1f%%, v1 "
+           "%.1f/%.1f/%.1f%%; %llu corrupt; radio frames per blob sent: v2 "
+           "%.1f, v1 %.1f; broadcasts at %zu B, %llu frames too large for a "
+           "v1 radio; plain v1 sketches: %llu messages to the host, %d CAPS "
+           "queries",
+           LEADER_MAX_PAYLOAD > LEADER_V1_PAYLOAD ? "v2 build"
+                                                  : "v1 build, all nodes v1",
+           pct(down[V2]), pct(unicast[V2]), pct(up[V2]), pct(down[V1]),
+           pct(unicast[V1]), pct(up[V1]), (unsigned long long)corrupt,
+           perBlob(V2), perBlob(V1), (size_t)leader.getBroadcastPayload(),
+           (unsigned long long)bench.sim.stats.tooLarge,
+           (unsigned long long)plainReceived, capsQueries);
+  bench.result.note = note;
+  bench.result.name = "mixed";
+  bench.result.nodes = nodes;
+  return bench.result;
+}
+
+struct Scenario {
+  const char *name;
+  Result (*run)(const Options &);
+};
+
+const Scenario SCENARIOS[] = {
+    {"fanout", runFanout},
+    {"fanin", runFanin},
+    {"hop", runHop},
+    {"storm", runStorm},
+    {"slotted", runSlotted},
+    {"polled", runPolled},
+    {"streams", runStreams},
+    {"doze", runDoze},
+    {"beats", runBeats},
+    {"peer", runPeer},
+    {"shard", runShard},
+    {"cues", runCues},
+    {"chatty", runChatty},
+    {"compact", runCompact},
+    {"failover", runFailover},
+    {"relay", runRelay},
+    {"fragment", runFragments},
+    {"mixed", runMixed},
+};
+
+// ==========================================
+// Reporting
+// ==========================================
+
+void printHeader() {
+  printf("%-8s %5s %9s %8s %8s %8s %8s %7s %6s %8s %6s\n", "scenario",
+         "nodes", "msgs/s", "p50 us", "p99 us", "expected", "received",
+         "drops", "drop%", "collided", "util%");
+}
+
+void printResult(Result &r) {
+  uint64_t drops = r.expected - std::min(r.received, r.expected);
+  double util = 100.0 * r.radio.airtimeUs[r.channel] /
+                ((r.seconds * 1e6) + BOOT_US + DRAIN_US);
+  printf("%-8s %5d %9.1f %8u %8u %8llu %8llu %7llu %6.2f %8llu %6.1f\n",
+         r.name.c_str(), r.nodes, r.received / r.seconds,
+         r.latency.percentile(0.50), r.latency.percentile(0.99),
+         (unsigned long long)r.expected, (unsigned long long)r.received,
+         (unsigned long long)drops, r.dropPct(),
+         (unsigned long long)r.radio.collided, util);
+  if (!r.note.empty())
+    printf("         %s\n", r.note.c_str());
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: leader-sim [--scenario fanout|fanin|hop|storm|slotted|\n"
+          "                   polled|streams|doze|beats|peer|shard|\n"
+          "                   cues|chatty|compact|failover|relay|fragment|\n"
+          "                   mixed|all]\n"
+          "                  [--nodes N] [--rate HZ] [--seconds S] [--seed N]\n"
+          "                  [--loss P] [--latency US] [--jitter US]\n"
+          "                  [--airtime US_PER_BYTE] [--channel C] [--baud B]\n"
+          "                  [--no-collisions]\n"
+          "                  [--max-p99 US] [--max-drop-pct PCT]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--scenario" && hasValue)
+      options.scenario = argv[++i];
+    else if (arg == "--nodes" && hasValue)
+      options.nodes = atoi(argv[++i]);
+    else if (arg == "--rate" && hasValue)
+      options.rate = atof(argv[++i]);
+    else if (arg == "--seconds" && hasValue)
+      options.seconds = atof(argv[++i]);
+    else if (arg == "--seed" && hasValue)
+      options.seed = atoi(argv[++i]);
+    else if (arg == "--loss" && hasValue)
+      options.radio.loss = atof(argv[++i]);
+    else if (arg == "--latency" && hasValue)
+      options.radio.latencyUs = atoi(argv[++i]);
+    else if (arg == "--jitter" && hasValue)
+      options.radio.jitterUs = atoi(argv[++i]);
+    else if (arg == "--airtime" && hasValue)
+      options.radio.airtimePerByteUs = atof(argv[++i]);
+    else if (arg == "--channel" && hasValue)
+      options.channel = atoi(argv[++i]);
+    else if (arg == "--baud" && hasValue)
+      options.baud = atol(argv[++i]);
+    else if (arg == "--no-collisions")
+      options.radio.collisions = false;
+    else if (arg == "--max-p99" && hasValue)
+      options.maxP99 = atof(argv[++i]);
+    else if (arg == "--max-drop-pct" && hasValue)
+      options.maxDropPct = atof(argv[++i]);
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (options.channel < 1 || options.channel > 13 || options.seconds <= 0) {
+    usage();
+    return 2;
+  }
+
+  bool ran = false;
+  bool regressed = false;
+  printHeader();
+  for (const Scenario &scenario : SCENARIOS) {
+    if (options.scenario != "all" && options.scenario != scenario.name)
+      continue;
+    ran = true;
+
+    Result result = scenario.run(options);
+    result.seconds = options.seconds;
+    printResult(result);
+
+    if ((options.maxP99 > 0 && result.latency.percentile(0.99) > options.maxP99) ||
+        (options.maxDropPct >= 0 && result.dropPct() > options.maxDropPct)) {
+      printf("         REGRESSION: limits exceeded\n");
+      regressed = true;
+    }
+  }
+
+  if (!ran) {
+    usage();
+    return 2;
+  }
+  return regressed ? 1 : 0;
+}
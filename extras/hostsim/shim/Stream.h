@@ -0,0 +1,6 @@
+#ifndef LEADER_SIM_STREAM_H
+#define LEADER_SIM_STREAM_H
+
+#include "Arduino.h"
+
+#endif
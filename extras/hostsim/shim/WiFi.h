@@ -0,0 +1,23 @@
+#ifndef LEADER_SIM_WIFI_H
+#define LEADER_SIM_WIFI_H
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2 } wifi_mode_t;
+
+/**
+ * @brief Scan results come from the simulated ambient networks.
+ */
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode);
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  int16_t scanNetworks();
+  int32_t channel(uint8_t networkItem);
+  void scanDelete();
+};
+
+extern WiFiClass WiFi;
+
+#endif
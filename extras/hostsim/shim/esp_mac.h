@@ -0,0 +1,10 @@
+#ifndef LEADER_SIM_ESP_MAC_H
+#define LEADER_SIM_ESP_MAC_H
+
+#include "esp_now.h"
+
+typedef enum { ESP_MAC_WIFI_STA = 0 } esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef LEADER_SIM_ESP_WIFI_H
+#define LEADER_SIM_ESP_WIFI_H
+
+#include "esp_now.h"
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+  WIFI_SECOND_CHAN_NONE = 0,
+  WIFI_SECOND_CHAN_ABOVE,
+  WIFI_SECOND_CHAN_BELOW
+} wifi_second_chan_t;
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second);
+esp_err_t esp_wifi_connectionless_module_set_wake_interval(
+    uint16_t wake_interval);
+
+#endif
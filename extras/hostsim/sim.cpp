@@ -0,0 +1,636 @@
+#include "sim.h"
+
+#include <LEADER.h>
+#include <WiFi.h>
+#include <esp_mac.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+// Lets the simulator re-point the library singletons at the running device
+struct LeaderSimHooks {
+  static void activate(sim::Device *dev) {
+    OSCLeaderCore::_instance = dev ? dev->leader : nullptr;
+    OSCFollowerCore::_instance = dev ? dev->follower : nullptr;
+  }
+};
+
+namespace sim {
+
+static Simulator *g_active = nullptr;
+
+Simulator &active() { return *g_active; }
+
+static bool isBroadcast(const uint8_t *mac) {
+  static const uint8_t all[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  return memcmp(mac, all, 6) == 0;
+}
+
+// ==========================================
+// Serial Links
+// ==========================================
+
+void Pipe::write(const uint8_t *data, size_t len, uint64_t now) {
+  double t = std::max((double)now, _lastReady);
+  for (size_t i = 0; i < len; i++) {
+    t += _byteUs;
+    _bytes.push_back({(uint64_t)t, data[i]});
+  }
+  _lastReady = t;
+}
+
+int Pipe::available(uint64_t now) const {
+  auto ready = std::upper_bound(
+      _bytes.begin(), _bytes.end(), now,
+      [](uint64_t t, const Byte &b) { return t < b.readyAt; });
+  return (int)(ready - _bytes.begin());
+}
+
+int Pipe::read(uint64_t now) {
+  if (_bytes.empty() || _bytes.front().readyAt > now)
+    return -1;
+  uint8_t value = _bytes.front().value;
+  _bytes.pop_front();
+  return value;
+}
+
+int Pipe::peek(uint64_t now) const {
+  if (_bytes.empty() || _bytes.front().readyAt > now)
+    return -1;
+  return _bytes.front().value;
+}
+
+int Port::available() { return _in.available(active().now()); }
+int Port::read() { return _in.read(active().now()); }
+int Port::peek() { return _in.peek(active().now()); }
+
+size_t Port::write(const uint8_t *buffer, size_t size) {
+  _out.write(buffer, size, active().now());
+  return size;
+}
+
+bool Device::hasPeer(const uint8_t *addr) const {
+  for (const auto &peer : peers)
+    if (memcmp(peer.data(), addr, 6) == 0)
+      return true;
+  return false;
+}
+
+bool Device::asleep(uint64_t now) const {
+  return dozing && !(wakeIntervalUs && now % wakeIntervalUs < wakeWindowUs);
+}
+
+uint64_t Device::sleepUs(uint64_t from, uint64_t to) const {
+  if (wakeIntervalUs == 0)
+    return to - from;
+  // Wake-window time from 0 to t
+  auto woken = [this](uint64_t t) {
+    return t / wakeIntervalUs * wakeWindowUs +
+           std::min(t % wakeIntervalUs, wakeWindowUs);
+  };
+  return to - from - (woken(to) - woken(from));
+}
+
+// ==========================================
+// Simulator
+// ==========================================
+
+Simulator::Simulator(const RadioConfig &radioConfig, uint32_t seed)
+    : radio(radioConfig), _rng(seed) {
+  g_active = this;
+}
+
+Simulator::~Simulator() {
+  LeaderSimHooks::activate(nullptr);
+  if (g_active == this)
+    g_active = nullptr;
+}
+
+Device &Simulator::addDevice() {
+  auto dev = std::make_unique<Device>();
+  dev->index = (int)_devices.size();
+  uint16_t id = dev->index + 1;
+  const uint8_t mac[6] = {0x24, 0x0A, 0xC4, 0x00, (uint8_t)(id >> 8),
+                          (uint8_t)id};
+  memcpy(dev->mac, mac, 6);
+  dev->clock = _now;
+
+  Device &ref = *dev;
+  _devices.push_back(std::move(dev));
+  // Random loop phase, so devices do not all run in lockstep
+  scheduleLoop(ref, _now + randomUint(ref.loopPeriodUs));
+  return ref;
+}
+
+void Simulator::runOn(Device &dev, const std::function<void()> &fn) {
+  Device *prevDevice = _current;
+  uint64_t *prevClock = _clock;
+
+  if (dev.clock < _now)
+    dev.clock = _now;
+  _current = &dev;
+  _clock = &dev.clock;
+  LeaderSimHooks::activate(&dev);
+
+  fn();
+
+  _current = prevDevice;
+  _clock = prevClock;
+  LeaderSimHooks::activate(prevDevice);
+}
+
+void Simulator::at(uint64_t timeUs, std::function<void()> fn) {
+  _events.push({std::max(timeUs, _now), _seq++, std::move(fn)});
+}
+
+void Simulator::every(uint64_t startUs, uint64_t periodUs,
+                      std::function<bool()> fn) {
+  at(startUs, [this, periodUs, fn] {
+    if (fn())
+      every(_now + periodUs, periodUs, fn);
+  });
+}
+
+void Simulator::runUntil(uint64_t timeUs) {
+  while (!_events.empty() && _events.top().time <= timeUs) {
+    Event ev = _events.top();
+    _events.pop();
+    _now = ev.time;
+    ev.fn();
+  }
+  _now = timeUs;
+}
+
+void Simulator::scheduleLoop(Device &dev, uint64_t t) {
+  at(t, [this, &dev] {
+    runOn(dev, [&dev] {
+      if (dev.loop)
+        dev.loop();
+    });
+    scheduleLoop(dev, dev.clock + dev.loopPeriodUs);
+  });
+}
+
+// ==========================================
+// Virtual Radio
+// ==========================================
+
+esp_err_t Simulator::send(Device &dev, const uint8_t *dest,
+                          const uint8_t *data, size_t len) {
+  if (onSend)
+    onSend(dev, data, len);
+
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+  size_t maxLen = ESP_NOW_MAX_DATA_LEN_V2;
+#else
+  size_t maxLen = ESP_NOW_MAX_DATA_LEN;
+#endif
+  if (dev.maxFrame && dev.maxFrame < maxLen)
+    maxLen = dev.maxFrame;
+  if (!dev.radioOn || len == 0 || len > maxLen || !dev.hasPeer(dest) ||
+      dev.txInFlight >= radio.txQueueDepth) {
+    stats.refused++;
+    return ESP_FAIL;
+  }
+
+  auto frame = std::make_shared<Frame>();
+  frame->src = dev.index;
+  memcpy(frame->srcMac, dev.mac, 6);
+  memcpy(frame->dest, dest, 6);
+  frame->channel = dev.channel;
+  frame->broadcast = isBroadcast(dest);
+  frame->airtimeUs =
+      radio.frameOverheadUs + (uint32_t)(len * radio.airtimePerByteUs);
+  frame->data.assign(data, data + len);
+
+  dev.txInFlight++;
+  request(frame, now());
+  return ESP_OK;
+}
+
+void Simulator::request(const FramePtr &frame, uint64_t t) {
+  Medium &m = _media[frame->channel];
+  bool contending = !m.waiting.empty() || t < m.lastStart;
+  bool unsensed = t >= m.lastStart && t < m.lastStart + radio.slotUs &&
+                  !m.startedTogether.empty();
+
+  // A device sends its own frames one after the other
+  for (auto &other : m.startedTogether)
+    if (other->src == frame->src)
+      unsensed = false;
+
+  if (!contending && (unsensed || t >= m.busyUntil)) {
+    startTx(frame, t); // Medium looks idle: transmit straight away
+    return;
+  }
+
+  // Binary exponential backoff: every failed attempt doubles the window
+  uint32_t window = (uint32_t)radio.contentionWindow
+                    << std::min<uint8_t>(frame->attempts, 6);
+  m.waiting.push_back({frame, randomUint(std::min<uint32_t>(window, 1024))});
+  if (!m.idleScheduled) {
+    m.idleScheduled = true;
+    uint8_t channel = frame->channel;
+    at(m.busyUntil, [this, channel] { onIdle(channel); });
+  }
+}
+
+void Simulator::startTx(const FramePtr &frame, uint64_t start) {
+  Medium &m = _media[frame->channel];
+
+  // Transmissions starting within one slot cannot hear each other
+  if (!m.startedTogether.empty() && start >= m.lastStart &&
+      start < m.lastStart + radio.slotUs) {
+    if (radio.collisions) {
+      frame->collided = true;
+      for (auto &other : m.startedTogether)
+        other->collided = true;
+    }
+  } else {
+    m.startedTogether.clear();
+    m.lastStart = start;
+  }
+  m.startedTogether.push_back(frame);
+
+  frame->attempts++;
+  stats.frames++;
+  uint64_t end = start + frame->airtimeUs;
+  if (end > m.busyUntil) {
+    stats.airtimeUs[frame->channel] += end - std::max(start, m.busyUntil);
+    m.busyUntil = end;
+  }
+  at(end, [this, frame] { finishTx(frame); });
+}
+
+void Simulator::onIdle(uint8_t channel) {
+  Medium &m = _media[channel];
+  m.idleScheduled = false;
+  if (m.waiting.empty())
+    return;
+  if (_now < m.busyUntil) {
+    m.idleScheduled = true;
+    at(m.busyUntil, [this, channel] { onIdle(channel); });
+    return;
+  }
+
+  // Only the oldest waiting frame of each device contends: a device sends
+  // its own frames in order
+  std::vector<bool> head(m.waiting.size(), true);
+  for (size_t i = 0; i < m.waiting.size(); i++)
+    for (size_t j = 0; j < i && head[i]; j++)
+      if (m.waiting[j].first->src == m.waiting[i].first->src)
+        head[i] = false;
+
+  // Lowest backoff wins the medium; equal draws collide
+  uint32_t lowest = UINT32_MAX;
+  for (size_t i = 0; i < m.waiting.size(); i++)
+    if (head[i])
+      lowest = std::min(lowest, m.waiting[i].second);
+  uint64_t start = _now + radio.difsUs + (uint64_t)lowest * radio.slotUs;
+
+  std::vector<FramePtr> winners;
+  std::vector<std::pair<FramePtr, uint32_t>> still;
+  for (size_t i = 0; i < m.waiting.size(); i++) {
+    auto &w = m.waiting[i];
+    if (head[i] && w.second == lowest) {
+      winners.push_back(w.first);
+      continue;
+    }
+    if (head[i])
+      w.second -= lowest; // Frozen counter resumes next round
+    still.push_back(w);
+  }
+  m.waiting.swap(still);
+  for (auto &frame : winners)
+    startTx(frame, start);
+
+  if (!m.waiting.empty()) {
+    m.idleScheduled = true;
+    at(m.busyUntil, [this, channel] { onIdle(channel); });
+  }
+}
+
+void Simulator::finishTx(const FramePtr &frame) {
+  uint64_t arrival = _now + radio.latencyUs + randomUint(radio.jitterUs + 1);
+  if (frame->collided)
+    stats.collided++;
+
+  if (frame->broadcast) {
+    if (!frame->collided) {
+      for (auto &dev : _devices) {
+        if (dev->index == frame->src ||
+            (inRange && !inRange(*_devices[frame->src], *dev)))
+          continue;
+        if (dev->asleep(_now)) {
+          stats.asleep++;
+          continue;
+        }
+        if (dev->maxFrame && frame->data.size() > dev->maxFrame) {
+          stats.tooLarge++;
+          continue;
+        }
+        if (randomUnit() < radio.loss) {
+          stats.lost++;
+          continue;
+        }
+        deliver(*dev, frame, arrival);
+      }
+    }
+    _devices[frame->src]->txInFlight--;
+    return;
+  }
+
+  Device *dest = nullptr;
+  for (auto &dev : _devices)
+    if (memcmp(dev->mac, frame->dest, 6) == 0)
+      dest = dev.get();
+
+  bool tooLarge = dest && dest->maxFrame &&
+                  frame->data.size() > dest->maxFrame;
+  bool reachable = dest && dest->radioOn && !dest->asleep(_now) && !tooLarge &&
+                   dest->channel == frame->channel &&
+                   (!inRange || inRange(*_devices[frame->src], *dest));
+  bool lost = !frame->collided && randomUnit() < radio.loss;
+  if (reachable && !frame->collided && !lost) {
+    deliver(*dest, frame, arrival);
+  } else if (frame->attempts <= radio.unicastRetries) {
+    // No ACK: the MAC retries after a fresh backoff
+    stats.retries++;
+    frame->collided = false;
+    request(frame, _now);
+    return;
+  } else if (dest && dest->asleep(_now)) {
+    stats.asleep++;
+  } else if (tooLarge) {
+    stats.tooLarge++;
+  } else if (!reachable) {
+    stats.offChannel++;
+  } else if (lost) {
+    stats.lost++;
+  }
+  _devices[frame->src]->txInFlight--;
+}
+
+void Simulator::deliver(Device &dev, const FramePtr &frame, uint64_t t) {
+  at(t, [this, &dev, frame] {
+    if (!dev.radioOn || dev.channel != frame->channel || !dev.recv)
+      return;
+
+    uint8_t src[6], dest[6];
+    memcpy(src, frame->srcMac, 6);
+    memcpy(dest, frame->dest, 6);
+    wifi_pkt_rx_ctrl_t ctrl = {};
+    ctrl.rssi = -50;
+    ctrl.channel = frame->channel;
+    esp_now_recv_info_t info = {src, dest, &ctrl};
+
+    // The receive callback runs at arrival time, whatever loop() is doing
+    Device *prevDevice = _current;
+    uint64_t *prevClock = _clock;
+    uint64_t arrival = _now;
+    _current = &dev;
+    _clock = &arrival;
+    LeaderSimHooks::activate(&dev);
+
+    stats.delivered++;
+    dev.recv(&info, frame->data.data(), (int)frame->data.size());
+
+    _current = prevDevice;
+    _clock = prevClock;
+    LeaderSimHooks::activate(prevDevice);
+  });
+}
+
+} // namespace sim
+
+// ==========================================
+// Arduino / ESP-IDF Shims
+// ==========================================
+
+using sim::active;
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+unsigned long millis() { return active().now() / 1000; }
+unsigned long micros() { return active().now(); }
+void delay(unsigned long ms) { active().advance((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { active().advance(us); }
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int analogRead(uint8_t) { return active().randomUint(4096); }
+
+long random(long howbig) { return active().randomUint(howbig); }
+long random(long howsmall, long howbig) {
+  return howsmall + (long)active().randomUint(howbig - howsmall);
+}
+
+uint32_t EspClass::getFreeHeap() { return 200000; }
+
+static sim::Port *currentPort() {
+  sim::Device *dev = active().current();
+  return dev ? &dev->usb.device : nullptr;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  if (sim::Device *dev = active().current())
+    dev->usb.setBaud(baud);
+}
+int HardwareSerial::available() {
+  sim::Port *port = currentPort();
+  return port ? port->available() : 0;
+}
+int HardwareSerial::read() {
+  sim::Port *port = currentPort();
+  return port ? port->read() : -1;
+}
+int HardwareSerial::peek() {
+  sim::Port *port = currentPort();
+  return port ? port->peek() : -1;
+}
+size_t HardwareSerial::write(uint8_t b) { return write(&b, 1); }
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  sim::Port *port = currentPort();
+  return port ? port->write(buffer, size) : 0;
+}
+int HardwareSerial::availableForWrite() {
+  sim::Port *port = currentPort();
+  return port ? port->availableForWrite() : 0;
+}
+
+static std::vector<uint8_t> g_scanResults;
+
+bool WiFiClass::mode(wifi_mode_t) { return true; }
+bool WiFiClass::disconnect(bool, bool) { return true; }
+
+int16_t WiFiClass::scanNetworks() {
+  active().advance(active().radio.scanUs);
+  g_scanResults.clear();
+  for (uint8_t ch = 1; ch <= 13; ch++)
+    for (uint8_t i = 0; i < active().ambientNetworks[ch]; i++)
+      g_scanResults.push_back(ch);
+  return (int16_t)g_scanResults.size();
+}
+
+int32_t WiFiClass::channel(uint8_t networkItem) {
+  return networkItem < g_scanResults.size() ? g_scanResults[networkItem] : 0;
+}
+
+void WiFiClass::scanDelete() { g_scanResults.clear(); }
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+  sim::Device *dev = active().current();
+  bool doze = type != WIFI_PS_NONE;
+  if (!dev || dev->dozing == doze)
+    return ESP_OK;
+  // No AP to sync with: modem sleep hears nothing outside the wake windows
+  if (doze)
+    dev->dozeStart = active().now();
+  else
+    dev->dozedUs += dev->sleepUs(dev->dozeStart, active().now());
+  dev->dozing = doze;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_connectionless_module_set_wake_interval(
+    uint16_t wake_interval) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  dev->wakeIntervalUs = wake_interval * 1000ULL;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t) {
+  sim::Device *dev = active().current();
+  if (!dev || primary < 1 || primary > 13)
+    return ESP_FAIL;
+  dev->channel = primary;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  *primary = dev->channel;
+  if (second)
+    *second = WIFI_SECOND_CHAN_NONE;
+  return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  memcpy(mac, dev->mac, 6);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_init(void) { return active().current() ? ESP_OK : ESP_FAIL; }
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  dev->recv = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  sim::Device *dev = active().current();
+  if (!dev || dev->hasPeer(peer->peer_addr))
+    return ESP_FAIL;
+  if (dev->peers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM)
+    return ESP_ERR_ESPNOW_FULL;
+  std::array<uint8_t, 6> addr;
+  memcpy(addr.data(), peer->peer_addr, 6);
+  dev->peers.push_back(addr);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t *peer) {
+  sim::Device *dev = active().current();
+  return dev && dev->hasPeer(peer->peer_addr) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *peer_addr) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  for (auto it = dev->peers.begin(); it != dev->peers.end(); ++it) {
+    if (memcmp(it->data(), peer_addr, 6) == 0) {
+      dev->peers.erase(it);
+      return ESP_OK;
+    }
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t esp_now_set_wake_window(uint16_t window) {
+  sim::Device *dev = active().current();
+  if (!dev)
+    return ESP_FAIL;
+  dev->wakeWindowUs = window * 1000ULL;
+  return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *peer_addr) {
+  sim::Device *dev = active().current();
+  return dev && dev->hasPeer(peer_addr);
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data,
+                       size_t len) {
+  sim::Device *dev = active().current();
+  return dev ? active().send(*dev, peer_addr, data, len) : ESP_FAIL;
+}
+
+struct esp_timer {
+  sim::Device *device;
+  esp_timer_cb_t callback;
+  void *arg;
+  uint32_t generation = 0; ///< Bumped on stop, retiring scheduled ticks
+};
+
+static std::vector<std::unique_ptr<esp_timer>> g_timers;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out_handle) {
+  sim::Device *dev = active().current();
+  if (!dev || !args || !args->callback)
+    return ESP_FAIL;
+  g_timers.push_back(std::unique_ptr<esp_timer>(
+      new esp_timer{dev, args->callback, args->arg}));
+  *out_handle = g_timers.back().get();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  if (!timer || period == 0)
+    return ESP_FAIL;
+  uint32_t generation = ++timer->generation;
+  sim::Simulator &s = active();
+  s.every(s.now() + period, period, [&s, timer, generation] {
+    if (timer->generation != generation)
+      return false;
+    s.runOn(*timer->device, [timer] { timer->callback(timer->arg); });
+    return true;
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer)
+    return ESP_FAIL;
+  timer->generation++;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  // Kept alive so ticks already queued can still see the stop
+  return esp_timer_stop(timer);
+}
+
+int64_t esp_timer_get_time(void) { return (int64_t)active().now(); }
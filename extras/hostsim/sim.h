@@ -0,0 +1,310 @@
+// ==========================================
+// LEADER HOST SIMULATOR CORE
+// ==========================================
+//
+// Discrete-event simulation of ESP32 devices running the unmodified LEADER
+// sources. Every device has its own clock view, serial link, peer table and
+// radio state; the shims in shim/ route Arduino, WiFi and ESP-NOW calls to
+// whichever device is currently executing.
+//
+// Time only advances through the event queue (and through delay() inside
+// device code), so runs are reproducible for a given seed.
+
+#ifndef LEADER_SIM_H
+#define LEADER_SIM_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+class OSCLeaderCore;
+class OSCFollowerCore;
+
+namespace sim {
+
+// ==========================================
+// Serial Links
+// ==========================================
+
+/**
+ * @brief One direction of a serial link, paced at the configured baud rate.
+ */
+class Pipe {
+public:
+  void setBaud(long baud) { _byteUs = baud > 0 ? 10e6 / baud : 0; }
+  void write(const uint8_t *data, size_t len, uint64_t now);
+  int available(uint64_t now) const;
+  int read(uint64_t now);
+  int peek(uint64_t now) const;
+  size_t queued() const { return _bytes.size(); }
+
+private:
+  struct Byte {
+    uint64_t readyAt;
+    uint8_t value;
+  };
+  std::deque<Byte> _bytes;
+  double _byteUs = 0;
+  double _lastReady = 0;
+};
+
+/**
+ * @brief Stream view of a link: reads one pipe, writes the other.
+ */
+class Port : public Stream {
+public:
+  Port(Pipe &in, Pipe &out) : _in(in), _out(out) {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int availableForWrite() override { return 4096; }
+  using Print::write;
+
+private:
+  Pipe &_in;
+  Pipe &_out;
+};
+
+/**
+ * @brief USB/UART cable between a device and its host computer.
+ */
+struct SerialLink {
+  Pipe toDevice;
+  Pipe toHost;
+  Port device{toDevice, toHost}; ///< What the firmware sees
+  Port host{toHost, toDevice};   ///< What the host application sees
+
+  void setBaud(long baud) {
+    toDevice.setBaud(baud);
+    toHost.setBaud(baud);
+  }
+};
+
+// ==========================================
+// Devices
+// ==========================================
+
+struct Device {
+  int index = 0;
+  uint8_t mac[6] = {};
+  uint8_t channel = 1;
+  bool radioOn = true;
+  bool dozing = false;    ///< Modem sleep: can transmit, hears nothing
+  uint64_t dozeStart = 0;
+  uint64_t dozedUs = 0;   ///< Time asleep while dozing, up to the last wake-up
+
+  /// Connectionless modem sleep still wakes the radio for wakeWindowUs
+  /// every wakeIntervalUs of simulated time; 0 = never
+  uint64_t wakeIntervalUs = 0;
+  uint64_t wakeWindowUs = 0;
+
+  /// Largest frame it sends or decodes; 0 = the build's limit, 250 models
+  /// an ESP-NOW v1 device in a v2 build
+  size_t maxFrame = 0;
+
+  esp_now_recv_cb_t recv = nullptr;
+  std::vector<std::array<uint8_t, 6>> peers;
+  int txInFlight = 0;
+
+  SerialLink usb;
+  OSCLeaderCore *leader = nullptr;
+  OSCFollowerCore *follower = nullptr;
+
+  /// Body of loop(); runs every loopPeriodUs of simulated time
+  std::function<void()> loop;
+  uint32_t loopPeriodUs = 100;
+  uint64_t clock = 0; ///< Local time, ahead of the queue while in delay()
+
+  bool hasPeer(const uint8_t *addr) const;
+
+  /// Dozing outside a wake window: frames sent to it now are missed
+  bool asleep(uint64_t now) const;
+
+  /// Time in [from, to) the radio would sleep if dozing throughout
+  uint64_t sleepUs(uint64_t from, uint64_t to) const;
+};
+
+// ==========================================
+// Virtual Radio
+// ==========================================
+
+struct RadioConfig {
+  double loss = 0.0;              ///< Per-receiver frame loss probability
+  uint32_t latencyUs = 150;       ///< Driver and task latency per frame
+  uint32_t jitterUs = 50;         ///< Uniform extra latency
+  double airtimePerByteUs = 8.0;  ///< 1 Mbit/s, the ESP-NOW default rate
+  uint32_t frameOverheadUs = 100; ///< Preamble, MAC header, ACK, IFS
+  uint32_t difsUs = 50;
+  uint32_t slotUs = 9;
+  uint8_t contentionWindow = 16; ///< Initial backoff window, in slots
+  bool collisions = true;        ///< Same-slot starts destroy each other
+  uint8_t unicastRetries = 3;    ///< MAC-level retries for unicast frames
+  uint8_t txQueueDepth = 8;      ///< esp_now_send() fails beyond this
+  uint32_t scanUs = 1560000;     ///< WiFi.scanNetworks() duration
+};
+
+struct RadioStats {
+  uint64_t frames = 0;     ///< Transmissions started, retries included
+  uint64_t delivered = 0;  ///< Frames handed to a receive callback
+  uint64_t lost = 0;       ///< Per-receiver random losses
+  uint64_t collided = 0;   ///< Transmissions destroyed by a collision
+  uint64_t retries = 0;    ///< Unicast retransmissions
+  uint64_t refused = 0;    ///< esp_now_send() calls that failed
+  uint64_t offChannel = 0; ///< Frames missed because the receiver hopped
+  uint64_t asleep = 0;     ///< Frames missed because the receiver dozed
+  uint64_t tooLarge = 0;   ///< Frames a v1 receiver could not decode
+  uint64_t airtimeUs[14] = {}; ///< Time each channel was occupied
+};
+
+struct Frame {
+  int src = -1;
+  uint8_t srcMac[6];
+  uint8_t dest[6];
+  uint8_t channel;
+  bool broadcast;
+  bool collided = false;
+  uint8_t attempts = 0;
+  uint32_t airtimeUs;
+  std::vector<uint8_t> data;
+};
+
+using FramePtr = std::shared_ptr<Frame>;
+
+// ==========================================
+// Simulator
+// ==========================================
+
+class Simulator {
+public:
+  explicit Simulator(const RadioConfig &radio = RadioConfig(),
+                     uint32_t seed = 1);
+  ~Simulator();
+
+  Device &addDevice();
+  Device &device(int index) { return *_devices[index]; }
+  size_t deviceCount() const { return _devices.size(); }
+
+  /**
+   * @brief Runs code in the context of a device (setup(), host pokes...).
+   */
+  void runOn(Device &dev, const std::function<void()> &fn);
+
+  /**
+   * @brief Schedules a callback at an absolute simulated time.
+   */
+  void at(uint64_t timeUs, std::function<void()> fn);
+
+  /**
+   * @brief Calls fn every periodUs, starting at startUs, until it returns
+   * false.
+   */
+  void every(uint64_t startUs, uint64_t periodUs, std::function<bool()> fn);
+
+  /**
+   * @brief Processes events until the given absolute time.
+   */
+  void runUntil(uint64_t timeUs);
+
+  uint64_t now() const { return _clock ? *_clock : _now; }
+  Device *current() { return _current; }
+  uint32_t randomUint(uint32_t bound) {
+    return bound ? std::uniform_int_distribution<uint32_t>(0, bound - 1)(
+                       _rng)
+                 : 0;
+  }
+  double randomUnit() { return std::uniform_real_distribution<>(0, 1)(_rng); }
+
+  // Called by the shims
+  esp_err_t send(Device &dev, const uint8_t *dest, const uint8_t *data,
+                 size_t len);
+  void advance(uint64_t us) {
+    if (_clock)
+      *_clock += us;
+  }
+
+  RadioConfig radio;
+  RadioStats stats;
+  uint8_t ambientNetworks[14] = {}; ///< Foreign APs per channel, for scans
+
+  /// Observes every frame a device hands to esp_now_send()
+  std::function<void(Device &, const uint8_t *, size_t)> onSend;
+
+  /// Whether a frame sent by the first device can reach the second; unset,
+  /// every device hears every other. Carrier sense stays channel-wide.
+  std::function<bool(const Device &, const Device &)> inRange;
+
+private:
+  struct Event {
+    uint64_t time;
+    uint64_t seq;
+    std::function<void()> fn;
+    bool operator>(const Event &other) const {
+      return time != other.time ? time > other.time : seq > other.seq;
+    }
+  };
+
+  struct Medium {
+    uint64_t busyUntil = 0;
+    uint64_t lastStart = 0;
+    std::vector<FramePtr> startedTogether;
+    std::vector<std::pair<FramePtr, uint32_t>> waiting; ///< Frame, backoff
+    bool idleScheduled = false;
+  };
+
+  void request(const FramePtr &frame, uint64_t t);
+  void startTx(const FramePtr &frame, uint64_t start);
+  void onIdle(uint8_t channel);
+  void finishTx(const FramePtr &frame);
+  void deliver(Device &dev, const FramePtr &frame, uint64_t t);
+  void scheduleLoop(Device &dev, uint64_t t);
+
+  std::vector<std::unique_ptr<Device>> _devices;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _events;
+  uint64_t _seq = 0;
+  uint64_t _now = 0;
+  uint64_t *_clock = nullptr;
+  Device *_current = nullptr;
+  Medium _media[14];
+  std::mt19937 _rng;
+};
+
+/**
+ * @brief The simulator the shims talk to. One at a time per process.
+ */
+Simulator &active();
+
+// ==========================================
+// Measurement
+// ==========================================
+
+class Latency {
+public:
+  void add(uint64_t us) { _samples.push_back((uint32_t)std::min<uint64_t>(us, UINT32_MAX)); }
+  size_t count() const { return _samples.size(); }
+  uint32_t percentile(double p) {
+    if (_samples.empty())
+      return 0;
+    size_t rank = (size_t)(p * (_samples.size() - 1));
+    std::nth_element(_samples.begin(), _samples.begin() + rank,
+                     _samples.end());
+    return _samples[rank];
+  }
+
+private:
+  std::vector<uint32_t> _samples;
+};
+
+} // namespace sim
+
+#endif
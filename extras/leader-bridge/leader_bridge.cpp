@@ -0,0 +1,1007 @@
+// ==========================================
+// LEADER HOST BRIDGE
+// ==========================================
+//
+// Owns the Leader's serial port and shares it with any number of local OSC
+// applications over UDP. Frames arriving from the Leader are fanned out to
+// every subscribed client; datagrams sent by clients are merged, in arrival
+// order, into the SLIP stream towards the Leader.
+//
+// Build (Linux only, no dependencies):
+//
+//   g++ -std=c++17 -O2 -Wall -o leader-bridge leader_bridge.cpp -lutil
+//
+// Run:
+//
+//   ./leader-bridge --device /dev/ttyACM0 --baud 1000000 --port 9000
+//   ./leader-bridge --pty --port 9000   # fake Leader on a pseudo-terminal
+//   ./leader-bridge --device /dev/ttyACM0 --device /dev/ttyACM1 --balance 5
+//
+// Clients subscribe simply by sending any datagram to the bridge port (an
+// empty "/bridge/subscribe" message is enough) and stay subscribed while they
+// keep sending at least once per idle timeout. Messages addressed to
+// "/bridge/..." are handled by the bridge itself:
+//
+//   /bridge/subscribe     register (or refresh) the sending client
+//   /bridge/unsubscribe   stop receiving Leader traffic
+//   /bridge/stats         reply with one "/bridge/client" message per client:
+//                         addr, toLeader, fromLeader, p50 us, p99 us
+//   /bridge/shards        reply with one "/bridge/shard" message per Leader:
+//                         port, shard, channel, nodes, air permille, frames
+//   /bridge/assign        nodeID shard: move a node to that shard's Leader
+//
+// Several --device (or --pty) options open one port per Leader, each serving
+// a shard (OSCLeader::enableSharding). Clients still see one namespace: every
+// port's frames are fanned out, and client messages go to every Leader,
+// except "/leader/send" and "/leader/shard/move" which go only to the Leader
+// the node last joined. The bridge polls "/leader/shard" every second; with
+// --balance PCT it sheds half the airtime gap from the busiest shard to the
+// idlest whenever they differ by more than PCT percent.
+//
+// Framing is the same SLIP used by OSCLeader (0xC0 END, 0xDB ESC). Leader
+// frames are decoded once into a pooled buffer and handed to sendmmsg() for
+// every client without further copies. Client datagrams are SLIP-encoded
+// straight from the recvmmsg() buffers into the serial TX queue.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_FRAME = 4096;    ///< Largest OSC message either way
+constexpr int MAX_CLIENTS = 32;       ///< Subscribers served at once
+constexpr int RECV_BATCH = 32;        ///< Datagrams pulled per recvmmsg()
+constexpr size_t TX_CAPACITY = 65536; ///< Serial-bound bytes kept queued
+constexpr size_t LATENCY_WINDOW = 1024;
+
+uint64_t nowMicros() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// ==========================================
+// Statistics
+// ==========================================
+
+/**
+ * @brief Rolling window of latency samples for percentile reporting.
+ */
+class LatencyWindow {
+public:
+  void add(uint64_t micros) {
+    _samples[_next] = micros > UINT32_MAX ? UINT32_MAX : (uint32_t)micros;
+    _next = (_next + 1) % LATENCY_WINDOW;
+    if (_count < LATENCY_WINDOW)
+      _count++;
+  }
+
+  uint32_t percentile(double p) const {
+    if (_count == 0)
+      return 0;
+    std::vector<uint32_t> sorted(_samples, _samples + _count);
+    size_t rank = (size_t)(p * (_count - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+  }
+
+private:
+  uint32_t _samples[LATENCY_WINDOW] = {};
+  size_t _count = 0;
+  size_t _next = 0;
+};
+
+struct Client {
+  sockaddr_in addr{};
+  bool used = false;
+  uint64_t lastHeard = 0;
+
+  uint64_t framesToLeader = 0;
+  uint64_t bytesToLeader = 0;
+  uint64_t framesFromLeader = 0;
+  uint64_t bytesFromLeader = 0;
+  uint64_t dropped = 0; ///< Client frames refused by a full serial queue
+
+  LatencyWindow toLeader;   ///< recvmmsg() to serial write completion
+  LatencyWindow fromLeader; ///< serial read to sendmmsg() completion
+
+  // Counters at the previous report, for rates
+  uint64_t lastFramesToLeader = 0;
+  uint64_t lastFramesFromLeader = 0;
+  uint64_t lastBytesToLeader = 0;
+  uint64_t lastBytesFromLeader = 0;
+
+  std::string name() const {
+    char text[32];
+    inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text));
+    return std::string(text) + ":" + std::to_string(ntohs(addr.sin_port));
+  }
+};
+
+// ==========================================
+// SLIP Codec (same framing as OSCLeader)
+// ==========================================
+
+/**
+ * @brief Streaming SLIP decoder. Completed frames stay in its buffer until
+ * the next byte is fed, so they can be fanned out without copying.
+ */
+class SlipDecoder {
+public:
+
+  /**
+   * @brief Feeds one byte.
+   * @return Length of a completed frame, 0 otherwise.
+   */
+  size_t feed(uint8_t b) {
+    if (b == 0xC0) {
+      size_t len = _overflow ? 0 : _len;
+      _len = 0;
+      _escaping = false;
+      _overflow = false;
+      return len;
+    }
+    if (b == 0xDB) {
+      _escaping = true;
+      return 0;
+    }
+    if (_escaping) {
+      b = b == 0xDC ? 0xC0 : b == 0xDD ? 0xDB : b;
+      _escaping = false;
+    }
+    if (_len < MAX_FRAME)
+      _frame[_len++] = b;
+    else
+      _overflow = true;
+    return 0;
+  }
+
+  const uint8_t *data() const { return _frame; }
+
+private:
+  uint8_t _frame[MAX_FRAME];
+  size_t _len = 0;
+  bool _escaping = false;
+  bool _overflow = false;
+};
+
+/**
+ * @brief Serial-bound byte queue fed with SLIP frames from many clients.
+ *
+ * Remembers where every frame ends so the time until it actually left for the
+ * Leader can be charged to the client that sent it.
+ */
+class SerialTx {
+public:
+  SerialTx() { _buf.resize(TX_CAPACITY); }
+
+  /**
+   * @brief SLIP-encodes one frame into the queue.
+   * @return False if the queue cannot hold the worst-case encoding.
+   */
+  bool push(const uint8_t *data, size_t len, int client, uint64_t stamp) {
+    if (_end + 2 * len + 2 > _buf.size()) {
+      compact();
+      if (_end + 2 * len + 2 > _buf.size())
+        return false;
+    }
+
+    uint8_t *out = _buf.data() + _end;
+    uint8_t *start = out;
+    *out++ = 0xC0;
+    for (size_t i = 0; i < len; i++) {
+      if (data[i] == 0xC0) {
+        *out++ = 0xDB;
+        *out++ = 0xDC;
+      } else if (data[i] == 0xDB) {
+        *out++ = 0xDB;
+        *out++ = 0xDD;
+      } else {
+        *out++ = data[i];
+      }
+    }
+    *out++ = 0xC0;
+
+    size_t encoded = out - start;
+    _end += encoded;
+    _queued += encoded;
+    _pending.push_back({_queued, client, stamp});
+    return true;
+  }
+
+  bool empty() const { return _begin == _end; }
+
+  /**
+   * @brief Writes as much as the descriptor accepts.
+   * @param onDone Called with (client, latency) for every frame fully sent.
+   * @return False on a fatal write error.
+   */
+  template <typename Done> bool drain(int fd, Done onDone) {
+    while (_begin < _end) {
+      ssize_t n = write(fd, _buf.data() + _begin, _end - _begin);
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+          break;
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      _begin += n;
+      _written += n;
+    }
+
+    uint64_t now = nowMicros();
+    while (!_pending.empty() && _pending.front().end <= _written) {
+      onDone(_pending.front().client, now - _pending.front().stamp);
+      _pending.pop_front();
+    }
+    if (_begin == _end)
+      _begin = _end = 0;
+    return true;
+  }
+
+private:
+  struct PendingFrame {
+    uint64_t end; ///< Absolute byte count at which this frame is fully sent
+    int client;
+    uint64_t stamp;
+  };
+
+  void compact() {
+    if (_begin == 0)
+      return;
+    memmove(_buf.data(), _buf.data() + _begin, _end - _begin);
+    _end -= _begin;
+    _begin = 0;
+  }
+
+  std::vector<uint8_t> _buf;
+  size_t _begin = 0;
+  size_t _end = 0;
+  uint64_t _queued = 0;
+  uint64_t _written = 0;
+  std::deque<PendingFrame> _pending;
+};
+
+// ==========================================
+// Minimal OSC helpers
+// ==========================================
+
+bool isAddress(const uint8_t *data, size_t len, const char *address) {
+  size_t addrLen = strlen(address);
+  return len > addrLen && memcmp(data, address, addrLen) == 0 &&
+         data[addrLen] == '\0';
+}
+
+void padTo4(std::vector<uint8_t> &out) {
+  do {
+    out.push_back(0);
+  } while (out.size() % 4 != 0);
+}
+
+/**
+ * @brief Packs "address ,s i..." (one string, then ints), as MiniOSC does.
+ */
+std::vector<uint8_t> packOsc(const char *address, const std::string &text,
+                             const std::vector<int32_t> &ints) {
+  std::vector<uint8_t> out(address, address + strlen(address));
+  padTo4(out);
+  out.push_back(',');
+  out.push_back('s');
+  out.insert(out.end(), ints.size(), 'i');
+  padTo4(out);
+  out.insert(out.end(), text.begin(), text.end());
+  padTo4(out);
+  for (int32_t v : ints) {
+    uint32_t net = htonl((uint32_t)v);
+    const uint8_t *p = (const uint8_t *)&net;
+    out.insert(out.end(), p, p + 4);
+  }
+  return out;
+}
+
+/**
+ * @brief Packs "address ,i..." with int arguments only.
+ */
+std::vector<uint8_t> packInts(const char *address,
+                              const std::vector<int32_t> &ints) {
+  std::vector<uint8_t> out(address, address + strlen(address));
+  padTo4(out);
+  out.push_back(',');
+  out.insert(out.end(), ints.size(), 'i');
+  padTo4(out);
+  for (int32_t v : ints) {
+    uint32_t net = htonl((uint32_t)v);
+    const uint8_t *p = (const uint8_t *)&net;
+    out.insert(out.end(), p, p + 4);
+  }
+  return out;
+}
+
+/**
+ * @brief Reads the leading int arguments of a message to address.
+ * @return Number of ints read, stopping at the first other type.
+ */
+int readInts(const uint8_t *data, size_t len, const char *address,
+             int32_t *out, int max) {
+  if (!isAddress(data, len, address))
+    return 0;
+  size_t tags = (strlen(address) + 4) & ~(size_t)3;
+  if (tags >= len || data[tags] != ',')
+    return 0;
+  const char *types = (const char *)data + tags;
+  size_t typeLen = strnlen(types, len - tags);
+  size_t offset = (tags + typeLen + 4) & ~(size_t)3;
+
+  int count = 0;
+  while (count < max && 1 + (size_t)count < typeLen &&
+         types[1 + count] == 'i' && offset + 4 <= len) {
+    uint32_t net;
+    memcpy(&net, data + offset, 4);
+    out[count++] = (int32_t)ntohl(net);
+    offset += 4;
+  }
+  return count;
+}
+
+// ==========================================
+// Serial Port
+// ==========================================
+
+speed_t baudConstant(long baud) {
+  switch (baud) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 500000:
+    return B500000;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  case 2000000:
+    return B2000000;
+  default:
+    return 0;
+  }
+}
+
+bool makeRaw(int fd, long baud) {
+  termios tio{};
+  if (tcgetattr(fd, &tio) != 0)
+    return false;
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  if (baud > 0) {
+    speed_t speed = baudConstant(baud);
+    if (speed == 0) {
+      fprintf(stderr, "unsupported baud rate %ld\n", baud);
+      return false;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+  }
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+void setNonBlocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+// ==========================================
+// Bridge
+// ==========================================
+
+struct Options {
+  std::vector<std::string> devices;
+  long baud = 1000000;
+  int ptys = 0;
+  std::string bind = "127.0.0.1";
+  int port = 9000;
+  int idleSeconds = 60;
+  int statsSeconds = 5;
+  int balancePct = 0; ///< Airtime gap between shards that triggers a shed
+};
+
+/**
+ * @brief One Leader serial link. With several, each serves one shard.
+ */
+struct LeaderPort {
+  std::string name;
+  int fd = -1;
+  int ptySlave = -1;
+  bool wantWrite = false;
+  SlipDecoder decoder;
+  SerialTx tx;
+
+  uint64_t frames = 0;
+  uint64_t malformed = 0;
+
+  // Last "/sys/shard" report
+  int shard = 0;
+  int channel = 0;
+  int nodes = 0;
+  int air = 0;        ///< Permille
+  bool fresh = false; ///< Reported since the last poll
+  int busiestID = 0;
+  int busiestLoad = 0;
+};
+
+class Bridge {
+public:
+  explicit Bridge(const Options &options)
+      : _options(options) {}
+
+  bool open();
+  int run();
+
+private:
+  bool openPort(LeaderPort &port, const std::string &device);
+  LeaderPort *findPort(int fd);
+  int findClient(const sockaddr_in &addr, bool create);
+  void onSerialReadable(LeaderPort &port);
+  void onSerialWritable(LeaderPort &port);
+  void onUdpReadable();
+  void trackLeader(int port, const uint8_t *frame, size_t len);
+  int routeOf(const uint8_t *data, size_t len) const;
+  void fanOut(const uint8_t *frame, size_t len, uint64_t stamp);
+  void handleLocal(int client, const uint8_t *data, size_t len);
+  void sendTo(int client, const std::vector<uint8_t> &msg);
+  void sendToLeader(int port, const std::vector<uint8_t> &msg);
+  bool assignNode(uint32_t nodeID, int shard);
+  void pollShards();
+  void expireClients();
+  void report(double seconds);
+  void updateSerialInterest(LeaderPort &port);
+
+  Options _options;
+  std::vector<LeaderPort> _ports;
+  int _udp = -1;
+  int _epoll = -1;
+  int _signals = -1;
+  int _timer = -1;
+
+  Client _clients[MAX_CLIENTS];
+
+  /// Port each node was last announced on, for routing "/leader/send"
+  std::unordered_map<uint32_t, int> _nodePort;
+  bool _balanceCooldown = false;
+  uint64_t _lastReport = 0;
+};
+
+bool Bridge::openPort(LeaderPort &port, const std::string &device) {
+  if (device.empty()) {
+    char name[128];
+    if (openpty(&port.fd, &port.ptySlave, name, nullptr, nullptr) != 0) {
+      perror("openpty");
+      return false;
+    }
+    // Keep the slave open so the master never reads EIO while idle
+    makeRaw(port.ptySlave, 0);
+    port.name = name;
+    printf("pty: %s\n", name);
+    fflush(stdout);
+  } else {
+    port.fd = ::open(device.c_str(), O_RDWR | O_NOCTTY);
+    if (port.fd < 0) {
+      perror(device.c_str());
+      return false;
+    }
+    if (!makeRaw(port.fd, _options.baud))
+      return false;
+    port.name = device;
+  }
+  setNonBlocking(port.fd);
+  return true;
+}
+
+bool Bridge::open() {
+  // Sized once: ports are never added after the loop starts
+  _ports.resize(_options.devices.size() + _options.ptys);
+  for (size_t i = 0; i < _ports.size(); i++) {
+    std::string device =
+        i < _options.devices.size() ? _options.devices[i] : std::string();
+    if (!openPort(_ports[i], device))
+      return false;
+  }
+
+  _udp = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(_options.port);
+  inet_pton(AF_INET, _options.bind.c_str(), &local.sin_addr);
+  if (bind(_udp, (sockaddr *)&local, sizeof(local)) != 0) {
+    perror("bind");
+    return false;
+  }
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
+  _signals = signalfd(-1, &mask, SFD_NONBLOCK);
+
+  _timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  itimerspec period{};
+  period.it_interval.tv_sec = 1;
+  period.it_value.tv_sec = 1;
+  timerfd_settime(_timer, 0, &period, nullptr);
+
+  _epoll = epoll_create1(0);
+  std::vector<int> fds = {_udp, _signals, _timer};
+  for (const LeaderPort &port : _ports)
+    fds.push_back(port.fd);
+  for (int fd : fds) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+  }
+  _lastReport = nowMicros();
+  return true;
+}
+
+LeaderPort *Bridge::findPort(int fd) {
+  for (LeaderPort &port : _ports)
+    if (port.fd == fd)
+      return &port;
+  return nullptr;
+}
+
+int Bridge::findClient(const sockaddr_in &addr, bool create) {
+  int freeSlot = -1;
+  for (int i = 0; i < MAX_CLIENTS; i++) {
+    if (!_clients[i].used) {
+      if (freeSlot < 0)
+        freeSlot = i;
+      continue;
+    }
+    if (_clients[i].addr.sin_addr.s_addr == addr.sin_addr.s_addr &&
+        _clients[i].addr.sin_port == addr.sin_port)
+      return i;
+  }
+  if (!create || freeSlot < 0)
+    return -1;
+
+  _clients[freeSlot] = Client();
+  _clients[freeSlot].used = true;
+  _clients[freeSlot].addr = addr;
+  fprintf(stderr, "+ client %s\n", _clients[freeSlot].name().c_str());
+  return freeSlot;
+}
+
+void Bridge::onSerialReadable(LeaderPort &port) {
+  uint8_t chunk[4096];
+  int index = &port - _ports.data();
+  for (;;) {
+    ssize_t n = read(port.fd, chunk, sizeof(chunk));
+    if (n <= 0)
+      return;
+    uint64_t stamp = nowMicros();
+    for (ssize_t i = 0; i < n; i++) {
+      size_t len = port.decoder.feed(chunk[i]);
+      if (len == 0)
+        continue;
+      if (len % 4 != 0) {
+        port.malformed++; // Not OSC-aligned: line noise or a truncated frame
+        continue;
+      }
+      port.frames++;
+      trackLeader(index, port.decoder.data(), len);
+      fanOut(port.decoder.data(), len, stamp);
+    }
+  }
+}
+
+void Bridge::trackLeader(int port, const uint8_t *frame, size_t len) {
+  if (frame[0] != '/' || frame[1] != 's')
+    return; // Only "/sys/..." changes the routing
+  int32_t v[96];
+  int count;
+  if (readInts(frame, len, "/sys/join", v, 1) == 1) {
+    _nodePort[v[0]] = port;
+  } else if (readInts(frame, len, "/sys/leave", v, 1) == 1) {
+    auto it = _nodePort.find(v[0]);
+    if (it != _nodePort.end() && it->second == port)
+      _nodePort.erase(it);
+  } else if (readInts(frame, len, "/sys/moved", v, 1) == 1) {
+    _nodePort.erase(v[0]); // Known again once it joins its new shard
+  } else if ((count = readInts(frame, len, "/sys/nodes", v, 96)) > 0) {
+    for (int i = 0; i + 2 < count; i += 3)
+      _nodePort[v[i]] = port;
+  } else if (readInts(frame, len, "/sys/shard", v, 6) == 6) {
+    LeaderPort &p = _ports[port];
+    p.shard = v[0];
+    p.channel = v[1];
+    p.nodes = v[2];
+    p.air = v[3];
+    p.fresh = true;
+    p.busiestID = v[4];
+    p.busiestLoad = v[5];
+  }
+}
+
+int Bridge::routeOf(const uint8_t *data, size_t len) const {
+  // Messages for one node go to the Leader that holds it, the rest to all
+  int32_t nodeID;
+  if (_ports.size() > 1 &&
+      (readInts(data, len, "/leader/send", &nodeID, 1) == 1 ||
+       readInts(data, len, "/leader/shard/move", &nodeID, 1) == 1)) {
+    auto it = _nodePort.find(nodeID);
+    if (it != _nodePort.end())
+      return it->second;
+  }
+  return -1;
+}
+
+void Bridge::fanOut(const uint8_t *frame, size_t len, uint64_t stamp) {
+  // One iovec shared by every datagram: the decoded frame is never copied
+  iovec iov{const_cast<uint8_t *>(frame), len};
+  mmsghdr msgs[MAX_CLIENTS];
+  int targets[MAX_CLIENTS];
+  int count = 0;
+
+  for (int i = 0; i < MAX_CLIENTS; i++) {
+    if (!_clients[i].used)
+      continue;
+    mmsghdr &m = msgs[count];
+    memset(&m, 0, sizeof(m));
+    m.msg_hdr.msg_name = &_clients[i].addr;
+    m.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    m.msg_hdr.msg_iov = &iov;
+    m.msg_hdr.msg_iovlen = 1;
+    targets[count++] = i;
+  }
+  if (count == 0)
+    return;
+
+  int sent = sendmmsg(_udp, msgs, count, 0);
+  uint64_t latency = nowMicros() - stamp;
+  for (int k = 0; k < sent; k++) {
+    Client &c = _clients[targets[k]];
+    c.framesFromLeader++;
+    c.bytesFromLeader += len;
+    c.fromLeader.add(latency);
+  }
+}
+
+void Bridge::onUdpReadable() {
+  static uint8_t buffers[RECV_BATCH][MAX_FRAME];
+  sockaddr_in from[RECV_BATCH];
+  iovec iov[RECV_BATCH];
+  mmsghdr msgs[RECV_BATCH];
+
+  for (;;) {
+    for (int i = 0; i < RECV_BATCH; i++) {
+      iov[i] = {buffers[i], MAX_FRAME};
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = &from[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = recvmmsg(_udp, msgs, RECV_BATCH, 0, nullptr);
+    if (count <= 0)
+      break;
+
+    uint64_t stamp = nowMicros();
+    for (int i = 0; i < count; i++) {
+      int client = findClient(from[i], true);
+      if (client < 0)
+        continue; // Client table full
+      Client &c = _clients[client];
+      c.lastHeard = stamp;
+
+      const uint8_t *data = buffers[i];
+      size_t len = msgs[i].msg_len;
+      if (len == 0)
+        continue;
+      if (len > 8 && memcmp(data, "/bridge/", 8) == 0) {
+        handleLocal(client, data, len);
+        continue;
+      }
+
+      // Merge into the Leader-bound streams straight from the receive buffer
+      int route = routeOf(data, len);
+      bool queued = true;
+      for (size_t p = 0; p < _ports.size(); p++)
+        if (route < 0 || (int)p == route)
+          queued &= _ports[p].tx.push(data, len, client, stamp);
+      if (queued) {
+        c.framesToLeader++;
+        c.bytesToLeader += len;
+      } else {
+        c.dropped++;
+      }
+    }
+  }
+
+  for (LeaderPort &port : _ports)
+    onSerialWritable(port);
+}
+
+void Bridge::handleLocal(int client, const uint8_t *data, size_t len) {
+  if (isAddress(data, len, "/bridge/unsubscribe")) {
+    fprintf(stderr, "- client %s\n", _clients[client].name().c_str());
+    _clients[client].used = false;
+    return;
+  }
+  if (isAddress(data, len, "/bridge/stats")) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+      const Client &c = _clients[i];
+      if (!c.used)
+        continue;
+      sendTo(client, packOsc("/bridge/client", c.name(),
+                             {(int32_t)c.framesToLeader,
+                              (int32_t)c.framesFromLeader,
+                              (int32_t)c.toLeader.percentile(0.50),
+                              (int32_t)c.toLeader.percentile(0.99)}));
+    }
+    return;
+  }
+  if (isAddress(data, len, "/bridge/shards")) {
+    for (const LeaderPort &port : _ports) {
+      int32_t nodes = 0;
+      for (const auto &entry : _nodePort)
+        nodes += &_ports[entry.second] == &port;
+      sendTo(client, packOsc("/bridge/shard", port.name,
+                             {port.shard, port.channel, nodes,
+                              port.air,
+                              (int32_t)port.frames}));
+    }
+    return;
+  }
+  int32_t args[2];
+  if (readInts(data, len, "/bridge/assign", args, 2) == 2) {
+    assignNode(args[0], args[1]);
+    return;
+  }
+  // "/bridge/subscribe" only needs the lastHeard refresh already done
+}
+
+void Bridge::sendTo(int client, const std::vector<uint8_t> &msg) {
+  sendto(_udp, msg.data(), msg.size(), 0,
+         (const sockaddr *)&_clients[client].addr, sizeof(sockaddr_in));
+}
+
+void Bridge::sendToLeader(int port, const std::vector<uint8_t> &msg) {
+  _ports[port].tx.push(msg.data(), msg.size(), -1, nowMicros());
+  onSerialWritable(_ports[port]);
+}
+
+bool Bridge::assignNode(uint32_t nodeID, int shard) {
+  auto owner = _nodePort.find(nodeID);
+  if (owner == _nodePort.end())
+    return false;
+  for (const LeaderPort &target : _ports) {
+    if (target.shard != shard || target.channel == 0)
+      continue;
+    if (_ports[owner->second].shard == shard)
+      return true; // Already there
+    sendToLeader(owner->second,
+                 packInts("/leader/shard/move",
+                          {(int32_t)nodeID, target.channel, shard}));
+    return true;
+  }
+  return false; // No Leader has reported that shard yet
+}
+
+void Bridge::pollShards() {
+  // Shed half the airtime gap from the busiest shard to the idlest, then
+  // give the moved nodes one report to show up before judging again
+  if (_options.balancePct > 0 && !_balanceCooldown) {
+    int busy = -1;
+    int idle = -1;
+    for (size_t i = 0; i < _ports.size(); i++) {
+      if (_ports[i].shard == 0 || !_ports[i].fresh)
+        continue;
+      if (busy < 0 || _ports[i].air > _ports[busy].air)
+        busy = i;
+      if (idle < 0 || _ports[i].air < _ports[idle].air)
+        idle = i;
+    }
+    int gap = busy >= 0 ? _ports[busy].air - _ports[idle].air : 0;
+    if (gap > _options.balancePct * 10) {
+      sendToLeader(busy, packInts("/leader/shard/shed",
+                                  {_ports[idle].channel, _ports[idle].shard,
+                                   gap / 2}));
+      _balanceCooldown = true;
+    }
+  } else {
+    _balanceCooldown = false;
+  }
+
+  std::vector<uint8_t> query = packInts("/leader/shard", {});
+  for (size_t i = 0; i < _ports.size(); i++) {
+    _ports[i].fresh = false;
+    sendToLeader(i, query);
+  }
+}
+
+void Bridge::onSerialWritable(LeaderPort &port) {
+  bool ok = port.tx.drain(port.fd, [this](int client, uint64_t latency) {
+    if (client >= 0 && _clients[client].used)
+      _clients[client].toLeader.add(latency);
+  });
+  if (!ok)
+    perror("serial write");
+  updateSerialInterest(port);
+}
+
+void Bridge::updateSerialInterest(LeaderPort &port) {
+  bool wantWrite = !port.tx.empty();
+  if (wantWrite == port.wantWrite)
+    return;
+  epoll_event ev{};
+  ev.events = wantWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  ev.data.fd = port.fd;
+  epoll_ctl(_epoll, EPOLL_CTL_MOD, port.fd, &ev);
+  port.wantWrite = wantWrite;
+}
+
+void Bridge::expireClients() {
+  uint64_t now = nowMicros();
+  uint64_t idle = (uint64_t)_options.idleSeconds * 1000000ULL;
+  for (int i = 0; i < MAX_CLIENTS; i++) {
+    if (_clients[i].used && now - _clients[i].lastHeard > idle) {
+      fprintf(stderr, "- client %s (idle)\n", _clients[i].name().c_str());
+      _clients[i].used = false;
+    }
+  }
+}
+
+void Bridge::report(double seconds) {
+  fprintf(stderr,
+          "%-22s %9s %9s %9s %9s %8s %8s %8s %8s %6s\n", "client",
+          "to/s", "from/s", "toKB/s", "fromKB/s", "toP50us", "toP99us",
+          "frP50us", "frP99us", "drop");
+  for (int i = 0; i < MAX_CLIENTS; i++) {
+    Client &c = _clients[i];
+    if (!c.used)
+      continue;
+    fprintf(stderr, "%-22s %9.1f %9.1f %9.2f %9.2f %8u %8u %8u %8u %6llu\n",
+            c.name().c_str(),
+            (c.framesToLeader - c.lastFramesToLeader) / seconds,
+            (c.framesFromLeader - c.lastFramesFromLeader) / seconds,
+            (c.bytesToLeader - c.lastBytesToLeader) / seconds / 1024.0,
+            (c.bytesFromLeader - c.lastBytesFromLeader) / seconds / 1024.0,
+            c.toLeader.percentile(0.50), c.toLeader.percentile(0.99),
+            c.fromLeader.percentile(0.50), c.fromLeader.percentile(0.99),
+            (unsigned long long)c.dropped);
+    c.lastFramesToLeader = c.framesToLeader;
+    c.lastFramesFromLeader = c.framesFromLeader;
+    c.lastBytesToLeader = c.bytesToLeader;
+    c.lastBytesFromLeader = c.bytesFromLeader;
+  }
+  for (const LeaderPort &port : _ports) {
+    fprintf(stderr, "leader %s frames: %llu, malformed: %llu",
+            port.name.c_str(), (unsigned long long)port.frames,
+            (unsigned long long)port.malformed);
+    if (port.shard)
+      fprintf(stderr, "; shard %d ch %d, %d nodes, %.1f%% air",
+              port.shard, port.channel, port.nodes, port.air / 10.0);
+    fprintf(stderr, "\n");
+  }
+}
+
+int Bridge::run() {
+  epoll_event events[8];
+  int ticks = 0;
+
+  for (;;) {
+    int n = epoll_wait(_epoll, events, 8, -1);
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (LeaderPort *port = findPort(fd)) {
+        if (events[i].events & EPOLLIN)
+          onSerialReadable(*port);
+        if (events[i].events & EPOLLOUT)
+          onSerialWritable(*port);
+        if (events[i].events & (EPOLLHUP | EPOLLERR) && port->ptySlave < 0) {
+          fprintf(stderr, "serial device %s closed\n", port->name.c_str());
+          return 1;
+        }
+      } else if (fd == _udp) {
+        onUdpReadable();
+      } else if (fd == _timer) {
+        uint64_t expirations;
+        if (read(_timer, &expirations, sizeof(expirations)) > 0) {
+          expireClients();
+          if (_ports.size() > 1)
+            pollShards();
+          if (_options.statsSeconds > 0 &&
+              ++ticks % _options.statsSeconds == 0) {
+            uint64_t now = nowMicros();
+            report((now - _lastReport) / 1e6);
+            _lastReport = now;
+          }
+        }
+      } else if (fd == _signals) {
+        report((nowMicros() - _lastReport) / 1e6);
+        return 0;
+      }
+    }
+  }
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: leader-bridge (--device PATH | --pty)... [--baud N]\n"
+          "                     [--bind ADDR] [--port N] [--idle S] "
+          "[--stats S]\n"
+          "                     [--balance PCT]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--device" && hasValue)
+      options.devices.push_back(argv[++i]);
+    else if (arg == "--baud" && hasValue)
+      options.baud = atol(argv[++i]);
+    else if (arg == "--pty")
+      options.ptys++;
+    else if (arg == "--bind" && hasValue)
+      options.bind = argv[++i];
+    else if (arg == "--port" && hasValue)
+      options.port = atoi(argv[++i]);
+    else if (arg == "--idle" && hasValue)
+      options.idleSeconds = atoi(argv[++i]);
+    else if (arg == "--stats" && hasValue)
+      options.statsSeconds = atoi(argv[++i]);
+    else if (arg == "--balance" && hasValue)
+      options.balancePct = atoi(argv[++i]);
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (options.devices.empty() && options.ptys == 0) {
+    usage();
+    return 2;
+  }
+
+  Bridge bridge(options);
+  if (!bridge.open())
+    return 1;
+  return bridge.run();
+}
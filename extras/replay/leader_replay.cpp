@@ -0,0 +1,980 @@
+// ==========================================
+// LEADER CAPTURE REPLAY
+// ==========================================
+//
+// Saves the traffic recorded by OSCLeader::enableCapture() and plays it back,
+// at its original pace or faster, into a real Leader or into the host
+// simulator, then reports latency and drops.
+//
+// Build from the repository root (Linux; the simulator is linked for --sim
+// and --synth):
+//
+//   g++ -std=gnu++17 -O2 -Iextras/hostsim/shim -Isrc src/*.cpp
+//       extras/hostsim/sim.cpp extras/replay/leader_replay.cpp
+//       -o leader-replay
+//
+// Run:
+//
+//   ./leader-replay --device /dev/ttyACM0 --start --bytes 65536
+//   ./leader-replay --device /dev/ttyACM0 --fetch show.lcap
+//   ./leader-replay --info show.lcap
+//   ./leader-replay --sim show.lcap --speed 4 --loss 0.01
+//   ./leader-replay --device /dev/ttyACM0 --replay show.lcap --speed 2
+//   ./leader-replay --synth demo.lcap --nodes 8 --seconds 5
+//   ./leader-replay --synth demo.lcap --cobs   # the same over COBS
+//
+// A .lcap file is a 16-byte header ("LCAP", version, entries, dropped)
+// followed by the LeaderCaptureRecord stream exactly as the Leader dumped it.
+//
+// --sim builds a simulated Leader and one virtual Follower per MAC seen in
+// the capture. Radio records are sent again by their Follower, host records
+// are written to the Leader's serial port, both at the captured times divided
+// by --speed. Latency is measured per message: radio -> host from the
+// Follower's send() to the host decode, host -> radio from the serial write
+// to each Follower's receive callback (every Follower for broadcasts, the
+// addressed one for "/leader/send"). Heartbeats are not replayed: a
+// captured "/sys/ping" interval makes the virtual Followers beat on their own.
+//
+// --replay against hardware can only inject the host side. It reports how
+// closely the frames kept to the schedule and the Leader's own sent/dropped
+// counters ("/leader/ping") over the run.
+//
+// --synth records a short simulated show with capture enabled and fetches
+// it through "/leader/capture/dump", for trying the tool without hardware.
+//
+// --cobs switches the host link to COBS with "/host/framing 1" before
+// anything else, as a host would, and back to SLIP when done with a device.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../hostsim/sim.h"
+
+#include <HostLink.h>
+#include <LEADER.h>
+#include <MiniOSC.h>
+
+namespace {
+
+struct Options {
+  std::string device;
+  long baud = 1000000;
+  std::string file;
+  std::string mode;
+  double speed = 1.0;
+  double loss = 0.0;
+  uint32_t seed = 1;
+  uint32_t captureBytes = LEADER_CAPTURE_BYTES;
+  int nodes = 8;
+  double seconds = 5;
+  bool cobs = false;
+};
+
+// ==========================================
+// Capture Files
+// ==========================================
+
+struct __attribute__((packed)) FileHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t entries;
+  uint32_t dropped; ///< Records the Leader overwrote before the dump
+};
+
+constexpr uint16_t FILE_VERSION = 1;
+
+struct Record {
+  uint64_t timeUs; ///< Since the first record, wrap-arounds undone
+  uint8_t dir;
+  uint8_t mac[6];
+  std::vector<uint8_t> data;
+};
+
+struct Capture {
+  std::vector<uint8_t> raw; ///< Records as dumped by the Leader
+  uint32_t dropped = 0;
+  std::vector<Record> records;
+
+  /// Splits the raw stream into records with 64-bit relative times
+  bool parse() {
+    records.clear();
+    size_t pos = 0;
+    uint32_t prev = 0;
+    uint64_t time = 0;
+    while (pos + sizeof(LeaderCaptureRecord) <= raw.size()) {
+      LeaderCaptureRecord header;
+      memcpy(&header, raw.data() + pos, sizeof(header));
+      pos += sizeof(header);
+      if (pos + header.len > raw.size())
+        return false;
+      if (!records.empty())
+        time += (uint32_t)(header.timeUs - prev);
+      prev = header.timeUs;
+
+      Record record;
+      record.timeUs = time;
+      record.dir = header.dir;
+      memcpy(record.mac, header.mac, 6);
+      record.data.assign(raw.data() + pos, raw.data() + pos + header.len);
+      records.push_back(std::move(record));
+      pos += header.len;
+    }
+    return pos == raw.size();
+  }
+
+  bool save(const std::string &path) const {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+      return false;
+    FileHeader header = {{'L', 'C', 'A', 'P'}, FILE_VERSION, 0,
+                         (uint32_t)records.size(), dropped};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(raw.data(), 1, raw.size(), f) == raw.size();
+    return fclose(f) == 0 && ok;
+  }
+
+  bool load(const std::string &path) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+      return false;
+    FileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, "LCAP", 4) == 0 &&
+              header.version == FILE_VERSION;
+    raw.clear();
+    uint8_t chunk[4096];
+    size_t n;
+    while (ok && (n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+      raw.insert(raw.end(), chunk, chunk + n);
+    fclose(f);
+    if (!ok)
+      return false;
+    dropped = header.dropped;
+    return parse();
+  }
+};
+
+bool hasAddress(const std::vector<uint8_t> &data, const char *address) {
+  size_t len = strlen(address);
+  return data.size() > len && memcmp(data.data(), address, len) == 0 &&
+         data[len] == '\0';
+}
+
+bool hasPrefix(const std::vector<uint8_t> &data, const char *prefix) {
+  size_t len = strlen(prefix);
+  return data.size() > len && memcmp(data.data(), prefix, len) == 0;
+}
+
+/// Host frames that would change the replay itself rather than the show
+bool skipHostFrame(const Record &record) {
+  return hasAddress(record.data, "/host/framing") ||
+         hasAddress(record.data, "/leader/heartbeats") ||
+         hasPrefix(record.data, "/leader/capture");
+}
+
+std::string macText(const uint8_t *mac) {
+  char text[18];
+  snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0],
+           mac[1], mac[2], mac[3], mac[4], mac[5]);
+  return text;
+}
+
+std::string addressOf(const std::vector<uint8_t> &data) {
+  size_t len = strnlen((const char *)data.data(), data.size());
+  return std::string((const char *)data.data(), len);
+}
+
+void printInfo(const Capture &capture) {
+  std::map<std::string, std::pair<uint64_t, uint64_t>> byAddress;
+  std::set<std::string> nodes;
+  for (const Record &record : capture.records) {
+    auto &count = byAddress[addressOf(record.data)];
+    (record.dir == CAPTURE_HOST ? count.first : count.second)++;
+    if (record.dir == CAPTURE_RADIO)
+      nodes.insert(macText(record.mac));
+  }
+  double span =
+      capture.records.empty() ? 0 : capture.records.back().timeUs / 1e6;
+  printf("%zu records over %.3f s from %zu nodes, %u overwritten before "
+         "the dump\n",
+         capture.records.size(), span, nodes.size(), capture.dropped);
+  printf("%-32s %10s %10s\n", "address", "host", "radio");
+  for (const auto &entry : byAddress)
+    printf("%-32s %10llu %10llu\n", entry.first.c_str(),
+           (unsigned long long)entry.second.first,
+           (unsigned long long)entry.second.second);
+}
+
+// ==========================================
+// Simulated Replay
+// ==========================================
+
+constexpr uint64_t BOOT_US = 500000;  ///< Binding before the first record
+constexpr uint64_t DRAIN_US = 500000; ///< Lets in-flight traffic land
+
+using Pending = std::map<std::vector<uint8_t>, std::deque<uint64_t>>;
+
+struct Direction {
+  uint64_t expected = 0;
+  uint64_t received = 0;
+  sim::Latency latency;
+
+  void expect(Pending &pending, const uint8_t *data, int len, uint64_t now) {
+    pending[std::vector<uint8_t>(data, data + len)].push_back(now);
+    expected++;
+  }
+
+  void match(Pending &pending, const uint8_t *data, int len, uint64_t now) {
+    auto it = pending.find(std::vector<uint8_t>(data, data + len));
+    if (it == pending.end() || it->second.empty())
+      return;
+    latency.add(now - it->second.front());
+    it->second.pop_front();
+    received++;
+  }
+
+  void print(const char *name) {
+    double drops =
+        expected ? 100.0 * (expected - std::min(received, expected)) / expected
+                 : 0;
+    printf("%-14s %9llu %9llu %7.2f%% %9u %9u %9u\n", name,
+           (unsigned long long)expected, (unsigned long long)received, drops,
+           latency.percentile(0.5), latency.percentile(0.99),
+           latency.percentile(1.0));
+  }
+};
+
+/// One Leader and its Followers in a simulator, driven from the host side
+struct SimNetwork {
+  explicit SimNetwork(const Options &options)
+      : sim(radioFor(options), options.seed), _baud(options.baud),
+        _cobs(options.cobs) {
+    _current = this;
+  }
+  ~SimNetwork() { _current = nullptr; }
+
+  sim::Simulator sim;
+  sim::Device *leaderDev = nullptr;
+  OSCLeader leader;
+  std::vector<sim::Device *> followerDevs;
+  std::vector<std::unique_ptr<OSCFollower>> followers;
+
+  std::function<void(sim::Device &, const uint8_t *, int)> onFollowerReceive;
+  std::function<void(const uint8_t *, int)> onHostReceive;
+
+  void addLeader(uint8_t channel) {
+    leaderDev = &sim.addDevice();
+    leaderDev->leader = &leader;
+    leaderDev->usb.setBaud(_baud);
+    sim::Device &dev = *leaderDev;
+    sim.runOn(dev, [&] { leader.begin(dev.usb.device, _baud, channel); });
+    dev.loop = [this] { leader.update(); };
+
+    _hostOut.begin(&dev.usb.host);
+    _hostOut.setPolicy(FLUSH_IMMEDIATE, 0);
+    sim.every(0, 50, [this] {
+      sim::Port &port = leaderDev->usb.host;
+      while (port.available() > 0) {
+        int frameLen = _hostIn.feed((uint8_t)port.read());
+        if (frameLen > 0 && !switchFraming(_hostIn.data(), frameLen) &&
+            onHostReceive)
+          onHostReceive(_hostIn.data(), frameLen);
+      }
+      return true;
+    });
+
+    // Before the Followers bind: nothing else is in flight on the link
+    if (_cobs)
+      sim.at(20000, [this] {
+        OSCValue mode;
+        mode.type = 'i';
+        mode.i = FRAMING_COBS;
+        uint8_t buffer[32];
+        hostSend(buffer, MiniOSC::pack(buffer, "/host/framing", &mode, 1));
+      });
+  }
+
+  /// Framing of the host link as the host decodes it
+  HostFraming hostFraming() const { return _hostIn.framing(); }
+
+  OSCFollower &addFollower(const uint8_t *mac, uint8_t channel) {
+    sim::Device &dev = sim.addDevice();
+    if (mac)
+      memcpy(dev.mac, mac, 6);
+    followers.push_back(std::make_unique<OSCFollower>());
+    OSCFollower *follower = followers.back().get();
+    dev.follower = follower;
+    followerDevs.push_back(&dev);
+    sim.runOn(dev, [&] {
+      follower->begin(channel, false);
+      follower->onReceive(followerCallback);
+    });
+    dev.loop = [follower] { follower->update(); };
+    return *follower;
+  }
+
+  void hostSend(const uint8_t *data, int len) {
+    _hostOut.writeFrame(data, len);
+    _hostOut.flush();
+  }
+
+  /// Broadcasts a bare "/sys/ping" a few times: binds every Follower and
+  /// has it answer with its node ID, so "/leader/send" can find it
+  void bindFollowers() {
+    for (uint64_t t = 100000; t <= 200000; t += 50000)
+      sim.at(t, [this] {
+        uint8_t buffer[32];
+        int len = MiniOSC::pack(buffer, "/sys/ping", nullptr, 0);
+        hostSend(buffer, len);
+      });
+  }
+
+private:
+  /// Follows the Leader's "/host/framing" acknowledgement, which arrives in
+  /// the old framing; everything after it is in the new one
+  bool switchFraming(const uint8_t *data, int len) {
+    OSCValue mode[1];
+    if (MiniOSC::extract(data, len, "/host/framing", mode, 1) != 1 ||
+        mode[0].type != 'i')
+      return false;
+    _hostIn.setFraming((HostFraming)mode[0].i);
+    _hostOut.setFraming((HostFraming)mode[0].i);
+    return true;
+  }
+
+  static sim::RadioConfig radioFor(const Options &options) {
+    sim::RadioConfig radio;
+    radio.loss = options.loss;
+    return radio;
+  }
+
+  static void followerCallback(const uint8_t *data, int len) {
+    if (_current && _current->onFollowerReceive)
+      _current->onFollowerReceive(*_current->sim.current(), data, len);
+  }
+
+  static SimNetwork *_current;
+  long _baud;
+  bool _cobs;
+  HostOutput _hostOut;
+  HostInput _hostIn;
+};
+
+SimNetwork *SimNetwork::_current = nullptr;
+
+/// Reports the host link framing; 1 if --cobs did not take
+int checkFraming(const SimNetwork &net, const Options &options) {
+  bool cobs = net.hostFraming() == FRAMING_COBS;
+  printf("host link: %s\n", cobs ? "COBS" : "SLIP");
+  if (options.cobs && !cobs) {
+    fprintf(stderr, "the Leader did not switch to COBS\n");
+    return 1;
+  }
+  return 0;
+}
+
+int replaySim(const Capture &capture, const Options &options) {
+  SimNetwork net(options);
+  net.addLeader(1);
+  net.sim.runOn(*net.leaderDev,
+                [&] { net.leader.setHeartbeatPassThrough(true); });
+
+  // One virtual Follower per node heard in the capture
+  std::map<std::vector<uint8_t>, int> byMac;
+  for (const Record &record : capture.records) {
+    std::vector<uint8_t> mac(record.mac, record.mac + 6);
+    if (record.dir == CAPTURE_RADIO && !byMac.count(mac)) {
+      byMac[mac] = (int)net.followerDevs.size();
+      net.addFollower(record.mac, 1);
+    }
+  }
+  net.bindFollowers();
+
+  Direction toHost, toRadio;
+  Pending hostPending;
+  std::vector<Pending> nodePending(net.followerDevs.size());
+  uint64_t skipped = 0, heartbeats = 0;
+
+  net.onHostReceive = [&](const uint8_t *data, int len) {
+    toHost.match(hostPending, data, len, net.sim.now());
+  };
+  net.onFollowerReceive = [&](sim::Device &dev, const uint8_t *data, int len) {
+    for (size_t i = 0; i < net.followerDevs.size(); i++)
+      if (net.followerDevs[i] == &dev)
+        toRadio.match(nodePending[i], data, len, net.sim.now());
+  };
+
+  uint64_t last = 0;
+  for (const Record &record : capture.records) {
+    uint64_t t = BOOT_US + (uint64_t)(record.timeUs / options.speed);
+    last = t;
+
+    if (record.dir == CAPTURE_RADIO) {
+      // Live Followers regenerate their heartbeats from the replayed ping
+      if (hasAddress(record.data, "/sys/pong")) {
+        heartbeats++;
+        continue;
+      }
+      int node = byMac[std::vector<uint8_t>(record.mac, record.mac + 6)];
+      sim::Device *dev = net.followerDevs[node];
+      const std::vector<uint8_t> *data = &record.data;
+      net.sim.at(t, [&net, &toHost, &hostPending, dev, data] {
+        net.sim.runOn(*dev, [&] {
+          toHost.expect(hostPending, data->data(), (int)data->size(),
+                        net.sim.now());
+          dev->follower->send(data->data(), (int)data->size());
+        });
+      });
+      continue;
+    }
+
+    if (skipHostFrame(record)) {
+      skipped++;
+      continue;
+    }
+    const std::vector<uint8_t> *data = &record.data;
+    net.sim.at(t, [&, data] {
+      uint64_t now = net.sim.now();
+      if (hasAddress(*data, "/leader/send")) {
+        // Expected at the one node whose ID matches
+        OSCValue args[2];
+        if (MiniOSC::extract(data->data(), (int)data->size(), "/leader/send",
+                             args, 2) == 2 &&
+            args[1].type == 'b')
+          for (size_t i = 0; i < net.followerDevs.size(); i++) {
+            const uint8_t *mac = net.followerDevs[i]->mac;
+            if ((uint32_t)args[0].i == (uint32_t)((mac[4] << 8) | mac[5]))
+              toRadio.expect(nodePending[i], (const uint8_t *)args[1].s,
+                             args[1].len, now);
+          }
+      } else if (!hasPrefix(*data, "/leader/")) {
+        for (Pending &pending : nodePending)
+          toRadio.expect(pending, data->data(), (int)data->size(), now);
+      }
+      net.hostSend(data->data(), (int)data->size());
+    });
+  }
+
+  net.sim.runUntil(last + DRAIN_US);
+
+  double span =
+      capture.records.empty() ? 0 : capture.records.back().timeUs / 1e6;
+  printf("replayed %zu records (%.3f s captured) at %.2fx into %zu "
+         "simulated Followers, loss %.3f\n",
+         capture.records.size(), span, options.speed, net.followerDevs.size(),
+         options.loss);
+  printf("%llu heartbeats left to the Followers, %llu host control frames "
+         "skipped\n",
+         (unsigned long long)heartbeats, (unsigned long long)skipped);
+  printf("%-14s %9s %9s %8s %9s %9s %9s\n", "direction", "expected",
+         "received", "drops", "p50 us", "p99 us", "max us");
+  toHost.print("radio->host");
+  toRadio.print("host->radio");
+  printf("radio: %llu frames, %llu collided, %llu lost, %llu refused\n",
+         (unsigned long long)net.sim.stats.frames,
+         (unsigned long long)net.sim.stats.collided,
+         (unsigned long long)net.sim.stats.lost,
+         (unsigned long long)net.sim.stats.refused);
+  return checkFraming(net, options);
+}
+
+/// Records a small simulated show and fetches it like --fetch would
+int synthesize(const Options &options) {
+  SimNetwork net(options);
+  net.addLeader(1);
+  net.sim.runOn(*net.leaderDev,
+                [&] { net.leader.enableCapture(options.captureBytes); });
+  for (int i = 0; i < options.nodes; i++)
+    net.addFollower(nullptr, 1);
+  net.bindFollowers();
+
+  uint64_t start = BOOT_US;
+  uint64_t end = start + (uint64_t)(options.seconds * 1e6);
+
+  // Heartbeats every 100 ms, cues at 20 Hz in between, a unicast now and then
+  net.sim.at(start + 25000, [&] {
+    OSCValue interval;
+    interval.type = 'i';
+    interval.i = 100;
+    uint8_t buffer[32];
+    int len = MiniOSC::pack(buffer, "/sys/ping", &interval, 1);
+    net.hostSend(buffer, len);
+  });
+  auto cue = std::make_shared<int32_t>(0);
+  net.sim.every(start, 50000, [&, cue, end] {
+    if (net.sim.now() >= end)
+      return false;
+    OSCValue vals[2];
+    vals[0].type = 'i';
+    vals[0].i = (*cue)++;
+    vals[1].type = 'f';
+    vals[1].f = (*cue % 100) / 100.0f;
+    uint8_t buffer[64];
+    int len = MiniOSC::pack(buffer, "/demo/cue", vals, 2);
+    net.hostSend(buffer, len);
+
+    if (*cue % 10 == 0) {
+      const uint8_t *mac = net.followerDevs[*cue / 10 % options.nodes]->mac;
+      uint8_t inner[32];
+      OSCValue note;
+      note.type = 'i';
+      note.i = *cue;
+      OSCValue args[2];
+      args[0].type = 'i';
+      args[0].i = (mac[4] << 8) | mac[5];
+      args[1].type = 'b';
+      args[1].s = (const char *)inner;
+      args[1].len = MiniOSC::pack(inner, "/demo/note", &note, 1);
+      len = MiniOSC::pack(buffer, "/leader/send", args, 2);
+      net.hostSend(buffer, len);
+    }
+    return true;
+  });
+
+  // Every Follower streams a sensor at 50 Hz
+  for (sim::Device *dev : net.followerDevs) {
+    OSCFollowerCore *follower = dev->follower;
+    auto next = std::make_shared<uint64_t>(start + net.sim.randomUint(20000));
+    auto seq = std::make_shared<int32_t>(0);
+    dev->loop = [follower, next, seq, end] {
+      follower->update();
+      uint64_t now = micros();
+      if (now < *next || now >= end)
+        return;
+      *next += 20000;
+      OSCFrame &frame = follower->beginFrame("/demo/sensor", "if");
+      frame.addInt((*seq)++).addFloat((*seq % 50) / 50.0f);
+      follower->commitFrame(frame);
+    };
+  }
+
+  // Fetch the ring through the host link, as from a real Leader
+  Capture capture;
+  bool done = false;
+  net.onHostReceive = [&](const uint8_t *data, int len) {
+    OSCValue vals[3];
+    if (MiniOSC::extract(data, len, "/sys/capture", vals, 1) == 1 &&
+        vals[0].type == 'b')
+      capture.raw.insert(capture.raw.end(), (const uint8_t *)vals[0].s,
+                         (const uint8_t *)vals[0].s + vals[0].len);
+    else if (MiniOSC::extract(data, len, "/sys/capture/end", vals, 3) == 3) {
+      capture.dropped = vals[1].i;
+      done = true;
+    }
+  };
+  net.sim.at(end + DRAIN_US, [&] {
+    uint8_t buffer[32];
+    int len = MiniOSC::pack(buffer, "/leader/capture/dump", nullptr, 0);
+    net.hostSend(buffer, len);
+  });
+  net.sim.runUntil(end + 2 * DRAIN_US + 5000000);
+
+  if (!done || !capture.parse()) {
+    fprintf(stderr, "capture dump incomplete\n");
+    return 1;
+  }
+  if (!capture.save(options.file)) {
+    fprintf(stderr, "cannot write %s\n", options.file.c_str());
+    return 1;
+  }
+  printInfo(capture);
+  return checkFraming(net, options);
+}
+
+// ==========================================
+// Serial Leader
+// ==========================================
+
+speed_t baudConstant(long baud) {
+  switch (baud) {
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 500000:
+    return B500000;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  case 2000000:
+    return B2000000;
+  default:
+    return 0;
+  }
+}
+
+uint64_t nowMicros() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Stream over a raw, non-blocking serial port, so HostOutput and
+ * HostInput frame exactly as the Leader does.
+ */
+class SerialPort : public Stream {
+public:
+  ~SerialPort() {
+    if (_fd >= 0)
+      close(_fd);
+  }
+
+  bool open(const std::string &path, long baud) {
+    _fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0)
+      return false;
+    termios tio{};
+    if (tcgetattr(_fd, &tio) != 0)
+      return false;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    speed_t speed = baudConstant(baud);
+    if (speed == 0) {
+      fprintf(stderr, "unsupported baud rate %ld\n", baud);
+      return false;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(_fd, TCSANOW, &tio) == 0;
+  }
+
+  int available() override {
+    fill();
+    return (int)(_end - _pos);
+  }
+  int read() override {
+    fill();
+    return _pos < _end ? _buf[_pos++] : -1;
+  }
+  int peek() override {
+    fill();
+    return _pos < _end ? _buf[_pos] : -1;
+  }
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *data, size_t size) override {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t n = ::write(_fd, data + done, size - done);
+      if (n > 0) {
+        done += n;
+      } else if (n < 0 && errno == EAGAIN) {
+        pollfd pfd = {_fd, POLLOUT, 0};
+        poll(&pfd, 1, 100);
+      } else {
+        break;
+      }
+    }
+    return done;
+  }
+  using Print::write;
+
+  /// Waits up to timeoutMs for input
+  bool wait(int timeoutMs) {
+    if (_pos < _end)
+      return true;
+    pollfd pfd = {_fd, POLLIN, 0};
+    return poll(&pfd, 1, timeoutMs) > 0;
+  }
+
+private:
+  void fill() {
+    if (_pos < _end)
+      return;
+    ssize_t n = ::read(_fd, _buf, sizeof(_buf));
+    _pos = 0;
+    _end = n > 0 ? n : 0;
+  }
+
+  int _fd = -1;
+  uint8_t _buf[4096];
+  size_t _pos = 0;
+  size_t _end = 0;
+};
+
+struct SerialLeader {
+  SerialPort port;
+  HostOutput out;
+  HostInput in;
+
+  /// Leaves the Leader in SLIP, the framing other hosts expect
+  ~SerialLeader() {
+    if (in.framing() == FRAMING_COBS)
+      framing(FRAMING_SLIP);
+  }
+
+  bool open(const Options &options) {
+    if (!port.open(options.device, options.baud)) {
+      fprintf(stderr, "cannot open %s: %s\n", options.device.c_str(),
+              strerror(errno));
+      return false;
+    }
+    out.begin(&port);
+    out.setPolicy(FLUSH_IMMEDIATE, 0);
+    if (options.cobs && !framing(FRAMING_COBS)) {
+      fprintf(stderr, "no reply to /host/framing\n");
+      return false;
+    }
+    return true;
+  }
+
+  /// Switches both directions once the Leader acknowledges, in the old
+  /// framing, "/host/framing mode"
+  bool framing(HostFraming mode) {
+    OSCValue value;
+    value.type = 'i';
+    value.i = mode;
+    command("/host/framing", &value, 1);
+    return poll(500, [&](const uint8_t *data, int len) {
+      OSCValue ack[1];
+      if (MiniOSC::extract(data, len, "/host/framing", ack, 1) != 1 ||
+          ack[0].type != 'i' || ack[0].i != mode)
+        return false;
+      in.setFraming(mode);
+      out.setFraming(mode);
+      return true;
+    });
+  }
+
+  void send(const uint8_t *data, int len) {
+    out.writeFrame(data, len);
+    out.flush();
+  }
+
+  void command(const char *address, OSCValue *args = nullptr, int count = 0) {
+    uint8_t buffer[64];
+    send(buffer, MiniOSC::pack(buffer, address, args, count));
+  }
+
+  /// Feeds frames to fn until it returns true or timeoutMs of silence
+  template <typename Fn> bool poll(int timeoutMs, Fn fn) {
+    while (port.wait(timeoutMs)) {
+      while (port.available() > 0) {
+        int len = in.feed((uint8_t)port.read());
+        if (len > 0 && fn(in.data(), len))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  /// "/leader/ping" sent and dropped counters
+  bool counters(uint32_t &sent, uint32_t &dropped) {
+    command("/leader/ping");
+    return poll(500, [&](const uint8_t *data, int len) {
+      OSCValue vals[5];
+      if (MiniOSC::extract(data, len, "/leader/ping", vals, 5) != 5)
+        return false;
+      sent = vals[3].i;
+      dropped = vals[4].i;
+      return true;
+    });
+  }
+};
+
+int startCapture(const Options &options) {
+  SerialLeader leader;
+  if (!leader.open(options))
+    return 1;
+  OSCValue args[2];
+  args[0].type = 'i';
+  args[0].i = 1;
+  args[1].type = 'i';
+  args[1].i = options.captureBytes;
+  leader.command("/leader/capture", args, 2);
+  printf("capturing into a %u-byte ring\n", options.captureBytes);
+  return 0;
+}
+
+int fetchCapture(const Options &options) {
+  SerialLeader leader;
+  if (!leader.open(options))
+    return 1;
+
+  Capture capture;
+  leader.command("/leader/capture/dump");
+  bool done = leader.poll(2000, [&](const uint8_t *data, int len) {
+    OSCValue vals[3];
+    if (MiniOSC::extract(data, len, "/sys/capture", vals, 1) == 1 &&
+        vals[0].type == 'b') {
+      capture.raw.insert(capture.raw.end(), (const uint8_t *)vals[0].s,
+                         (const uint8_t *)vals[0].s + vals[0].len);
+      return false;
+    }
+    if (MiniOSC::extract(data, len, "/sys/capture/end", vals, 3) == 3) {
+      capture.dropped = vals[1].i;
+      return true;
+    }
+    return false;
+  });
+  if (!done || !capture.parse()) {
+    fprintf(stderr, "capture dump incomplete\n");
+    return 1;
+  }
+  if (!capture.save(options.file)) {
+    fprintf(stderr, "cannot write %s\n", options.file.c_str());
+    return 1;
+  }
+  printInfo(capture);
+  return 0;
+}
+
+int replayDevice(const Capture &capture, const Options &options) {
+  SerialLeader leader;
+  if (!leader.open(options))
+    return 1;
+
+  uint32_t sentBefore = 0, droppedBefore = 0;
+  if (!leader.counters(sentBefore, droppedBefore)) {
+    fprintf(stderr, "no reply to /leader/ping\n");
+    return 1;
+  }
+
+  sim::Latency lag;
+  uint64_t replayed = 0, radioRecords = 0, heard = 0;
+  uint64_t start = nowMicros() + 100000;
+  for (const Record &record : capture.records) {
+    if (record.dir == CAPTURE_RADIO) {
+      radioRecords++;
+      continue;
+    }
+    if (skipHostFrame(record))
+      continue;
+
+    uint64_t due = start + (uint64_t)(record.timeUs / options.speed);
+    // Drain the Leader while waiting, so its output never backs up
+    for (;;) {
+      uint64_t now = nowMicros();
+      if (now >= due)
+        break;
+      if (due - now > 2000)
+        leader.poll(0, [&](const uint8_t *, int) {
+          heard++;
+          return false;
+        });
+      else
+        std::this_thread::yield();
+    }
+    leader.send(record.data.data(), (int)record.data.size());
+    lag.add(nowMicros() - due);
+    replayed++;
+  }
+  leader.poll(200, [&](const uint8_t *, int) {
+    heard++;
+    return false;
+  });
+
+  uint32_t sentAfter = 0, droppedAfter = 0;
+  if (!leader.counters(sentAfter, droppedAfter)) {
+    fprintf(stderr, "no reply to /leader/ping after the replay\n");
+    return 1;
+  }
+  printf("replayed %llu host frames at %.2fx, schedule lag p50 %u us, p99 "
+         "%u us\n",
+         (unsigned long long)replayed, options.speed, lag.percentile(0.5),
+         lag.percentile(0.99));
+  printf("leader: %u sent, %u dropped; %llu frames heard back\n",
+         sentAfter - sentBefore, droppedAfter - droppedBefore,
+         (unsigned long long)heard);
+  printf("%llu radio records not injectable from the host side (use --sim)\n",
+         (unsigned long long)radioRecords);
+  return 0;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: leader-replay --device PATH [--baud N] --start [--bytes N]\n"
+          "       leader-replay --device PATH [--baud N] --fetch FILE\n"
+          "       leader-replay --info FILE\n"
+          "       leader-replay --sim FILE [--speed X] [--loss P] "
+          "[--seed N]\n"
+          "       leader-replay --device PATH [--baud N] --replay FILE "
+          "[--speed X]\n"
+          "       leader-replay --synth FILE [--nodes N] [--seconds S] "
+          "[--bytes N]\n"
+          "       (any mode) [--cobs]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--device" && hasValue)
+      options.device = argv[++i];
+    else if (arg == "--baud" && hasValue)
+      options.baud = atol(argv[++i]);
+    else if (arg == "--start")
+      options.mode = "start";
+    else if (arg == "--bytes" && hasValue)
+      options.captureBytes = atol(argv[++i]);
+    else if ((arg == "--fetch" || arg == "--info" || arg == "--sim" ||
+                arg == "--replay" || arg == "--synth") &&
+               hasValue) {
+      options.mode = arg.substr(2);
+      options.file = argv[++i];
+    } else if (arg == "--speed" && hasValue)
+      options.speed = atof(argv[++i]);
+    else if (arg == "--loss" && hasValue)
+      options.loss = atof(argv[++i]);
+    else if (arg == "--seed" && hasValue)
+      options.seed = atol(argv[++i]);
+    else if (arg == "--nodes" && hasValue)
+      options.nodes = atoi(argv[++i]);
+    else if (arg == "--seconds" && hasValue)
+      options.seconds = atof(argv[++i]);
+    else if (arg == "--cobs")
+      options.cobs = true;
+    else {
+      usage();
+      return 2;
+    }
+  }
+  bool needsDevice = options.mode == "start" || options.mode == "fetch" ||
+                     options.mode == "replay";
+  if (options.mode.empty() || (needsDevice && options.device.empty()) ||
+      options.speed <= 0 || options.nodes < 1) {
+    usage();
+    return 2;
+  }
+
+  if (options.mode == "start")
+    return startCapture(options);
+  if (options.mode == "fetch")
+    return fetchCapture(options);
+  if (options.mode == "synth")
+    return synthesize(options);
+
+  Capture capture;
+  if (!capture.load(options.file)) {
+    fprintf(stderr, "cannot read capture %s\n", options.file.c_str());
+    return 1;
+  }
+  if (options.mode == "info") {
+    printInfo(capture);
+    return 0;
+  }
+  if (options.mode == "sim")
+    return replaySim(capture, options);
+  return replayDevice(capture, options);
+}
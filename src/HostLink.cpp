@@ -0,0 +1,188 @@
+#include "HostLink.h"
+#include "MiniOSC.h"
+
+// ==========================================
+// HOST OUTPUT STAGING
+// ==========================================
+
+void HostOutput::flush() {
+  if (!_stream || _len == 0)
+    return;
+
+  size_t written = _stream->write(_buf, _len);
+  if (written >= _len) {
+    _len = 0;
+  } else {
+    // Driver took only part of it: keep the tail for the next flush
+    memmove(_buf, _buf + written, _len - written);
+    _len -= written;
+  }
+}
+
+void HostOutput::writeSlip(const uint8_t *data, int len) {
+  // Worst-case SLIP expansion: each byte becomes 2 bytes + 2 framing bytes
+  size_t worstCase = 2 * (size_t)len + 2;
+  if (_len + worstCase > sizeof(_buf))
+    flush();
+
+  if (_len + worstCase <= sizeof(_buf)) {
+    // Fast path: the whole frame fits, encode without bounds checks
+    uint8_t *out = _buf + _len;
+    *out++ = 0xC0; // SLIP END (frame start)
+    for (int i = 0; i < len; i++) {
+      uint8_t b = data[i];
+      if (b == 0xC0) {
+        *out++ = 0xDB; // ESC
+        *out++ = 0xDC; // ESC_END
+      } else if (b == 0xDB) {
+        *out++ = 0xDB; // ESC
+        *out++ = 0xDD; // ESC_ESC
+      } else {
+        *out++ = b;
+      }
+    }
+    *out++ = 0xC0; // SLIP END (frame end)
+    _len = out - _buf;
+  } else {
+    // Oversized frame: stream it through the buffer
+    put(0xC0);
+    for (int i = 0; i < len; i++) {
+      if (data[i] == 0xC0) {
+        put(0xDB);
+        put(0xDC);
+      } else if (data[i] == 0xDB) {
+        put(0xDB);
+        put(0xDD);
+      } else {
+        put(data[i]);
+      }
+    }
+    put(0xC0);
+  }
+
+  frameDone();
+}
+
+void HostOutput::writeCobs(const uint8_t *data, int len) {
+  // Worst case: one code byte per 254 data bytes plus both delimiters
+  size_t worstCase = (size_t)len + len / 254 + 3;
+  if (_len + worstCase > sizeof(_buf))
+    flush();
+  bool fits = _len + worstCase <= sizeof(_buf);
+
+  const uint8_t *p = data;
+  const uint8_t *end = data + len;
+
+  put(0x00); // Leading delimiter lets the host resynchronise
+  for (;;) {
+    // Look ahead for the next zero, at most one full block away
+    int run = 0;
+    while (p + run < end && run < 254 && p[run] != 0)
+      run++;
+
+    if (fits) {
+      _buf[_len++] = run + 1;
+      memcpy(_buf + _len, p, run);
+      _len += run;
+    } else {
+      put(run + 1);
+      for (int i = 0; i < run; i++)
+        put(p[i]);
+    }
+    p += run;
+
+    if (run == 254) {
+      if (p == end)
+        break;
+      continue; // Full block: no zero was replaced
+    }
+    if (p == end)
+      break;
+    p++; // The code byte stands in for this zero
+  }
+  put(0x00);
+
+  frameDone();
+}
+
+// ==========================================
+// HOST INPUT DECODING
+// ==========================================
+
+int HostInput::feedSlip(uint8_t b) {
+  if (b == 0xC0) // SLIP END character
+    return finish();
+
+  if (b == 0xDB) { // SLIP ESC character
+    _escaping = true;
+    return 0;
+  }
+
+  // Decode escaped specialized bytes inline
+  if (_escaping) {
+    if (b == 0xDC)
+      b = 0xC0;
+    else if (b == 0xDD)
+      b = 0xDB;
+    _escaping = false;
+  }
+  store(b);
+  return 0;
+}
+
+int HostInput::feedCobs(uint8_t b) {
+  if (b == 0x00) {
+    // A frame ending mid-block is truncated: abandon it
+    if (_cobsLeft > 0)
+      _overflow = true;
+    _cobsLeft = 0;
+    _cobsCode = 0xFF;
+    return finish();
+  }
+
+  if (_cobsLeft > 0) {
+    store(b);
+    _cobsLeft--;
+    return 0;
+  }
+
+  // New code byte: the previous block (unless full) ended with a zero
+  if (_cobsCode != 0xFF)
+    store(0x00);
+  _cobsCode = b;
+  _cobsLeft = b - 1;
+  return 0;
+}
+
+// ==========================================
+// FRAMING HANDSHAKE
+// ==========================================
+
+bool handleFramingHandshake(const uint8_t *frame, int len, HostInput &in,
+                            HostOutput &out) {
+  if (len < 14 || strncmp((const char *)frame, "/host/framing", 13) != 0 ||
+      frame[13] != '\0')
+    return false;
+
+  OSCValue args[1];
+  int argCount = MiniOSC::extract(frame, len, "/host/framing", args, 1);
+
+  HostFraming framing = in.framing();
+  if (argCount > 0 && args[0].type == 'i' &&
+      (args[0].i == FRAMING_SLIP || args[0].i == FRAMING_COBS))
+    framing = (HostFraming)args[0].i;
+
+  // Acknowledge in the framing the host is still decoding, then switch
+  OSCValue outVal;
+  outVal.type = 'i';
+  outVal.i = framing;
+  uint8_t outBuffer[32];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/host/framing",
+                             &outVal, 1);
+  out.writeFrame(outBuffer, outLen);
+
+  out.setFraming(framing);
+  if (framing != in.framing())
+    in.setFraming(framing);
+  return true;
+}
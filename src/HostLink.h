@@ -0,0 +1,232 @@
+#ifndef HOSTLINK_H
+#define HOSTLINK_H
+
+#include <Arduino.h>
+#include <Stream.h>
+
+#include "LEADERProtocol.h"
+
+#ifndef LEADER_HOST_TX_BUFFER
+/// Bytes of framed host output staged before a bulk write.
+#define LEADER_HOST_TX_BUFFER 2048
+#endif
+
+#ifndef LEADER_HOST_FLUSH_THRESHOLD
+#if ARDUINO_USB_CDC_ON_BOOT
+/// Native USB-CDC: flush in whole 64-byte full-speed bulk packets.
+#define LEADER_HOST_FLUSH_THRESHOLD 512
+#else
+#define LEADER_HOST_FLUSH_THRESHOLD 256
+#endif
+#endif
+
+/**
+ * @brief Byte framing used on the serial link to the host computer.
+ *
+ * SLIP is the default and what Pure Data's [slipenc]/[slipdec] speak. COBS
+ * costs at most one byte per 254 instead of doubling escape-heavy payloads
+ * (binary blobs, packed floats) and frames with 0x00 delimiters.
+ */
+enum HostFraming : uint8_t {
+  FRAMING_SLIP = 0, ///< RFC 1055, 0xC0 delimited
+  FRAMING_COBS = 1, ///< Consistent Overhead Byte Stuffing, 0x00 delimited
+};
+
+/**
+ * @brief When buffered host output is handed to the serial driver.
+ */
+enum HostFlushPolicy : uint8_t {
+  FLUSH_PER_UPDATE, ///< One bulk write at the end of every update()
+  FLUSH_THRESHOLD,  ///< As above, plus mid-update once the threshold is hit
+  FLUSH_IMMEDIATE,  ///< One write per frame (legacy behaviour)
+};
+
+/**
+ * @brief Batched, framed output towards the host computer.
+ *
+ * Frames are encoded straight into a staging buffer and written out in large
+ * chunks, so a burst of radio traffic costs one driver call (one USB transfer
+ * on native USB-CDC chips) instead of one per message. Partial writes are
+ * kept and retried on the next flush.
+ */
+class HostOutput {
+public:
+  /**
+   * @brief Binds the output to a serial stream.
+   */
+  void begin(Stream *stream) { _stream = stream; }
+
+  /**
+   * @brief Selects when staged output is written.
+   * @param policy Flush policy.
+   * @param threshold Staged bytes that trigger a mid-update flush
+   * (FLUSH_THRESHOLD only).
+   */
+  void setPolicy(HostFlushPolicy policy, uint16_t threshold) {
+    _policy = policy;
+    _threshold = threshold;
+  }
+
+  /**
+   * @brief Selects the framing applied by writeFrame().
+   */
+  void setFraming(HostFraming framing) { _framing = framing; }
+
+  /**
+   * @brief Appends one message in the current framing.
+   */
+  void writeFrame(const uint8_t *data, int len) {
+    if (_framing == FRAMING_COBS)
+      writeCobs(data, len);
+    else
+      writeSlip(data, len);
+  }
+
+  /**
+   * @brief Appends one SLIP-framed message.
+   */
+  void writeSlip(const uint8_t *data, int len);
+
+  /**
+   * @brief Appends one COBS-encoded message between 0x00 delimiters.
+   */
+  void writeCobs(const uint8_t *data, int len);
+
+  /**
+   * @brief Writes everything staged to the stream.
+   */
+  void flush();
+
+  /**
+   * @brief Called once at the end of update(); every policy flushes here.
+   */
+  void endOfUpdate() {
+    if (_len > 0)
+      flush();
+  }
+
+  /**
+   * @brief Bytes currently staged.
+   */
+  size_t pending() const { return _len; }
+
+private:
+  /**
+   * @brief Appends one byte, flushing first if the buffer is full.
+   */
+  void put(uint8_t b) {
+    if (_len >= sizeof(_buf))
+      flush();
+    if (_len < sizeof(_buf))
+      _buf[_len++] = b;
+  }
+
+  /**
+   * @brief Applies the flush policy after a complete frame was appended.
+   */
+  void frameDone() {
+    if (_policy == FLUSH_IMMEDIATE ||
+        (_policy == FLUSH_THRESHOLD && _len >= _threshold))
+      flush();
+  }
+
+  Stream *_stream = nullptr;
+  HostFraming _framing = FRAMING_SLIP;
+  HostFlushPolicy _policy = FLUSH_THRESHOLD;
+  uint16_t _threshold = LEADER_HOST_FLUSH_THRESHOLD;
+  uint8_t _buf[LEADER_HOST_TX_BUFFER];
+  size_t _len = 0;
+};
+
+/**
+ * @brief Streaming decoder for framed messages arriving from the host.
+ *
+ * Bytes are fed one at a time straight from the serial read chunk; completed
+ * messages are returned in a bounded LEADER_MAX_MESSAGE buffer. Oversized or
+ * malformed frames are abandoned up to the next delimiter.
+ */
+class HostInput {
+public:
+  /**
+   * @brief Switches framing, discarding any partial frame.
+   */
+  void setFraming(HostFraming framing) {
+    _framing = framing;
+    reset();
+  }
+
+  HostFraming framing() const { return _framing; }
+
+  /**
+   * @brief Feeds one received byte.
+   * @return Length of a message completed by this byte (see data()), else 0.
+   */
+  int feed(uint8_t b) {
+    return _framing == FRAMING_COBS ? feedCobs(b) : feedSlip(b);
+  }
+
+  /**
+   * @brief The last completed message, valid until the next feed().
+   */
+  const uint8_t *data() const { return _buf; }
+
+  /**
+   * @brief Drops any partially received frame.
+   */
+  void reset() {
+    _len = 0;
+    _escaping = false;
+    _overflow = false;
+    _cobsLeft = 0;
+    _cobsCode = 0xFF;
+  }
+
+private:
+  int feedSlip(uint8_t b);
+  int feedCobs(uint8_t b);
+
+  /**
+   * @brief Stores one decoded byte, flagging the frame if it overflows.
+   */
+  void store(uint8_t b) {
+    if (_len < (int)sizeof(_buf))
+      _buf[_len++] = b;
+    else
+      _overflow = true;
+  }
+
+  /**
+   * @brief Ends the current frame at a delimiter.
+   * @return Its length, or 0 if it was empty or had to be abandoned.
+   */
+  int finish() {
+    int len = _overflow ? 0 : _len;
+    _len = 0;
+    _escaping = false;
+    _overflow = false;
+    return len;
+  }
+
+  HostFraming _framing = FRAMING_SLIP;
+  uint8_t _buf[LEADER_MAX_MESSAGE];
+  int _len = 0;
+  bool _escaping = false;
+  bool _overflow = false;
+  uint8_t _cobsLeft = 0;    ///< Data bytes left in the current COBS block
+  uint8_t _cobsCode = 0xFF; ///< Code byte of the current COBS block
+};
+
+/**
+ * @brief Handles the "/host/framing" handshake on a host link.
+ *
+ * Without arguments it reports the active framing. With an int argument
+ * (0 = SLIP, 1 = COBS) it acknowledges with "/host/framing mode" in the old
+ * framing, then switches both directions. The host should wait for that
+ * acknowledgement before sending in the new framing.
+ *
+ * @return True if the frame was a handshake and has been consumed.
+ */
+bool handleFramingHandshake(const uint8_t *frame, int len, HostInput &in,
+                            HostOutput &out);
+
+#endif
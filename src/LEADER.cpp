@@ -6,14 +6,40 @@
 // LEADER IMPLEMENTATION
 // ==========================================
 
-OSCLeader *OSCLeader::_instance = nullptr;
+OSCLeaderCore *OSCLeaderCore::_instance = nullptr;
+
+OSCLeaderCore::OSCLeaderCore(NodeRecord *nodes, uint8_t maxNodes,
+                             uint8_t *nodeHash, uint16_t nodeHashSize,
+                             RxPacket *rxQueue, uint8_t rxQueueSize,
+                             uint8_t *rxData, uint16_t rxPayload,
+                             RxFlow *rxFlows, uint8_t rxFlowCount,
+                             HeldFrame *held, uint8_t holdSlots,
+                             SlotOwner *slotOwners, uint16_t maxSlots,
+                             CompactEntry *compact, uint8_t compactTable,
+                             LeaderReassemblySlot *uploads,
+                             uint8_t uploadSlots)
+    : _activeNodes(nodes), _maxNodes(maxNodes), _nodeHash(nodeHash),
+      _nodeHashMask(nodeHashSize - 1), _reassembler(uploads, uploadSlots),
+      _held(held), _holdSlots(holdSlots),
+      _slotOwners(slotOwners), _maxSlots(maxSlots), _compact(compact),
+      _compactTable(compactTable), _rxQueue(rxQueue),
+      _rxQueueSize(rxQueueSize), _rxPayload(rxPayload), _flows(rxFlows),
+      _flowCount(rxFlowCount) {
+  for (uint8_t i = 0; i < rxQueueSize; i++)
+    _rxQueue[i].data = rxData + (size_t)i * rxPayload;
+}
 
-void OSCLeader::begin(Stream &serialPort, long baudRate, uint8_t homeChannel,
-                      bool autoHop) {
+void OSCLeaderCore::begin(Stream &serialPort, long baudRate,
+                          uint8_t homeChannel, bool autoHop,
+                          HostFraming framing) {
   _instance = this;
   _serial = &serialPort;
+  _hostOut.begin(_serial);
+  _hostOut.setFraming(framing);
+  _hostIn.setFraming(framing);
   _homeChannel = homeChannel;
   _autoHop = autoHop;
+  _reliableSeq = random(0x10000); // A restart must not look like a repeat
 
   // Configure Wi-Fi in Station Mode and disable power saving for lowest latency
   WiFi.mode(WIFI_STA);
@@ -43,8 +69,8 @@ void OSCLeader::begin(Stream &serialPort, long baudRate, uint8_t homeChannel,
   }
 }
 
-void OSCLeader::setIndicator(int pin, unsigned long blinkDuration,
-                             bool activeLow) {
+void OSCLeaderCore::setIndicator(int pin, unsigned long blinkDuration,
+                                 bool activeLow) {
   _ledPin = pin;
   _blinkDuration = blinkDuration;
   _ledOnState = activeLow ? LOW : HIGH;
@@ -56,31 +82,23 @@ void OSCLeader::setIndicator(int pin, unsigned long blinkDuration,
   }
 }
 
-void OSCLeader::_sendSlipToSerial(const uint8_t *data, int len) {
-  // Worst-case SLIP expansion: each byte becomes 2 bytes + 2 framing bytes
-  uint8_t slipBuffer[502]; // 250 * 2 + 2
-  int slipIndex = 0;
-
-  slipBuffer[slipIndex++] = 0xC0; // SLIP END (frame start)
-  for (int i = 0; i < len; i++) {
-    if (slipIndex >= (int)sizeof(slipBuffer) - 2)
-      break; // Prevent overflow
-    if (data[i] == 0xC0) {
-      slipBuffer[slipIndex++] = 0xDB; // ESC
-      slipBuffer[slipIndex++] = 0xDC; // ESC_END
-    } else if (data[i] == 0xDB) {
-      slipBuffer[slipIndex++] = 0xDB; // ESC
-      slipBuffer[slipIndex++] = 0xDD; // ESC_ESC
-    } else {
-      slipBuffer[slipIndex++] = data[i];
-    }
-  }
-  slipBuffer[slipIndex++] = 0xC0; // SLIP END (frame end)
+void OSCLeaderCore::_sendSlipToSerial(const uint8_t *data, int len) {
+  _hostOut.writeFrame(data, len);
+}
 
-  _serial->write(slipBuffer, slipIndex);
+void OSCLeaderCore::setFlushPolicy(HostFlushPolicy policy, uint16_t threshold) {
+  _hostOut.setPolicy(policy, threshold);
 }
 
-void OSCLeader::triggerHop() {
+void OSCLeaderCore::triggerHop() {
+  // Only the serving Leader may move the network
+  if (_standby)
+    return;
+
+  // Announce the scan silence so a standby does not read it as a failure
+  if (_failoverEnabled)
+    sendBeacon(5000);
+
   uint8_t targetChannel = findQuietestChannel();
 
   // Create a raw 4-byte explicit hopping command (0xFE 0xFE 0xFE [CHANNEL])
@@ -89,31 +107,40 @@ void OSCLeader::triggerHop() {
   // Blast the hop command aggressively to ensure followers receive it before
   // migration
   for (int i = 0; i < 10; i++) {
-    esp_now_send(_broadcastAddress, hopMessage, sizeof(hopMessage));
+    broadcastFrame(hopMessage, sizeof(hopMessage));
     delay(10);
   }
 
   // Migrate Leader to the newly designated channel
-  esp_wifi_set_channel(targetChannel, WIFI_SECOND_CHAN_NONE);
-  _peerInfo.channel = targetChannel;
-  esp_now_mod_peer(&_peerInfo);
+  applyChannel(targetChannel);
+
+  // Resume regular beaconing straight away on the new channel
+  if (_failoverEnabled)
+    sendBeacon();
 
   // Notify the host application of the successful migration
   sendChannelFeedback();
 }
 
-void OSCLeader::sendChannelFeedback() {
+void OSCLeaderCore::applyChannel(uint8_t channel) {
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  _peerInfo.channel = channel;
+  esp_now_mod_peer(&_peerInfo);
+}
+
+void OSCLeaderCore::sendChannelFeedback() {
   OSCValue outVal;
   outVal.type = 'i';
   outVal.i = _peerInfo.channel;
 
   uint8_t outBuffer[64];
-  int outLen = MiniOSC::pack(outBuffer, "/leader/channel", &outVal, 1);
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/leader/channel",
+                             &outVal, 1);
 
   _sendSlipToSerial(outBuffer, outLen);
 }
 
-void OSCLeader::sendPingReply() {
+void OSCLeaderCore::sendPingReply() {
   OSCValue outVals[5];
 
   // Compile global node telemetry tracking states
@@ -129,12 +156,13 @@ void OSCLeader::sendPingReply() {
   outVals[4].i = _packetsDropped;
 
   uint8_t outBuffer[128];
-  int outLen = MiniOSC::pack(outBuffer, "/leader/ping", outVals, 5);
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/leader/ping",
+                             outVals, 5);
 
   _sendSlipToSerial(outBuffer, outLen);
 }
 
-uint8_t OSCLeader::findQuietestChannel() {
+uint8_t OSCLeaderCore::findQuietestChannel() {
   int numNetworks = WiFi.scanNetworks();
   int channelCounts[14] = {0};
 
@@ -160,33 +188,74 @@ uint8_t OSCLeader::findQuietestChannel() {
   return bestChannel;
 }
 
-void OSCLeader::updateNodeRegistry(const uint8_t *mac, uint32_t nodeID) {
+int OSCLeaderCore::updateNodeRegistry(const uint8_t *mac, uint32_t nodeID) {
   // Check if node already exists
-  for (int i = 0; i < _nodeCount; i++) {
-    if (memcmp(_activeNodes[i].mac, mac, 6) == 0) {
-      _activeNodes[i].nodeID = nodeID;
-      _activeNodes[i].lastSeen = millis();
-      _activeNodes[i].active = true;
-      return;
+  int index = findNode(mac);
+  if (index >= 0) {
+    NodeRecord &node = _activeNodes[index];
+    if (node.movedAt != 0) {
+      // Frames sent before the move reached the node do not bring it back
+      if (millis() - node.movedAt < SHARD_MOVE_RETRY)
+        return index;
+      // Still talking here before a moved node could have given up: the
+      // move frame was lost. Later, the node came back
+      if (millis() - node.movedAt < LEADER_SHARD_MOVE_TIMEOUT &&
+          node.moveTries < SHARD_MOVE_TRIES && sendMoveFrame(node))
+        return index;
+      node.movedAt = 0;
     }
+    if (nodeID != 0) // Only heartbeats carry the ID, keep it otherwise
+      node.nodeID = nodeID;
+    node.lastSeen = millis();
+    node.active = true;
+    announceNode(node);
+    return index;
   }
 
   // Compact the registry before adding if full
-  if (_nodeCount >= MAX_NODES) {
+  if (_nodeCount >= _maxNodes) {
     compactNodeRegistry();
   }
 
   // Create new node if there is space
-  if (_nodeCount < MAX_NODES) {
-    memcpy(_activeNodes[_nodeCount].mac, mac, 6);
-    _activeNodes[_nodeCount].nodeID = nodeID;
-    _activeNodes[_nodeCount].lastSeen = millis();
-    _activeNodes[_nodeCount].active = true;
-    _nodeCount++;
+  if (_nodeCount < _maxNodes) {
+    NodeRecord &node = _activeNodes[_nodeCount];
+    memcpy(node.mac, mac, 6);
+    node.nodeID = nodeID;
+    node.lastSeen = millis();
+    node.active = true;
+    node.hops = 0;
+    node.routeSeen = 0;
+    node.relayDelay = 0;
+    node.maxPayload = 0;
+    node.capsQueries = 0;
+    node.wakeInterval = 0;
+    node.wakeWindow = 0;
+    node.awakePermille = 1000;
+    node.wakeAt = 0;
+    node.groups = 0;
+    node.peering = false;
+    node.announced = false;
+    node.reportedQuality = 100;
+    node.quality = 10000;
+    node.lastBeat = 0;
+    node.airUs = 0;
+    node.load = 0;
+    node.movedAt = 0;
+    node.moveTries = 0;
+    node.reliablePending = 0;
+    node.reliableSeen.reset();
+    node.rateCap = 0;
+    node.rxPassed = 0;
+    node.rxCapped = 0;
+    indexNode(_nodeCount);
+    announceNode(node);
+    return _nodeCount++;
   }
+  return -1;
 }
 
-void OSCLeader::compactNodeRegistry() {
+void OSCLeaderCore::compactNodeRegistry() {
   uint8_t writeIndex = 0;
   unsigned long currentMillis = millis();
 
@@ -201,11 +270,146 @@ void OSCLeader::compactNodeRegistry() {
     }
   }
   _nodeCount = writeIndex;
+
+  // Indices moved: rebuild the hash index
+  memset(_nodeHash, 0, _nodeHashMask + 1);
+  for (uint8_t i = 0; i < _nodeCount; i++)
+    indexNode(i);
+}
+
+// Spreads MACs over the index; vendor bytes are shared, so use the tail
+static uint16_t hashMac(const uint8_t *mac) {
+  return (mac[3] * 31 + mac[4]) * 31 + mac[5];
+}
+
+int OSCLeaderCore::findNode(const uint8_t *mac) const {
+  uint16_t slot = hashMac(mac) & _nodeHashMask;
+  while (_nodeHash[slot] != 0) {
+    int index = _nodeHash[slot] - 1;
+    if (memcmp(_activeNodes[index].mac, mac, 6) == 0)
+      return index;
+    slot = (slot + 1) & _nodeHashMask;
+  }
+  return -1;
+}
+
+void OSCLeaderCore::indexNode(uint8_t index) {
+  uint16_t slot = hashMac(_activeNodes[index].mac) & _nodeHashMask;
+  while (_nodeHash[slot] != 0)
+    slot = (slot + 1) & _nodeHashMask;
+  _nodeHash[slot] = index + 1;
+}
+
+void OSCLeaderCore::announceNode(NodeRecord &node) {
+  // A standby mirrors the registry silently; the primary owns the host
+  if (node.announced || node.nodeID == 0 || _standby)
+    return;
+  node.announced = true;
+  node.quality = 10000;
+  node.reportedQuality = 100;
+  node.lastBeat = 0;
+  sendNodeEvent("/sys/join", node.nodeID, 0, false);
+}
+
+void OSCLeaderCore::noteHeartbeat(NodeRecord &node) {
+  unsigned long now = millis();
+  if (node.lastBeat != 0 && _heartbeatInterval > 0) {
+    // Gaps of n intervals mean n - 1 heartbeats were lost on the way
+    unsigned long gap = now - node.lastBeat;
+    unsigned long beats = (gap + _heartbeatInterval / 2) / _heartbeatInterval;
+    if (beats > 16)
+      beats = 16;
+    // Smoothed over ~16 heartbeats: one loss alone is not worth reporting
+    for (unsigned long i = 1; i < beats; i++)
+      node.quality -= node.quality / 16;
+    node.quality += (10000 - node.quality) / 16;
+
+    int percent = (node.quality + 50) / 100;
+    int change = percent - node.reportedQuality;
+    if (change >= QUALITY_STEP || change <= -QUALITY_STEP ||
+        (percent == 100 && change != 0)) {
+      node.reportedQuality = percent;
+      if (node.announced && !_standby)
+        sendNodeEvent("/sys/quality", node.nodeID, percent, true);
+    }
+  }
+  node.lastBeat = now;
+}
+
+void OSCLeaderCore::serviceRegistry() {
+  unsigned long currentMillis = millis();
+  if (currentMillis - _lastRegistryCheck < REGISTRY_CHECK_INTERVAL)
+    return;
+  _lastRegistryCheck = currentMillis;
+
+  // Five missed heartbeats, within 0.5 s to 10 s; 10 s if none were asked
+  unsigned long timeout = NODE_TIMEOUT;
+  if (_heartbeatInterval > 0 && _heartbeatInterval * 5 < NODE_TIMEOUT)
+    timeout = _heartbeatInterval * 5 > 500 ? _heartbeatInterval * 5 : 500;
+
+  for (uint8_t i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    unsigned long silence = currentMillis - node.lastSeen;
+    if (!node.active || silence <= timeout)
+      continue;
+    node.active = false;
+    if (node.announced && !_standby)
+      sendNodeEvent("/sys/leave", node.nodeID, silence, true);
+    node.announced = false;
+  }
+}
+
+void OSCLeaderCore::sendNodeEvent(const char *address, uint32_t nodeID,
+                                  int32_t value, bool withValue) {
+  OSCValue outVals[2];
+  outVals[0].type = 'i';
+  outVals[0].i = nodeID;
+  outVals[1].type = 'i';
+  outVals[1].i = value;
+
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), address, outVals,
+                             withValue ? 2 : 1);
+  _sendSlipToSerial(outBuffer, outLen);
 }
 
-void OSCLeader::sendNodeRegistry() {
+void OSCLeaderCore::sendNodeRegistry() {
   unsigned long currentMillis = millis();
 
+  if (!_heartbeatPassThrough) {
+    // (nodeID, msSinceSeen, quality) per node, one message per 32 nodes
+    OSCValue outVals[NODES_PER_MESSAGE * 3];
+    uint8_t outBuffer[64 + NODES_PER_MESSAGE * 3 * 5];
+    int count = 0;
+    bool sent = false;
+    for (int i = 0; i < _nodeCount; i++) {
+      const NodeRecord &node = _activeNodes[i];
+      if (!node.active || currentMillis - node.lastSeen > NODE_TIMEOUT)
+        continue;
+      outVals[count].type = 'i';
+      outVals[count++].i = node.nodeID;
+      outVals[count].type = 'i';
+      outVals[count++].i = currentMillis - node.lastSeen;
+      outVals[count].type = 'i';
+      outVals[count++].i = node.reportedQuality;
+      if (count == NODES_PER_MESSAGE * 3) {
+        int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/nodes",
+                                   outVals, count);
+        _sendSlipToSerial(outBuffer, outLen);
+        count = 0;
+        sent = true;
+      }
+    }
+
+    // An empty registry still gets its (empty) answer
+    if (count > 0 || !sent) {
+      int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/nodes",
+                                 outVals, count);
+      _sendSlipToSerial(outBuffer, outLen);
+    }
+    return;
+  }
+
   for (int i = 0; i < _nodeCount; i++) {
     // If node hasn't been seen in 10 seconds, mark it inactive
     if (currentMillis - _activeNodes[i].lastSeen > 10000) {
@@ -220,388 +424,3541 @@ void OSCLeader::sendNodeRegistry() {
     outVals[1].i = currentMillis - _activeNodes[i].lastSeen;
 
     uint8_t outBuffer[64];
-    int outLen = MiniOSC::pack(outBuffer, "/sys/node", outVals, 2);
+    int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/node",
+                               outVals, 2);
 
     _sendSlipToSerial(outBuffer, outLen);
   }
 }
 
-bool OSCLeader::update() {
-  // Handle asynchronous status LED reset cycle
-  if (_ledPin >= 0 && _isLedOn && (millis() - _lastDataTime > _blinkDuration)) {
-    digitalWrite(_ledPin, _ledOffState);
-    _isLedOn = false;
-  }
-
-  // Process queued packets from ESP-NOW callback (thread-safe)
-  while (_rxTail != _rxHead) {
-    RxPacket &pkt = _rxQueue[_rxTail];
-
-    // Update Node Registry on any incoming message
-    uint32_t possibleNodeID = 0;
-    if (pkt.len > 9 &&
-        strncmp((const char *)pkt.data, "/sys/pong", 9) == 0) {
-      OSCValue pongArgs[1];
-      int pongCount =
-          MiniOSC::extract(pkt.data, pkt.len, "/sys/pong", pongArgs, 1);
-      if (pongCount > 0 && pongArgs[0].type == 'i') {
-        possibleNodeID = pongArgs[0].i;
-      }
-    }
-    updateNodeRegistry(pkt.mac, possibleNodeID);
+// ==========================================
+// LEADER PAYLOAD NEGOTIATION
+// ==========================================
 
-    // Forward received radio data to Host Computer via SLIP
-    _sendSlipToSerial(pkt.data, pkt.len);
+uint16_t OSCLeaderCore::broadcastPayload() const {
+  if (LEADER_MAX_PAYLOAD <= LEADER_V1_PAYLOAD)
+    return LEADER_MAX_PAYLOAD;
 
-    _rxTail = (_rxTail + 1) % RX_QUEUE_SIZE;
-  }
+  unsigned long currentMillis = millis();
+  uint16_t payload = LEADER_MAX_PAYLOAD;
+  bool anyNode = false;
 
-  // Automatic channel hopping on a periodic interval
-  if (_autoHop && (millis() - _lastAutoHopTime >= AUTO_HOP_INTERVAL)) {
-    _lastAutoHopTime = millis();
-    triggerHop();
+  // A broadcast must fit the smallest receiver; silent nodes count as v1
+  for (int i = 0; i < _nodeCount; i++) {
+    if (currentMillis - _activeNodes[i].lastSeen > 10000)
+      continue;
+    anyNode = true;
+    uint16_t nodePayload = _activeNodes[i].maxPayload > 0
+                               ? _activeNodes[i].maxPayload
+                               : LEADER_V1_PAYLOAD;
+    if (nodePayload < payload)
+      payload = nodePayload;
   }
 
-  bool actionTriggered = false;
+  return anyNode ? payload : LEADER_V1_PAYLOAD;
+}
 
-  // Read SLIP-encoded OSC payloads incoming sequentially from Host Computer
-  while (_serial->available()) {
-    uint8_t incomingByte = _serial->read();
+void OSCLeaderCore::sendCapsQuery() {
+  LeaderCapsFrame caps;
+  caps.magic = LEADER_CTRL_MAGIC;
+  caps.op = CTRL_CAPS;
+  caps.version = LEADER_PROTOCOL_VERSION;
+  caps.flags = CAPS_QUERY;
+  caps.maxPayload = _rxPayload;
+
+  broadcastFrame((const uint8_t *)&caps, sizeof(caps));
+  _lastCapsQuery = millis();
+  for (int i = 0; i < _nodeCount; i++)
+    if (_activeNodes[i].maxPayload == 0 &&
+        _activeNodes[i].capsQueries < CAPS_QUERY_TRIES)
+      _activeNodes[i].capsQueries++;
+}
 
-    if (incomingByte == 0xC0) { // SLIP END character
-      if (_bufferIndex > 0) {
+// ==========================================
+// LEADER MULTI-HOP RELAY
+// ==========================================
 
-        // Intercept local telemetry ping address natively
-        if (strncmp((const char *)_oscBuffer, "/leader/ping", 12) == 0 &&
-            _oscBuffer[12] == '\0') {
-          sendPingReply();
-          actionTriggered = true;
-        }
-        // Intercept forcing manual channel hopping mechanism
-        else if (strncmp((const char *)_oscBuffer, "/leader/hop", 11) == 0 &&
-                 _oscBuffer[11] == '\0') {
-          triggerHop();
-          actionTriggered = true;
-        }
-        // Intercept node registry query
-        else if (strncmp((const char *)_oscBuffer, "/leader/nodes", 13) == 0 &&
-                 _oscBuffer[13] == '\0') {
-          sendNodeRegistry();
-          actionTriggered = true;
-        }
-        // Forward standard commands transparently out to the radio architecture
-        else {
-          esp_err_t result =
-              esp_now_send(_broadcastAddress, _oscBuffer, _bufferIndex);
-          if (result == ESP_OK) {
-            _packetsSent++;
-          } else {
-            // Note: Retrying dropped packets breaks zero-latency constraint,
-            // therefore drops are counted dynamically but not continuously
-            // re-transmitted.
-            _packetsDropped++;
-          }
-          actionTriggered = true;
-        }
+void OSCLeaderCore::enableRelay(uint8_t maxHops) {
+  if (maxHops < 1)
+    maxHops = 1;
+  if (maxHops > 8)
+    maxHops = 8;
+  _relayTtl = maxHops;
+  esp_read_mac(_ownMac, ESP_MAC_WIFI_STA);
+}
 
-        _bufferIndex = 0; // Reset payload cache for subsequent chunks
-      }
-    } else if (incomingByte == 0xDB) { // SLIP ESC character
-      _isEscaping = true;
-    } else {
-      // Decode escaped specialized bytes inline
-      if (_isEscaping) {
-        if (incomingByte == 0xDC)
-          incomingByte = 0xC0;
-        if (incomingByte == 0xDD)
-          incomingByte = 0xDB;
-        _isEscaping = false;
-      }
-      // Populate buffer against payload limits
-      if (_bufferIndex < sizeof(_oscBuffer)) {
-        _oscBuffer[_bufferIndex++] = incomingByte;
-      } else {
-        _bufferIndex = 0; // Abandon malformed oversized transmissions
-      }
-    }
-  }
+esp_err_t OSCLeaderCore::broadcastMessage(const uint8_t *data, int len) {
+  int room = broadcastPayload();
+  if (_relayTtl)
+    room -= sizeof(LeaderRelayHeader);
+  if (len <= room)
+    return broadcastFrame(data, len); // Fast path: one frame, untouched
+
+  bool sent = fragmentFrame(data, len, room, _fragmentSeq++,
+                            [this](const uint8_t *frame, int frameLen) {
+                              return broadcastFrame(frame, frameLen) == ESP_OK;
+                            });
+  return sent ? ESP_OK : ESP_FAIL;
+}
 
-  // Update LED indicator on activity
-  if (actionTriggered && _ledPin >= 0) {
-    digitalWrite(_ledPin, _ledOnState);
-    _lastDataTime = millis();
-    _isLedOn = true;
+esp_err_t OSCLeaderCore::broadcastFrame(const uint8_t *data, int len) {
+  if (_relayTtl == 0 ||
+      len + (int)sizeof(LeaderRelayHeader) > broadcastPayload()) {
+    _txAirUs += airtimeOf(len);
+    return esp_now_send(_broadcastAddress, data, len);
   }
 
-  return actionTriggered;
-}
-
-void OSCLeader::_staticOnDataRecv(const esp_now_recv_info_t *info,
-                                  const uint8_t *incomingData, int len) {
-  if (_instance)
-    _instance->_handleDataRecv(info->src_addr, incomingData, len);
+  LeaderRelayHeader header;
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_RELAY;
+  header.flags = 0;
+  header.ttl = _relayTtl;
+  header.hops = 0;
+  memcpy(header.origin, _ownMac, 6);
+  header.seq = _relaySeq++;
+  header.delay = 0;
+
+  uint8_t frame[LEADER_MAX_PAYLOAD];
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), data, len);
+  _txAirUs += airtimeOf(sizeof(header) + len);
+  return esp_now_send(_broadcastAddress, frame, sizeof(header) + len);
 }
 
-void OSCLeader::_handleDataRecv(const uint8_t *mac, const uint8_t *incomingData,
-                                int len) {
-  // Queue the packet for processing in update() (main loop context)
-  // This avoids serial writes from the Wi-Fi task callback context
-  uint8_t nextHead = (_rxHead + 1) % RX_QUEUE_SIZE;
-  if (nextHead == _rxTail)
-    return; // Queue full, drop packet
+void OSCLeaderCore::noteRoute(int index, const uint8_t *via, uint8_t hops,
+                              uint32_t delayMicros) {
+  if (index < 0)
+    return;
 
-  if (len > 250)
-    len = 250; // Clamp to ESP-NOW max
+  NodeRecord &node = _activeNodes[index];
+  unsigned long currentMillis = millis();
+  bool sameRoute =
+      node.routeSeen != 0 && node.hops == hops &&
+      (hops == 0 || memcmp(node.via, via, 6) == 0);
 
-  RxPacket &pkt = _rxQueue[_rxHead];
-  memcpy(pkt.data, incomingData, len);
-  memcpy(pkt.mac, mac, 6);
-  pkt.len = len;
+  // Keep a shorter path for as long as it is still being confirmed
+  if (!sameRoute && node.routeSeen != 0 && hops > node.hops &&
+      currentMillis - node.routeSeen <= ROUTE_TIMEOUT)
+    return;
 
-  _rxHead = nextHead;
+  node.relayDelay =
+      sameRoute ? (node.relayDelay * 7 + delayMicros) / 8 : delayMicros;
+  node.hops = hops;
+  if (hops > 0)
+    memcpy(node.via, via, 6);
+  node.routeSeen = currentMillis;
 }
 
-// ==========================================
-// FOLLOWER IMPLEMENTATION
-// ==========================================
-
-OSCFollower *OSCFollower::_instance = nullptr;
+void OSCLeaderCore::sendRouteTable() {
+  unsigned long currentMillis = millis();
 
-void OSCFollower::begin(uint8_t homeChannel, bool enableUSB, long baudRate) {
-  _instance = this;
-  _homeChannel = homeChannel;
-  _currentChannel = homeChannel;
-  _usbEnabled = enableUSB;
+  for (int i = 0; i < _nodeCount; i++) {
+    const NodeRecord &node = _activeNodes[i];
+    if (currentMillis - node.lastSeen > 10000)
+      continue;
+
+    // Resolve the relay MAC back to the relay's own node ID
+    uint32_t relayID = 0;
+    if (node.hops > 0) {
+      for (int j = 0; j < _nodeCount; j++) {
+        if (memcmp(_activeNodes[j].mac, node.via, 6) == 0) {
+          relayID = _activeNodes[j].nodeID;
+          break;
+        }
+      }
+    }
 
-  // Initialize tethered bridging state bindings conditionally
-  if (_usbEnabled) {
-    Serial.begin(baudRate);
-  }
+    OSCValue outVals[4];
+    outVals[0].type = 'i';
+    outVals[0].i = node.nodeID;
+    outVals[1].type = 'i';
+    outVals[1].i = node.hops;
+    outVals[2].type = 'i';
+    outVals[2].i = relayID;
+    outVals[3].type = 'i';
+    outVals[3].i = node.relayDelay;
 
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-  esp_wifi_set_ps(WIFI_PS_NONE);
-  esp_wifi_set_channel(_homeChannel, WIFI_SECOND_CHAN_NONE);
+    uint8_t outBuffer[64];
+    int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/route",
+                               outVals, 4);
 
-  if (esp_now_init() != ESP_OK)
-    return;
+    _sendSlipToSerial(outBuffer, outLen);
+  }
+}
 
-  esp_now_register_recv_cb(_staticOnDataRecv);
-  _lastMessageTime = millis();
+// ==========================================
+// LEADER POWER-SAVE DELIVERY
+// ==========================================
 
-  // Generate a distinct internal tracking 16-bit identifier dynamically based
-  // on MAC endcaps
-  uint8_t mac[6];
-  esp_read_mac(mac, ESP_MAC_WIFI_STA);
-  _nodeID = (mac[4] << 8) | mac[5];
+bool OSCLeaderCore::nodeListening(const NodeRecord &node) const {
+  return node.wakeInterval == 0 || millis() - node.wakeAt < node.wakeWindow;
 }
 
-void OSCFollower::onReceive(OSCReceiveCallback callback) {
-  _userCallback = callback;
-}
+esp_err_t OSCLeaderCore::unicastFrame(const uint8_t *mac, const uint8_t *data,
+                                      int len) {
+  int slot = -1;
+  for (uint8_t i = 0; i < _unicastPeerCount; i++) {
+    if (memcmp(_unicastPeers[i].mac, mac, 6) == 0) {
+      slot = i;
+      break;
+    }
+  }
 
-void OSCFollower::send(const uint8_t *data, int len) {
-  if (_leaderMacSet)
-    esp_now_send(_leaderMac, data, len);
-}
+  if (slot < 0 && !esp_now_is_peer_exist(mac)) {
+    if (_unicastPeerCount < UNICAST_PEER_SLOTS) {
+      slot = _unicastPeerCount++;
+    } else {
+      slot = 0;
+      for (uint8_t i = 1; i < _unicastPeerCount; i++) {
+        if ((long)(_unicastPeers[i].used - _unicastPeers[slot].used) < 0)
+          slot = i;
+      }
+      esp_now_del_peer(_unicastPeers[slot].mac);
+    }
 
-void OSCFollower::enableHeartbeat(uint32_t interval, uint32_t customID) {
-  _heartbeatInterval = interval;
-  if (customID != 0) {
-    _nodeID = customID;
+    esp_now_peer_info_t peer = _peerInfo;
+    memcpy(peer.peer_addr, mac, 6);
+    peer.channel = 0; // Follow the Leader across channel hops
+    esp_err_t added = esp_now_add_peer(&peer);
+    if (added != ESP_OK) {
+      _unicastPeers[slot] = _unicastPeers[--_unicastPeerCount];
+      return added; // Peer table full
+    }
+    memcpy(_unicastPeers[slot].mac, mac, 6);
   }
-  _heartbeatEnabled = true;
+  if (slot >= 0)
+    _unicastPeers[slot].used = millis();
+  _txAirUs += airtimeOf(len);
+  return esp_now_send(mac, data, len);
 }
 
-void OSCFollower::_staticOnDataRecv(const esp_now_recv_info_t *info,
-                                    const uint8_t *incomingData, int len) {
-  if (_instance)
-    _instance->_handleDataRecv(info->src_addr, incomingData, len);
+bool OSCLeaderCore::holdFrame(const uint8_t *mac, const uint8_t *data,
+                              int len) {
+  if (len > LEADER_V1_PAYLOAD)
+    return false;
+  for (int i = 0; i < _holdSlots; i++) {
+    HeldFrame &held = _held[i];
+    if (held.len != 0)
+      continue;
+    memcpy(held.mac, mac, 6);
+    memcpy(held.data, data, len);
+    held.len = len;
+    held.heldAt = micros();
+    _heldCount++;
+    return true;
+  }
+  _heldRefused++;
+  return false;
 }
 
-void OSCFollower::_handleDataRecv(const uint8_t *mac,
-                                  const uint8_t *incomingData, int len) {
-  // Queue the packet for processing in update() (main loop context)
-  uint8_t nextHead = (_rxHead + 1) % RX_QUEUE_SIZE;
-  if (nextHead == _rxTail)
-    return; // Queue full, drop packet
-
-  if (len > 250)
-    len = 250;
-
-  RxPacket &pkt = _rxQueue[_rxHead];
-  memcpy(pkt.data, incomingData, len);
-  memcpy(pkt.mac, mac, 6);
-  pkt.len = len;
+bool OSCLeaderCore::sendToNode(uint32_t nodeID, const uint8_t *data, int len) {
+  if (nodeID == 0 || len <= 0 || len > LEADER_MAX_MESSAGE)
+    return false;
 
-  _rxHead = nextHead;
+  int index = -1;
+  for (int i = 0; i < _nodeCount; i++) {
+    if (_activeNodes[i].active && _activeNodes[i].nodeID == nodeID) {
+      index = i;
+      break;
+    }
+  }
+  if (index < 0)
+    return false;
+  NodeRecord &node = _activeNodes[index];
+
+  if (_reliablePatterns.matches(data, len) && sendReliable(data, len, nodeID))
+    return true;
+
+  // Awake nodes get the frame now; dozing ones at their next check-in, in
+  // frames small enough for the hold slots
+  bool hold = !nodeListening(node);
+  int room = hold ? LEADER_V1_PAYLOAD
+                  : (node.maxPayload ? node.maxPayload : LEADER_V1_PAYLOAD);
+  if (room > LEADER_MAX_PAYLOAD)
+    room = LEADER_MAX_PAYLOAD;
+
+  const uint8_t *mac = node.mac;
+  auto deliver = [this, mac, hold, &node](const uint8_t *frame, int frameLen) {
+    if (hold)
+      return holdFrame(mac, frame, frameLen);
+    if (unicastFrame(mac, frame, frameLen) != ESP_OK)
+      return false;
+    if (node.wakeInterval)
+      noteHoldTime(0); // Sent inside a window: no added delay
+    return true;
+  };
+  if (len <= room)
+    return deliver(data, len);
+  return fragmentFrame(data, len, room, _fragmentSeq++, deliver);
 }
 
-void OSCFollower::update() {
-  // Process queued packets from ESP-NOW callback (thread-safe)
-  while (_rxTail != _rxHead) {
-    RxPacket &pkt = _rxQueue[_rxTail];
-
-    _lastMessageTime = millis();
-
-    // Perform a sanity check before locking onto a presumed Leader node MAC
-    if (!_leaderMacSet) {
-      bool isValidLeaderPacket = false;
-
-      if (pkt.len == 4 && pkt.data[0] == 0xFE && pkt.data[1] == 0xFE &&
-          pkt.data[2] == 0xFE) {
-        isValidLeaderPacket = true;
-      } else if (pkt.len > 0 && pkt.data[0] == '/') {
-        isValidLeaderPacket = true;
-      }
-
-      if (isValidLeaderPacket) {
-        memcpy(_leaderMac, pkt.mac, 6);
-        esp_now_peer_info_t peerInfo = {};
-        memcpy(peerInfo.peer_addr, _leaderMac, 6);
-        peerInfo.channel = _currentChannel;
-        peerInfo.encrypt = false;
-        esp_now_add_peer(&peerInfo);
-        _leaderMacSet = true;
-      }
-    }
+void OSCLeaderCore::servicePowerSave() {
+  if (_heldCount == 0 || _standby)
+    return;
 
-    // Check: Hidden Hardware Hop Command
-    if (pkt.len == 4 && pkt.data[0] == 0xFE && pkt.data[1] == 0xFE &&
-        pkt.data[2] == 0xFE) {
-      uint8_t targetChannel = pkt.data[3];
-      if (targetChannel != _currentChannel) {
-        _currentChannel = targetChannel;
-        esp_wifi_set_channel(_currentChannel, WIFI_SECOND_CHAN_NONE);
-        if (_leaderMacSet) {
-          esp_now_peer_info_t peerInfo = {};
-          memcpy(peerInfo.peer_addr, _leaderMac, 6);
-          peerInfo.channel = _currentChannel;
-          esp_now_mod_peer(&peerInfo);
-        }
-      }
-      _rxTail = (_rxTail + 1) % RX_QUEUE_SIZE;
-      continue; // Skip downstream processing for hop commands
+  // Drop frames whose node vanished or missed two check-ins in a row
+  unsigned long now = micros();
+  for (int i = 0; i < _holdSlots; i++) {
+    HeldFrame &held = _held[i];
+    if (held.len == 0)
+      continue;
+    int index = -1;
+    for (int n = 0; n < _nodeCount; n++)
+      if (memcmp(_activeNodes[n].mac, held.mac, 6) == 0)
+        index = n;
+    unsigned long limitUs =
+        index < 0 ? 0
+                  : (2UL * _activeNodes[index].wakeInterval +
+                     _activeNodes[index].wakeWindow) *
+                        1000UL;
+    if (index < 0 || now - held.heldAt > limitUs) {
+      held.len = 0;
+      _heldCount--;
+      _heldExpired++;
     }
+  }
 
-    // Intercept system ping/pong
-    if (pkt.len > 9 &&
-        strncmp((const char *)pkt.data, "/sys/ping", 9) == 0) {
-      OSCValue pingCheck[1];
-      int pingArgs =
-          MiniOSC::extract(pkt.data, pkt.len, "/sys/ping", pingCheck, 1);
-
-      if (pingArgs > 0 && pingCheck[0].type == 'i') {
-        int interval = pingCheck[0].i;
-        if (interval > 0) {
-          _heartbeatInterval = interval;
-          _heartbeatEnabled = true;
-        } else {
-          _heartbeatEnabled = false;
+  // Release oldest first to every node that is listening, until the radio
+  // queue pushes back
+  while (_heldCount > 0) {
+    int oldest = -1;
+    for (int i = 0; i < _holdSlots; i++) {
+      HeldFrame &held = _held[i];
+      if (held.len == 0 ||
+          (oldest >= 0 && now - held.heldAt <= now - _held[oldest].heldAt))
+        continue;
+      for (int n = 0; n < _nodeCount; n++) {
+        if (memcmp(_activeNodes[n].mac, held.mac, 6) == 0 &&
+            nodeListening(_activeNodes[n])) {
+          oldest = i;
+          break;
         }
-      } else if (pingArgs == 0) {
-        OSCValue outVal;
-        outVal.type = 'i';
-        outVal.i = _nodeID;
-        uint8_t outBuffer[64];
-        int outLen = MiniOSC::pack(outBuffer, "/sys/pong", &outVal, 1);
-        send(outBuffer, outLen);
       }
     }
+    if (oldest < 0)
+      return;
 
-    // Dispatch to user callback
-    if (_userCallback)
-      _userCallback(pkt.data, pkt.len);
-
-    // Forward to USB if tethered
-    if (_usbEnabled) {
-      _sendSlipToUSB(pkt.data, pkt.len);
-    }
-
-    _rxTail = (_rxTail + 1) % RX_QUEUE_SIZE;
+    HeldFrame &held = _held[oldest];
+    if (unicastFrame(held.mac, held.data, held.len) != ESP_OK)
+      return; // Try again on the next update()
+    noteHoldTime(micros() - held.heldAt);
+    held.len = 0;
+    _heldCount--;
+    _heldReleased++;
   }
+}
 
-  // Handle serial input for tethered mode
-  if (_usbEnabled) {
-    _handleSerial();
+void OSCLeaderCore::sendPowerSaveReport() {
+  uint8_t outBuffer[64];
+  OSCValue vals[6];
+  for (int i = 0; i < 6; i++)
+    vals[i].type = 'i';
+
+  for (int i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    if (!node.active || node.wakeInterval == 0)
+      continue;
+    int held = 0;
+    for (int h = 0; h < _holdSlots; h++)
+      if (_held[h].len && memcmp(_held[h].mac, node.mac, 6) == 0)
+        held++;
+    vals[0].i = node.nodeID;
+    vals[1].i = node.wakeInterval;
+    vals[2].i = node.wakeWindow;
+    vals[3].i = node.awakePermille;
+    vals[4].i = held;
+    int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/powersave",
+                               vals, 5);
+    _sendSlipToSerial(outBuffer, outLen);
   }
 
-  if (_heartbeatEnabled && _leaderMacSet) {
-    if (millis() - _lastHeartbeatTime >= _heartbeatInterval) {
-      _lastHeartbeatTime = millis();
+  // Percentiles over the most recent deliveries
+  uint32_t sorted[HOLD_SAMPLES];
+  uint8_t count = _holdSamples.sort(sorted);
+  vals[0].i = _heldReleased;
+  vals[1].i = _heldExpired;
+  vals[2].i = _heldRefused;
+  vals[3].i = count ? sorted[(count - 1) * 50 / 100] : 0;
+  vals[4].i = count ? sorted[(count - 1) * 90 / 100] : 0;
+  vals[5].i = count ? sorted[(count - 1) * 99 / 100] : 0;
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/holdtime",
+                             vals, 6);
+  _sendSlipToSerial(outBuffer, outLen);
+}
 
-      OSCValue outVal;
-      outVal.type = 'i';
-      outVal.i = _nodeID;
+// ==========================================
+// LEADER SLOT SCHEDULING
+// ==========================================
 
-      uint8_t outBuffer[64];
-      int outLen = MiniOSC::pack(outBuffer, "/sys/pong", &outVal, 1);
+void OSCLeaderCore::enableSlots(uint16_t slotCount, uint32_t slotUs,
+                                bool tdmaStreams) {
+  _slotCount = slotCount < _maxSlots ? slotCount : _maxSlots;
+  _slotUsConfig = slotUs;
+  _slotFlags = tdmaStreams ? SLOT_TDMA : 0;
+  planSlots();
+}
 
-      send(outBuffer, outLen);
-    }
+void OSCLeaderCore::planSlots() {
+  // Spread the slots over one heartbeat interval unless told otherwise
+  _slotUs = _slotUsConfig;
+  if (_slotUs == 0 && _slotCount > 0) {
+    uint32_t interval = _heartbeatInterval ? _heartbeatInterval : 100;
+    _slotUs = interval * 1000UL / _slotCount;
   }
+  if (++_slotPlan == 0)
+    _slotPlan = 1; // 0 marks nodes without a slot
+  _nextSlot = 0;
+  _slotPendingCount = 0;
+  memset(_slotOwners, 0, _maxSlots * sizeof(SlotOwner));
+  if (!_standby)
+    sendSlotPlan();
 }
 
-// ==========================================
-// FOLLOWER SLIP USB ENGINES
-// ==========================================
+void OSCLeaderCore::writeSlotHeader(LeaderSlotHeader &header, uint8_t kind) {
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_SLOT;
+  header.kind = kind;
+  header.flags = _slotFlags;
+  header.plan = _slotPlan;
+  header.count = 0;
+  header.slotCount = _slotCount;
+  header.slotUs = _slotUs;
+  header.leaderUs = micros();
+}
 
-void OSCFollower::_sendSlipToUSB(const uint8_t *data, int len) {
-  // OSC Standard alignment mandates valid structures to be strict multiples of
-  // 4 bytes
-  if (len == 0 || len % 4 != 0)
-    return;
+void OSCLeaderCore::sendSlotPlan() {
+  LeaderSlotHeader header;
+  writeSlotHeader(header, SLOT_PLAN);
+  esp_now_send(_broadcastAddress, (const uint8_t *)&header, sizeof(header));
+  _lastSlotPlan = millis();
+}
 
-  // Worst-case SLIP expansion: each byte becomes 2 bytes + 2 framing bytes
-  uint8_t slipBuffer[502]; // 250 * 2 + 2
-  int slipIndex = 0;
-
-  slipBuffer[slipIndex++] = 0xC0;
-  for (int i = 0; i < len; i++) {
-    if (slipIndex >= (int)sizeof(slipBuffer) - 2)
-      break; // Prevent overflow
-    if (data[i] == 0xC0) {
-      slipBuffer[slipIndex++] = 0xDB;
-      slipBuffer[slipIndex++] = 0xDC;
-    } else if (data[i] == 0xDB) {
-      slipBuffer[slipIndex++] = 0xDB;
-      slipBuffer[slipIndex++] = 0xDD;
-    } else {
-      slipBuffer[slipIndex++] = data[i];
+void OSCLeaderCore::sendSlotAssignments() {
+  uint8_t frame[sizeof(LeaderSlotHeader) +
+                SLOT_BATCH * sizeof(LeaderSlotEntry)];
+  LeaderSlotHeader header;
+  writeSlotHeader(header, SLOT_ASSIGN);
+  header.count = _slotPendingCount;
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), _slotPending,
+         _slotPendingCount * sizeof(LeaderSlotEntry));
+
+  esp_now_send(_broadcastAddress, frame,
+               sizeof(header) + _slotPendingCount * sizeof(LeaderSlotEntry));
+  _slotPendingCount = 0;
+}
+
+void OSCLeaderCore::assignSlot(const uint8_t *mac) {
+  for (uint8_t i = 0; i < _slotPendingCount; i++) {
+    if (memcmp(_slotPending[i].mac, mac, 6) == 0)
+      return; // Already in the next batch
+  }
+  if (_slotPendingCount == SLOT_BATCH)
+    sendSlotAssignments();
+
+  // Nodes whose assignment was lost get the same slot back; past
+  // slotCount nodes, slots are shared in turn
+  LeaderSlotEntry &entry = _slotPending[_slotPendingCount];
+  memcpy(entry.mac, mac, 6);
+  int slot = -1, freeSlot = -1;
+  for (uint16_t i = 0; i < _slotCount && slot < 0; i++) {
+    if (!_slotOwners[i].taken) {
+      if (freeSlot < 0)
+        freeSlot = i;
+    } else if (memcmp(_slotOwners[i].mac, mac, 6) == 0) {
+      slot = i;
     }
   }
-  slipBuffer[slipIndex++] = 0xC0;
+  if (slot < 0 && freeSlot >= 0) {
+    slot = freeSlot;
+    memcpy(_slotOwners[slot].mac, mac, 6);
+    _slotOwners[slot].taken = true;
+  }
+  if (slot < 0) {
+    slot = _nextSlot;
+    _nextSlot = (_nextSlot + 1) % _slotCount;
+  }
+  entry.slot = slot;
 
-  Serial.write(slipBuffer, slipIndex);
+  if (_slotPendingCount++ == 0)
+    _slotPendingSince = millis();
 }
 
-void OSCFollower::_handleSerial() {
-  while (Serial.available()) {
-    uint8_t c = Serial.read();
+void OSCLeaderCore::serviceSlots() {
+  if (_slotCount == 0 || _standby)
+    return;
 
-    if (c == 0xC0) {
-      if (_serialRxLen > 0) {
-        if (_leaderMacSet) {
-          esp_now_send(_leaderMac, _serialRxBuf, _serialRxLen);
+  if (_slotPendingCount > 0 &&
+      millis() - _slotPendingSince >= SLOT_BATCH_DELAY)
+    sendSlotAssignments();
+  if (millis() - _lastSlotPlan >= SLOT_PLAN_INTERVAL)
+    sendSlotPlan();
+}
+
+// ==========================================
+// LEADER PEER DISCOVERY
+// ==========================================
+
+void OSCLeaderCore::sendPeerTable() {
+  static constexpr uint8_t PER_CHUNK =
+      (LEADER_V1_PAYLOAD - sizeof(LeaderPeerHeader)) / sizeof(LeaderPeerEntry);
+  unsigned long currentMillis = millis();
+
+  uint8_t frame[LEADER_V1_PAYLOAD];
+  LeaderPeerHeader header = {};
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_PEERS;
+  header.kind = PEER_TABLE;
+
+  // Followers merge chunks as they come, so each one stands on its own
+  int len = sizeof(header);
+  for (uint8_t i = 0; i < _nodeCount; i++) {
+    const NodeRecord &node = _activeNodes[i];
+    if (!node.peering || !node.active ||
+        currentMillis - node.lastSeen > 10000)
+      continue;
+
+    LeaderPeerEntry entry;
+    memcpy(entry.mac, node.mac, 6);
+    entry.nodeID = node.nodeID;
+    entry.groups = node.groups;
+    memcpy(frame + len, &entry, sizeof(entry));
+    len += sizeof(entry);
+
+    if (++header.count == PER_CHUNK) {
+      memcpy(frame, &header, sizeof(header));
+      esp_now_send(_broadcastAddress, frame, len);
+      header.count = 0;
+      len = sizeof(header);
+    }
+  }
+  if (header.count > 0) {
+    memcpy(frame, &header, sizeof(header));
+    esp_now_send(_broadcastAddress, frame, len);
+  }
+
+  _lastPeerTable = currentMillis;
+  _peerTablePending = false;
+}
+
+void OSCLeaderCore::servicePeers() {
+  if (_peerTablePending && !_standby &&
+      millis() - _lastPeerTable >= PEER_TABLE_INTERVAL)
+    sendPeerTable();
+}
+
+void OSCLeaderCore::reportPeerMirror(const uint8_t *mac, const uint8_t *data,
+                                     int len) {
+  LeaderPeerHeader header;
+  memcpy(&header, data, sizeof(header));
+  int index = updateNodeRegistry(mac, 0);
+
+  // Direct sends carry the destination ID, group sends a single group bit
+  int group = -1;
+  for (int bit = 0; bit < 32; bit++) {
+    if (header.groups == (1UL << bit)) {
+      group = bit;
+      break;
+    }
+  }
+
+  OSCValue outVals[4];
+  outVals[0].type = 'i';
+  outVals[0].i = index >= 0 ? _activeNodes[index].nodeID : 0;
+  outVals[1].type = 'i';
+  outVals[1].i = header.id;
+  outVals[2].type = 'i';
+  outVals[2].i = group;
+  outVals[3].type = 'b';
+  outVals[3].s = (const char *)data + sizeof(header);
+  outVals[3].len = len - sizeof(header);
+
+  uint8_t outBuffer[LEADER_MAX_MESSAGE + 64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/peer", outVals,
+                             4);
+  _sendSlipToSerial(outBuffer, outLen);
+}
+
+// ==========================================
+// LEADER CHANNEL SHARDING
+// ==========================================
+
+void OSCLeaderCore::enableSharding(uint8_t shard) {
+  _shard = shard & BEACON_SHARD_MASK;
+  _autoHop = false; // Shards must not hop onto each other's channel
+  _shardWindowStart = micros();
+  if (_shard && !_standby)
+    sendBeacon();
+}
+
+bool OSCLeaderCore::moveNode(uint32_t nodeID, uint8_t channel,
+                             uint8_t shard) {
+  if (_standby || channel < 1 || channel > 13 || shard < 1 ||
+      shard > BEACON_SHARD_MASK || shard == _shard)
+    return false;
+
+  int index = -1;
+  for (int i = 0; i < _nodeCount; i++) {
+    if (_activeNodes[i].active && _activeNodes[i].movedAt == 0 &&
+        _activeNodes[i].nodeID == nodeID) {
+      index = i;
+      break;
+    }
+  }
+  if (index < 0)
+    return false;
+
+  NodeRecord &node = _activeNodes[index];
+  node.moveChannel = channel;
+  node.moveShard = shard;
+  node.moveTries = 0;
+  if (!sendMoveFrame(node))
+    return false;
+
+  // Gone from this shard without a "/sys/leave": the host hears where to
+  node.active = false;
+  node.announced = false;
+
+  OSCValue outVals[3];
+  outVals[0].type = 'i';
+  outVals[0].i = nodeID;
+  outVals[1].type = 'i';
+  outVals[1].i = channel;
+  outVals[2].type = 'i';
+  outVals[2].i = shard;
+
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/moved",
+                             outVals, 3);
+  _sendSlipToSerial(outBuffer, outLen);
+  return true;
+}
+
+bool OSCLeaderCore::sendMoveFrame(NodeRecord &node) {
+  LeaderShardFrame move;
+  move.magic = LEADER_CTRL_MAGIC;
+  move.op = CTRL_SHARD;
+  move.channel = node.moveChannel;
+  move.shard = node.moveShard;
+  // Retries go out after the record is retired, so not through sendToNode()
+  bool sent = nodeListening(node)
+                  ? unicastFrame(node.mac, (const uint8_t *)&move,
+                                 sizeof(move)) == ESP_OK
+                  : holdFrame(node.mac, (const uint8_t *)&move, sizeof(move));
+  if (!sent)
+    return false;
+
+  node.moveTries++;
+  node.movedAt = millis();
+  if (node.movedAt == 0)
+    node.movedAt = 1;
+  return true;
+}
+
+int OSCLeaderCore::shedLoad(uint8_t channel, uint8_t shard,
+                           uint16_t budgetPermille) {
+  unsigned long currentMillis = millis();
+  int moved = 0;
+  for (;;) {
+    // Moved nodes drop out of the candidates, so this walks down by load
+    int busiest = -1;
+    for (int i = 0; i < _nodeCount; i++) {
+      const NodeRecord &node = _activeNodes[i];
+      if (!node.active || node.movedAt != 0 || node.nodeID == 0 ||
+          node.load == 0 || node.load > budgetPermille ||
+          currentMillis - node.lastSeen > NODE_TIMEOUT)
+        continue;
+      if (busiest < 0 || node.load > _activeNodes[busiest].load)
+        busiest = i;
+    }
+    if (busiest < 0 ||
+        !moveNode(_activeNodes[busiest].nodeID, channel, shard))
+      return moved;
+    budgetPermille -= _activeNodes[busiest].load;
+    moved++;
+  }
+}
+
+void OSCLeaderCore::sendShardReport() {
+  unsigned long now = micros();
+  uint32_t elapsed = now - _shardWindowStart;
+  if (elapsed == 0)
+    elapsed = 1;
+  _shardWindowStart = now;
+
+  // The receive callback may add to _rxAirUs from the Wi-Fi task at any
+  // time: take and clear it in one step, or frames heard in between are lost
+  uint32_t air = __atomic_exchange_n(&_rxAirUs, 0, __ATOMIC_RELAXED) +
+                 _txAirUs;
+  _txAirUs = 0;
+
+  // Node loads are kept for shedLoad() until the next report
+  unsigned long currentMillis = millis();
+  int live = 0;
+  int busiest = -1;
+  for (int i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    uint64_t permille = (uint64_t)node.airUs * 1000 / elapsed;
+    node.load = permille > 1000 ? 1000 : permille;
+    node.airUs = 0;
+    if (!node.active || node.movedAt != 0 ||
+        currentMillis - node.lastSeen > NODE_TIMEOUT)
+      continue;
+    live++;
+    if (busiest < 0 || node.load > _activeNodes[busiest].load)
+      busiest = i;
+  }
+
+  uint64_t permille = (uint64_t)air * 1000 / elapsed;
+  OSCValue outVals[6];
+  for (int i = 0; i < 6; i++)
+    outVals[i].type = 'i';
+  outVals[0].i = _shard;
+  outVals[1].i = _peerInfo.channel;
+  outVals[2].i = live;
+  outVals[3].i = permille > 1000 ? 1000 : permille;
+  outVals[4].i = busiest >= 0 ? _activeNodes[busiest].nodeID : 0;
+  outVals[5].i = busiest >= 0 ? _activeNodes[busiest].load : 0;
+
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/shard",
+                             outVals, 6);
+  _sendSlipToSerial(outBuffer, outLen);
+}
+
+void OSCLeaderCore::serviceSharding() {
+  // With failover on, its own (faster) beacons already carry the shard
+  if (!_shard || _failoverEnabled || _standby)
+    return;
+  if (millis() - _lastBeaconTime >= SHARD_BEACON_INTERVAL)
+    sendBeacon();
+}
+
+// ==========================================
+// LEADER FAIR RECEIVE
+// ==========================================
+
+int OSCLeaderCore::nextRxPacket() {
+  if (_rxTail == _rxHead)
+    return -1;
+
+  // Deficit round robin: a flow with frames waiting gains a quantum on its
+  // turn and spends it on its oldest frames; idle flows bank nothing. Each
+  // full round adds a quantum to some waiting flow, so this ends.
+  for (;;) {
+    uint8_t flow = _rxFlow;
+    RxFlow &state = _flows[flow];
+    int index = -1;
+    if (state.in != state.out) {
+      uint8_t head = _rxHead;
+      for (uint8_t i = _rxTail; i != head; i = (i + 1) % _rxQueueSize) {
+        if (_rxQueue[i].flow == flow) {
+          index = i;
+          break;
         }
-        _serialRxLen = 0;
       }
-      _serialEscaping = false;
-    } else if (c == 0xDB) {
-      _serialEscaping = true;
-    } else {
-      if (_serialEscaping) {
-        if (c == 0xDC)
-          c = 0xC0;
-        else if (c == 0xDD)
-          c = 0xDB;
-        _serialEscaping = false;
+    }
+
+    if (index >= 0) {
+      if (!_rxFlowTurn) {
+        state.deficit += RX_QUANTUM;
+        _rxFlowTurn = true;
+      }
+      if (_rxQueue[index].len <= state.deficit) {
+        state.deficit -= _rxQueue[index].len;
+        return index;
       }
-      if (_serialRxLen < (int)sizeof(_serialRxBuf)) {
-        _serialRxBuf[_serialRxLen++] = c;
-      } else {
-        _serialRxLen = 0; // Abandon oversized segments
+    } else {
+      state.deficit = 0;
+    }
+
+    _rxFlow = flow + 1 < _flowCount ? flow + 1 : 0;
+    _rxFlowTurn = false;
+  }
+}
+
+void OSCLeaderCore::releaseRxPacket(int index) {
+  _flows[_rxQueue[index].flow].out++;
+  _rxQueue[index].flow = RX_FLOW_DONE;
+
+  // Slots only return to the callback in order
+  while (_rxTail != _rxHead && _rxQueue[_rxTail].flow == RX_FLOW_DONE)
+    _rxTail = (_rxTail + 1) % _rxQueueSize;
+}
+
+bool OSCLeaderCore::withinRateCap(NodeRecord &node) {
+  if (node.rateCap == 0)
+    return true;
+
+  // Budget in thousandths of a message: the cap per millisecond, up to a
+  // tenth of a second's worth
+  unsigned long now = millis();
+  unsigned long elapsed = now - node.rateRefilled;
+  if (elapsed > 1000)
+    elapsed = 1000;
+  node.rateRefilled = now;
+  uint32_t burst = (node.rateCap >= 10 ? node.rateCap / 10 : 1) * 1000UL;
+  node.rateTokens += elapsed * node.rateCap;
+  if (node.rateTokens > burst)
+    node.rateTokens = burst;
+
+  if (node.rateTokens < 1000) {
+    node.rxCapped++;
+    return false;
+  }
+  node.rateTokens -= 1000;
+  return true;
+}
+
+bool OSCLeaderCore::setRateCap(uint32_t nodeID, uint16_t perSecond) {
+  bool found = false;
+  for (int i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    if (!node.active || node.nodeID != nodeID)
+      continue;
+    node.rateCap = perSecond;
+    node.rateTokens = (perSecond >= 10 ? perSecond / 10 : 1) * 1000UL;
+    node.rateRefilled = millis();
+    found = true;
+  }
+  return found;
+}
+
+void OSCLeaderCore::sendRxReport() {
+  unsigned long currentMillis = millis();
+
+  // (nodeID, passed, capped, overflowed) per node, one message per 32 nodes
+  OSCValue outVals[NODES_PER_MESSAGE * 4];
+  uint8_t outBuffer[64 + NODES_PER_MESSAGE * 4 * 5];
+  int count = 0;
+  bool sent = false;
+  for (int i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    if (!node.active || currentMillis - node.lastSeen > NODE_TIMEOUT)
+      continue;
+    // The callback keeps counting; report against what was read
+    int flow = findRxFlow(node.mac);
+    uint32_t drops = 0;
+    if (flow >= 0) {
+      uint32_t total = _flows[flow].drops;
+      drops = total - _flows[flow].dropsReported;
+      _flows[flow].dropsReported = total;
+    }
+    outVals[count].type = 'i';
+    outVals[count++].i = node.nodeID;
+    outVals[count].type = 'i';
+    outVals[count++].i = node.rxPassed;
+    outVals[count].type = 'i';
+    outVals[count++].i = node.rxCapped;
+    outVals[count].type = 'i';
+    outVals[count++].i = drops;
+    node.rxPassed = 0;
+    node.rxCapped = 0;
+    if (count == NODES_PER_MESSAGE * 4) {
+      int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/rx",
+                                 outVals, count);
+      _sendSlipToSerial(outBuffer, outLen);
+      count = 0;
+      sent = true;
+    }
+  }
+  if (count > 0 || !sent) {
+    int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/rx", outVals,
+                               count);
+    _sendSlipToSerial(outBuffer, outLen);
+  }
+
+  // Drops of senders that are not live nodes go unreported, rather than
+  // to whoever is given their flow next
+  for (uint8_t f = 0; f < _flowCount; f++) {
+    RxFlow &state = _flows[f];
+    int index = state.bound ? findNode(state.mac) : -1;
+    if (index < 0 || !_activeNodes[index].active ||
+        currentMillis - _activeNodes[index].lastSeen > NODE_TIMEOUT)
+      state.dropsReported = state.drops;
+  }
+}
+
+int OSCLeaderCore::findRxFlow(const uint8_t *mac) const {
+  // Flows are never unbound, so a sender sits before the first free one
+  // on its probe path
+  uint8_t flow = hashMac(mac) % _flowCount;
+  for (uint8_t n = 0; n < _flowCount; n++) {
+    const RxFlow &state = _flows[flow];
+    if (!state.bound)
+      return -1;
+    if (memcmp(state.mac, mac, 6) == 0)
+      return flow;
+    flow = flow + 1 < _flowCount ? flow + 1 : 0;
+  }
+  return -1;
+}
+
+uint8_t OSCLeaderCore::rxFlowOf(const uint8_t *mac, const uint8_t *data,
+                                int len) {
+  // Upstream envelopes count against the node that sent them, not the relay
+  if (len >= (int)sizeof(LeaderRelayHeader) &&
+      data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_RELAY &&
+      (data[offsetof(LeaderRelayHeader, flags)] & RELAY_UPSTREAM))
+    mac = data + offsetof(LeaderRelayHeader, origin);
+
+  unsigned long now = millis();
+  int found = findRxFlow(mac);
+  if (found >= 0) {
+    _flows[found].heard = now;
+    return found;
+  }
+
+  // A new sender takes the first free flow on its probe path. Once all are
+  // bound it takes the idle one heard from longest ago: there are more
+  // flows than queue entries, so one is always idle
+  uint8_t flow = hashMac(mac) % _flowCount;
+  int idle = -1;
+  for (uint8_t n = 0; n < _flowCount; n++) {
+    RxFlow &state = _flows[flow];
+    if (!state.bound) {
+      idle = flow;
+      break;
+    }
+    if (state.in == state.out &&
+        (idle < 0 || now - state.heard > now - _flows[idle].heard))
+      idle = flow;
+    flow = flow + 1 < _flowCount ? flow + 1 : 0;
+  }
+  RxFlow &state = _flows[idle];
+  memcpy(state.mac, mac, 6);
+  state.bound = true;
+  state.heard = now;
+  return idle;
+}
+
+// ==========================================
+// LEADER COMPACT ENCODING
+// ==========================================
+
+bool OSCLeaderCore::handleCompactFrame(const uint8_t *mac,
+                                       const uint8_t *&data, int &len) {
+  LeaderCompactHeader header;
+  memcpy(&header, data, sizeof(header));
+  const uint8_t *body = data + sizeof(header);
+  int size = len - sizeof(header);
+  unsigned long now = millis();
+
+  // The node's layout, or room for a new one: a free entry, else the one
+  // idle longest
+  CompactEntry *entry = nullptr;
+  CompactEntry *empty = nullptr;
+  CompactEntry *idle = nullptr;
+  for (uint8_t i = 0; i < _compactTable; i++) {
+    CompactEntry &e = _compact[i];
+    if (!e.schema.valid()) {
+      if (!empty)
+        empty = &e;
+      continue;
+    }
+    if (e.id == header.schema && memcmp(e.mac, mac, 6) == 0) {
+      entry = &e;
+      break;
+    }
+    if (now - e.usedAt > COMPACT_IDLE_MS &&
+        (!idle || (long)(e.usedAt - idle->usedAt) < 0))
+      idle = &e;
+  }
+
+  if (header.kind == COMPACT_SCHEMA) {
+    if (!entry)
+      entry = empty ? empty : idle;
+    OSCCompactSchema schema;
+    if (!entry || !schema.load(body, size)) {
+      sendCompactReply(mac, COMPACT_REFUSE, header.schema);
+      return false;
+    }
+    entry->schema = schema;
+    memcpy(entry->mac, mac, 6);
+    entry->id = header.schema;
+    entry->primed = false;
+    entry->usedAt = now;
+    sendCompactReply(mac, COMPACT_ACCEPT, header.schema);
+    return false;
+  }
+  if (header.kind != COMPACT_KEY && header.kind != COMPACT_DELTA)
+    return false;
+
+  // Restarted, or a standby that took over: have the node announce again
+  if (!entry) {
+    if (now - _compactUnknownAt >= COMPACT_UNKNOWN_SPACING_MS) {
+      _compactUnknownAt = now;
+      sendCompactReply(mac, COMPACT_UNKNOWN, header.schema);
+    }
+    return false;
+  }
+
+  entry->usedAt = now;
+  if (header.kind == COMPACT_KEY) {
+    if (!entry->schema.unpackKey(body, size, entry->steps))
+      return false;
+  } else if (!entry->primed || header.seq != (uint8_t)(entry->seq + 1) ||
+             !entry->schema.unpackDelta(body, size, entry->steps)) {
+    entry->primed = false; // Wait for the next key
+    _compactSkipped++;
+    return false;
+  }
+  entry->primed = true;
+  entry->seq = header.seq;
+
+  int expanded = entry->schema.expand(entry->steps, _compactOut);
+  _compactExpanded++;
+  if (expanded > len)
+    _compactSaved += expanded - len;
+  data = _compactOut;
+  len = expanded;
+  return true;
+}
+
+void OSCLeaderCore::sendCompactReply(const uint8_t *mac, uint8_t kind,
+                                     uint8_t schema) {
+  LeaderCompactReply reply = {LEADER_CTRL_MAGIC, CTRL_COMPACT, kind, schema,
+                              {}};
+  memcpy(reply.node, mac, 6);
+  int index = findNode(mac);
+  if (index < 0 || _activeNodes[index].hops ||
+      unicastFrame(mac, (const uint8_t *)&reply, sizeof(reply)) != ESP_OK)
+    broadcastFrame((const uint8_t *)&reply, sizeof(reply));
+}
+
+void OSCLeaderCore::sendCompactReport() {
+  int layouts = 0;
+  for (uint8_t i = 0; i < _compactTable; i++)
+    if (_compact[i].schema.valid())
+      layouts++;
+
+  OSCValue outVals[4];
+  outVals[0].type = 'i';
+  outVals[0].i = layouts;
+  outVals[1].type = 'i';
+  outVals[1].i = _compactExpanded;
+  outVals[2].type = 'i';
+  outVals[2].i = _compactSaved;
+  outVals[3].type = 'i';
+  outVals[3].i = _compactSkipped;
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/compact",
+                             outVals, 4);
+  _sendSlipToSerial(outBuffer, outLen);
+
+  _compactExpanded = 0;
+  _compactSaved = 0;
+  _compactSkipped = 0;
+}
+
+// ==========================================
+// LEADER RELIABLE DELIVERY
+// ==========================================
+
+bool OSCLeaderCore::addReliable(const char *pattern) {
+  return _reliablePatterns.add(pattern);
+}
+
+bool OSCLeaderCore::sendReliable(const uint8_t *data, int len,
+                                 uint32_t nodeID) {
+  if (len > LEADER_RELIABLE_MESSAGE)
+    return false;
+
+  // Broadcasts wait for nodes that can hear them: live, awake and still ours
+  unsigned long currentMillis = millis();
+  auto addressee = [&](const NodeRecord &node) {
+    if (!node.active || node.movedAt != 0 ||
+        currentMillis - node.lastSeen > NODE_TIMEOUT)
+      return false;
+    return nodeID ? node.nodeID == nodeID : node.wakeInterval == 0;
+  };
+  uint8_t pending = 0;
+  for (int i = 0; i < _nodeCount; i++)
+    if (addressee(_activeNodes[i]) && pending < 255)
+      pending++;
+  if (pending == 0)
+    return false;
+
+  // Take a free slot, or give up on the oldest message
+  uint8_t index = 0;
+  for (uint8_t i = 0; i < LEADER_RELIABLE_SLOTS; i++) {
+    if (_reliable[i].len == 0) {
+      index = i;
+      break;
+    }
+    if (_reliable[i].sentAt - _reliable[index].sentAt > 0x7FFFFFFFUL)
+      index = i;
+  }
+  if (_reliable[index].len)
+    releaseReliable(index);
+
+  uint8_t bit = 1 << index;
+  for (int i = 0; i < _nodeCount; i++)
+    if (addressee(_activeNodes[i]))
+      _activeNodes[i].reliablePending |= bit;
+
+  // Every node answers a broadcast copy: give their acks room to take turns
+  ReliableSlot &slot = _reliable[index];
+  uint32_t spread = nodeID ? 0 : pending * RELIABLE_ACK_SPACING_US / 100;
+  slot.spread = spread > 255 ? 255 : spread;
+  LeaderReliableHeader header = {LEADER_CTRL_MAGIC, CTRL_RELIABLE,
+                                 RELIABLE_DATA,     0,
+                                 _reliableSeq++,    slot.spread};
+  memcpy(slot.frame, &header, sizeof(header));
+  memcpy(slot.frame + sizeof(header), data, len);
+  slot.len = sizeof(header) + len;
+  slot.nodeID = nodeID;
+  slot.attempt = 0;
+  slot.addressees = slot.pending = pending;
+  slot.sentAt = micros();
+  _reliableSent++;
+  transmitReliable(slot); // A refused first copy is repeated like a lost one
+  slot.retryAt = slot.sentAt + reliableWait(slot);
+  return true;
+}
+
+uint32_t OSCLeaderCore::reliableWait(const ReliableSlot &slot) {
+  // Broadcast acks are spread out, and dozing nodes answer after check-in
+  uint32_t wait = slot.frame[offsetof(LeaderReliableHeader, spread)] * 100UL +
+                  _reliableTimeout.after(slot.attempt);
+  uint8_t bit = 1 << (&slot - _reliable);
+  for (int i = 0; i < _nodeCount; i++) {
+    const NodeRecord &node = _activeNodes[i];
+    if ((node.reliablePending & bit) && !nodeListening(node))
+      return wait + node.wakeInterval * 1000UL;
+  }
+  return wait;
+}
+
+bool OSCLeaderCore::transmitReliable(ReliableSlot &slot) {
+  slot.frame[offsetof(LeaderReliableHeader, attempt)] = slot.attempt;
+  slot.frame[offsetof(LeaderReliableHeader, spread)] = 0;
+  uint8_t bit = 1 << (&slot - _reliable);
+
+  // Repeats of a broadcast go to the nodes still missing it, with MAC-level
+  // retries, unless that is most of them or one sits behind a relay
+  bool broadcast = slot.nodeID == 0;
+  if (broadcast && slot.attempt > 0 && slot.pending * 2 <= slot.addressees) {
+    broadcast = false;
+    for (int i = 0; i < _nodeCount; i++)
+      if ((_activeNodes[i].reliablePending & bit) && _activeNodes[i].hops)
+        broadcast = true;
+  }
+  if (broadcast) {
+    slot.frame[offsetof(LeaderReliableHeader, spread)] = slot.spread;
+    return broadcastFrame(slot.frame, slot.len) == ESP_OK;
+  }
+
+  bool sent = false;
+  for (int i = 0; i < _nodeCount; i++) {
+    NodeRecord &node = _activeNodes[i];
+    if (!(node.reliablePending & bit))
+      continue;
+    if (!nodeListening(node))
+      sent |= holdFrame(node.mac, slot.frame, slot.len);
+    else
+      sent |= unicastFrame(node.mac, slot.frame, slot.len) == ESP_OK;
+  }
+  return sent;
+}
+
+void OSCLeaderCore::releaseReliable(uint8_t index) {
+  uint8_t bit = 1 << index;
+  for (int i = 0; i < _nodeCount; i++) {
+    if (_activeNodes[i].reliablePending & bit) {
+      _activeNodes[i].reliablePending &= ~bit;
+      _reliableFailed++;
+    }
+  }
+  _reliable[index].len = 0;
+}
+
+bool OSCLeaderCore::handleReliableFrame(const uint8_t *mac,
+                                        const uint8_t *&data, int &len) {
+  LeaderReliableHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (header.kind == RELIABLE_ACK) {
+    int index = findNode(mac);
+    if (index < 0)
+      return false;
+    NodeRecord &node = _activeNodes[index];
+    for (uint8_t i = 0; i < LEADER_RELIABLE_SLOTS; i++) {
+      ReliableSlot &slot = _reliable[i];
+      uint8_t bit = 1 << i;
+      if (slot.len == 0 || !(node.reliablePending & bit) ||
+          memcmp(slot.frame + offsetof(LeaderReliableHeader, seq),
+                 &header.seq, sizeof(header.seq)) != 0)
+        continue;
+      node.reliablePending &= ~bit;
+      _reliableDelivered++;
+      uint32_t delay = micros() - slot.sentAt;
+      _reliableLatency.add(delay);
+      if (slot.nodeID)
+        _reliableTimeout.sample(delay); // Broadcast acks wait out the spread
+      if (slot.pending)
+        slot.pending--;
+      if (slot.pending == 0)
+        slot.len = 0;
+      break;
+    }
+    return false;
+  }
+  if (header.kind != RELIABLE_DATA || len <= (int)sizeof(header))
+    return false;
+
+  // Every copy is answered, as the previous answer may be the one lost.
+  // Nodes in range get it with MAC-level retries; relays carry the rest.
+  LeaderReliableAck ack = {LEADER_CTRL_MAGIC, CTRL_RELIABLE, RELIABLE_ACK,
+                           header.attempt, header.seq, {}};
+  memcpy(ack.node, mac, 6);
+  int index = findNode(mac);
+  if (index < 0 || _activeNodes[index].hops ||
+      unicastFrame(mac, (const uint8_t *)&ack, sizeof(ack)) != ESP_OK)
+    broadcastFrame((const uint8_t *)&ack, sizeof(ack));
+
+  bool repeat = index >= 0 ? _activeNodes[index].reliableSeen.seen(header.seq)
+                           : _reliableDedup.seen(mac, header.seq);
+  if (repeat) {
+    _reliableDuplicates++;
+    return false;
+  }
+  _reliableReceived++;
+  data += sizeof(header);
+  len -= sizeof(header);
+  return true;
+}
+
+void OSCLeaderCore::serviceReliable() {
+  unsigned long now = micros();
+  for (uint8_t i = 0; i < LEADER_RELIABLE_SLOTS; i++) {
+    ReliableSlot &slot = _reliable[i];
+    if (slot.len == 0 || (long)(now - slot.retryAt) < 0)
+      continue;
+
+    // Nodes dropped from the registry took their pending bit with them
+    uint8_t bit = 1 << i;
+    uint8_t pending = 0;
+    for (int n = 0; n < _nodeCount; n++)
+      if (_activeNodes[n].reliablePending & bit)
+        pending++;
+    slot.pending = pending;
+    if (pending == 0) {
+      slot.len = 0;
+      continue;
+    }
+    if (slot.attempt >= LEADER_RELIABLE_RETRIES) {
+      releaseReliable(i);
+      continue;
+    }
+    slot.attempt++;
+    if (transmitReliable(slot))
+      _reliableRetransmits++;
+    slot.retryAt = now + reliableWait(slot);
+  }
+}
+
+void OSCLeaderCore::sendReliableReport() {
+  uint8_t outBuffer[96];
+  OSCValue vals[8];
+  for (int i = 0; i < 8; i++)
+    vals[i].type = 'i';
+
+  vals[0].i = _reliableSent;
+  vals[1].i = _reliableDelivered;
+  vals[2].i = _reliableRetransmits;
+  vals[3].i = _reliableFailed;
+  vals[4].i = _reliableLatency.percentile(50);
+  vals[5].i = _reliableLatency.percentile(99);
+  vals[6].i = _reliableReceived;
+  vals[7].i = _reliableDuplicates;
+  _reliableSent = _reliableDelivered = _reliableRetransmits = 0;
+  _reliableFailed = _reliableReceived = _reliableDuplicates = 0;
+
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/reliable",
+                             vals, 8);
+  _sendSlipToSerial(outBuffer, outLen);
+}
+
+// ==========================================
+// LEADER TRAFFIC CAPTURE
+// ==========================================
+
+bool OSCLeaderCore::enableCapture(size_t bytes) {
+  if (bytes < sizeof(LeaderCaptureRecord) + LEADER_MAX_MESSAGE)
+    bytes = sizeof(LeaderCaptureRecord) + LEADER_MAX_MESSAGE;
+
+  if (bytes != _captureSize) {
+    free(_capture);
+    // Internal RAM is scarce; a few megabytes of PSRAM hold minutes of show
+    _capture = psramFound() ? (uint8_t *)ps_malloc(bytes) : nullptr;
+    if (!_capture)
+      _capture = (uint8_t *)malloc(bytes);
+    _captureSize = _capture ? bytes : 0;
+  }
+
+  _captureHead = 0;
+  _captureTail = 0;
+  _captureEnd = 0;
+  _captureWrapped = false;
+  _captureEntries = 0;
+  _captureDropped = 0;
+  _captureDumping = false;
+  _capturing = _capture != nullptr;
+  return _capturing;
+}
+
+void OSCLeaderCore::captureFrame(uint8_t dir, const uint8_t *mac,
+                                 const uint8_t *data, int len,
+                                 unsigned long stamp) {
+  if (len > LEADER_MAX_MESSAGE)
+    len = LEADER_MAX_MESSAGE;
+  size_t need = sizeof(LeaderCaptureRecord) + len;
+  if (_captureEntries == 0) {
+    _captureHead = _captureTail = _captureEnd = 0;
+    _captureWrapped = false;
+  }
+
+  // Records never straddle the end of the ring, so a dump can send runs of
+  // them straight from it
+  for (;;) {
+    if (!_captureWrapped) {
+      if (_captureHead + need <= _captureSize)
+        break;
+      _captureEnd = _captureHead;
+      _captureHead = 0;
+      _captureWrapped = true;
+    }
+    if (_captureHead + need <= _captureTail)
+      break;
+
+    // Evict the oldest record
+    LeaderCaptureRecord oldest;
+    memcpy(&oldest, _capture + _captureTail, sizeof(oldest));
+    _captureTail += sizeof(oldest) + oldest.len;
+    _captureEntries--;
+    _captureDropped++;
+    if (_captureTail >= _captureEnd) {
+      _captureTail = 0;
+      _captureWrapped = false;
+    }
+  }
+
+  LeaderCaptureRecord record;
+  record.timeUs = stamp;
+  record.len = len;
+  record.dir = dir;
+  if (mac)
+    memcpy(record.mac, mac, 6);
+  else
+    memset(record.mac, 0, 6);
+  memcpy(_capture + _captureHead, &record, sizeof(record));
+  memcpy(_capture + _captureHead + sizeof(record), data, len);
+  _captureHead += need;
+  _captureEntries++;
+}
+
+void OSCLeaderCore::sendCapture() {
+  if (_captureDumping)
+    return;
+  _captureDumping = true;
+  _captureResume = _capturing;
+  _capturing = false; // Hold the ring still while it is read out
+  _captureDumpPos = _captureTail;
+  _captureDumpWrapped = _captureWrapped;
+  _captureDumpLeft = _captureEntries;
+}
+
+void OSCLeaderCore::serviceCapture() {
+  if (!_captureDumping)
+    return;
+
+  uint8_t outBuffer[sizeof(LeaderCaptureRecord) + LEADER_MAX_MESSAGE + 32];
+  for (uint8_t burst = 0; burst < CAPTURE_BURST; burst++) {
+    if (_captureDumpLeft == 0) {
+      OSCValue outVals[3];
+      outVals[0].type = 'i';
+      outVals[0].i = _captureEntries;
+      outVals[1].type = 'i';
+      outVals[1].i = _captureDropped;
+      outVals[2].type = 'i';
+      outVals[2].i = _captureSize;
+      int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer),
+                                 "/sys/capture/end", outVals, 3);
+      _sendSlipToSerial(outBuffer, outLen);
+      _captureDumping = false;
+      _capturing = _captureResume;
+      return;
+    }
+
+    // Gather whole records up to a chunk, or a single larger one
+    size_t start = _captureDumpPos;
+    size_t run = 0;
+    while (_captureDumpLeft > 0) {
+      LeaderCaptureRecord record;
+      memcpy(&record, _capture + _captureDumpPos, sizeof(record));
+      size_t size = sizeof(record) + record.len;
+      if (run > 0 && run + size > CAPTURE_CHUNK)
+        break;
+      run += size;
+      _captureDumpPos += size;
+      _captureDumpLeft--;
+      if (_captureDumpWrapped && _captureDumpPos >= _captureEnd) {
+        _captureDumpPos = 0;
+        _captureDumpWrapped = false;
+        break;
       }
     }
+
+    OSCValue outVal;
+    outVal.type = 'b';
+    outVal.s = (const char *)(_capture + start);
+    outVal.len = run;
+    int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/capture",
+                               &outVal, 1);
+    _sendSlipToSerial(outBuffer, outLen);
+  }
+}
+
+// ==========================================
+// LEADER HOT-STANDBY FAILOVER
+// ==========================================
+
+void OSCLeaderCore::enableFailover(bool standby, unsigned long beaconInterval,
+                                   uint8_t missedBeacons) {
+  _failoverEnabled = true;
+  _standby = standby;
+  _beaconInterval = beaconInterval > 0 ? beaconInterval : 1;
+  _takeoverTimeout = _beaconInterval * (missedBeacons > 0 ? missedBeacons : 1);
+
+  // A standby that never hears a primary takes over after the boot grace
+  _lastPrimaryMicros = micros();
+  _primaryHoldMs = 0;
+  _primaryHeard = false;
+
+  if (!_standby)
+    sendBeacon();
+  sendRoleFeedback();
+}
+
+void OSCLeaderCore::sendBeacon(uint16_t holdMs) {
+  LeaderBeaconFrame beacon;
+  beacon.magic = LEADER_CTRL_MAGIC;
+  beacon.op = CTRL_BEACON;
+  beacon.channel = _peerInfo.channel;
+  beacon.flags = _shard;
+  beacon.epoch = _epoch;
+  beacon.holdMs = holdMs;
+
+  esp_now_send(_broadcastAddress, (const uint8_t *)&beacon, sizeof(beacon));
+  _lastBeaconTime = millis();
+}
+
+void OSCLeaderCore::sendDirectory() {
+  static constexpr uint8_t PER_CHUNK =
+      (LEADER_V1_PAYLOAD - sizeof(LeaderDirectoryHeader)) /
+      sizeof(LeaderDirectoryEntry);
+  unsigned long currentMillis = millis();
+
+  // Only live nodes are mirrored, so stale entries age out on the standby too
+  uint8_t live[UINT8_MAX];
+  uint8_t liveCount = 0;
+  for (uint8_t i = 0; i < _nodeCount; i++) {
+    if (_activeNodes[i].active &&
+        currentMillis - _activeNodes[i].lastSeen <= 10000)
+      live[liveCount++] = i;
+  }
+
+  uint8_t frame[LEADER_V1_PAYLOAD];
+  uint8_t first = 0;
+  do {
+    uint8_t count = liveCount - first;
+    if (count > PER_CHUNK)
+      count = PER_CHUNK;
+
+    LeaderDirectoryHeader header;
+    header.magic = LEADER_CTRL_MAGIC;
+    header.op = CTRL_DIRECTORY;
+    header.first = first;
+    header.count = count;
+    header.total = liveCount;
+    memcpy(frame, &header, sizeof(header));
+
+    int len = sizeof(header);
+    for (uint8_t i = 0; i < count; i++) {
+      const NodeRecord &node = _activeNodes[live[first + i]];
+      LeaderDirectoryEntry entry;
+      memcpy(entry.mac, node.mac, 6);
+      entry.nodeID = node.nodeID;
+      memcpy(frame + len, &entry, sizeof(entry));
+      len += sizeof(entry);
+    }
+
+    esp_now_send(_broadcastAddress, frame, len);
+    first += count;
+  } while (first < liveCount);
+}
+
+void OSCLeaderCore::serviceFailover() {
+  if (!_failoverEnabled)
+    return;
+
+  if (_standby) {
+    unsigned long limitMs = _takeoverTimeout + _primaryHoldMs;
+    if (!_primaryHeard && limitMs < FAILOVER_BOOT_GRACE)
+      limitMs = FAILOVER_BOOT_GRACE;
+    if (micros() - _lastPrimaryMicros > limitMs * 1000UL)
+      takeOver();
+    return;
+  }
+
+  unsigned long currentMillis = millis();
+  if (currentMillis - _lastBeaconTime >= _beaconInterval)
+    sendBeacon();
+
+  if (currentMillis - _lastDirectoryTime >= DIRECTORY_INTERVAL) {
+    _lastDirectoryTime = currentMillis;
+    sendDirectory();
+  }
+}
+
+void OSCLeaderCore::takeOver() {
+  _standby = false;
+  _epoch++;
+
+  // The first beacon is what re-binds the Followers: stamp the takeover there
+  sendBeacon();
+  _takeoverMicros = micros() - _lastPrimaryMicros;
+
+  // Repeat the announcement in case the first broadcast is lost
+  sendBeacon();
+  sendDirectory();
+  _lastDirectoryTime = millis();
+
+  OSCValue outVals[2];
+  outVals[0].type = 'i';
+  outVals[0].i = _epoch;
+  outVals[1].type = 'i';
+  outVals[1].i = _takeoverMicros;
+
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/leader/takeover",
+                             outVals, 2);
+  _sendSlipToSerial(outBuffer, outLen);
+
+  sendRoleFeedback();
+}
+
+void OSCLeaderCore::sendRoleFeedback() {
+  OSCValue outVals[2];
+  outVals[0].type = 'i';
+  outVals[0].i = _standby ? 0 : 1;
+  outVals[1].type = 'i';
+  outVals[1].i = _epoch;
+
+  uint8_t outBuffer[64];
+  int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/leader/role",
+                             outVals, 2);
+  _sendSlipToSerial(outBuffer, outLen);
+}
+
+void OSCLeaderCore::handleControlFrame(const uint8_t *mac, const uint8_t *data,
+                                       int len) {
+  if (data[1] == CTRL_CAPS) {
+    if (_standby || len < (int)sizeof(LeaderCapsFrame))
+      return;
+    LeaderCapsFrame caps;
+    memcpy(&caps, data, sizeof(caps));
+    if (caps.flags & CAPS_QUERY)
+      return; // Another Leader's query, not a node
+
+    int index = updateNodeRegistry(mac, 0);
+    if (index >= 0)
+      _activeNodes[index].maxPayload = caps.maxPayload;
+    return;
+  }
+
+  if (data[1] == CTRL_WAKE) {
+    if (_standby || len < (int)sizeof(LeaderWakeFrame))
+      return;
+    LeaderWakeFrame wake;
+    memcpy(&wake, data, sizeof(wake));
+
+    // The window opens now; servicePowerSave() releases what is held
+    int index = updateNodeRegistry(mac, wake.nodeID);
+    if (index < 0)
+      return;
+    NodeRecord &node = _activeNodes[index];
+    node.wakeInterval = wake.intervalMs;
+    node.wakeWindow = wake.windowMs;
+    node.awakePermille = wake.intervalMs ? wake.awakePermille : 1000;
+    node.wakeAt = millis();
+    return;
+  }
+
+  if (data[1] == CTRL_SLOT) {
+    if (_standby || _slotCount == 0 || len < (int)sizeof(LeaderSlotHeader))
+      return;
+    if (data[offsetof(LeaderSlotHeader, kind)] == SLOT_REQUEST)
+      assignSlot(mac);
+    return;
+  }
+
+  if (data[1] == CTRL_PEERS) {
+    if (_standby || len < (int)sizeof(LeaderPeerHeader))
+      return;
+    LeaderPeerHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.kind == PEER_ANNOUNCE) {
+      int index = updateNodeRegistry(mac, header.id);
+      if (index < 0)
+        return;
+      _activeNodes[index].groups = header.groups;
+      _activeNodes[index].peering = true;
+      _peerTablePending = true; // Answer the newcomer, rate-limited
+    } else if (header.kind == PEER_MIRROR) {
+      reportPeerMirror(mac, data, len);
+    }
+    return;
+  }
+
+  if (!_failoverEnabled)
+    return;
+
+  switch (data[1]) {
+  case CTRL_BEACON: {
+    if (len < (int)sizeof(LeaderBeaconFrame))
+      return;
+    LeaderBeaconFrame beacon;
+    memcpy(&beacon, data, sizeof(beacon));
+    if ((beacon.flags & BEACON_SHARD_MASK) != _shard)
+      return; // Another shard's Leader: neither a rival nor a primary
+
+    if (_standby) {
+      if (beacon.epoch < _epoch)
+        return; // Stale Leader from an older term
+      _epoch = beacon.epoch;
+      _lastPrimaryMicros = micros();
+      _primaryHoldMs = beacon.holdMs;
+      _primaryHeard = true;
+      if (beacon.channel != _peerInfo.channel)
+        applyChannel(beacon.channel);
+      return;
+    }
+
+    // Two serving Leaders: the newer term wins, MAC order breaks ties
+    uint8_t ownMac[6];
+    esp_read_mac(ownMac, ESP_MAC_WIFI_STA);
+    if (beacon.epoch > _epoch ||
+        (beacon.epoch == _epoch && memcmp(mac, ownMac, 6) < 0)) {
+      _epoch = beacon.epoch;
+      _standby = true;
+      _lastPrimaryMicros = micros();
+      _primaryHoldMs = beacon.holdMs;
+      _primaryHeard = true;
+      sendRoleFeedback();
+    }
+    break;
+  }
+
+  case CTRL_DIRECTORY: {
+    if (!_standby || len < (int)sizeof(LeaderDirectoryHeader))
+      return;
+    LeaderDirectoryHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    int offset = sizeof(header);
+    for (uint8_t i = 0; i < header.count; i++) {
+      if (offset + (int)sizeof(LeaderDirectoryEntry) > len)
+        break;
+      LeaderDirectoryEntry entry;
+      memcpy(&entry, data + offset, sizeof(entry));
+      updateNodeRegistry(entry.mac, entry.nodeID);
+      offset += sizeof(entry);
+    }
+    break;
+  }
+
+  case CTRL_HOP:
+    // Follow the primary's migration; its hop burst also proves liveness
+    if (_standby && len == 4) {
+      _lastPrimaryMicros = micros();
+      _primaryHeard = true;
+      if (data[3] != _peerInfo.channel)
+        applyChannel(data[3]);
+    }
+    break;
+  }
+}
+
+// Tests whether a message is addressed exactly to the given OSC address
+static bool matchAddress(const uint8_t *frame, int len, const char *address) {
+  int addrLen = strlen(address);
+  return len > addrLen && strncmp((const char *)frame, address, addrLen) == 0 &&
+         frame[addrLen] == '\0';
+}
+
+bool OSCLeaderCore::handleHostFrame(const uint8_t *frame, int len) {
+  // Traffic capture: "/leader/capture 1 [bytes]" starts, 0 stops
+  if (matchAddress(frame, len, "/leader/capture")) {
+    OSCValue args[2];
+    int count = MiniOSC::extract(frame, len, "/leader/capture", args, 2);
+    // A size of another type is refused, not read as a garbage int
+    bool sized = count >= 2 && args[1].type == 'i';
+    if (count >= 1 && args[0].type == 'i' && (count < 2 || sized)) {
+      if (args[0].i == 0)
+        disableCapture();
+      else
+        enableCapture(sized && args[1].i > 0 ? args[1].i
+                                             : LEADER_CAPTURE_BYTES);
+    }
+    return true;
+  }
+  if (matchAddress(frame, len, "/leader/capture/dump")) {
+    sendCapture();
+    return true;
+  }
+  if (_capturing)
+    captureFrame(CAPTURE_HOST, nullptr, frame, len, micros());
+
+  // Intercept local telemetry ping address natively
+  if (matchAddress(frame, len, "/leader/ping")) {
+    sendPingReply();
+    return true;
+  }
+  // Intercept forcing manual channel hopping mechanism
+  if (matchAddress(frame, len, "/leader/hop")) {
+    triggerHop();
+    return true;
+  }
+  // Intercept node registry query
+  if (matchAddress(frame, len, "/leader/nodes")) {
+    sendNodeRegistry();
+    return true;
+  }
+  // Intercept relay route table query
+  if (matchAddress(frame, len, "/leader/routes")) {
+    sendRouteTable();
+    return true;
+  }
+  // Intercept power-save statistics query
+  if (matchAddress(frame, len, "/leader/powersave")) {
+    sendPowerSaveReport();
+    return true;
+  }
+  // Shard load report: "/leader/shard"
+  if (matchAddress(frame, len, "/leader/shard")) {
+    sendShardReport();
+    return true;
+  }
+  // "/leader/shard/move nodeID channel shard"
+  if (matchAddress(frame, len, "/leader/shard/move")) {
+    OSCValue args[3];
+    if (MiniOSC::extract(frame, len, "/leader/shard/move", args, 3) == 3 &&
+        args[0].type == 'i' && args[1].type == 'i' && args[2].type == 'i')
+      moveNode(args[0].i, args[1].i, args[2].i);
+    return true;
+  }
+  // "/leader/shard/shed channel shard budgetPermille"
+  if (matchAddress(frame, len, "/leader/shard/shed")) {
+    OSCValue args[3];
+    if (MiniOSC::extract(frame, len, "/leader/shard/shed", args, 3) == 3 &&
+        args[0].type == 'i' && args[1].type == 'i' && args[2].type == 'i' &&
+        args[2].i > 0)
+      shedLoad(args[0].i, args[1].i, args[2].i > 1000 ? 1000 : args[2].i);
+    return true;
+  }
+  // Reliable lane: "/leader/reliable pattern" marks addresses, and without
+  // arguments reports the lane
+  if (matchAddress(frame, len, "/leader/reliable")) {
+    OSCValue args[1];
+    args[0].s = nullptr;
+    if (MiniOSC::extract(frame, len, "/leader/reliable", args, 1) == 1 &&
+        args[0].type == 's' && args[0].s)
+      addReliable(args[0].s);
+    else
+      sendReliableReport();
+    return true;
+  }
+  if (matchAddress(frame, len, "/leader/reliable/clear")) {
+    clearReliable();
+    return true;
+  }
+  // Receive fairness: "/leader/rx" reports, "/leader/rx/cap nodeID hz" caps
+  if (matchAddress(frame, len, "/leader/rx")) {
+    sendRxReport();
+    return true;
+  }
+  if (matchAddress(frame, len, "/leader/rx/cap")) {
+    OSCValue args[2];
+    if (MiniOSC::extract(frame, len, "/leader/rx/cap", args, 2) == 2 &&
+        args[0].type == 'i' && args[1].type == 'i' && args[1].i >= 0)
+      setRateCap(args[0].i, args[1].i > 0xFFFF ? 0xFFFF : args[1].i);
+    return true;
+  }
+  // Compact encoding: "/leader/compact" reports the layouts expanded
+  if (matchAddress(frame, len, "/leader/compact")) {
+    sendCompactReport();
+    return true;
+  }
+  // Heartbeat pass-through: "/leader/heartbeats 1" forwards every pong
+  if (matchAddress(frame, len, "/leader/heartbeats")) {
+    OSCValue enable[1];
+    if (MiniOSC::extract(frame, len, "/leader/heartbeats", enable, 1) == 1 &&
+        enable[0].type == 'i')
+      _heartbeatPassThrough = enable[0].i != 0;
+    return true;
+  }
+  // The heartbeat interval set by the host tells how often pongs are due
+  if (matchAddress(frame, len, "/sys/ping")) {
+    OSCValue interval[1];
+    if (MiniOSC::extract(frame, len, "/sys/ping", interval, 1) == 1 &&
+        interval[0].type == 'i') {
+      uint32_t previous = _heartbeatInterval;
+      _heartbeatInterval = interval[0].i > 0 ? interval[0].i : 0;
+      for (uint8_t i = 0; i < _nodeCount; i++)
+        _activeNodes[i].lastBeat = 0; // Old gaps mean nothing now
+      // Slots sized from the interval are re-planned to the new one
+      if (_slotCount && !_slotUsConfig && _heartbeatInterval &&
+          _heartbeatInterval != previous)
+        planSlots();
+    }
+  }
+  // Heartbeat slots: "/leader/slots slotCount [slotUs] [tdma]"
+  if (matchAddress(frame, len, "/leader/slots")) {
+    OSCValue args[3];
+    int count = MiniOSC::extract(frame, len, "/leader/slots", args, 3);
+    bool typed = true;
+    for (int i = 0; i < count; i++)
+      typed &= args[i].type == 'i';
+    if (count >= 1 && typed && args[0].i >= 0) {
+      // Clamp before enableSlots() narrows the count to 16 bits
+      uint16_t slots =
+          args[0].i < LEADER_MAX_SLOTS ? args[0].i : LEADER_MAX_SLOTS;
+      uint32_t slotUs = count >= 2 && args[1].i > 0 ? args[1].i : 0;
+      enableSlots(slots, slotUs, count >= 3 && args[2].i != 0);
+    }
+    return true;
+  }
+  // Unicast to a single node: "/leader/send nodeID blob"
+  if (matchAddress(frame, len, "/leader/send")) {
+    OSCValue args[2];
+    if (!_standby &&
+        MiniOSC::extract(frame, len, "/leader/send", args, 2) == 2 &&
+        args[0].type == 'i' && args[1].type == 'b' &&
+        sendToNode(args[0].i, (const uint8_t *)args[1].s, args[1].len))
+      _packetsSent++;
+    else
+      _packetsDropped++;
+    return true;
+  }
+  // Host link framing negotiation never leaves the Leader
+  if (handleFramingHandshake(frame, len, _hostIn, _hostOut))
+    return false;
+
+  // A standby swallows host traffic until it takes over
+  if (_standby)
+    return false;
+
+  // Cues the host marked reliable wait for every node's acknowledgement
+  if (_reliablePatterns.matches(frame, len) && sendReliable(frame, len, 0)) {
+    _packetsSent++;
+    return true;
+  }
+
+  // Forward standard commands transparently out to the radio architecture
+  esp_err_t result = broadcastMessage(frame, len);
+  if (result == ESP_OK) {
+    _packetsSent++;
+  } else {
+    // Note: Retrying dropped packets breaks zero-latency constraint,
+    // therefore drops are counted dynamically but not continuously
+    // re-transmitted.
+    _packetsDropped++;
+  }
+  return true;
+}
+
+void OSCLeaderCore::processRxPacket(RxPacket &pkt) {
+  const uint8_t *src = pkt.mac;
+  const uint8_t *data = pkt.data;
+  int len = pkt.len;
+  uint8_t hops = 0;
+  uint32_t relayDelay = 0;
+
+  // Unwrap Followers reaching us over relays. Our own downstream envelopes
+  // echoed back by relays, and repeated copies, end here.
+  if (len >= (int)sizeof(LeaderRelayHeader) &&
+      data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_RELAY) {
+    LeaderRelayHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (_standby || !(header.flags & RELAY_UPSTREAM) ||
+        _relayDedup.seen(header.origin, header.seq))
+      return;
+    src = pkt.data + offsetof(LeaderRelayHeader, origin);
+    data += sizeof(header);
+    len -= sizeof(header);
+    hops = header.hops;
+    relayDelay = (uint32_t)header.delay * 10;
+  }
+
+  // Reassemble oversized messages; only complete ones travel further
+  if (len > (int)sizeof(LeaderFragmentHeader) &&
+      data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_FRAGMENT) {
+    if (_standby)
+      len = 0;
+    else
+      len = _reassembler.add(src, data, len, data);
+    if (len == 0)
+      return;
+  }
+
+  // Acknowledge reliable messages; acks and repeated copies end here
+  if (len >= (int)sizeof(LeaderReliableHeader) &&
+      data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_RELIABLE &&
+      (_standby || !handleReliableFrame(src, data, len)))
+    return;
+
+  // Expand compact messages; layout announcements end here
+  if (len >= (int)sizeof(LeaderCompactHeader) &&
+      data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_COMPACT &&
+      (_standby || !handleCompactFrame(src, data, len)))
+    return;
+
+  // Control traffic between Leaders never reaches the host
+  if (isLeaderControlFrame(data, len)) {
+    handleControlFrame(src, data, len);
+    return;
+  }
+
+  // A standby only mirrors; the primary owns the host stream
+  if (_standby)
+    return;
+
+  if (_capturing)
+    captureFrame(CAPTURE_RADIO, src, data, len, pkt.stamp);
+
+  // Update Node Registry on any incoming message
+  uint32_t possibleNodeID = 0;
+  bool heartbeat = false;
+  if (len > 9 && strncmp((const char *)data, "/sys/pong", 9) == 0) {
+    OSCValue pongArgs[1];
+    int pongCount = MiniOSC::extract(data, len, "/sys/pong", pongArgs, 1);
+    if (pongCount > 0 && pongArgs[0].type == 'i') {
+      possibleNodeID = pongArgs[0].i;
+      heartbeat = true;
+    }
+  }
+  int nodeIndex = updateNodeRegistry(src, possibleNodeID);
+  if (nodeIndex >= 0)
+    _activeNodes[nodeIndex].airUs += airtimeOf(pkt.len);
+  if (heartbeat && nodeIndex >= 0)
+    noteHeartbeat(_activeNodes[nodeIndex]);
+  noteRoute(nodeIndex, pkt.mac, hops, relayDelay);
+
+  // Ask unknown nodes whether they take large ESP-NOW v2 frames. Nodes
+  // that never answer (ESP-NOW v1 firmware) are left at 250 bytes.
+  if (nodeIndex >= 0 && _activeNodes[nodeIndex].maxPayload == 0 &&
+      _activeNodes[nodeIndex].capsQueries < CAPS_QUERY_TRIES &&
+      millis() - _lastCapsQuery >= CAPS_QUERY_INTERVAL)
+    sendCapsQuery();
+
+  // Forward received radio data to Host Computer via SLIP. Heartbeats
+  // only reach it as join/leave/quality events unless asked for.
+  // Nodes over their rate cap stop here, registry and heartbeat updated.
+  if (heartbeat && !_heartbeatPassThrough)
+    return;
+  if (nodeIndex >= 0) {
+    NodeRecord &node = _activeNodes[nodeIndex];
+    if (!withinRateCap(node))
+      return;
+    node.rxPassed++;
+  }
+  _sendSlipToSerial(data, len);
+}
+
+bool OSCLeaderCore::update() {
+  // Handle asynchronous status LED reset cycle
+  if (_ledPin >= 0 && _isLedOn && (millis() - _lastDataTime > _blinkDuration)) {
+    digitalWrite(_ledPin, _ledOffState);
+    _isLedOn = false;
+  }
+
+  // Process queued packets from ESP-NOW callback (thread-safe), taking
+  // turns between senders so a chatty node cannot hold up the others
+  int index;
+  while ((index = nextRxPacket()) >= 0) {
+    processRxPacket(_rxQueue[index]);
+    releaseRxPacket(index);
+  }
+
+  serviceRegistry();
+  serviceSlots();
+  servicePowerSave();
+  serviceReliable();
+  servicePeers();
+  serviceCapture();
+  serviceFailover();
+  serviceSharding();
+
+  // Automatic channel hopping on a periodic interval
+  if (_autoHop && !_standby &&
+      (millis() - _lastAutoHopTime >= AUTO_HOP_INTERVAL)) {
+    _lastAutoHopTime = millis();
+    triggerHop();
+  }
+
+  bool actionTriggered = false;
+
+  // Read framed OSC payloads incoming sequentially from Host Computer
+  uint8_t chunk[64];
+  while (_serial->available() > 0) {
+    int count = _serial->available();
+    if (count > (int)sizeof(chunk))
+      count = sizeof(chunk);
+    count = _serial->readBytes(chunk, count);
+    if (count <= 0)
+      break;
+
+    for (int i = 0; i < count; i++) {
+      int frameLen = _hostIn.feed(chunk[i]);
+      if (frameLen > 0 && handleHostFrame(_hostIn.data(), frameLen))
+        actionTriggered = true;
+    }
+  }
+
+  // One bulk write for everything this cycle produced
+  _hostOut.endOfUpdate();
+
+  // Update LED indicator on activity
+  if (actionTriggered && _ledPin >= 0) {
+    digitalWrite(_ledPin, _ledOnState);
+    _lastDataTime = millis();
+    _isLedOn = true;
+  }
+
+  return actionTriggered;
+}
+
+void OSCLeaderCore::_staticOnDataRecv(const esp_now_recv_info_t *info,
+                                      const uint8_t *incomingData, int len) {
+  if (_instance)
+    _instance->_handleDataRecv(info->src_addr, incomingData, len);
+}
+
+void OSCLeaderCore::_handleDataRecv(const uint8_t *mac,
+                                    const uint8_t *incomingData, int len) {
+  // Every frame heard occupied the channel, queued or not
+  __atomic_fetch_add(&_rxAirUs, airtimeOf(len), __ATOMIC_RELAXED);
+
+  // Queue the packet for processing in update() (main loop context)
+  // This avoids serial writes from the Wi-Fi task callback context
+  if (len > _rxPayload)
+    return; // Above the frame size we announced: truncating would corrupt it
+
+  // Fair share: one flow may fill three quarters of the queue while the
+  // others are quiet, but once it is half full each waiting flow only gets
+  // an equal part, keeping one part free for a sender yet to speak
+  uint8_t flow = rxFlowOf(mac, incomingData, len);
+  RxFlow &state = _flows[flow];
+  uint8_t capacity = _rxQueueSize - 1;
+  uint8_t used = (_rxHead - _rxTail + _rxQueueSize) % _rxQueueSize;
+  uint8_t queued = state.in - state.out;
+  uint8_t limit = capacity - capacity / 4;
+  if (used * 2 >= capacity) {
+    uint8_t waiting = queued ? 1 : 2;
+    for (uint8_t f = 0; f < _flowCount; f++)
+      if (_flows[f].in != _flows[f].out)
+        waiting++;
+    if (capacity / waiting < limit)
+      limit = capacity / waiting;
+  }
+  if (limit == 0)
+    limit = 1;
+  if (used >= capacity || queued >= limit) {
+    state.drops++; // Queue full for this sender, drop packet
+    return;
+  }
+
+  RxPacket &pkt = _rxQueue[_rxHead];
+  memcpy(pkt.data, incomingData, len);
+  memcpy(pkt.mac, mac, 6);
+  pkt.len = len;
+  pkt.stamp = micros();
+  pkt.flow = flow;
+
+  state.in++;
+  _rxHead = (_rxHead + 1) % _rxQueueSize;
+}
+
+// ==========================================
+// FOLLOWER IMPLEMENTATION
+// ==========================================
+
+OSCFollowerCore *OSCFollowerCore::_instance = nullptr;
+
+OSCFollowerCore::OSCFollowerCore(RxPacket *rxQueue, uint8_t rxQueueSize,
+                                 uint8_t *rxData, uint16_t rxPayload,
+                                 HostOutput *usbOut, HostInput *usbIn,
+                                 uint8_t *txSlot, uint16_t txMessage,
+                                 LeaderReassemblySlot *reassembly,
+                                 uint8_t reassemblySlots, PeerRecord *peers,
+                                 uint8_t maxPeers, SensorStream *streams,
+                                 uint8_t maxStreams, ReliableSlot *reliable,
+                                 uint8_t reliableSlots, CompactSlot *compact,
+                                 uint8_t compactSchemas)
+    : _reassembler(reassembly, reassemblySlots), _txSlot(txSlot),
+      _txMessage(txMessage), _peers(peers), _maxPeers(maxPeers),
+      _streams(streams), _maxStreams(maxStreams), _reliable(reliable),
+      _reliableSlots(reliableSlots), _compact(compact),
+      _compactSchemas(compactSchemas), _usbOut(usbOut), _usbIn(usbIn),
+      _rxQueue(rxQueue),
+      _rxQueueSize(rxQueueSize), _rxPayload(rxPayload) {
+  for (uint8_t i = 0; i < rxQueueSize; i++)
+    _rxQueue[i].data = rxData + (size_t)i * rxPayload;
+}
+
+void OSCFollowerCore::begin(uint8_t homeChannel, bool enableUSB, long baudRate,
+                            HostFraming framing) {
+  _instance = this;
+  _homeChannel = homeChannel;
+  _currentChannel = homeChannel;
+  _usbEnabled = enableUSB && _usbOut; // Ignored when compiled out
+
+  // Initialize tethered bridging state bindings conditionally
+  if (_usbEnabled) {
+    Serial.begin(baudRate);
+    _usbOut->begin(&Serial);
+    _usbOut->setFraming(framing);
+    _usbIn->setFraming(framing);
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  esp_wifi_set_ps(WIFI_PS_NONE);
+  esp_wifi_set_channel(_homeChannel, WIFI_SECOND_CHAN_NONE);
+
+  if (esp_now_init() != ESP_OK)
+    return;
+
+  esp_now_register_recv_cb(_staticOnDataRecv);
+  _lastMessageTime = millis();
+
+  // Generate a distinct internal tracking 16-bit identifier dynamically based
+  // on MAC endcaps
+  esp_read_mac(_ownMac, ESP_MAC_WIFI_STA);
+  _nodeID = (_ownMac[4] << 8) | _ownMac[5];
+  _reliableSeq = random(0x10000); // A restart must not look like a repeat
+}
+
+void OSCFollowerCore::onReceive(OSCReceiveCallback callback) {
+  _userCallback = callback;
+}
+
+void OSCFollowerCore::send(const uint8_t *data, int len) {
+  if (!_leaderMacSet)
+    return;
+  if (_reliablePatterns.matches(data, len) && _sendReliable(data, len))
+    return;
+  _sendMessage(data, len);
+}
+
+void OSCFollowerCore::_sendMessage(const uint8_t *data, int len) {
+  if (!_leaderMacSet)
+    return;
+  if (_compactCount > 0 && _sendCompact(data, len))
+    return;
+
+  // Relayed paths may cross v1 relays, direct ones use the negotiated size
+  int room = _uplinkHops > 0 ? LEADER_V1_PAYLOAD - sizeof(LeaderRelayHeader)
+                             : _leaderPayload;
+  if (len <= room) {
+    _sendFrame(data, len);
+    return;
+  }
+
+  fragmentFrame(data, len, room, _fragmentSeq++,
+                [this](const uint8_t *frame, int frameLen) {
+                  _sendFrame(frame, frameLen);
+                  return true;
+                });
+}
+
+OSCFrame &OSCFollowerCore::beginFrame(const char *address,
+                                      const char *typeTags) {
+  _txFrame.begin(_txSlot + TX_HEADROOM, _txMessage, address, typeTags);
+  return _txFrame;
+}
+
+bool OSCFollowerCore::commitFrame(OSCFrame &frame) {
+  if (!_leaderMacSet || !frame.ready())
+    return false;
+
+  const uint8_t *data = frame.data();
+  int len = frame.length();
+  // Built in someone else's slot there is no headroom to use, reliable
+  // messages are copied into their retransmit slot anyway, and compact ones
+  // are rebuilt
+  if (data != _txSlot + TX_HEADROOM || _reliablePatterns.matches(data, len) ||
+      _compactCount > 0) {
+    send(data, len);
+    return true;
+  }
+
+  if (_uplinkHops == 0 && len <= _leaderPayload) {
+    _chargeAirtime(len);
+    esp_now_send(_leaderMac, data, len);
+    return true;
+  }
+  if (_uplinkHops > 0 &&
+      len + (int)sizeof(LeaderRelayHeader) <= LEADER_V1_PAYLOAD) {
+    // Wrap in place: the header goes into the headroom just before the data
+    uint8_t *frameStart = _txSlot + TX_HEADROOM - sizeof(LeaderRelayHeader);
+    LeaderRelayHeader header;
+    _writeUpstreamHeader(header);
+    memcpy(frameStart, &header, sizeof(header));
+    _chargeAirtime(sizeof(header) + len);
+    esp_now_send(_uplinkMac, frameStart, sizeof(header) + len);
+    return true;
+  }
+
+  send(data, len); // Needs fragmenting
+  return true;
+}
+
+void OSCFollowerCore::_sendFrame(const uint8_t *data, int len) {
+  _chargeAirtime(len);
+  // Out of the Leader's direct range: go through the learned relay
+  if (_uplinkHops > 0)
+    _sendUpstream(data, len);
+  else
+    esp_now_send(_leaderMac, data, len);
+}
+
+void OSCFollowerCore::enableHeartbeat(uint32_t interval, uint32_t customID) {
+  _heartbeatInterval = interval;
+  if (customID != 0) {
+    _nodeID = customID;
+  }
+  _heartbeatEnabled = true;
+}
+
+void OSCFollowerCore::_staticOnDataRecv(const esp_now_recv_info_t *info,
+                                        const uint8_t *incomingData, int len) {
+  if (_instance)
+    _instance->_handleDataRecv(info->src_addr, incomingData, len);
+}
+
+void OSCFollowerCore::_handleDataRecv(const uint8_t *mac,
+                                      const uint8_t *incomingData, int len) {
+  // Queue the packet for processing in update() (main loop context)
+  uint8_t nextHead = (_rxHead + 1) % _rxQueueSize;
+  if (nextHead == _rxTail)
+    return; // Queue full, drop packet
+
+  if (len > _rxPayload)
+    return;
+
+  RxPacket &pkt = _rxQueue[_rxHead];
+  memcpy(pkt.data, incomingData, len);
+  memcpy(pkt.mac, mac, 6);
+  pkt.len = len;
+  pkt.stamp = micros();
+
+  _rxHead = nextHead;
+}
+
+void OSCFollowerCore::update() {
+  // Process queued packets from ESP-NOW callback (thread-safe)
+  while (_rxTail != _rxHead) {
+    RxPacket &pkt = _rxQueue[_rxTail];
+    const uint8_t *src = pkt.mac;
+    const uint8_t *data = pkt.data;
+    int len = pkt.len;
+
+    _lastMessageTime = millis();
+
+    // Unwrap relay envelopes; duplicates and transit traffic end here
+    if (len >= (int)sizeof(LeaderRelayHeader) &&
+        data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_RELAY) {
+      if (!_handleRelayFrame(pkt, src, data, len)) {
+        _rxTail = (_rxTail + 1) % _rxQueueSize;
+        continue;
+      }
+    } else if (_leaderMacSet && memcmp(src, _leaderMac, 6) == 0) {
+      _lastDirectLeader = millis(); // Leader within direct range
+      _uplinkHops = 0;
+      // Held traffic is flowing: keep listening until it stops
+      if (_psInterval && _psListening)
+        _psWindowStart = micros();
+    }
+
+    // Reassemble oversized messages; only complete ones travel further
+    if (len > (int)sizeof(LeaderFragmentHeader) &&
+        data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_FRAGMENT) {
+      len = _reassembler.add(src, data, len, data);
+      if (len == 0) {
+        _rxTail = (_rxTail + 1) % _rxQueueSize;
+        continue;
+      }
+    }
+
+    // Acknowledge reliable messages; acks and repeated copies end here
+    if (len >= (int)sizeof(LeaderReliableHeader) &&
+        data[0] == LEADER_CTRL_MAGIC && data[1] == CTRL_RELIABLE &&
+        !_handleReliableFrame(src, data, len)) {
+      _rxTail = (_rxTail + 1) % _rxQueueSize;
+      continue;
+    }
+
+    // Perform a sanity check before locking onto a presumed Leader node MAC.
+    // A node moving between shards waits for its new Leader's beacon.
+    if (!_leaderMacSet && !_shardMoving && len > 0 && data[0] == '/' &&
+        _findPeer(src) < 0)
+      _bindLeader(src);
+
+    // Hop commands, beacons and other LEADER control frames stay internal
+    if (isLeaderControlFrame(data, len)) {
+      _rxStamp = pkt.stamp;
+      _handleControlFrame(src, data, len);
+      _rxTail = (_rxTail + 1) % _rxQueueSize;
+      continue;
+    }
+
+    // Intercept system ping/pong
+    if (len > 9 && strncmp((const char *)data, "/sys/ping", 9) == 0) {
+      OSCValue pingCheck[1];
+      int pingArgs = MiniOSC::extract(data, len, "/sys/ping", pingCheck, 1);
+
+      if (pingArgs > 0 && pingCheck[0].type == 'i') {
+        int interval = pingCheck[0].i;
+        if (interval > 0) {
+          _heartbeatInterval = interval;
+          _heartbeatEnabled = true;
+          _scheduleSlottedBeat();
+        } else {
+          _heartbeatEnabled = false;
+        }
+      } else if (pingArgs == 0) {
+        OSCValue outVal;
+        outVal.type = 'i';
+        outVal.i = _nodeID;
+        uint8_t outBuffer[64];
+        int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/pong",
+                                   &outVal, 1);
+        send(outBuffer, outLen);
+      }
+    }
+
+    // Dispatch to user callback
+    if (_userCallback)
+      _userCallback(data, len);
+
+    // Forward to USB if tethered
+    if (_usbEnabled) {
+      _sendSlipToUSB(data, len);
+    }
+
+    _rxTail = (_rxTail + 1) % _rxQueueSize;
+  }
+
+  // Handle serial input for tethered mode
+  if (_usbEnabled) {
+    _handleSerial();
+    _usbOut->endOfUpdate();
+  }
+
+  if (_slotRequestDue && (long)(micros() - _slotRequestAt) >= 0) {
+    LeaderSlotHeader request = {};
+    request.magic = LEADER_CTRL_MAGIC;
+    request.op = CTRL_SLOT;
+    request.kind = SLOT_REQUEST;
+    request.plan = _slotPlan;
+    _sendFrame((const uint8_t *)&request, sizeof(request));
+    _slotRequestDue = false;
+  }
+
+  if (_heartbeatEnabled && _leaderMacSet) {
+    if (_heartbeatDue()) {
+      _lastHeartbeatTime = millis();
+
+      OSCValue outVal;
+      outVal.type = 'i';
+      outVal.i = _nodeID;
+
+      uint8_t outBuffer[64];
+      int outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/pong",
+                                 &outVal, 1);
+
+      send(outBuffer, outLen);
+
+      // Relays piggyback their forwarding statistics on the heartbeat
+      if (_relayEnabled) {
+        OSCValue stats[5];
+        for (int i = 0; i < 5; i++)
+          stats[i].type = 'i';
+        stats[0].i = _nodeID;
+        stats[1].i = _relayedCount;
+        stats[2].i = _relayDuplicates;
+        stats[3].i = (_rxHead - _rxTail + _rxQueueSize) % _rxQueueSize;
+        stats[4].i = _relayQueuePeak;
+
+        outLen = MiniOSC::pack(outBuffer, sizeof(outBuffer), "/sys/relay",
+                               stats, 5);
+        send(outBuffer, outLen);
+      }
+    }
+  }
+
+  _serviceStreams();
+  _serviceReliable();
+  _serviceCompact();
+  _servicePowerSave();
+  _servicePeers();
+  _serviceShardMove();
+}
+
+void OSCFollowerCore::_bindLeader(const uint8_t *mac) {
+  if (_leaderMacSet) {
+    if (memcmp(_leaderMac, mac, 6) == 0)
+      return;
+    esp_now_del_peer(_leaderMac); // Drop the Leader we failed over from
+  }
+
+  memcpy(_leaderMac, mac, 6);
+  _reliableSeen.reset(); // Another Leader numbers its messages afresh
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, _leaderMac, 6);
+  peerInfo.channel = _currentChannel;
+  peerInfo.encrypt = false;
+  esp_now_add_peer(&peerInfo);
+  _leaderMacSet = true;
+
+  // A new Leader starts from v1 frames until it announces otherwise, and
+  // from its own slot plan
+  _leaderPayload = LEADER_V1_PAYLOAD;
+  _slotted = false;
+  _slotCount = 0;
+  _sendCaps();
+  if (_peeringEnabled)
+    _sendPeerAnnounce();
+
+  // Compact layouts are negotiated with each Leader afresh
+  for (uint8_t i = 0; i < _compactCount; i++) {
+    _compact[i].state = COMPACT_PENDING;
+    _announceCompact(i);
+  }
+}
+
+void OSCFollowerCore::_sendCaps() {
+  LeaderCapsFrame caps;
+  caps.magic = LEADER_CTRL_MAGIC;
+  caps.op = CTRL_CAPS;
+  caps.version = LEADER_PROTOCOL_VERSION;
+  caps.flags = 0;
+  caps.maxPayload = _rxPayload;
+
+  send((const uint8_t *)&caps, sizeof(caps));
+}
+
+void OSCFollowerCore::_switchChannel(uint8_t channel) {
+  if (channel == _currentChannel)
+    return;
+
+  _currentChannel = channel;
+  esp_wifi_set_channel(_currentChannel, WIFI_SECOND_CHAN_NONE);
+  if (_leaderMacSet) {
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, _leaderMac, 6);
+    peerInfo.channel = _currentChannel;
+    esp_now_mod_peer(&peerInfo);
+  }
+}
+
+void OSCFollowerCore::_handleControlFrame(const uint8_t *mac,
+                                          const uint8_t *data, int len) {
+  switch (data[1]) {
+  case CTRL_HOP:
+    // Check: Hidden Hardware Hop Command
+    if (len == 4 && data[2] == 0xFE && !_shardMoving) {
+      if (!_leaderMacSet)
+        _bindLeader(mac);
+      _switchChannel(data[3]);
+    }
+    break;
+
+  case CTRL_BEACON: {
+    if (len < (int)sizeof(LeaderBeaconFrame))
+      return;
+    LeaderBeaconFrame beacon;
+    memcpy(&beacon, data, sizeof(beacon));
+    uint8_t shard = beacon.flags & BEACON_SHARD_MASK;
+
+    // Only the shard this node was sent to may take it in
+    if (_shardMoving) {
+      if (shard != _shardTarget)
+        break;
+      _shardMoving = false;
+      _leaderEpoch = beacon.epoch;
+      _leaderShard = shard;
+      _bindLeader(mac);
+      _switchChannel(beacon.channel);
+      break;
+    }
+
+    // Epochs are per shard: other shards' Leaders are not successors
+    bool bound = _leaderMacSet && memcmp(mac, _leaderMac, 6) == 0;
+    if (_leaderMacSet && !bound && shard != _leaderShard)
+      break;
+
+    // Re-bind whenever a Leader announces a newer term (failover)
+    if (!_leaderMacSet || beacon.epoch > _leaderEpoch ||
+        (beacon.epoch == _leaderEpoch && bound)) {
+      _leaderEpoch = beacon.epoch;
+      _leaderShard = shard;
+      _bindLeader(mac);
+      _switchChannel(beacon.channel);
+    }
+    break;
+  }
+
+  case CTRL_COMPACT:
+    // Only the bound Leader decides which layouts are in use
+    if (_leaderMacSet && memcmp(mac, _leaderMac, 6) == 0)
+      _handleCompactReply(data, len);
+    break;
+
+  case CTRL_CAPS: {
+    if (len < (int)sizeof(LeaderCapsFrame))
+      return;
+    LeaderCapsFrame caps;
+    memcpy(&caps, data, sizeof(caps));
+
+    // Only Leaders query; adopt their frame limit and answer with ours
+    if (!(caps.flags & CAPS_QUERY) || _shardMoving)
+      return;
+    if (!_leaderMacSet)
+      _bindLeader(mac);
+    if (memcmp(mac, _leaderMac, 6) != 0)
+      return;
+    // A node built for v1 frames keeps to them both ways
+    _leaderPayload =
+        caps.maxPayload < _rxPayload ? caps.maxPayload : _rxPayload;
+    _sendCaps();
+    break;
+  }
+
+  case CTRL_SLOT:
+    if (_leaderMacSet && memcmp(mac, _leaderMac, 6) == 0)
+      _handleSlotFrame(data, len);
+    break;
+
+  case CTRL_PEERS:
+    // Only the bound Leader's table is trusted
+    if (_peeringEnabled && _leaderMacSet && memcmp(mac, _leaderMac, 6) == 0)
+      _mergePeerTable(data, len);
+    break;
+
+  case CTRL_SHARD:
+    if (_leaderMacSet && memcmp(mac, _leaderMac, 6) == 0 &&
+        len >= (int)sizeof(LeaderShardFrame)) {
+      LeaderShardFrame move;
+      memcpy(&move, data, sizeof(move));
+      _startShardMove(move);
+    }
+    break;
+
+  default:
+    break; // Directory snapshots are only consumed by standby Leaders
+  }
+}
+
+// ==========================================
+// FOLLOWER POWER SAVE
+// ==========================================
+
+void OSCFollowerCore::enablePowerSave(uint16_t intervalMs, uint16_t windowMs) {
+  if (_relayEnabled || intervalMs == 0)
+    return; // Relays must hear their neighbours at all times
+  if (windowMs == 0 || windowMs > intervalMs)
+    windowMs = intervalMs;
+  if (_psInterval == 0) {
+    _psTotalUs = 0;
+    _psAwakeUs = 0;
+    _psLastTick = micros();
+  }
+  _psInterval = intervalMs;
+  _psWindow = windowMs;
+  _psLastWake = millis() - intervalMs; // Check in on the next update()
+
+  // With no AP to follow, modem sleep wakes on the connectionless schedule,
+  // which by default keeps the radio on: give it ours
+  esp_wifi_connectionless_module_set_wake_interval(intervalMs);
+  esp_now_set_wake_window(windowMs);
+  _psListening = false;
+}
+
+void OSCFollowerCore::disablePowerSave() {
+  if (_psInterval == 0)
+    return;
+  _psInterval = 0;
+  _psListening = true;
+  esp_wifi_set_ps(WIFI_PS_NONE);
+  if (_leaderMacSet)
+    _sendWake(); // intervalMs = 0: the Leader stops holding
+}
+
+float OSCFollowerCore::awakeRatio() const {
+  if (_psInterval == 0 || _psTotalUs == 0)
+    return 1.0f;
+  return (float)_psAwakeUs / _psTotalUs;
+}
+
+void OSCFollowerCore::_servicePowerSave() {
+  if (_psInterval == 0)
+    return;
+
+  unsigned long now = micros();
+  unsigned long elapsed = now - _psLastTick;
+  _psLastTick = now;
+  _psTotalUs += elapsed;
+  if (_psListening)
+    _psAwakeUs += elapsed;
+
+  // Unbound nodes keep listening, or they would never find a Leader. Nodes
+  // that bind together must not check in together: pick a random phase.
+  if (!_leaderMacSet) {
+    if (!_psListening)
+      esp_wifi_set_ps(WIFI_PS_NONE);
+    _psListening = true;
+    _psWindowStart = now;
+    _psLastWake = millis() - random(_psInterval);
+    return;
+  }
+
+  if (_psListening && now - _psWindowStart >= _psWindow * 1000UL) {
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+    _psListening = false;
+  }
+
+  if (!_psListening && millis() - _psLastWake >= _psInterval) {
+    _psLastWake += _psInterval;
+    if (millis() - _psLastWake >= _psInterval)
+      _psLastWake = millis(); // Loop stalled: restart the schedule
+    esp_wifi_set_ps(WIFI_PS_NONE);
+    _psListening = true;
+    _psWindowStart = now;
+    _sendWake();
+  }
+}
+
+void OSCFollowerCore::_sendWake() {
+  LeaderWakeFrame wake;
+  wake.magic = LEADER_CTRL_MAGIC;
+  wake.op = CTRL_WAKE;
+  wake.intervalMs = _psInterval;
+  wake.windowMs = _psWindow;
+  wake.awakePermille = (uint16_t)(awakeRatio() * 1000.0f + 0.5f);
+  wake.nodeID = _nodeID;
+  _sendFrame((const uint8_t *)&wake, sizeof(wake));
+}
+
+// ==========================================
+// FOLLOWER SLOT SCHEDULING
+// ==========================================
+
+void OSCFollowerCore::_handleSlotFrame(const uint8_t *data, int len) {
+  if (len < (int)sizeof(LeaderSlotHeader))
+    return;
+  LeaderSlotHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.kind != SLOT_PLAN && header.kind != SLOT_ASSIGN)
+    return;
+
+  // Flight time is ignored: it is about the same for every node, so slots
+  // stay apart even though all clocks lag the Leader slightly
+  _leaderClockOffset = header.leaderUs - _rxStamp;
+
+  if (header.slotCount == 0) {
+    _slotted = false;
+    _slotCount = 0;
+    _slotRequestDue = false;
+    return;
+  }
+  if (header.plan != _slotPlan || header.slotCount != _slotCount ||
+      header.slotUs != _slotUs)
+    _slotted = false; // New plan: old slots are void
+  _slotPlan = header.plan;
+  _slotFlags = header.flags;
+  _slotCount = header.slotCount;
+  _slotUs = header.slotUs;
+
+  if (header.kind == SLOT_ASSIGN) {
+    int offset = sizeof(header);
+    for (uint8_t i = 0; i < header.count; i++) {
+      if (offset + (int)sizeof(LeaderSlotEntry) > len)
+        break;
+      LeaderSlotEntry entry;
+      memcpy(&entry, data + offset, sizeof(entry));
+      offset += sizeof(entry);
+      if (memcmp(entry.mac, _ownMac, 6) == 0) {
+        _slot = entry.slot;
+        _slotted = true;
+        _slotRequestDue = false;
+      }
+    }
+  }
+
+  if (_slotted) {
+    _scheduleSlottedBeat(); // Re-aligned to the fresh clock
+  } else if (!_slotRequestDue) {
+    // Every node hears the plan at once: spread the requests over a cycle
+    unsigned long spread = (unsigned long)_slotUs * _slotCount;
+    if (spread > SLOT_REQUEST_SPREAD)
+      spread = SLOT_REQUEST_SPREAD;
+    _slotRequestAt = micros() + random(spread > 0 ? spread : 1);
+    _slotRequestDue = true;
+  }
+}
+
+void OSCFollowerCore::_scheduleSlottedBeat() {
+  unsigned long period = _heartbeatInterval * 1000UL;
+  if (!_slotted || period == 0)
+    return;
+
+  // Leader time wraps every ~71 minutes; the next plan re-aligns the beat
+  unsigned long phase = (uint64_t)_slot * _slotUs % period;
+  unsigned long now = micros();
+  unsigned long leaderNow = now + _leaderClockOffset;
+  unsigned long wait = (phase + period - leaderNow % period) % period;
+
+  // Re-alignment must not add a beat right after the one just sent
+  if (_lastHeartbeatTime != 0 &&
+      millis() - _lastHeartbeatTime + wait / 1000 < _heartbeatInterval / 2)
+    wait += period;
+  _nextBeatUs = now + wait;
+}
+
+bool OSCFollowerCore::_heartbeatDue() {
+  if (!_slotted)
+    return millis() - _lastHeartbeatTime >= _heartbeatInterval;
+
+  unsigned long now = micros();
+  if ((long)(now - _nextBeatUs) < 0)
+    return false;
+  _nextBeatUs += _heartbeatInterval * 1000UL;
+  if ((long)(now - _nextBeatUs) >= 0)
+    _scheduleSlottedBeat(); // Loop stalled for a whole interval
+  return true;
+}
+
+bool OSCFollowerCore::_inSlot() const {
+  unsigned long cycle = (unsigned long)_slotUs * _slotCount;
+  if (cycle == 0)
+    return true;
+  unsigned long position = leaderMicros() % cycle;
+  return position - (unsigned long)_slot * _slotUs < _slotUs;
+}
+
+// ==========================================
+// FOLLOWER PEER MESSAGING
+// ==========================================
+
+void OSCFollowerCore::enablePeering(uint32_t groups, bool mirror) {
+  if (_maxPeers == 0)
+    return; // Built out
+  _peeringEnabled = true;
+  _peerGroups = groups;
+  _peerMirror = mirror;
+  if (_leaderMacSet)
+    _sendPeerAnnounce();
+}
+
+bool OSCFollowerCore::sendTo(uint32_t nodeID, const uint8_t *data, int len) {
+  if (!_peeringEnabled || len <= 0 || len > LEADER_MAX_MESSAGE)
+    return false;
+
+  for (uint8_t i = 0; i < _peerCount; i++) {
+    if (_peers[i].nodeID != nodeID)
+      continue;
+    if (!_sendToPeer(_peers[i], data, len))
+      return false;
+    if (_peerMirror)
+      _mirrorToLeader(nodeID, 0, data, len);
+    return true;
+  }
+
+  // Not listed yet: ask for a fresh table instead of waiting for the refresh
+  _peerWanted = nodeID;
+  if (_leaderMacSet && millis() - _lastPeerAnnounce >= PEER_RETRY)
+    _sendPeerAnnounce();
+  return false;
+}
+
+int OSCFollowerCore::sendToGroup(uint8_t group, const uint8_t *data, int len) {
+  if (!_peeringEnabled || group > 31 || len <= 0 || len > LEADER_MAX_MESSAGE)
+    return 0;
+
+  uint32_t mask = 1UL << group;
+  int reached = 0;
+  for (uint8_t i = 0; i < _peerCount; i++) {
+    if ((_peers[i].groups & mask) && _sendToPeer(_peers[i], data, len))
+      reached++;
+  }
+  if (reached > 0 && _peerMirror)
+    _mirrorToLeader(0, mask, data, len);
+  return reached;
+}
+
+bool OSCFollowerCore::_sendToPeer(PeerRecord &peer, const uint8_t *data,
+                                  int len) {
+  if (!peer.added && !esp_now_is_peer_exist(peer.mac)) {
+    // The radio's peer table is shared with the Leader and relays: keep only
+    // the most recently used peers registered
+    if (_peerSlotsUsed >= PEER_SLOTS) {
+      int oldest = -1;
+      for (uint8_t i = 0; i < _peerCount; i++) {
+        if (_peers[i].added &&
+            (oldest < 0 || (long)(_peers[i].used - _peers[oldest].used) < 0))
+          oldest = i;
+      }
+      if (oldest >= 0) {
+        esp_now_del_peer(_peers[oldest].mac);
+        _peers[oldest].added = false;
+        _peerSlotsUsed--;
+      }
+    }
+
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, peer.mac, 6);
+    peerInfo.channel = 0; // Follow the current channel across hops
+    peerInfo.encrypt = false;
+    if (esp_now_add_peer(&peerInfo) != ESP_OK)
+      return false;
+    peer.added = true;
+    _peerSlotsUsed++;
+  }
+  peer.used = millis();
+
+  // The peer's frame limit is unknown: stay within v1 frames
+  if (len <= LEADER_V1_PAYLOAD) {
+    _chargeAirtime(len);
+    return esp_now_send(peer.mac, data, len) == ESP_OK;
+  }
+  const uint8_t *mac = peer.mac;
+  return fragmentFrame(data, len, LEADER_V1_PAYLOAD, _fragmentSeq++,
+                       [this, mac](const uint8_t *frame, int frameLen) {
+                         _chargeAirtime(frameLen);
+                         return esp_now_send(mac, frame, frameLen) == ESP_OK;
+                       });
+}
+
+void OSCFollowerCore::_mirrorToLeader(uint32_t nodeID, uint32_t groups,
+                                      const uint8_t *data, int len) {
+  if (!_leaderMacSet ||
+      len + (int)sizeof(LeaderPeerHeader) > LEADER_MAX_MESSAGE)
+    return;
+
+  uint8_t frame[LEADER_MAX_MESSAGE];
+  LeaderPeerHeader header = {};
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_PEERS;
+  header.kind = PEER_MIRROR;
+  header.id = nodeID;
+  header.groups = groups;
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), data, len);
+  send(frame, sizeof(header) + len);
+}
+
+void OSCFollowerCore::_sendPeerAnnounce() {
+  LeaderPeerHeader header = {};
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_PEERS;
+  header.kind = PEER_ANNOUNCE;
+  header.id = _nodeID;
+  header.groups = _peerGroups;
+  _sendFrame((const uint8_t *)&header, sizeof(header));
+  _lastPeerAnnounce = millis();
+}
+
+void OSCFollowerCore::_mergePeerTable(const uint8_t *data, int len) {
+  if (len < (int)sizeof(LeaderPeerHeader))
+    return;
+  LeaderPeerHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.kind != PEER_TABLE)
+    return;
+
+  int offset = sizeof(header);
+  for (uint8_t i = 0; i < header.count; i++) {
+    if (offset + (int)sizeof(LeaderPeerEntry) > len)
+      break;
+    LeaderPeerEntry entry;
+    memcpy(&entry, data + offset, sizeof(entry));
+    offset += sizeof(entry);
+    if (memcmp(entry.mac, _ownMac, 6) == 0)
+      continue;
+
+    int index = _findPeer(entry.mac);
+    if (index < 0 && _peerCount >= _maxPeers) {
+      // Full: only a peer someone asked for displaces the least recently used
+      if (entry.nodeID != _peerWanted)
+        continue;
+      index = 0;
+      for (uint8_t k = 1; k < _peerCount; k++) {
+        if ((long)(_peers[k].used - _peers[index].used) < 0)
+          index = k;
+      }
+      _dropPeer(index);
+      index = -1;
+    }
+    if (index < 0) {
+      index = _peerCount++;
+      PeerRecord &peer = _peers[index];
+      memcpy(peer.mac, entry.mac, 6);
+      peer.used = 0;
+      peer.added = false;
+    }
+    _peers[index].nodeID = entry.nodeID;
+    _peers[index].groups = entry.groups;
+    _peers[index].seen = millis();
+    if (entry.nodeID == _peerWanted)
+      _peerWanted = 0;
+  }
+}
+
+int OSCFollowerCore::_findPeer(const uint8_t *mac) const {
+  for (uint8_t i = 0; i < _peerCount; i++) {
+    if (memcmp(_peers[i].mac, mac, 6) == 0)
+      return i;
+  }
+  return -1;
+}
+
+void OSCFollowerCore::_dropPeer(uint8_t index) {
+  if (_peers[index].added) {
+    esp_now_del_peer(_peers[index].mac);
+    _peerSlotsUsed--;
+  }
+  _peers[index] = _peers[--_peerCount];
+}
+
+void OSCFollowerCore::_servicePeers() {
+  if (!_peeringEnabled || !_leaderMacSet)
+    return;
+
+  if (millis() - _lastPeerAnnounce >= PEER_REFRESH)
+    _sendPeerAnnounce();
+
+  // Peers that left stop being listed; forget them one per update
+  for (uint8_t i = 0; i < _peerCount; i++) {
+    if (millis() - _peers[i].seen > PEER_TIMEOUT) {
+      _dropPeer(i);
+      break;
+    }
+  }
+}
+
+// ==========================================
+// FOLLOWER CHANNEL SHARDING
+// ==========================================
+
+void OSCFollowerCore::_startShardMove(const LeaderShardFrame &move) {
+  if (move.channel < 1 || move.channel > 13 || move.shard == 0)
+    return;
+
+  _shardFromChannel = _currentChannel;
+  _shardTarget = move.shard & BEACON_SHARD_MASK;
+  _shardMoving = true;
+  _shardMoveAt = millis();
+
+  // Unbound until the target's beacon; sends are dropped meanwhile
+  esp_now_del_peer(_leaderMac);
+  _leaderMacSet = false;
+  _switchChannel(move.channel);
+}
+
+void OSCFollowerCore::_serviceShardMove() {
+  if (!_shardMoving || millis() - _shardMoveAt < LEADER_SHARD_MOVE_TIMEOUT)
+    return;
+
+  // Nobody took us in: go back and bind to whoever serves the old channel
+  _shardMoving = false;
+  _switchChannel(_shardFromChannel);
+}
+
+// ==========================================
+// FOLLOWER RELIABLE DELIVERY
+// ==========================================
+
+bool OSCFollowerCore::_sendReliable(const uint8_t *data, int len) {
+  if (_reliableSlots == 0 || len > LEADER_RELIABLE_MESSAGE)
+    return false;
+
+  // Take a free slot, or give up on the oldest message
+  uint8_t index = 0;
+  for (uint8_t i = 0; i < _reliableSlots; i++) {
+    if (_reliable[i].len == 0) {
+      index = i;
+      break;
+    }
+    if (_reliable[i].sentAt - _reliable[index].sentAt > 0x7FFFFFFFUL)
+      index = i;
+  }
+  ReliableSlot &slot = _reliable[index];
+  if (slot.len)
+    _reliableFailed++;
+
+  LeaderReliableHeader header = {LEADER_CTRL_MAGIC, CTRL_RELIABLE,
+                                 RELIABLE_DATA, 0, _reliableSeq++, 0};
+  memcpy(slot.frame, &header, sizeof(header));
+  memcpy(slot.frame + sizeof(header), data, len);
+  slot.len = sizeof(header) + len;
+  slot.attempt = 0;
+  slot.sentAt = micros();
+  slot.retryAt = slot.sentAt + _reliableTimeout.after(0);
+  _reliableSent++;
+  _sendFrame(slot.frame, slot.len);
+  return true;
+}
+
+bool OSCFollowerCore::_handleReliableFrame(const uint8_t *src,
+                                           const uint8_t *&data, int &len) {
+  LeaderReliableHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (header.kind == RELIABLE_ACK) {
+    // The Leader broadcasts its acks: only ours, from our Leader, count
+    LeaderReliableAck ack;
+    if (len < (int)sizeof(ack) || !_leaderMacSet ||
+        memcmp(src, _leaderMac, 6) != 0)
+      return false;
+    memcpy(&ack, data, sizeof(ack));
+    if (memcmp(ack.node, _ownMac, 6) != 0)
+      return false;
+    for (uint8_t i = 0; i < _reliableSlots; i++) {
+      ReliableSlot &slot = _reliable[i];
+      if (slot.len &&
+          memcmp(slot.frame + offsetof(LeaderReliableHeader, seq), &ack.seq,
+                 sizeof(ack.seq)) == 0) {
+        uint32_t delay = micros() - slot.sentAt;
+        _reliableLatency.add(delay);
+        _reliableTimeout.sample(delay);
+        slot.len = 0;
+        break;
+      }
+    }
+    return false;
+  }
+  if (header.kind != RELIABLE_DATA || len <= (int)sizeof(header))
+    return false;
+
+  // A cue may be the first thing a fresh node hears from its Leader
+  if (!_leaderMacSet && !_shardMoving && _findPeer(src) < 0)
+    _bindLeader(src);
+  if (!_leaderMacSet || memcmp(src, _leaderMac, 6) != 0)
+    return false;
+
+  // Every copy is answered, as the previous answer may be the one lost
+  PendingAck *slot = nullptr;
+  for (uint8_t i = 0; i < LEADER_RELIABLE_SLOTS && !slot; i++)
+    if (!_reliableAcks[i].pending || _reliableAcks[i].seq == header.seq)
+      slot = &_reliableAcks[i];
+  if (slot) {
+    slot->dueAt = micros() + random(header.spread * 100L + 1);
+    slot->seq = header.seq;
+    slot->attempt = header.attempt;
+    slot->pending = true;
+  } else {
+    _sendReliableAck(header.seq, header.attempt);
+  }
+
+  if (_reliableSeen.seen(header.seq))
+    return false;
+  data += sizeof(header);
+  len -= sizeof(header);
+  return true;
+}
+
+void OSCFollowerCore::_sendReliableAck(uint16_t seq, uint8_t attempt) {
+  if (!_leaderMacSet)
+    return;
+  LeaderReliableAck ack = {LEADER_CTRL_MAGIC, CTRL_RELIABLE, RELIABLE_ACK,
+                           attempt, seq, {}};
+  memcpy(ack.node, _leaderMac, 6);
+  _sendFrame((const uint8_t *)&ack, sizeof(ack));
+}
+
+void OSCFollowerCore::_serviceReliable() {
+  unsigned long now = micros();
+  for (uint8_t i = 0; i < LEADER_RELIABLE_SLOTS; i++) {
+    PendingAck &ack = _reliableAcks[i];
+    if (ack.pending && (long)(now - ack.dueAt) >= 0) {
+      ack.pending = false;
+      _sendReliableAck(ack.seq, ack.attempt);
+    }
+  }
+
+  for (uint8_t i = 0; i < _reliableSlots; i++) {
+    ReliableSlot &slot = _reliable[i];
+    if (slot.len == 0 || (long)(now - slot.retryAt) < 0)
+      continue;
+    if (slot.attempt >= LEADER_RELIABLE_RETRIES || !_leaderMacSet) {
+      _reliableFailed++;
+      slot.len = 0;
+      continue;
+    }
+    slot.attempt++;
+    slot.frame[offsetof(LeaderReliableHeader, attempt)] = slot.attempt;
+    slot.retryAt = now + _reliableTimeout.after(slot.attempt);
+    _reliableRetransmits++;
+    _sendFrame(slot.frame, slot.len);
+  }
+}
+
+// ==========================================
+// FOLLOWER COMPACT ENCODING
+// ==========================================
+
+bool OSCFollowerCore::addCompact(const char *address, const char *typeTags,
+                                 float min, float max, uint8_t bits,
+                                 bool deltas) {
+  if (_compactCount >= _compactSchemas)
+    return false;
+
+  CompactSlot &slot = _compact[_compactCount];
+  if (!slot.schema.set(address, typeTags, min, max, bits))
+    return false;
+  slot.deltas = deltas;
+  slot.state = COMPACT_PENDING;
+  slot.primed = false;
+  slot.seq = 0;
+  slot.sinceKey = 0;
+  slot.announcedAt = 0;
+  _compactCount++;
+
+  // Otherwise announced on binding
+  if (_leaderMacSet)
+    _announceCompact(_compactCount - 1);
+  return true;
+}
+
+bool OSCFollowerCore::_sendCompact(const uint8_t *data, int len) {
+  for (uint8_t i = 0; i < _compactCount; i++) {
+    CompactSlot &slot = _compact[i];
+    uint16_t steps[OSCCompactSchema::MAX_ARGS];
+    if (slot.state != COMPACT_ON || !slot.schema.quantize(data, len, steps))
+      continue;
+
+    uint8_t frame[sizeof(LeaderCompactHeader) +
+                  2 * OSCCompactSchema::MAX_ARGS];
+    LeaderCompactHeader header = {LEADER_CTRL_MAGIC, CTRL_COMPACT,
+                                  COMPACT_KEY, i, ++slot.seq};
+    uint8_t *body = frame + sizeof(header);
+
+    // A delta where every change fits, with a key now and then so a lost
+    // frame only costs the deltas up to it
+    int size = -1;
+    if (slot.deltas && slot.primed &&
+        slot.sinceKey + 1 < LEADER_COMPACT_KEY_INTERVAL)
+      size = slot.schema.packDelta(steps, slot.previous, body);
+    if (size >= 0) {
+      header.kind = COMPACT_DELTA;
+      slot.sinceKey++;
+    } else {
+      size = slot.schema.packKey(steps, body);
+      slot.sinceKey = 0;
+    }
+    memcpy(frame, &header, sizeof(header));
+    memcpy(slot.previous, steps, slot.schema.argCount() * sizeof(steps[0]));
+    slot.primed = true;
+
+    int frameLen = sizeof(header) + size;
+    _sendFrame(frame, frameLen);
+    _compactSent++;
+    if (len > frameLen)
+      _compactSaved += len - frameLen;
+    return true;
+  }
+  return false;
+}
+
+void OSCFollowerCore::_announceCompact(uint8_t index) {
+  CompactSlot &slot = _compact[index];
+  uint8_t frame[sizeof(LeaderCompactHeader) +
+                OSCCompactSchema::MAX_DESCRIPTION];
+  LeaderCompactHeader header = {LEADER_CTRL_MAGIC, CTRL_COMPACT,
+                                COMPACT_SCHEMA, index, 0};
+  memcpy(frame, &header, sizeof(header));
+  int len = sizeof(header) + slot.schema.describe(frame + sizeof(header));
+  _sendFrame(frame, len);
+  slot.announcedAt = millis();
+}
+
+void OSCFollowerCore::_handleCompactReply(const uint8_t *data, int len) {
+  if (len < (int)sizeof(LeaderCompactReply))
+    return;
+  LeaderCompactReply reply;
+  memcpy(&reply, data, sizeof(reply));
+  if (memcmp(reply.node, _ownMac, 6) != 0 || reply.schema >= _compactCount)
+    return;
+
+  CompactSlot &slot = _compact[reply.schema];
+  switch (reply.kind) {
+  case COMPACT_ACCEPT:
+    slot.state = COMPACT_ON;
+    slot.primed = false; // The Leader starts over: open with a key
+    break;
+  case COMPACT_REFUSE:
+    slot.state = COMPACT_OFF; // Until the next Leader
+    break;
+  case COMPACT_UNKNOWN:
+    if (slot.state == COMPACT_ON) {
+      slot.state = COMPACT_PENDING;
+      _announceCompact(reply.schema);
+    }
+    break;
+  }
+}
+
+void OSCFollowerCore::_serviceCompact() {
+  if (!_leaderMacSet)
+    return;
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < _compactCount; i++) {
+    if (_compact[i].state == COMPACT_PENDING &&
+        now - _compact[i].announcedAt >= COMPACT_ANNOUNCE_MS)
+      _announceCompact(i);
+  }
+}
+
+// ==========================================
+// FOLLOWER SENSOR STREAMS
+// ==========================================
+
+int OSCFollowerCore::addStream(const char *address, StreamSource source,
+                               float minRate, float maxRate, float deadband) {
+  return _addStream(address, source, nullptr, minRate, maxRate, deadband);
+}
+
+int OSCFollowerCore::addStream(const char *address, StreamIntSource source,
+                               float minRate, float maxRate, int deadband) {
+  return _addStream(address, nullptr, source, minRate, maxRate, deadband);
+}
+
+int OSCFollowerCore::_addStream(const char *address, StreamSource source,
+                                StreamIntSource intSource, float minRate,
+                                float maxRate, float deadband) {
+  if (_streamCount >= _maxStreams || address == nullptr ||
+      (source == nullptr && intSource == nullptr) || maxRate <= 0)
+    return -1;
+
+  SensorStream &s = _streams[_streamCount];
+  s.address = address;
+  s.source = source;
+  s.intSource = intSource;
+  s.deadband = deadband < 0 ? -deadband : deadband;
+  s.periodUs = (uint32_t)(1000000.0f / maxRate);
+  if (s.periodUs < 500)
+    s.periodUs = 500; // 2 kHz is plenty, and keeps the timer task sane
+  s.keepAliveUs = minRate > 0 ? (uint32_t)(1000000.0f / minRate) : 0;
+  s.nextSample = micros();
+  s.fresh = false;
+  s.everSent = false;
+  s.deferred = false;
+  _streamCount++;
+
+  // One timer ticks at the fastest stream's period; slower ones skip ticks
+  if (_streamTimer == nullptr) {
+    esp_timer_create_args_t args = {};
+    args.callback = _staticStreamTick;
+    args.arg = this;
+    args.name = "leader_streams";
+    if (esp_timer_create(&args, &_streamTimer) != ESP_OK) {
+      _streamTimer = nullptr;
+      _streamCount--;
+      return -1;
+    }
+  }
+  if (_streamTickUs == 0 || s.periodUs < _streamTickUs) {
+    _streamTickUs = s.periodUs;
+    esp_timer_stop(_streamTimer);
+    esp_timer_start_periodic(_streamTimer, _streamTickUs);
+  }
+  return _streamCount - 1;
+}
+
+void OSCFollowerCore::setAirtimeBudget(uint32_t usPerSecond, uint32_t burstUs) {
+  _airtimeRate = usPerSecond;
+  _airtimeBurst = burstUs ? burstUs : usPerSecond / 10;
+  _airtimeTokens = _airtimeBurst;
+  _airtimeRefilled = micros();
+}
+
+void OSCFollowerCore::_refillAirtime() {
+  uint32_t now = micros();
+  uint32_t elapsed = now - _airtimeRefilled;
+  // Only whole microseconds of air are credited, the remainder waits
+  uint32_t credit = (uint64_t)elapsed * _airtimeRate / 1000000;
+  if (credit == 0)
+    return;
+  _airtimeRefilled += (uint64_t)credit * 1000000 / _airtimeRate;
+  _airtimeTokens += credit > (uint32_t)_airtimeBurst ? _airtimeBurst : credit;
+  if (_airtimeTokens > _airtimeBurst)
+    _airtimeTokens = _airtimeBurst;
+}
+
+void OSCFollowerCore::_staticStreamTick(void *arg) {
+  static_cast<OSCFollowerCore *>(arg)->_sampleStreams();
+}
+
+void OSCFollowerCore::_sampleStreams() {
+  uint32_t now = micros();
+  for (uint8_t i = 0; i < _streamCount; i++) {
+    SensorStream &s = _streams[i];
+    if ((int32_t)(now - s.nextSample) < 0)
+      continue;
+    s.nextSample += s.periodUs;
+    if ((int32_t)(now - s.nextSample) >= 0)
+      s.nextSample = now + s.periodUs; // Fell behind: do not burst to catch up
+
+    if (s.intSource)
+      s.sample.i = s.intSource();
+    else
+      s.sample.f = s.source();
+    s.fresh = true;
+  }
+}
+
+void OSCFollowerCore::_serviceStreams() {
+  if (_streamCount == 0 || !_leaderMacSet)
+    return;
+  if (_airtimeRate)
+    _refillAirtime();
+  // TDMA: samples stay pending until this node's slot comes up
+  if (_slotted && (_slotFlags & SLOT_TDMA) && !_inSlot())
+    return;
+
+  uint32_t now = micros();
+  for (uint8_t n = 0; n < _streamCount; n++) {
+    SensorStream &s = _streams[(_streamCursor + n) % _streamCount];
+    if (!s.fresh)
+      continue;
+
+    // The timer may overwrite the sample meanwhile; either value is current
+    OSCValue value;
+    bool changed;
+    if (s.intSource) {
+      value.type = 'i';
+      value.i = s.sample.i;
+      int32_t delta = value.i - s.lastSent.i;
+      changed = (delta < 0 ? -delta : delta) > s.deadband;
+    } else {
+      value.type = 'f';
+      value.f = s.sample.f;
+      float delta = value.f - s.lastSent.f;
+      changed = (delta < 0 ? -delta : delta) > s.deadband;
+    }
+    bool keepAlive = s.keepAliveUs && now - s.lastSendUs >= s.keepAliveUs;
+
+    if (s.everSent && !changed && !keepAlive) {
+      s.fresh = false;
+      _streamSuppressed++;
+      continue;
+    }
+
+    uint8_t buffer[LEADER_V1_PAYLOAD];
+    int len = MiniOSC::pack(buffer, sizeof(buffer), s.address, &value, 1);
+    if (_airtimeRate && _airtimeTokens < (int32_t)(FRAME_OVERHEAD_US + 8 * len)) {
+      // Out of airtime: keep the stream pending, the next sample replaces it
+      if (!s.deferred)
+        _streamDeferred++;
+      s.deferred = true;
+      continue;
+    }
+
+    _sendMessage(buffer, len); // Streams stay best-effort
+    s.fresh = false;
+    s.deferred = false;
+    s.everSent = true;
+    s.lastSendUs = now;
+    if (s.intSource)
+      s.lastSent.i = value.i;
+    else
+      s.lastSent.f = value.f;
+    _streamSent++;
+  }
+  _streamCursor = (_streamCursor + 1) % _streamCount;
+}
+
+// ==========================================
+// FOLLOWER MULTI-HOP RELAY
+// ==========================================
+
+void OSCFollowerCore::enableRelay() {
+  disablePowerSave();
+  _relayEnabled = true;
+
+  // Re-broadcasting needs the broadcast address as a peer
+  uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  if (!esp_now_is_peer_exist(broadcastAddress)) {
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+    peerInfo.channel = 0; // Follow whatever channel the radio is on
+    peerInfo.encrypt = false;
+    esp_now_add_peer(&peerInfo);
+  }
+}
+
+void OSCFollowerCore::_setUplink(const uint8_t *mac, uint8_t hops) {
+  bool changed = _uplinkHops == 0 || memcmp(_uplinkMac, mac, 6) != 0;
+  if (changed) {
+    if (_uplinkHops > 0)
+      esp_now_del_peer(_uplinkMac);
+    memcpy(_uplinkMac, mac, 6);
+    if (!esp_now_is_peer_exist(_uplinkMac)) {
+      esp_now_peer_info_t peerInfo = {};
+      memcpy(peerInfo.peer_addr, _uplinkMac, 6);
+      peerInfo.channel = 0;
+      peerInfo.encrypt = false;
+      esp_now_add_peer(&peerInfo);
+    }
+  }
+  _uplinkHops = hops;
+  _lastUplinkTime = millis();
+}
+
+void OSCFollowerCore::_relayForward(RxPacket &pkt, const uint8_t *dest) {
+  // Patch the envelope in place: the queue slot doubles as the TX buffer
+  LeaderRelayHeader header;
+  memcpy(&header, pkt.data, sizeof(header));
+  header.ttl--;
+  header.hops++;
+  uint32_t delay = header.delay + (micros() - pkt.stamp) / 10;
+  header.delay = delay > 0xFFFF ? 0xFFFF : delay;
+  memcpy(pkt.data, &header, sizeof(header));
+
+  esp_now_send(dest, pkt.data, pkt.len);
+  _relayedCount++;
+
+  uint8_t depth = (_rxHead - _rxTail + _rxQueueSize) % _rxQueueSize;
+  if (depth > _relayQueuePeak)
+    _relayQueuePeak = depth;
+}
+
+bool OSCFollowerCore::_handleRelayFrame(RxPacket &pkt, const uint8_t *&src,
+                                        const uint8_t *&data, int &len) {
+  LeaderRelayHeader header;
+  memcpy(&header, pkt.data, sizeof(header));
+
+  // Upstream envelopes only reach us because we are someone's uplink
+  if (header.flags & RELAY_UPSTREAM) {
+    if (!_relayEnabled || !_leaderMacSet || header.ttl == 0)
+      return false;
+    if (_relayDedup.seen(header.origin, header.seq)) {
+      _relayDuplicates++;
+      return false;
+    }
+    _relayForward(pkt, _uplinkHops > 0 ? _uplinkMac : _leaderMac);
+    return false;
+  }
+
+  // Downstream: learn how far away the Leader is, and through whom
+  unsigned long currentMillis = millis();
+  if (header.hops == 0) {
+    _lastDirectLeader = currentMillis;
+    _uplinkHops = 0;
+  } else {
+    bool directStale = _lastDirectLeader == 0 ||
+                       currentMillis - _lastDirectLeader > ROUTE_TIMEOUT;
+    bool uplinkStale = _uplinkHops == 0 ||
+                       currentMillis - _lastUplinkTime > ROUTE_TIMEOUT;
+    bool sameUplink =
+        _uplinkHops > 0 && memcmp(pkt.mac, _uplinkMac, 6) == 0;
+    if (directStale &&
+        (uplinkStale || sameUplink || header.hops < _uplinkHops))
+      _setUplink(pkt.mac, header.hops);
+  }
+
+  if (_relayDedup.seen(header.origin, header.seq)) {
+    _relayDuplicates++;
+    return false;
+  }
+
+  // Pass it on before acting on it, so hop commands reach the far side first
+  if (_relayEnabled && header.ttl > 0) {
+    uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    _relayForward(pkt, broadcastAddress);
+  }
+
+  src = pkt.data + offsetof(LeaderRelayHeader, origin);
+  data = pkt.data + sizeof(LeaderRelayHeader);
+  len = pkt.len - sizeof(LeaderRelayHeader);
+  return true;
+}
+
+void OSCFollowerCore::_sendUpstream(const uint8_t *data, int len) {
+  if (len + (int)sizeof(LeaderRelayHeader) > LEADER_V1_PAYLOAD)
+    return; // Cannot be wrapped, and the Leader is out of direct range
+
+  LeaderRelayHeader header;
+  _writeUpstreamHeader(header);
+
+  uint8_t frame[LEADER_V1_PAYLOAD];
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), data, len);
+  esp_now_send(_uplinkMac, frame, sizeof(header) + len);
+}
+
+void OSCFollowerCore::_writeUpstreamHeader(LeaderRelayHeader &header) {
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_RELAY;
+  header.flags = RELAY_UPSTREAM;
+  header.ttl = RELAY_UPSTREAM_TTL;
+  header.hops = 0;
+  memcpy(header.origin, _ownMac, 6);
+  header.seq = _relaySeq++;
+  header.delay = 0;
+}
+
+// ==========================================
+// FOLLOWER SLIP USB ENGINES
+// ==========================================
+
+void OSCFollowerCore::_sendSlipToUSB(const uint8_t *data, int len) {
+  // OSC Standard alignment mandates valid structures to be strict multiples of
+  // 4 bytes
+  if (len == 0 || len % 4 != 0)
+    return;
+
+  _usbOut->writeFrame(data, len);
+}
+
+void OSCFollowerCore::setFlushPolicy(HostFlushPolicy policy,
+                                     uint16_t threshold) {
+  if (_usbOut)
+    _usbOut->setPolicy(policy, threshold);
+}
+
+void OSCFollowerCore::_handleSerial() {
+  uint8_t chunk[64];
+  while (Serial.available() > 0) {
+    int count = Serial.available();
+    if (count > (int)sizeof(chunk))
+      count = sizeof(chunk);
+    count = Serial.readBytes(chunk, count);
+    if (count <= 0)
+      break;
+
+    for (int i = 0; i < count; i++) {
+      int frameLen = _usbIn->feed(chunk[i]);
+      if (frameLen == 0)
+        continue;
+      // Framing handshakes stay on the USB link, everything else goes out
+      if (!handleFramingHandshake(_usbIn->data(), frameLen, *_usbIn, *_usbOut))
+        send(_usbIn->data(), frameLen);
+    }
   }
 }
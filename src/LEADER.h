@@ -5,10 +5,64 @@
 #include <Stream.h>
 #include <WiFi.h>
 #include <esp_now.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 
+#include "HostLink.h"
+#include "LEADERProtocol.h"
+#include "MiniOSC.h"
+
 typedef void (*OSCReceiveCallback)(const uint8_t *data, int len);
 
+/// Value sources for OSCFollower::addStream(), sent as 'f' or 'i'
+typedef float (*StreamSource)();
+typedef int (*StreamIntSource)();
+
+#ifndef LEADER_MAX_STREAMS
+#define LEADER_MAX_STREAMS 8
+#endif
+
+#ifndef LEADER_MAX_PEERS
+/// Other Followers a peering Follower can address directly
+#define LEADER_MAX_PEERS 16
+#endif
+
+#ifndef LEADER_MAX_SLOTS
+/// Heartbeat slots a Leader can hand out (see OSCLeader::enableSlots)
+#define LEADER_MAX_SLOTS 128
+#endif
+
+#ifndef LEADER_CAPTURE_BYTES
+/// Default ring size for OSCLeader::enableCapture(), taken from PSRAM if any
+#define LEADER_CAPTURE_BYTES 16384
+#endif
+
+#ifndef LEADER_RX_QUEUE_SIZE
+/// Radio frames queued between the receive callback and update()
+#define LEADER_RX_QUEUE_SIZE 8
+#endif
+
+#ifndef LEADER_RX_FLOWS
+/// Fewest flows the Leader's receive queue is shared between; with a
+/// registry there is one per node
+#define LEADER_RX_FLOWS 16
+#endif
+
+#ifndef LEADER_SHARD_MOVE_TIMEOUT
+/// Milliseconds a moving Follower waits for its new shard's beacon
+#define LEADER_SHARD_MOVE_TIMEOUT 3000
+#endif
+
+#ifndef LEADER_MAX_NODES
+/// Nodes tracked by the Leader's registry (at most 250)
+#define LEADER_MAX_NODES 32
+#endif
+
+#ifndef LEADER_PS_HOLD_SLOTS
+/// Frames a Leader can hold for dozing power-save Followers, all nodes shared
+#define LEADER_PS_HOLD_SLOTS 32
+#endif
+
 // ==========================================
 // The Universal CNMAT Adaptor Bucket
 // ==========================================
@@ -20,11 +74,15 @@ typedef void (*OSCReceiveCallback)(const uint8_t *data, int len);
  * CNMAT OSCMessage objects to send data transparently, buffering everything
  * and padding nicely on 4-byte boundaries at the end to satisfy Pure Data
  * requirements.
+ *
+ * @tparam Size Largest message held. OSCBuffer takes LEADER_MAX_MESSAGE,
+ * fragmented by OSCFollower::send() above one radio frame; a small board
+ * can use BasicOSCBuffer<LEADER_V1_PAYLOAD>.
  */
-class OSCBuffer : public Print {
+template <size_t Size = LEADER_MAX_MESSAGE>
+class BasicOSCBuffer : public Print {
 public:
-  uint8_t
-      buffer[250]; ///< Maximum payload size allowed for esp_now is 250 bytes
+  uint8_t buffer[Size];
   size_t length = 0;
 
   /**
@@ -48,14 +106,12 @@ public:
    * @return The number of bytes successfully written.
    */
   size_t write(const uint8_t *str, size_t size) override {
-    size_t count = 0;
-    while (size--) {
-      if (write(*str++))
-        count++;
-      else
-        break;
-    }
-    return count;
+    size_t room = sizeof(buffer) - length;
+    if (size > room)
+      size = room; // Truncate rather than overflow
+    memcpy(buffer + length, str, size);
+    length += size;
+    return size;
   }
 
   /**
@@ -69,9 +125,11 @@ public:
   void end() {
     // Bounded padding to prevent infinite loops where length is at the max
     // capacity
-    while (length % 4 != 0 && length < sizeof(buffer)) {
-      write(0);
-    }
+    size_t padded = (length + 3) & ~(size_t)3;
+    if (padded > sizeof(buffer))
+      padded = sizeof(buffer);
+    memset(buffer + length, 0, padded - length);
+    length = padded;
   }
 
   /**
@@ -80,6 +138,291 @@ public:
   void clear() { length = 0; }
 };
 
+using OSCBuffer = BasicOSCBuffer<>;
+
+// ==========================================
+// Compile-time Configuration
+// ==========================================
+
+/// Parts of a Leader or Follower whose memory can be left out of the build
+enum LeaderFeature : uint8_t {
+  FEATURE_REGISTRY = 0x01, ///< Leader node registry: joins, unicast, slots...
+  FEATURE_USB = 0x02,      ///< Follower tethered USB bridging
+  FEATURE_COMPACT = 0x04,  ///< Compact frames: Leader table, Follower layouts
+  FEATURE_FRAGMENTS = 0x08, ///< Follower messages above one radio frame
+  FEATURE_PEERS = 0x10,     ///< Follower-to-Follower messaging
+  FEATURE_STREAMS = 0x20,   ///< Follower sensor streams
+  FEATURE_RELIABLE = 0x40,  ///< Follower reliable lane to the Leader
+  FEATURE_ALL = 0xFF,
+};
+
+/**
+ * @brief Sizes the buffers of BasicOSCLeader and BasicOSCFollower.
+ *
+ * OSCLeader and OSCFollower use the defaults. Smaller configurations trade
+ * headroom for RAM, e.g. a Follower on an ESP32-C3 that also drives LEDs:
+ *
+ * @code
+ * using LeanConfig = LeaderConfig<4, 1, LEADER_V1_PAYLOAD,
+ *                                 FEATURE_COMPACT | FEATURE_STREAMS>;
+ * BasicOSCFollower<LeanConfig> node;
+ * @endcode
+ *
+ * extras/benchmarks/footprint.cpp prints the static RAM of each configuration.
+ *
+ * @tparam RxQueue Radio frames queued between the receive callback and
+ * update(); frames arriving while it is full are dropped.
+ * @tparam MaxNodes Nodes the Leader's registry tracks (1-250). Unused by
+ * Followers.
+ * @tparam Payload Largest radio frame accepted, from LEADER_V1_PAYLOAD up to
+ * LEADER_MAX_PAYLOAD. Announced to peers, so they never send more; a
+ * Follower sends the Leader nothing larger either. Sizes the receive queue;
+ * with FEATURE_FRAGMENTS, messages split into fragments are built and
+ * reassembled in LEADER_MAX_MESSAGE buffers whatever the Payload.
+ * @tparam Features LeaderFeature flags to build in. Without FEATURE_REGISTRY a
+ * Leader only bridges broadcasts, with no power-save hold slots or heartbeat
+ * slots; without FEATURE_COMPACT it refuses compact layouts, so nodes send
+ * standard OSC. A Follower without FEATURE_USB ignores begin(...,
+ * enableUSB = true); without FEATURE_FRAGMENTS it builds frames of one
+ * Payload and drops fragmented messages it hears; without FEATURE_PEERS,
+ * FEATURE_STREAMS, FEATURE_RELIABLE or FEATURE_COMPACT, enablePeering()
+ * does nothing, addStream(), addReliable() and addCompact() fail, and
+ * everything goes to the Leader best-effort as standard OSC.
+ */
+template <uint8_t RxQueue = LEADER_RX_QUEUE_SIZE,
+          uint8_t MaxNodes = LEADER_MAX_NODES,
+          uint16_t Payload = LEADER_MAX_PAYLOAD, uint8_t Features = FEATURE_ALL>
+struct LeaderConfig {
+  static_assert(RxQueue >= 2, "the receive queue keeps one entry free");
+  static_assert(MaxNodes >= 1 && MaxNodes <= 250, "1 to 250 nodes");
+  static_assert(Payload >= LEADER_V1_PAYLOAD && Payload <= LEADER_MAX_PAYLOAD,
+                "payload between LEADER_V1_PAYLOAD and LEADER_MAX_PAYLOAD");
+
+  static constexpr uint8_t rxQueue = RxQueue;
+  static constexpr uint8_t maxNodes =
+      Features & FEATURE_REGISTRY ? MaxNodes : 0;
+  static constexpr uint16_t payload = Payload;
+  static constexpr uint8_t features = Features;
+  static constexpr uint8_t holdSlots =
+      Features & FEATURE_REGISTRY ? LEADER_PS_HOLD_SLOTS : 0;
+  static constexpr uint16_t maxSlots =
+      Features & FEATURE_REGISTRY ? LEADER_MAX_SLOTS : 0;
+  static constexpr uint8_t compactTable =
+      Features & FEATURE_COMPACT ? LEADER_COMPACT_TABLE : 0;
+  /// Reassembly slots shared by all nodes, one per node up to
+  /// LEADER_UPLOAD_SLOTS; without a registry, a Follower's count
+  static constexpr uint8_t uploadSlots =
+      maxNodes == 0 ? LEADER_REASSEMBLY_SLOTS
+                    : (maxNodes < LEADER_UPLOAD_SLOTS ? maxNodes
+                                                      : LEADER_UPLOAD_SLOTS);
+  /// Largest message a Follower builds in its transmit slot
+  static constexpr uint16_t message =
+      Features & FEATURE_FRAGMENTS ? LEADER_MAX_MESSAGE : Payload;
+  static constexpr uint8_t reassemblySlots =
+      Features & FEATURE_FRAGMENTS ? LEADER_REASSEMBLY_SLOTS : 0;
+  static constexpr uint8_t peers =
+      Features & FEATURE_PEERS ? LEADER_MAX_PEERS : 0;
+  static constexpr uint8_t streams =
+      Features & FEATURE_STREAMS ? LEADER_MAX_STREAMS : 0;
+  static constexpr uint8_t reliableSlots =
+      Features & FEATURE_RELIABLE ? LEADER_RELIABLE_SLOTS : 0;
+  static constexpr uint8_t compactSchemas =
+      Features & FEATURE_COMPACT ? LEADER_COMPACT_SCHEMAS : 0;
+};
+
+using LeaderDefaultConfig = LeaderConfig<>;
+
+/**
+ * @brief One entry of the Leader's node registry.
+ */
+struct LeaderNodeRecord {
+  uint8_t mac[6];
+  uint32_t nodeID;
+  unsigned long lastSeen;
+  bool active;
+  uint8_t via[6];          ///< Last relay on the best path (hops > 0)
+  uint8_t hops;            ///< Relays between node and Leader
+  unsigned long routeSeen; ///< When the best path was last confirmed
+  uint32_t relayDelay;     ///< Smoothed relay residence time, microseconds
+  uint16_t maxPayload;     ///< Announced frame limit (0 = not announced)
+  uint8_t capsQueries;     ///< CAPS queries sent while it stayed silent
+  uint16_t wakeInterval;   ///< Power-save check-in period (0 = always on)
+  uint16_t wakeWindow;     ///< Listening time after each check-in
+  uint16_t awakePermille;  ///< Scheduled awake share reported by the node
+  unsigned long wakeAt;    ///< millis() of the last check-in
+  uint32_t groups;         ///< Peer groups the node joined
+  bool peering;            ///< Announced itself for direct messaging
+  bool announced;          ///< Join reported to the host
+  uint8_t reportedQuality; ///< Last quality percent sent to the host
+  uint16_t quality;        ///< Heartbeats received, smoothed, 0-10000
+  unsigned long lastBeat;  ///< millis() of the last heartbeat (0 = none)
+  uint32_t airUs;          ///< Airtime of its frames in this shard window
+  uint16_t load;           ///< Airtime over the previous window, permille
+  unsigned long movedAt;   ///< millis() of the last move frame (0 = none)
+  uint8_t moveChannel;     ///< Channel of the shard it was moved to
+  uint8_t moveShard;       ///< Shard it was moved to
+  uint8_t moveTries;       ///< Move frames sent so far
+  uint8_t reliablePending; ///< Bit n: reliable slot n awaits its ack
+  SequenceWindow reliableSeen; ///< Its reliable messages passed on
+  uint16_t rateCap;        ///< Messages per second to the host (0 = any)
+  uint32_t rateTokens;     ///< Cap budget left, thousandths of a message
+  unsigned long rateRefilled; ///< millis() of the last budget refill
+  uint32_t rxPassed;       ///< Messages passed to the host since the report
+  uint32_t rxCapped;       ///< Messages over its cap since the report
+};
+
+/**
+ * @brief One radio frame waiting in a receive queue for update().
+ */
+struct LeaderRxPacket {
+  uint8_t *data; ///< Config::payload bytes of queue storage
+  uint8_t mac[6];
+  int len;
+  unsigned long stamp; ///< micros() at reception
+  uint8_t flow;        ///< Leader: sender's fair-queuing flow
+};
+
+/**
+ * @brief One sender's share of the Leader's receive queue.
+ *
+ * The receive callback binds flows to senders and owns in, drops and heard;
+ * update() owns out, dropsReported and deficit. The flow's queued frames
+ * are (uint8_t)(in - out).
+ */
+struct LeaderRxFlow {
+  uint8_t mac[6];          ///< Sender, or a relayed frame's origin
+  bool bound;              ///< mac is set
+  volatile uint8_t in;     ///< Frames queued
+  volatile uint8_t out;    ///< Frames processed
+  volatile uint32_t drops; ///< Frames the full queue turned away
+  uint32_t dropsReported;  ///< drops at the last "/sys/rx"
+  int16_t deficit;         ///< Bytes it may still drain this turn
+  unsigned long heard;     ///< millis() of its last frame
+};
+
+/**
+ * @brief A unicast frame the Leader holds for a dozing power-save node.
+ */
+struct LeaderHeldFrame {
+  uint8_t mac[6];
+  uint16_t len;         ///< 0 = free slot
+  unsigned long heldAt; ///< micros() when queued
+  uint8_t data[LEADER_V1_PAYLOAD];
+};
+
+/**
+ * @brief The node a heartbeat slot was handed to.
+ */
+struct LeaderSlotOwner {
+  uint8_t mac[6];
+  bool taken; ///< False = free slot
+};
+
+/**
+ * @brief One node's compact layout, as the Leader expands it.
+ */
+struct LeaderCompactEntry {
+  OSCCompactSchema schema;
+  uint8_t mac[6];
+  uint8_t id;     ///< Node's layout number
+  bool primed;    ///< steps hold frame seq, deltas apply
+  uint8_t seq;
+  unsigned long usedAt;
+  uint16_t steps[OSCCompactSchema::MAX_ARGS];
+};
+
+/**
+ * @brief Another peering Follower, as a Follower knows it.
+ */
+struct FollowerPeerRecord {
+  uint8_t mac[6];
+  uint32_t nodeID;
+  uint32_t groups;
+  unsigned long seen; ///< millis() of the last table listing it
+  unsigned long used; ///< millis() of the last send, for eviction
+  bool added;         ///< Registered as an ESP-NOW peer
+};
+
+/**
+ * @brief One sensor stream of a Follower (OSCFollower::addStream).
+ */
+struct FollowerSensorStream {
+  const char *address;
+  StreamSource source;
+  StreamIntSource intSource;
+  float deadband;
+  uint32_t periodUs;    ///< Sampling period, 1 / maxRate
+  uint32_t keepAliveUs; ///< 0 = no keep-alive
+  uint32_t nextSample;
+  uint32_t lastSendUs;
+  volatile bool fresh = false; ///< Set by the timer, cleared by update()
+  bool everSent = false;
+  bool deferred = false;
+  union {
+    float f;
+    int32_t i;
+  } sample, lastSent;
+};
+
+/**
+ * @brief A Follower's reliable message awaiting the Leader's ack.
+ */
+struct FollowerReliableSlot {
+  unsigned long sentAt;  ///< micros() of the first copy
+  unsigned long retryAt; ///< micros() of the next copy
+  uint8_t attempt;
+  uint8_t len; ///< Frame length, 0 = free slot
+  uint8_t frame[sizeof(LeaderReliableHeader) + LEADER_RELIABLE_MESSAGE];
+};
+
+/// Whether the Leader took a Follower's compact layout
+enum FollowerCompactState : uint8_t {
+  COMPACT_PENDING,
+  COMPACT_ON,
+  COMPACT_OFF
+};
+
+/**
+ * @brief One compact layout of a Follower (OSCFollower::addCompact).
+ */
+struct FollowerCompactSlot {
+  OSCCompactSchema schema;
+  bool deltas;
+  FollowerCompactState state;
+  bool primed;          ///< previous holds the last frame sent
+  uint8_t seq;
+  uint8_t sinceKey;     ///< Deltas since the last key
+  unsigned long announcedAt;
+  uint16_t previous[OSCCompactSchema::MAX_ARGS];
+};
+
+/**
+ * @brief N entries of storage, or none at all for N = 0.
+ */
+template <class T, size_t N> struct LeaderSlots {
+  T items[N] = {};
+  T *get() { return items; }
+};
+
+template <class T> struct LeaderSlots<T, 0> {
+  T *get() { return nullptr; }
+};
+
+/// Registry hash index size: a power of two at least twice the node count
+constexpr uint16_t leaderNodeHashSize(uint8_t maxNodes) {
+  uint16_t size = 2;
+  while (size < 2u * maxNodes)
+    size <<= 1;
+  return size;
+}
+
+/// Receive flows: one per node, and more than the queue can hold frames, so
+/// a new sender always finds an idle flow
+constexpr uint8_t leaderRxFlows(uint8_t maxNodes, uint8_t rxQueue) {
+  uint8_t flows = maxNodes > LEADER_RX_FLOWS ? maxNodes : LEADER_RX_FLOWS;
+  return flows > rxQueue ? flows : rxQueue;
+}
+
 // ==========================================
 // System Network Object Directors
 // ==========================================
@@ -91,8 +434,11 @@ public:
  * Accepts SLIP formatted OSC data over serial, translating it to ESP-NOW
  * broadcast architecture. Intercepts local telemetry checks without network
  * congestion.
+ *
+ * Holds the logic only; instantiate OSCLeader, or BasicOSCLeader for a
+ * custom LeaderConfig.
  */
-class OSCLeader {
+class OSCLeaderCore {
 public:
   /**
    * @brief Initializes the Leader node network state, Wi-Fi parameters, and
@@ -106,9 +452,13 @@ public:
    * @param autoHop Flag requesting dynamic channel scanning to prevent
    * interference. When enabled, the Leader will periodically scan for the
    * quietest channel and migrate the network automatically.
+   * @param framing Host link framing after reset: FRAMING_SLIP (Pure Data
+   * compatible) or FRAMING_COBS. The host can renegotiate it at any time
+   * with "/host/framing".
    */
   void begin(Stream &serialPort, long baudRate = 1000000,
-             uint8_t homeChannel = 1, bool autoHop = false);
+             uint8_t homeChannel = 1, bool autoHop = false,
+             HostFraming framing = FRAMING_SLIP);
 
   /**
    * @brief Ongoing process to handle Serial incoming payloads and emit network
@@ -133,12 +483,336 @@ public:
                     bool activeLow = true);
 
   /**
-   * @brief Transmits the current node registry to the Host Computer.
+   * @brief Transmits the current node registry to the Host Computer as one
+   * message, "/sys/nodes" followed by (nodeID, msSinceSeen, qualityPercent)
+   * for every live node. With heartbeat pass-through on, sends one
+   * "/sys/node nodeID msSinceSeen" per node instead, as older hosts expect.
    */
   void sendNodeRegistry();
 
+  /**
+   * @brief Chooses whether Follower heartbeats reach the host.
+   *
+   * By default the Leader consumes "/sys/pong" itself and only tells the
+   * host about changes: "/sys/join nodeID" when a node appears,
+   * "/sys/leave nodeID msSilent" when it goes quiet for five heartbeat
+   * intervals (10 s while the host has not set one with "/sys/ping"), and
+   * "/sys/quality nodeID percent" when the share of heartbeats received
+   * moves by 10 points. Pass-through also forwards every heartbeat, as
+   * before. The host does the same with "/leader/heartbeats 0|1".
+   */
+  void setHeartbeatPassThrough(bool enable) { _heartbeatPassThrough = enable; }
+
+  /**
+   * @brief Gives every Follower its own phase within the heartbeat interval,
+   * so heartbeats no longer fire together and collide.
+   *
+   * The Leader broadcasts a plan of slotCount slots and its clock once a
+   * second; Followers ask for a slot, are handed the next free one, and fire
+   * their heartbeat at slot * slotUs into each interval of Leader time.
+   * With tdmaStreams, sensor streams (OSCFollower::addStream) also wait for
+   * their node's slot in every cycle of slotCount slots. The host does the
+   * same with "/leader/slots slotCount [slotUs] [tdma]".
+   *
+   * @param slotCount Number of slots, usually the number of nodes, up to
+   * LEADER_MAX_SLOTS (0 = off). Past slotCount nodes, slots are shared.
+   * @param slotUs Slot width; 0 = heartbeat interval / slotCount, following
+   * "/sys/ping" changes.
+   * @param tdmaStreams Hold stream sends until the node's slot comes up.
+   */
+  void enableSlots(uint16_t slotCount, uint32_t slotUs = 0,
+                   bool tdmaStreams = false);
+
+  /**
+   * @brief Enables hot-standby failover between two Leaders sharing a channel.
+   *
+   * The primary broadcasts a tiny beacon every beaconInterval ms and a
+   * registry snapshot twice per second. A standby Leader stays silent on the
+   * radio, mirrors that registry and takes over once no beacon has been heard
+   * for missedBeacons intervals. Followers re-bind to the new Leader on its
+   * first beacon, without rebooting. Until it has heard a first beacon, the
+   * standby waits at least 2 s, so that powering both Leaders up together
+   * does not promote it while the primary is still booting.
+   *
+   * While in standby, host frames are swallowed instead of broadcast, so the
+   * host may safely write to both Leaders at once.
+   *
+   * @param standby True to start as the passive standby Leader.
+   * @param beaconInterval Milliseconds between primary beacons.
+   * @param missedBeacons Silent intervals tolerated before taking over.
+   */
+  void enableFailover(bool standby = false, unsigned long beaconInterval = 20,
+                      uint8_t missedBeacons = 3);
+
+  /**
+   * @brief Reports whether this Leader is currently the passive standby.
+   */
+  bool isStandby() const { return _standby; }
+
+  /**
+   * @brief Duration of the last takeover, from the last primary beacon heard
+   * to this Leader's first own beacon.
+   * @return Microseconds, or 0 if this Leader never took over.
+   */
+  unsigned long getTakeoverTime() const { return _takeoverMicros; }
+
+  /**
+   * @brief Wraps outgoing broadcasts in relay envelopes so relay Followers can
+   * carry them beyond direct radio range.
+   *
+   * Upstream envelopes from distant Followers are always accepted; the Leader
+   * keeps the shortest relay path per node and reports it on "/leader/routes".
+   *
+   * @param maxHops Number of relay re-broadcasts a frame may take (1-8).
+   */
+  void enableRelay(uint8_t maxHops = 2);
+
+  /**
+   * @brief Transmits the learned relay path of every node to the Host Computer
+   * ("/sys/route nodeID hops relayID relayDelayUs").
+   */
+  void sendRouteTable();
+
+  /**
+   * @brief Largest radio frame currently used for broadcasts, as negotiated
+   * with every live node (250 while any ESP-NOW v1 peer is present).
+   */
+  uint16_t getBroadcastPayload() const { return broadcastPayload(); }
+
+  /**
+   * @brief Fragmented messages that expired with a fragment missing.
+   */
+  uint32_t reassemblyTimeoutCount() const { return _reassembler.timeouts; }
+
+  /**
+   * @brief Fragmented messages dropped to make room for newer ones.
+   */
+  uint32_t reassemblyEvictionCount() const { return _reassembler.evictions; }
+
+  /**
+   * @brief Chooses how framed output to the host is batched.
+   *
+   * Radio traffic and replies are staged and written in bulk instead of one
+   * write per message. The default, FLUSH_THRESHOLD, writes once at the end of
+   * every update() and earlier when threshold bytes are waiting.
+   *
+   * @param policy FLUSH_PER_UPDATE, FLUSH_THRESHOLD or FLUSH_IMMEDIATE.
+   * @param threshold Staged bytes that force a mid-update write.
+   */
+  void setFlushPolicy(HostFlushPolicy policy,
+                      uint16_t threshold = LEADER_HOST_FLUSH_THRESHOLD);
+
+  /**
+   * @brief Sends a message to a single node instead of broadcasting it.
+   *
+   * The host does the same with "/leader/send nodeID blob". Messages for a
+   * power-save Follower that is dozing are held (up to LEADER_PS_HOLD_SLOTS
+   * frames across all nodes) and released when it next checks in. Messages
+   * still held after two check-in intervals are dropped. Only nodes in direct
+   * range are reached.
+   *
+   * @param nodeID The node's ID, as reported in "/sys/pong".
+   * @param data OSC message, up to LEADER_MAX_MESSAGE bytes.
+   * @param len Length of the message.
+   * @return False if the node is unknown or the message could not be sent or
+   * held.
+   */
+  bool sendToNode(uint32_t nodeID, const uint8_t *data, int len);
+
+  /**
+   * @brief Reports power-save nodes ("/sys/powersave nodeID intervalMs
+   * windowMs awakePermille held") and the delivery delay of their unicast
+   * traffic ("/sys/holdtime released expired refused p50Us p90Us p99Us") to
+   * the host.
+   */
+  void sendPowerSaveReport();
+
+  /**
+   * @brief Broadcasts the table of peering Followers (node ID, MAC, groups)
+   * so they can reach each other directly. Sent automatically whenever a
+   * Follower announces itself; see OSCFollower::enablePeering().
+   */
+  void sendPeerTable();
+
+  /**
+   * @brief Runs this Leader as one shard of a multi-Leader installation.
+   *
+   * Leaders on different channels, each on its own serial port, split the
+   * Followers between them to add up their channels' airtime;
+   * extras/leader-bridge merges their host links into one. A shard Leader
+   * tags its beacons with its number and beacons even without failover, so
+   * Followers sent to it can find it. It never auto-hops: the channel plan
+   * belongs to the host. Followers move between shards with moveNode() and
+   * shedLoad().
+   *
+   * @param shard Shard number, 1-15 (0 = unsharded). A hot standby needs
+   * the same number as its primary.
+   */
+  void enableSharding(uint8_t shard);
+
+  /**
+   * @brief Number of this Leader's shard (0 = unsharded).
+   */
+  uint8_t shard() const { return _shard; }
+
+  /**
+   * @brief Sends a node to the Leader of another shard.
+   *
+   * The node moves to channel and binds to the first beacon of that shard,
+   * or comes back here if none is heard within LEADER_SHARD_MOVE_TIMEOUT.
+   * This Leader drops it at once and reports "/sys/moved nodeID channel
+   * shard"; the other one reports it with "/sys/join". While the node is
+   * still heard here, the move is repeated a few times before it is taken
+   * back. The host does the same with "/leader/shard/move nodeID channel
+   * shard".
+   *
+   * @return False if the node is unknown or the move could not be sent.
+   */
+  bool moveNode(uint32_t nodeID, uint8_t channel, uint8_t shard);
+
+  /**
+   * @brief Moves up to budgetPermille of load to another shard, busiest
+   * nodes first.
+   *
+   * A node's load is the airtime of its frames over the last shard report
+   * window; nodes heavier than what is left of the budget are skipped. The
+   * host does the same with "/leader/shard/shed channel shard
+   * budgetPermille".
+   *
+   * @param budgetPermille Airtime to move, in permille (e.g. half the gap
+   * to the least loaded shard).
+   * @return Number of nodes moved.
+   */
+  int shedLoad(uint8_t channel, uint8_t shard, uint16_t budgetPermille);
+
+  /**
+   * @brief Reports this shard's load, "/sys/shard shard channel nodes
+   * airPermille busiestID busiestPermille", and starts a new window.
+   *
+   * Airtime is estimated from the frames this Leader hears and sends (100 us
+   * of overhead plus 8 us per byte at 1 Mbit/s), so foreign traffic on the
+   * channel is not included. Also available as "/leader/shard".
+   */
+  void sendShardReport();
+
+  /**
+   * @brief Delivers host messages whose address matches pattern reliably.
+   *
+   * Matching broadcasts are acknowledged by every live node, and matching
+   * "/leader/send" (or sendToNode()) messages by their node. Unacknowledged
+   * copies are repeated after LEADER_RELIABLE_BACKOFF ms, doubling each
+   * time, up to LEADER_RELIABLE_RETRIES times; nodes drop the duplicates.
+   * Up to LEADER_RELIABLE_SLOTS messages can be in flight; a further one
+   * pushes out the oldest. Messages longer than LEADER_RELIABLE_MESSAGE stay
+   * best-effort. Followers choose their own reliable addresses
+   * (OSCFollower::addReliable); the Leader acknowledges those whatever its
+   * patterns. Also available as "/leader/reliable pattern".
+   *
+   * @param pattern An exact address, or a prefix ending in '*' ("/cue*").
+   * @return False if the pattern is too long or LEADER_RELIABLE_PATTERNS are
+   * set.
+   */
+  bool addReliable(const char *pattern);
+
+  /**
+   * @brief Sends every host message best-effort again
+   * ("/leader/reliable/clear").
+   */
+  void clearReliable() { _reliablePatterns.clear(); }
+
+  /**
+   * @brief Reports the reliable lane to the host, "/sys/reliable sent
+   * delivered retransmits failed p50Us p99Us received duplicates", and
+   * resets the counters. Downstream: messages sent, acknowledgements
+   * received, repeated frames, deliveries given up, and the delay from the
+   * first send to each acknowledgement. Upstream: reliable messages passed
+   * to the host and repeated copies dropped. Also available as
+   * "/leader/reliable".
+   */
+  void sendReliableReport();
+
+  /**
+   * @brief Limits how many messages a node may pass to the host.
+   *
+   * Messages over the cap are counted and dropped once the node's registry
+   * entry and heartbeat have been updated, so a capped node stays live. The
+   * cap allows bursts of a tenth of a second. Also available as
+   * "/leader/rx/cap nodeID perSecond".
+   *
+   * @param nodeID The node's announced ID.
+   * @param perSecond Messages per second, 0 to lift the cap.
+   * @return False if no live node has that ID.
+   */
+  bool setRateCap(uint32_t nodeID, uint16_t perSecond);
+
+  /**
+   * @brief Reports receive fairness to the host, "/sys/rx" followed by
+   * (nodeID, passed, capped, overflowed) for every live node, and resets
+   * the counters. Overflowed counts frames the receive queue turned away
+   * from the node, relayed or not. Also available as "/leader/rx".
+   */
+  void sendRxReport();
+
+  /**
+   * @brief Reports compact encoding to the host, "/sys/compact layouts
+   * expanded savedBytes skipped", and resets the counters: layouts held
+   * for nodes (OSCFollower::addCompact), compact messages expanded to
+   * standard OSC, radio bytes saved by them, and deltas dropped because
+   * the frame before them was lost. Also available as "/leader/compact".
+   */
+  void sendCompactReport();
+
+  /**
+   * @brief Starts recording traffic for later replay.
+   *
+   * Every frame the host sends and every radio frame bound for the host
+   * (heartbeats included) is stored with its arrival time in microseconds,
+   * direction and source MAC in a ring that overwrites the oldest records
+   * once full. The ring comes from PSRAM when the board has it. Restarting
+   * clears the ring. Also available as "/leader/capture 1 [bytes]".
+   *
+   * @param bytes Ring size; records cost 13 bytes plus the frame.
+   * @return False if the ring could not be allocated.
+   */
+  bool enableCapture(size_t bytes = LEADER_CAPTURE_BYTES);
+
+  /**
+   * @brief Stops recording, keeping the ring for sendCapture().
+   */
+  void disableCapture() { _capturing = _captureResume = false; }
+
+  /**
+   * @brief Dumps the ring to the host as "/sys/capture" blobs of whole
+   * LeaderCaptureRecord entries, oldest first, closed by "/sys/capture/end
+   * entries dropped bytes". The dump is spread over the following update()
+   * calls and recording pauses until it is done. Also available as
+   * "/leader/capture/dump".
+   */
+  void sendCapture();
+
+protected:
+  using NodeRecord = LeaderNodeRecord;
+  using RxPacket = LeaderRxPacket;
+  using RxFlow = LeaderRxFlow;
+  using HeldFrame = LeaderHeldFrame;
+  using SlotOwner = LeaderSlotOwner;
+  using CompactEntry = LeaderCompactEntry;
+
+  /**
+   * @brief Binds the storage owned by BasicOSCLeader.
+   */
+  OSCLeaderCore(NodeRecord *nodes, uint8_t maxNodes, uint8_t *nodeHash,
+                uint16_t nodeHashSize, RxPacket *rxQueue, uint8_t rxQueueSize,
+                uint8_t *rxData, uint16_t rxPayload, RxFlow *rxFlows,
+                uint8_t rxFlowCount, HeldFrame *held, uint8_t holdSlots, SlotOwner *slotOwners, uint16_t maxSlots,
+                CompactEntry *compact, uint8_t compactTable,
+                LeaderReassemblySlot *uploads, uint8_t uploadSlots);
+  OSCLeaderCore(const OSCLeaderCore &) = delete;
+  OSCLeaderCore &operator=(const OSCLeaderCore &) = delete;
+
 private:
   Stream *_serial;
+  HostOutput _hostOut;
   uint8_t _homeChannel;
   bool _autoHop = false;
   unsigned long _lastAutoHopTime = 0;
@@ -146,9 +820,7 @@ private:
   uint8_t _broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
   esp_now_peer_info_t _peerInfo;
 
-  uint8_t _oscBuffer[250];
-  uint16_t _bufferIndex = 0;
-  bool _isEscaping = false;
+  HostInput _hostIn;
 
   // Built-in LED Variables
   int _ledPin = -1;
@@ -163,114 +835,570 @@ private:
   uint32_t _packetsDropped = 0;
 
   // --- Node Registry ---
-  static constexpr uint8_t MAX_NODES = 32;
-  struct NodeRecord {
-    uint8_t mac[6];
-    uint32_t nodeID;
-    unsigned long lastSeen;
-    bool active;
-  };
-  NodeRecord _activeNodes[MAX_NODES];
+  static constexpr uint8_t NODES_PER_MESSAGE = 32; ///< Per "/sys/nodes" reply
+  NodeRecord *_activeNodes;
+  uint8_t _maxNodes; ///< 0 = registry compiled out
   uint8_t _nodeCount = 0;
-  void updateNodeRegistry(const uint8_t *mac, uint32_t nodeID);
+  int updateNodeRegistry(const uint8_t *mac, uint32_t nodeID);
   void compactNodeRegistry();
 
-  // --- Thread-safe receive queue ---
-  static constexpr uint8_t RX_QUEUE_SIZE = 8;
-  struct RxPacket {
-    uint8_t data[250];
-    uint8_t mac[6];
-    int len;
-  };
-  volatile uint8_t _rxHead = 0;
-  volatile uint8_t _rxTail = 0;
-  RxPacket _rxQueue[RX_QUEUE_SIZE];
+  // --- Registry Events ---
+  static const unsigned long NODE_TIMEOUT = 10000;
+  static const unsigned long REGISTRY_CHECK_INTERVAL = 100;
+  static constexpr uint8_t QUALITY_STEP = 10; ///< Percent change reported
+  uint8_t *_nodeHash;                         ///< Node index + 1, 0 = empty
+  uint16_t _nodeHashMask;                     ///< Hash size - 1
+  bool _heartbeatPassThrough = false;
+  uint32_t _heartbeatInterval = 0; ///< Last "/sys/ping" interval, ms
+  unsigned long _lastRegistryCheck = 0;
 
   /**
-   * @brief Encodes and writes data over SLIP to the serial port.
-   * @param data Pointer to the raw payload.
-   * @param len Length of the payload.
+   * @brief Looks a node up by MAC through the hash index.
+   * @return Registry index, or -1.
    */
-  void _sendSlipToSerial(const uint8_t *data, int len);
+  int findNode(const uint8_t *mac) const;
+  void indexNode(uint8_t index);
 
   /**
-   * @brief Internal logic scanning existing Wi-Fi APs to evaluate congestion
-   * density.
-   * @return The channel numbering from 1-13 with lowest interference load.
+   * @brief Reports a node whose ID is known and that was not reported yet.
    */
-  uint8_t findQuietestChannel();
+  void announceNode(NodeRecord &node);
 
   /**
-   * @brief Assembles an OSC string "/leader/channel" and reports back to Host
-   * Computer.
+   * @brief Folds a heartbeat (and any missed before it) into the node's
+   * quality, reporting large changes.
    */
-  void sendChannelFeedback();
+  void noteHeartbeat(NodeRecord &node);
 
   /**
-   * @brief Compiles hardware telemetry arguments and beams it over SLIP to
-   * Host.
+   * @brief Reports nodes that went silent.
    */
-  void sendPingReply();
+  void serviceRegistry();
 
-  /**
-   * @brief Discovers strongest Wi-Fi channel and forcefully reassigns entire
-   * mesh architecture.
-   */
-  void triggerHop();
+  void sendNodeEvent(const char *address, uint32_t nodeID, int32_t value,
+                     bool withValue);
 
-  static OSCLeader *_instance;
-  static void _staticOnDataRecv(const esp_now_recv_info_t *info,
-                                const uint8_t *incomingData, int len);
-  void _handleDataRecv(const uint8_t *mac, const uint8_t *incomingData,
-                       int len);
-};
+  // --- Multi-hop Relay ---
+  static const unsigned long ROUTE_TIMEOUT = 3000;
+  uint8_t _relayTtl = 0; ///< 0 = broadcasts leave unwrapped
+  uint16_t _relaySeq = 0;
+  uint8_t _ownMac[6];
+  FrameDedupCache _relayDedup;
+
+  // --- Fragmentation ---
+  FrameReassembler _reassembler;
+  uint16_t _fragmentSeq = 0;
+
+  // --- Payload Negotiation ---
+  static const unsigned long CAPS_QUERY_INTERVAL = 1000;
+  static const uint8_t CAPS_QUERY_TRIES = 3; ///< Then the node stays v1
+  unsigned long _lastCapsQuery = 0;
 
-/**
- * @brief Endpoint Client Node mapping internal logic or external hardware to
- * central Leader.
- *
- * Functions autonomously via battery reading logic gates or tethered
- * translating parallel host machines into radio broadcasts identical to Leader.
- */
-class OSCFollower {
-public:
   /**
-   * @brief Bootstraps internal framework binding Follower node to incoming
-   * channels.
+   * @brief Largest frame every live node can receive.
    *
-   * @param homeChannel Fixed channel identifier to await incoming
-   * transmissions.
-   * @param enableUSB Enables explicit bridging forwarding ESP-NOW packets to
-   * SLIP computer output.
-   * @param baudRate Connection speed necessary if enableUSB is flagged true.
+   * Falls back to LEADER_V1_PAYLOAD as soon as one node has not announced
+   * ESP-NOW v2 support (or no node is known at all).
    */
-  void begin(uint8_t homeChannel = 1, bool enableUSB = false,
-             long baudRate = 115200);
+  uint16_t broadcastPayload() const;
 
   /**
-   * @brief Required ongoing cycle process listening for SLIP/ESP-NOW exchanges
-   * over the internal hardware layer and executing callbacks.
+   * @brief Broadcasts the Leader's capabilities, asking nodes for theirs.
+   * Counts as one try for every node that has not announced yet.
    */
-  void update();
+  void sendCapsQuery();
 
   /**
-   * @brief Subscribes a custom user callback routine invoked for raw network
-   * data.
-   *
-   * @param callback Void routine receiving pointer to raw packet payload and
-   * size offset.
+   * @brief Broadcasts a message of any size up to LEADER_MAX_MESSAGE,
+   * fragmenting it when it exceeds a single radio frame.
    */
-  void onReceive(OSCReceiveCallback callback);
+  esp_err_t broadcastMessage(const uint8_t *data, int len);
 
   /**
-   * @brief Transmits unstructured binary payload out through wireless
-   * architecture bound for the cached Leader identity.
-   *
-   * @param data Byte pointer corresponding to memory offset.
+   * @brief Broadcasts a frame, wrapped in a relay envelope when relaying is
+   * enabled and the envelope still fits in one ESP-NOW frame.
+   */
+  esp_err_t broadcastFrame(const uint8_t *data, int len);
+
+  /**
+   * @brief Records the path a node's frame took if it beats the known one.
+   */
+  void noteRoute(int index, const uint8_t *via, uint8_t hops,
+                 uint32_t delayMicros);
+
+  // --- Power-save Delivery ---
+  static constexpr uint8_t HOLD_SAMPLES = 64;
+  HeldFrame *_held;
+  uint8_t _holdSlots; ///< 0 = registry compiled out
+  uint8_t _heldCount = 0;
+  uint32_t _heldReleased = 0;
+  uint32_t _heldExpired = 0;
+  uint32_t _heldRefused = 0; ///< Hold slots exhausted
+  LatencySamples<HOLD_SAMPLES> _holdSamples; ///< Recent delivery delays
+
+  /**
+   * @brief True while a node's radio is on: not in power save, or inside
+   * the window that follows its last check-in.
+   */
+  bool nodeListening(const NodeRecord &node) const;
+
+  // --- Unicast Peers ---
+  // The radio holds ESP_NOW_MAX_TOTAL_PEER_NUM (20) peers, one of them the
+  // broadcast address: only the most recently addressed nodes stay added
+  static constexpr uint8_t UNICAST_PEER_SLOTS = 16;
+  struct UnicastPeer {
+    uint8_t mac[6];
+    unsigned long used; ///< millis() of the last send, for eviction
+  };
+  UnicastPeer _unicastPeers[UNICAST_PEER_SLOTS];
+  uint8_t _unicastPeerCount = 0;
+
+  /**
+   * @brief Sends one frame to a single node, adding it as a peer if needed
+   * and removing the least recently used one to make room.
+   */
+  esp_err_t unicastFrame(const uint8_t *mac, const uint8_t *data, int len);
+
+  /**
+   * @brief Queues one frame for a dozing node.
+   */
+  bool holdFrame(const uint8_t *mac, const uint8_t *data, int len);
+
+  /**
+   * @brief Releases held frames to listening nodes and expires stale ones.
+   */
+  void servicePowerSave();
+
+  void noteHoldTime(uint32_t micros) { _holdSamples.add(micros); }
+
+  // --- Slot Scheduling ---
+  static const unsigned long SLOT_PLAN_INTERVAL = 1000;
+  static const unsigned long SLOT_BATCH_DELAY = 5; ///< Requests gathered, ms
+  static constexpr uint8_t SLOT_BATCH = 16;
+  uint16_t _slotCount = 0; ///< 0 = slotting off
+  uint32_t _slotUsConfig = 0;
+  uint32_t _slotUs = 0;
+  uint8_t _slotFlags = 0;
+  uint8_t _slotPlan = 0;
+  uint16_t _nextSlot = 0; ///< Shared-slot turn once every slot is owned
+  SlotOwner *_slotOwners;
+  uint16_t _maxSlots; ///< 0 = registry compiled out
+  unsigned long _lastSlotPlan = 0;
+  LeaderSlotEntry _slotPending[SLOT_BATCH];
+  uint8_t _slotPendingCount = 0;
+  unsigned long _slotPendingSince = 0;
+
+  /**
+   * @brief Starts a new plan (slot width, fresh numbering) and announces it.
+   */
+  void planSlots();
+  void writeSlotHeader(LeaderSlotHeader &header, uint8_t kind);
+  void sendSlotPlan();
+
+  /**
+   * @brief Broadcasts the slots handed out since the last batch.
+   */
+  void sendSlotAssignments();
+
+  /**
+   * @brief Hands a slot to a requesting node: the one it already owns, else
+   * the first free one.
+   */
+  void assignSlot(const uint8_t *mac);
+
+  /**
+   * @brief Repeats the plan and flushes batched assignments.
+   */
+  void serviceSlots();
+
+  // --- Follower-to-Follower Discovery ---
+  static const unsigned long PEER_TABLE_INTERVAL = 200;
+  bool _peerTablePending = false;
+  unsigned long _lastPeerTable = 0;
+
+  /**
+   * @brief Sends a pending peer table once the rate limit allows it.
+   */
+  void servicePeers();
+
+  /**
+   * @brief Reports a Follower's mirrored direct send to the host.
+   */
+  void reportPeerMirror(const uint8_t *mac, const uint8_t *data, int len);
+
+  // --- Traffic Capture ---
+  static constexpr uint16_t CAPTURE_CHUNK = 512; ///< Blob bytes per message
+  static constexpr uint8_t CAPTURE_BURST = 2;    ///< Dump messages per update
+  uint8_t *_capture = nullptr;
+  size_t _captureSize = 0;
+  size_t _captureHead = 0;      ///< Next write offset
+  size_t _captureTail = 0;      ///< Oldest record
+  size_t _captureEnd = 0;       ///< End of the upper run once wrapped
+  bool _captureWrapped = false; ///< Records continue at offset 0
+  bool _capturing = false;
+  uint32_t _captureEntries = 0;
+  uint32_t _captureDropped = 0; ///< Records overwritten or too large
+  bool _captureDumping = false;
+  bool _captureResume = false; ///< Recording state to restore after a dump
+  size_t _captureDumpPos = 0;
+  bool _captureDumpWrapped = false;
+  uint32_t _captureDumpLeft = 0;
+
+  /**
+   * @brief Appends one frame to the ring, evicting the oldest records.
+   */
+  void captureFrame(uint8_t dir, const uint8_t *mac, const uint8_t *data,
+                    int len, unsigned long stamp);
+
+  /**
+   * @brief Sends the next chunks of a dump in progress.
+   */
+  void serviceCapture();
+
+  // --- Channel Sharding ---
+  static const unsigned long SHARD_BEACON_INTERVAL = 250;
+  static const unsigned long SHARD_MOVE_RETRY = 100; ///< Frames in flight
+  static const uint8_t SHARD_MOVE_TRIES = 4;
+  static constexpr uint32_t FRAME_OVERHEAD_US = 100; ///< Preamble, header, ACK
+  uint8_t _shard = 0;                  ///< 0 = unsharded
+  volatile uint32_t _rxAirUs = 0;      ///< Frames heard, updated atomically
+  uint32_t _txAirUs = 0;               ///< Frames sent in this window
+  unsigned long _shardWindowStart = 0; ///< micros()
+
+  /**
+   * @brief Beacons for Followers moving in, when failover does not.
+   */
+  void serviceSharding();
+
+  /**
+   * @brief Sends a node the move frame recorded in its registry entry.
+   */
+  bool sendMoveFrame(NodeRecord &node);
+
+  static uint32_t airtimeOf(int len) { return FRAME_OVERHEAD_US + 8 * len; }
+
+  // --- Reliable Delivery ---
+  static constexpr uint8_t RELIABLE_SAMPLES = 64;
+  static constexpr uint32_t RELIABLE_ACK_SPACING_US = 1000; ///< Air + backoff
+  struct ReliableSlot {
+    uint32_t nodeID;       ///< Single addressee, 0 = every live node
+    unsigned long sentAt;  ///< micros() of the first copy
+    unsigned long retryAt; ///< micros() of the next copy
+    uint8_t attempt;
+    uint8_t spread; ///< Ack window of broadcast copies, 100 us units
+    uint8_t addressees; ///< Nodes the message was sent to
+    uint8_t pending;    ///< Addressees yet to acknowledge
+    uint8_t len;     ///< Frame length, 0 = free slot
+    uint8_t frame[sizeof(LeaderReliableHeader) + LEADER_RELIABLE_MESSAGE];
+  };
+  ReliableSlot _reliable[LEADER_RELIABLE_SLOTS] = {};
+  AddressPatternSet _reliablePatterns;
+  FrameDedupCache _reliableDedup; ///< Nodes missing from the registry
+  uint16_t _reliableSeq = 0;
+  uint32_t _reliableSent = 0;
+  uint32_t _reliableDelivered = 0;
+  uint32_t _reliableRetransmits = 0;
+  uint32_t _reliableFailed = 0;
+  uint32_t _reliableReceived = 0;
+  uint32_t _reliableDuplicates = 0;
+  LatencySamples<RELIABLE_SAMPLES> _reliableLatency;
+  ReliableTimeout _reliableTimeout;
+
+  /**
+   * @brief Sends a message on the reliable lane, to one node or all.
+   * @return False if it is too long for the lane or has no addressee.
+   */
+  bool sendReliable(const uint8_t *data, int len, uint32_t nodeID);
+
+  /**
+   * @brief Transmits one copy of a reliable slot.
+   */
+  bool transmitReliable(ReliableSlot &slot);
+
+  /**
+   * @brief Microseconds to wait for the acknowledgements of the copy just
+   * sent.
+   */
+  uint32_t reliableWait(const ReliableSlot &slot);
+
+  /**
+   * @brief Frees a slot, counting the nodes still pending as failed.
+   */
+  void releaseReliable(uint8_t index);
+
+  /**
+   * @brief Acknowledges upstream reliable data and consumes downstream
+   * acknowledgements.
+   * @return True if data holds a first copy, unwrapped, for the host.
+   */
+  bool handleReliableFrame(const uint8_t *mac, const uint8_t *&data,
+                           int &len);
+
+  /**
+   * @brief Repeats unacknowledged messages whose backoff ran out.
+   */
+  void serviceReliable();
+
+  // --- Compact encoding ---
+  static const unsigned long COMPACT_IDLE_MS = 10000; ///< Then evictable
+  static const unsigned long COMPACT_UNKNOWN_SPACING_MS = 50;
+  CompactEntry *_compact;
+  uint8_t _compactTable; ///< 0 = compact frames refused
+  uint8_t _compactOut[OSCCompactSchema::MAX_MESSAGE]; ///< Last expansion
+  unsigned long _compactUnknownAt = 0;
+  uint32_t _compactExpanded = 0;
+  uint32_t _compactSaved = 0;   ///< Bytes the radio did not carry
+  uint32_t _compactSkipped = 0; ///< Deltas without their previous frame
+
+  /**
+   * @brief Registers layouts and expands compact messages.
+   * @return True if data now holds a standard OSC message for the host.
+   */
+  bool handleCompactFrame(const uint8_t *mac, const uint8_t *&data,
+                          int &len);
+
+  /**
+   * @brief Answers a node about one of its layouts.
+   */
+  void sendCompactReply(const uint8_t *mac, uint8_t kind, uint8_t schema);
+
+  // --- Hot-standby Failover ---
+  static const unsigned long DIRECTORY_INTERVAL = 500;
+  static const unsigned long FAILOVER_BOOT_GRACE = 2000; ///< ms, first beacon
+  bool _failoverEnabled = false;
+  bool _standby = false;
+  bool _primaryHeard = false; ///< A primary beaconed since enableFailover()
+  unsigned long _beaconInterval = 20;
+  unsigned long _takeoverTimeout = 60;
+  unsigned long _lastBeaconTime = 0;
+  unsigned long _lastDirectoryTime = 0;
+  unsigned long _lastPrimaryMicros = 0; ///< Arrival of last primary beacon
+  unsigned long _primaryHoldMs = 0;     ///< Silence announced by the primary
+  unsigned long _takeoverMicros = 0;
+  uint32_t _epoch = 1;
+
+  /**
+   * @brief Broadcasts a liveness beacon for the current epoch.
+   * @param holdMs Announced silence before the next beacon.
+   */
+  void sendBeacon(uint16_t holdMs = 0);
+
+  /**
+   * @brief Broadcasts the node registry in as many chunks as required.
+   */
+  void sendDirectory();
+
+  /**
+   * @brief Runs beacon, registry mirroring and takeover timers.
+   */
+  void serviceFailover();
+
+  /**
+   * @brief Promotes a standby Leader to primary and announces the new epoch.
+   */
+  void takeOver();
+
+  /**
+   * @brief Reports the Leader's failover role ("/leader/role") to the host.
+   */
+  void sendRoleFeedback();
+
+  /**
+   * @brief Consumes LEADER control frames heard from other Leaders.
+   */
+  void handleControlFrame(const uint8_t *mac, const uint8_t *data, int len);
+
+  // --- Thread-safe receive queue ---
+  volatile uint8_t _rxHead = 0;
+  volatile uint8_t _rxTail = 0;
+  RxPacket *_rxQueue;
+  uint8_t _rxQueueSize;
+  uint16_t _rxPayload; ///< Largest frame accepted and announced
+
+  // --- Fair receive queue ---
+  static constexpr uint8_t RX_FLOW_DONE = 0xFF; ///< Slot already processed
+  static constexpr int16_t RX_QUANTUM = LEADER_V1_PAYLOAD; ///< Bytes per turn
+  RxFlow *_flows;
+  uint8_t _flowCount;
+  uint8_t _rxFlow = 0;       ///< Flow whose turn it is
+  bool _rxFlowTurn = false;  ///< Its quantum was granted this turn
+
+  /**
+   * @brief Finds the sender's flow from the receive callback, binding an
+   * idle one to a new sender. Relayed frames go to their origin's flow.
+   * @return The flow's index.
+   */
+  uint8_t rxFlowOf(const uint8_t *mac, const uint8_t *data, int len);
+
+  /**
+   * @brief Looks a sender's flow up without binding one.
+   * @return Flow index, or -1.
+   */
+  int findRxFlow(const uint8_t *mac) const;
+
+  /**
+   * @brief Picks the next queued frame in deficit round-robin order, so
+   * every flow drains about RX_QUANTUM bytes per turn.
+   * @return Its queue index, or -1 if the queue is empty.
+   */
+  int nextRxPacket();
+
+  /**
+   * @brief Marks a frame processed and frees the slots it unblocks.
+   */
+  void releaseRxPacket(int index);
+
+  /**
+   * @brief Runs one received frame through unwrapping, the registry and
+   * on to the host.
+   */
+  void processRxPacket(RxPacket &pkt);
+
+  /**
+   * @brief Takes one message from a node's rate cap budget.
+   * @return False if the node is over its cap.
+   */
+  bool withinRateCap(NodeRecord &node);
+
+  /**
+   * @brief Frames data (SLIP unless COBS was negotiated) into the batched
+   * serial output.
+   * @param data Pointer to the raw payload.
+   * @param len Length of the payload.
+   */
+  void _sendSlipToSerial(const uint8_t *data, int len);
+
+  /**
+   * @brief Acts on one complete message received from the host: local
+   * "/leader/..." commands, framing handshakes, or a radio broadcast.
+   * @return True if the message triggered network or telemetry activity.
+   */
+  bool handleHostFrame(const uint8_t *frame, int len);
+
+  /**
+   * @brief Internal logic scanning existing Wi-Fi APs to evaluate congestion
+   * density.
+   * @return The channel numbering from 1-13 with lowest interference load.
+   */
+  uint8_t findQuietestChannel();
+
+  /**
+   * @brief Assembles an OSC string "/leader/channel" and reports back to Host
+   * Computer.
+   */
+  void sendChannelFeedback();
+
+  /**
+   * @brief Compiles hardware telemetry arguments and beams it over SLIP to
+   * Host.
+   */
+  void sendPingReply();
+
+  /**
+   * @brief Discovers strongest Wi-Fi channel and forcefully reassigns entire
+   * mesh architecture.
+   */
+  void triggerHop();
+
+  /**
+   * @brief Moves the radio and the broadcast peer onto another channel.
+   */
+  void applyChannel(uint8_t channel);
+
+  // The host simulator (extras/hostsim) runs many devices in one process and
+  // re-points _instance at whichever virtual device is active
+  friend struct LeaderSimHooks;
+
+  static OSCLeaderCore *_instance;
+  static void _staticOnDataRecv(const esp_now_recv_info_t *info,
+                                const uint8_t *incomingData, int len);
+  void _handleDataRecv(const uint8_t *mac, const uint8_t *incomingData,
+                       int len);
+};
+
+/**
+ * @brief Endpoint Client Node mapping internal logic or external hardware to
+ * central Leader.
+ *
+ * Functions autonomously via battery reading logic gates or tethered
+ * translating parallel host machines into radio broadcasts identical to Leader.
+ *
+ * Holds the logic only; instantiate OSCFollower, or BasicOSCFollower for a
+ * custom LeaderConfig.
+ */
+class OSCFollowerCore {
+public:
+  /**
+   * @brief Bootstraps internal framework binding Follower node to incoming
+   * channels.
+   *
+   * @param homeChannel Fixed channel identifier to await incoming
+   * transmissions.
+   * @param enableUSB Enables explicit bridging forwarding ESP-NOW packets to
+   * SLIP computer output.
+   * @param baudRate Connection speed necessary if enableUSB is flagged true.
+   * @param framing USB link framing after reset (see OSCLeader::begin).
+   */
+  void begin(uint8_t homeChannel = 1, bool enableUSB = false,
+             long baudRate = 115200, HostFraming framing = FRAMING_SLIP);
+
+  /**
+   * @brief Required ongoing cycle process listening for SLIP/ESP-NOW exchanges
+   * over the internal hardware layer and executing callbacks.
+   */
+  void update();
+
+  /**
+   * @brief Subscribes a custom user callback routine invoked for raw network
+   * data.
+   *
+   * @param callback Void routine receiving pointer to raw packet payload and
+   * size offset.
+   */
+  void onReceive(OSCReceiveCallback callback);
+
+  /**
+   * @brief Transmits unstructured binary payload out through wireless
+   * architecture bound for the cached Leader identity.
+   *
+   * Payloads larger than one radio frame (up to LEADER_MAX_MESSAGE) are
+   * split into fragments and reassembled by the Leader.
+   *
+   * @param data Byte pointer corresponding to memory offset.
    * @param len Quantity of valid bytes encoded.
    */
   void send(const uint8_t *data, int len);
 
+  /**
+   * @brief Starts building a message directly in this node's transmit slot.
+   *
+   * The zero-copy alternative to OSCMessage + OSCBuffer + send(): arguments
+   * are written in place by the returned frame's add*() calls, and
+   * commitFrame() hands the slot to the radio without staging it anywhere
+   * else. The slot keeps headroom for a relay header, so relayed sends are
+   * not copied either. Only one frame can be open at a time. The slot holds
+   * LEADER_MAX_MESSAGE bytes, or one Payload without FEATURE_FRAGMENTS.
+   *
+   * The slot survives commitFrame(), so a node that always sends the same
+   * address can call beginFrame() once and then rewind() the frame before
+   * each new set of arguments, skipping the header entirely.
+   *
+   * @param address The OSC address pattern (e.g., "/imu").
+   * @param typeTags Argument types, e.g. "fffi" (see OSCFrame).
+   * @return The frame; check ready() or commitFrame()'s result for errors.
+   */
+  OSCFrame &beginFrame(const char *address, const char *typeTags);
+
+  /**
+   * @brief Sends the frame opened by beginFrame().
+   *
+   * Frames larger than one radio frame are fragmented like send() does.
+   *
+   * @return False if the frame is incomplete, overflowed or no Leader is
+   * bound yet.
+   */
+  bool commitFrame(OSCFrame &frame);
+
   /**
    * @brief Initiates scheduled system polling broadcasting unique identity
    * codes automatically.
@@ -281,8 +1409,297 @@ public:
    */
   void enableHeartbeat(uint32_t interval, uint32_t customID = 0);
 
+  /**
+   * @brief Chooses how tethered output to USB is batched.
+   * @see OSCLeader::setFlushPolicy
+   */
+  void setFlushPolicy(HostFlushPolicy policy,
+                      uint16_t threshold = LEADER_HOST_FLUSH_THRESHOLD);
+
+  /**
+   * @brief Turns this Follower into a relay that re-broadcasts Leader traffic
+   * to nodes beyond direct range and forwards their replies upstream.
+   *
+   * Duplicates are suppressed with an (origin, sequence) cache. While the
+   * heartbeat runs, relay statistics are reported upstream as
+   * "/sys/relay nodeID relayed duplicates queueDepth queuePeak".
+   * Any Follower, relay or not, automatically routes its own sends through a
+   * relay when it can no longer hear the Leader directly.
+   */
+  void enableRelay();
+
+  /**
+   * @brief Number of frames this relay forwarded.
+   */
+  uint32_t relayedCount() const { return _relayedCount; }
+
+  /**
+   * @brief Highest receive queue occupancy observed while relaying.
+   */
+  uint8_t relayQueuePeak() const { return _relayQueuePeak; }
+
+  /**
+   * @brief Registers a sensor stream that samples and sends itself.
+   *
+   * The source is sampled maxRate times per second from a hardware timer,
+   * independently of loop(). update() sends a sample only when it moved by
+   * more than the deadband since the last value sent, or when 1/minRate
+   * seconds passed without a send (keep-alive, 0 = change only). Each
+   * message is "address ,f value" (or ",i" for integer sources).
+   *
+   * Sources run in the esp_timer task: keep them short, and do not share a
+   * bus (I2C, SPI) with code in loop() without locking.
+   *
+   * @param address OSC address; must stay valid (a string literal).
+   * @param source Function returning the current value.
+   * @param minRate Keep-alive rate in Hz (0 = only on change).
+   * @param maxRate Sampling rate in Hz, which also caps the send rate.
+   * @param deadband Smallest change worth sending.
+   * @return Stream index, or -1 if LEADER_MAX_STREAMS are registered or
+   * streams are built out (FEATURE_STREAMS).
+   */
+  int addStream(const char *address, StreamSource source, float minRate,
+                float maxRate, float deadband = 0);
+  int addStream(const char *address, StreamIntSource source, float minRate,
+                float maxRate, int deadband = 0);
+
+  /**
+   * @brief Caps this node's total radio airtime with a token bucket.
+   *
+   * Every frame the node originates is charged an estimate of its airtime
+   * (preamble and MAC overhead plus 8 us per byte at 1 Mbit/s). Streams wait
+   * while the bucket is empty and send their latest sample once it refills;
+   * other sends are never held back but still draw from the bucket.
+   *
+   * @param usPerSecond Airtime allowed per second (e.g. 20000 = 2%). 0
+   * disables the cap.
+   * @param burstUs Bucket depth; defaults to 100 ms worth of budget.
+   */
+  void setAirtimeBudget(uint32_t usPerSecond, uint32_t burstUs = 0);
+
+  /// Stream samples sent, skipped as unchanged, and held by the budget
+  uint32_t streamSentCount() const { return _streamSent; }
+  uint32_t streamSuppressedCount() const { return _streamSuppressed; }
+  uint32_t streamDeferredCount() const { return _streamDeferred; }
+
+  /**
+   * @brief Duty-cycles the radio: the node checks in with the Leader every
+   * intervalMs, listens for windowMs, then dozes in modem sleep.
+   *
+   * Sends still go out at any time. The Leader holds messages addressed to
+   * this node (OSCLeader::sendToNode, "/leader/send") and releases them at
+   * check-in, so their delay is bounded by intervalMs. Broadcasts sent while
+   * the node dozes are missed. The radio stays on until a Leader is bound,
+   * and relays never doze.
+   *
+   * The Wi-Fi driver also wakes the radio for windowMs every intervalMs while
+   * it dozes, on a clock of its own, so it may be on up to twice as long.
+   *
+   * @param intervalMs Time between check-ins (the worst-case delay).
+   * @param windowMs Listening time after each check-in.
+   */
+  void enablePowerSave(uint16_t intervalMs, uint16_t windowMs = 20);
+
+  /**
+   * @brief Keeps the radio on again and tells the Leader to stop holding.
+   */
+  void disablePowerSave();
+
+  /**
+   * @brief Share of time the schedule kept the radio listening since power
+   * save was enabled (1.0 without power save). This is the duty cycle asked
+   * of the driver, not measured radio time: its own wake windows and sends
+   * made while dozing are not counted.
+   */
+  float awakeRatio() const;
+
+  /**
+   * @brief Lets this Follower talk to other Followers directly, without a
+   * round trip through the Leader and host.
+   *
+   * The node announces its ID and groups to the Leader, which broadcasts the
+   * table of all peering nodes; the announcement is repeated every few
+   * seconds to keep the table fresh. Peers must be in direct radio range of
+   * each other, and power-save peers only hear direct sends during their
+   * wake windows. Messages from peers arrive through onReceive() like any
+   * other.
+   *
+   * @param groups Bit n set = member of group n (see sendToGroup()).
+   * @param mirror Also send a copy of every direct send to the Leader, which
+   * reports it to the host as "/sys/peer fromID toID group blob".
+   * Ignored if peering is built out (FEATURE_PEERS).
+   */
+  void enablePeering(uint32_t groups = 0, bool mirror = false);
+
+  /**
+   * @brief Sends a message straight to another peering Follower.
+   *
+   * Peers are added as ESP-NOW peers on first use; only the most recently
+   * used few are kept registered, as the radio's peer table is small.
+   * Messages above one v1 frame are fragmented.
+   *
+   * @param nodeID The peer's ID, as reported in "/sys/pong".
+   * @param data OSC message, up to LEADER_MAX_MESSAGE bytes.
+   * @param len Length of the message.
+   * @return False if the peer is not (yet) known or the radio refused the
+   * frame. An unknown peer triggers an early table refresh.
+   */
+  bool sendTo(uint32_t nodeID, const uint8_t *data, int len);
+
+  /**
+   * @brief Sends a message to every known peer in a group, one unicast each.
+   * @param group Group number, 0-31.
+   * @return Number of peers the message was handed to.
+   */
+  int sendToGroup(uint8_t group, const uint8_t *data, int len);
+
+  /**
+   * @brief Number of other Followers currently known as peers.
+   */
+  uint8_t peerCount() const { return _peerCount; }
+
+  /**
+   * @brief The Leader's micros() clock as estimated by this node, learned
+   * from slot plans (see OSCLeader::enableSlots). Equals micros() until a
+   * plan has been heard.
+   */
+  uint32_t leaderMicros() const { return micros() + _leaderClockOffset; }
+
+  /**
+   * @brief Heartbeat slot handed out by the Leader, or -1 without one.
+   */
+  int slot() const { return _slotted ? _slot : -1; }
+
+  /**
+   * @brief Shard of the bound Leader (0 = unsharded), see
+   * OSCLeader::enableSharding.
+   */
+  uint8_t shard() const { return _leaderShard; }
+
+  /**
+   * @brief Delivers messages whose address matches pattern reliably.
+   *
+   * Matching send() and commitFrame() messages are repeated until the Leader
+   * acknowledges them, after LEADER_RELIABLE_BACKOFF ms and then twice as
+   * long each time, up to LEADER_RELIABLE_RETRIES times; the Leader drops
+   * the duplicates. Up to LEADER_RELIABLE_SLOTS messages can be in flight; a
+   * further one pushes out the oldest. Sensor streams always stay
+   * best-effort, as do messages longer than LEADER_RELIABLE_MESSAGE.
+   * Reliable messages from the Leader (OSCLeader::addReliable) are
+   * acknowledged and passed on once whatever is set here.
+   *
+   * @param pattern An exact address, or a prefix ending in '*' ("/cue*").
+   * @return False if the pattern is too long, LEADER_RELIABLE_PATTERNS are
+   * set or the lane is built out (FEATURE_RELIABLE).
+   */
+  bool addReliable(const char *pattern) {
+    return _reliableSlots > 0 && _reliablePatterns.add(pattern);
+  }
+
+  /**
+   * @brief Sends every message best-effort again.
+   */
+  void clearReliable() { _reliablePatterns.clear(); }
+
+  /**
+   * @brief Reliable messages sent since begin().
+   */
+  uint32_t reliableSentCount() const { return _reliableSent; }
+
+  /**
+   * @brief Repeated reliable frames since begin().
+   */
+  uint32_t reliableRetransmitCount() const { return _reliableRetransmits; }
+
+  /**
+   * @brief Reliable messages the Leader never acknowledged.
+   */
+  uint32_t reliableFailedCount() const { return _reliableFailed; }
+
+  /**
+   * @brief One percentile (0-100) of the delay from sending a reliable
+   * message to its acknowledgement, in microseconds, over the most recent
+   * deliveries; 0 before the first.
+   */
+  uint32_t reliableLatency(uint8_t pct) const {
+    return _reliableLatency.percentile(pct);
+  }
+
+  /**
+   * @brief Sends messages of one layout in a compact, quantized form.
+   *
+   * Messages to address with exactly these type tags travel as bits-wide
+   * steps of [min, max], packed back to back; "fff" at 16 bits takes 11
+   * bytes on air instead of 32. With deltas on, each step may instead be
+   * sent as a change of half the width against the previous message, with
+   * a full key every LEADER_COMPACT_KEY_INTERVAL messages. The Leader
+   * expands them into standard OSC before the host sees them, so only the
+   * precision changes. Messages stay standard until the Leader accepts the
+   * layout, and for good if it has no room or predates compact encoding.
+   * Reliable addresses are never compacted.
+   *
+   * @param address An exact OSC address.
+   * @param typeTags One 'i' or 'f' per argument (at most 16).
+   * @param min Lowest value carried; lower values are clamped.
+   * @param max Highest value carried; higher values are clamped.
+   * @param bits Step width, 4 to 16.
+   * @param deltas Send changes against the previous message where they fit.
+   * @return False if the layout is unusable, LEADER_COMPACT_SCHEMAS are in
+   * use or compact layouts are built out (FEATURE_COMPACT).
+   */
+  bool addCompact(const char *address, const char *typeTags, float min,
+                  float max, uint8_t bits = 16, bool deltas = false);
+
+  /**
+   * @brief Messages sent in compact form since begin().
+   */
+  uint32_t compactSentCount() const { return _compactSent; }
+
+  /**
+   * @brief Radio bytes compact form saved since begin().
+   */
+  uint32_t compactSavedBytes() const { return _compactSaved; }
+
+  /**
+   * @brief Fragmented messages that expired with a fragment missing.
+   */
+  uint32_t reassemblyTimeoutCount() const { return _reassembler.timeouts; }
+
+  /**
+   * @brief Fragmented messages dropped to make room for newer ones.
+   */
+  uint32_t reassemblyEvictionCount() const { return _reassembler.evictions; }
+
+  /// Room ahead of the transmit slot: a relay header fits, so the message
+  /// keeps 4-byte alignment and relayed frames are wrapped without a copy
+  static constexpr size_t TX_HEADROOM =
+      (sizeof(LeaderRelayHeader) + 3) & ~(size_t)3;
+
+protected:
+  using RxPacket = LeaderRxPacket;
+  using PeerRecord = FollowerPeerRecord;
+  using SensorStream = FollowerSensorStream;
+  using ReliableSlot = FollowerReliableSlot;
+  using CompactSlot = FollowerCompactSlot;
+
+  /**
+   * @brief Binds the storage owned by BasicOSCFollower.
+   */
+  OSCFollowerCore(RxPacket *rxQueue, uint8_t rxQueueSize, uint8_t *rxData,
+                  uint16_t rxPayload, HostOutput *usbOut, HostInput *usbIn,
+                  uint8_t *txSlot, uint16_t txMessage,
+                  LeaderReassemblySlot *reassembly, uint8_t reassemblySlots,
+                  PeerRecord *peers, uint8_t maxPeers, SensorStream *streams,
+                  uint8_t maxStreams, ReliableSlot *reliable,
+                  uint8_t reliableSlots, CompactSlot *compact,
+                  uint8_t compactSchemas);
+  OSCFollowerCore(const OSCFollowerCore &) = delete;
+  OSCFollowerCore &operator=(const OSCFollowerCore &) = delete;
+
 private:
-  static OSCFollower *_instance;
+  friend struct LeaderSimHooks;
+
+  static OSCFollowerCore *_instance;
   static void _staticOnDataRecv(const esp_now_recv_info_t *info,
                                 const uint8_t *incomingData, int len);
   void _handleDataRecv(const uint8_t *mac, const uint8_t *incomingData,
@@ -292,34 +1709,442 @@ private:
   uint8_t _currentChannel;
   uint8_t _leaderMac[6];
   bool _leaderMacSet = false;
+  uint32_t _leaderEpoch = 0;
+  uint8_t _leaderShard = 0; ///< From the bound Leader's beacons
   unsigned long _lastMessageTime;
+
+  // --- Channel Sharding ---
+  bool _shardMoving = false; ///< Unbound, waiting for the target's beacon
+  uint8_t _shardTarget = 0;
+  uint8_t _shardFromChannel = 0;
+  unsigned long _shardMoveAt = 0;
+
+  /**
+   * @brief Leaves the bound Leader for another shard's channel.
+   */
+  void _startShardMove(const LeaderShardFrame &move);
+
+  /**
+   * @brief Returns to the previous channel if the target never showed up.
+   */
+  void _serviceShardMove();
   OSCReceiveCallback _userCallback = nullptr;
 
+  // --- Multi-hop Relay ---
+  static const unsigned long ROUTE_TIMEOUT = 3000;
+  static constexpr uint8_t RELAY_UPSTREAM_TTL = 4;
+  bool _relayEnabled = false;
+  uint16_t _relaySeq = 0;
+  uint8_t _ownMac[6];
+  uint8_t _uplinkMac[6];
+  uint8_t _uplinkHops = 0; ///< 0 = Leader heard directly
+  unsigned long _lastDirectLeader = 0;
+  unsigned long _lastUplinkTime = 0;
+  FrameDedupCache _relayDedup;
+  uint32_t _relayedCount = 0;
+  uint32_t _relayDuplicates = 0;
+  uint8_t _relayQueuePeak = 0;
+
+  // --- Fragmentation ---
+  FrameReassembler _reassembler;
+  uint16_t _fragmentSeq = 0;
+
+  // --- In-place Transmit Slot ---
+  uint8_t *_txSlot; ///< TX_HEADROOM, then the message
+  uint16_t _txMessage;
+  OSCFrame _txFrame;
+
+  // --- Power Save ---
+  uint16_t _psInterval = 0; ///< 0 = radio always on
+  uint16_t _psWindow = 0;
+  bool _psListening = true;
+  unsigned long _psLastWake = 0;    ///< millis() of the last check-in
+  unsigned long _psWindowStart = 0; ///< micros()
+  unsigned long _psLastTick = 0;    ///< micros() of the last accounting step
+  uint64_t _psTotalUs = 0;
+  uint64_t _psAwakeUs = 0;
+
+  /**
+   * @brief Opens and closes wake windows and keeps the awake-time account.
+   */
+  void _servicePowerSave();
+
+  /**
+   * @brief Sends a CTRL_WAKE check-in announcing the current schedule.
+   */
+  void _sendWake();
+
+  // --- Follower-to-Follower Messaging ---
+  static constexpr uint8_t PEER_SLOTS = 6; ///< ESP-NOW peers used for peers
+  static const unsigned long PEER_REFRESH = 5000;
+  static const unsigned long PEER_RETRY = 250; ///< Early refresh rate limit
+  static const unsigned long PEER_TIMEOUT = 15000;
+  PeerRecord *_peers;
+  uint8_t _maxPeers; ///< 0 = peering compiled out
+  uint8_t _peerCount = 0;
+  uint8_t _peerSlotsUsed = 0;
+  bool _peeringEnabled = false;
+  bool _peerMirror = false;
+  uint32_t _peerGroups = 0;
+  uint32_t _peerWanted = 0; ///< Unknown ID a send asked for, gets room first
+  unsigned long _lastPeerAnnounce = 0;
+
+  /**
+   * @brief Repeats the announcement and forgets peers no longer listed.
+   */
+  void _servicePeers();
+
+  /**
+   * @brief Sends PEER_ANNOUNCE (ID and groups) to the Leader.
+   */
+  void _sendPeerAnnounce();
+
+  /**
+   * @brief Merges one PEER_TABLE chunk from the Leader.
+   */
+  void _mergePeerTable(const uint8_t *data, int len);
+
+  int _findPeer(const uint8_t *mac) const;
+  bool _sendToPeer(PeerRecord &peer, const uint8_t *data, int len);
+  void _dropPeer(uint8_t index);
+
+  /**
+   * @brief Sends a PEER_MIRROR copy of a direct send to the Leader.
+   */
+  void _mirrorToLeader(uint32_t nodeID, uint32_t groups, const uint8_t *data,
+                       int len);
+
+  // --- Slot Scheduling ---
+  static const unsigned long SLOT_REQUEST_SPREAD = 1000000; ///< Max, us
+  bool _slotted = false; ///< Holding a slot in the Leader's current plan
+  bool _slotRequestDue = false;
+  uint8_t _slotPlan = 0;
+  uint8_t _slotFlags = 0;
+  uint16_t _slot = 0;
+  uint16_t _slotCount = 0; ///< 0 = the Leader is not slotting
+  uint32_t _slotUs = 0;
+  uint32_t _leaderClockOffset = 0; ///< Leader micros() minus ours
+  unsigned long _slotRequestAt = 0; ///< micros()
+  unsigned long _nextBeatUs = 0;    ///< micros() of the next slotted beat
+  unsigned long _rxStamp = 0; ///< micros() at reception of the current frame
+
+  /**
+   * @brief Follows the Leader's slot plan and picks up this node's slot.
+   */
+  void _handleSlotFrame(const uint8_t *data, int len);
+
+  /**
+   * @brief Aligns the next heartbeat with this node's slot in Leader time.
+   */
+  void _scheduleSlottedBeat();
+
+  /**
+   * @brief True if a heartbeat is due, by slot or by plain interval.
+   */
+  bool _heartbeatDue();
+
+  /**
+   * @brief True while Leader time is inside this node's TDMA slot.
+   */
+  bool _inSlot() const;
+
+  // --- Sensor Streams ---
+  static constexpr uint32_t FRAME_OVERHEAD_US = 100; ///< Preamble, header, ACK
+  SensorStream *_streams;
+  uint8_t _maxStreams;
+  uint8_t _streamCount = 0;
+  uint8_t _streamCursor = 0; ///< Round-robin start, so no stream starves
+  esp_timer_handle_t _streamTimer = nullptr;
+  uint32_t _streamTickUs = 0;
+  uint32_t _streamSent = 0;
+  uint32_t _streamSuppressed = 0;
+  uint32_t _streamDeferred = 0;
+
+  // Airtime token bucket, in microseconds of air; may go negative
+  uint32_t _airtimeRate = 0;
+  int32_t _airtimeBurst = 0;
+  int32_t _airtimeTokens = 0;
+  uint32_t _airtimeRefilled = 0;
+
+  int _addStream(const char *address, StreamSource source,
+                 StreamIntSource intSource, float minRate, float maxRate,
+                 float deadband);
+  static void _staticStreamTick(void *arg);
+
+  /**
+   * @brief Timer context: takes a sample from every stream that is due.
+   */
+  void _sampleStreams();
+
+  /**
+   * @brief Loop context: sends the samples worth sending, within budget.
+   */
+  void _serviceStreams();
+
+  void _refillAirtime();
+  void _chargeAirtime(int len) {
+    if (_airtimeRate)
+      _airtimeTokens -= FRAME_OVERHEAD_US + 8 * len;
+    if (_psInterval && !_psListening)
+      _psAwakeUs += FRAME_OVERHEAD_US + 8 * len; // Woken just to transmit
+  }
+
+  // --- Reliable Delivery ---
+  static constexpr uint8_t RELIABLE_SAMPLES = 32;
+  ReliableSlot *_reliable;
+  uint8_t _reliableSlots; ///< 0 = the lane to the Leader is compiled out
+  /// Acks wait a random moment, so a broadcast is not answered by every
+  /// node in the same instant
+  struct PendingAck {
+    unsigned long dueAt;
+    uint16_t seq;
+    uint8_t attempt;
+    bool pending;
+  };
+  PendingAck _reliableAcks[LEADER_RELIABLE_SLOTS] = {};
+  AddressPatternSet _reliablePatterns;
+  SequenceWindow _reliableSeen = {}; ///< The Leader's messages passed on
+  uint16_t _reliableSeq = 0;
+  uint32_t _reliableSent = 0;
+  uint32_t _reliableRetransmits = 0;
+  uint32_t _reliableFailed = 0;
+  LatencySamples<RELIABLE_SAMPLES> _reliableLatency;
+  ReliableTimeout _reliableTimeout;
+
+  /**
+   * @brief send() without the reliable lane, as used by sensor streams.
+   */
+  void _sendMessage(const uint8_t *data, int len);
+
+  /**
+   * @brief Sends a message on the reliable lane.
+   * @return False if it is too long for the lane.
+   */
+  bool _sendReliable(const uint8_t *data, int len);
+
+  /**
+   * @brief Acknowledges downstream reliable data and consumes the Leader's
+   * acknowledgements.
+   * @return True if data holds a first copy, unwrapped, to pass on.
+   */
+  bool _handleReliableFrame(const uint8_t *src, const uint8_t *&data,
+                            int &len);
+
+  /**
+   * @brief Answers a reliable message from the Leader.
+   */
+  void _sendReliableAck(uint16_t seq, uint8_t attempt);
+
+  /**
+   * @brief Sends acks that are due and repeats unacknowledged messages
+   * whose backoff ran out.
+   */
+  void _serviceReliable();
+
+  // --- Compact Encoding ---
+  static const unsigned long COMPACT_ANNOUNCE_MS = 1000; ///< Until answered
+  CompactSlot *_compact;
+  uint8_t _compactSchemas;
+  uint8_t _compactCount = 0;
+  uint32_t _compactSent = 0;
+  uint32_t _compactSaved = 0;
+
+  /**
+   * @brief Sends a message in compact form if the Leader took its layout.
+   * @return False if it goes as standard OSC.
+   */
+  bool _sendCompact(const uint8_t *data, int len);
+
+  /**
+   * @brief Announces one layout to the Leader.
+   */
+  void _announceCompact(uint8_t index);
+
+  /**
+   * @brief Acts on the Leader's answer about a layout.
+   */
+  void _handleCompactReply(const uint8_t *data, int len);
+
+  /**
+   * @brief Repeats announcements the Leader has not answered.
+   */
+  void _serviceCompact();
+
+  // --- Payload Negotiation ---
+  uint16_t _leaderPayload = LEADER_V1_PAYLOAD; ///< Until the Leader announces
+
+  /**
+   * @brief Announces this node's frame limit to the Leader.
+   */
+  void _sendCaps();
+
   // Heartbeat memory variables
   uint32_t _nodeID;
   uint32_t _heartbeatInterval = 0;
   unsigned long _lastHeartbeatTime = 0;
   bool _heartbeatEnabled = false;
 
-  // SLIP USB Variables for Tethered Mode
+  // SLIP USB Variables for Tethered Mode (null when compiled out)
   bool _usbEnabled = false;
-  uint8_t _serialRxBuf[250];
-  int _serialRxLen = 0;
-  bool _serialEscaping = false;
+  HostOutput *_usbOut;
+  HostInput *_usbIn;
 
   // --- Thread-safe receive queue ---
-  static constexpr uint8_t RX_QUEUE_SIZE = 8;
-  struct RxPacket {
-    uint8_t data[250];
-    uint8_t mac[6];
-    int len;
-  };
   volatile uint8_t _rxHead = 0;
   volatile uint8_t _rxTail = 0;
-  RxPacket _rxQueue[RX_QUEUE_SIZE];
+  RxPacket *_rxQueue;
+  uint8_t _rxQueueSize;
+  uint16_t _rxPayload; ///< Largest frame accepted and announced
 
   void _handleSerial();
   void _sendSlipToUSB(const uint8_t *data, int len);
+
+  /**
+   * @brief Registers a Leader as the ESP-NOW peer for outgoing traffic,
+   * replacing any previously bound Leader.
+   */
+  void _bindLeader(const uint8_t *mac);
+
+  /**
+   * @brief Applies a channel migration for this node and its Leader peer.
+   */
+  void _switchChannel(uint8_t channel);
+
+  /**
+   * @brief Handles LEADER control frames (hop, beacon, caps, peers, slots).
+   */
+  void _handleControlFrame(const uint8_t *mac, const uint8_t *data, int len);
+
+  /**
+   * @brief Unwraps a relay envelope, learning routes, suppressing duplicates
+   * and forwarding it onwards when acting as a relay.
+   *
+   * @param pkt Queued packet holding the envelope.
+   * @param[out] src Origin MAC of the wrapped frame.
+   * @param[out] data Wrapped frame.
+   * @param[out] len Length of the wrapped frame.
+   * @return True if the wrapped frame must be processed locally.
+   */
+  bool _handleRelayFrame(RxPacket &pkt, const uint8_t *&src,
+                         const uint8_t *&data, int &len);
+
+  /**
+   * @brief Re-sends a queued envelope one hop further, in place.
+   */
+  void _relayForward(RxPacket &pkt, const uint8_t *dest);
+
+  /**
+   * @brief Sends a frame towards the Leader through the learned uplink relay.
+   */
+  void _sendUpstream(const uint8_t *data, int len);
+
+  /**
+   * @brief Fills an upstream relay envelope header for this node.
+   */
+  void _writeUpstreamHeader(LeaderRelayHeader &header);
+
+  /**
+   * @brief Sends one radio frame to the Leader, directly or via the uplink.
+   */
+  void _sendFrame(const uint8_t *data, int len);
+
+  /**
+   * @brief Adopts a relay as the next hop towards the Leader.
+   */
+  void _setUplink(const uint8_t *mac, uint8_t hops);
 };
 
+// ==========================================
+// Configured Instances
+// ==========================================
+
+/**
+ * @brief Buffers of a BasicOSCLeader, sized by its LeaderConfig.
+ */
+template <class Config> struct LeaderStorage {
+  static constexpr uint16_t nodeHashSize = leaderNodeHashSize(Config::maxNodes);
+  static constexpr uint8_t rxFlows =
+      leaderRxFlows(Config::maxNodes, Config::rxQueue);
+  static_assert(rxFlows < 0xFF, "flow 0xFF marks a processed frame");
+  LeaderNodeRecord nodes[Config::maxNodes ? Config::maxNodes : 1];
+  uint8_t nodeHash[nodeHashSize] = {};
+  LeaderRxPacket rxQueue[Config::rxQueue];
+  uint8_t rxData[Config::rxQueue][Config::payload];
+  LeaderRxFlow flows[rxFlows] = {};
+  LeaderHeldFrame held[Config::holdSlots ? Config::holdSlots : 1] = {};
+  LeaderSlotOwner slotOwners[Config::maxSlots ? Config::maxSlots : 1] = {};
+  LeaderCompactEntry compact[Config::compactTable ? Config::compactTable : 1];
+  LeaderReassemblySlot uploads[Config::uploadSlots] = {};
+};
+
+/**
+ * @brief Tethered USB link of a BasicOSCFollower, if built in.
+ */
+template <bool Enabled> struct FollowerUsbStorage {
+  HostOutput out;
+  HostInput in;
+  HostOutput *output() { return &out; }
+  HostInput *input() { return &in; }
+};
+
+template <> struct FollowerUsbStorage<false> {
+  HostOutput *output() { return nullptr; }
+  HostInput *input() { return nullptr; }
+};
+
+/**
+ * @brief Buffers of a BasicOSCFollower, sized by its LeaderConfig.
+ */
+template <class Config> struct FollowerStorage {
+  LeaderRxPacket rxQueue[Config::rxQueue];
+  uint8_t rxData[Config::rxQueue][Config::payload];
+  FollowerUsbStorage<(Config::features & FEATURE_USB) != 0> usb;
+  alignas(4) uint8_t txSlot[OSCFollowerCore::TX_HEADROOM + Config::message];
+  LeaderSlots<LeaderReassemblySlot, Config::reassemblySlots> reassembly;
+  LeaderSlots<FollowerPeerRecord, Config::peers> peers;
+  LeaderSlots<FollowerSensorStream, Config::streams> streams;
+  LeaderSlots<FollowerReliableSlot, Config::reliableSlots> reliable;
+  LeaderSlots<FollowerCompactSlot, Config::compactSchemas> compact;
+};
+
+/**
+ * @brief OSCLeaderCore with buffers sized at compile time.
+ *
+ * The storage base comes first, so it is constructed before the logic that
+ * points into it.
+ */
+template <class Config = LeaderDefaultConfig>
+class BasicOSCLeader : private LeaderStorage<Config>, public OSCLeaderCore {
+public:
+  BasicOSCLeader()
+      : OSCLeaderCore(this->nodes, Config::maxNodes, this->nodeHash,
+                      LeaderStorage<Config>::nodeHashSize, this->rxQueue,
+                      Config::rxQueue, this->rxData[0], Config::payload,
+                      this->flows, LeaderStorage<Config>::rxFlows,
+                      this->held, Config::holdSlots, this->slotOwners,
+                      Config::maxSlots, this->compact, Config::compactTable,
+                      this->uploads, Config::uploadSlots) {}
+};
+
+/**
+ * @brief OSCFollowerCore with buffers sized at compile time.
+ */
+template <class Config = LeaderDefaultConfig>
+class BasicOSCFollower : private FollowerStorage<Config>,
+                         public OSCFollowerCore {
+public:
+  BasicOSCFollower()
+      : OSCFollowerCore(this->rxQueue, Config::rxQueue, this->rxData[0],
+                        Config::payload, this->usb.output(),
+                        this->usb.input(), this->txSlot, Config::message,
+                        this->reassembly.get(), Config::reassemblySlots,
+                        this->peers.get(), Config::peers,
+                        this->streams.get(), Config::streams,
+                        this->reliable.get(), Config::reliableSlots,
+                        this->compact.get(), Config::compactSchemas) {}
+};
+
+using OSCLeader = BasicOSCLeader<>;
+using OSCFollower = BasicOSCFollower<>;
+
 #endif
\ No newline at end of file
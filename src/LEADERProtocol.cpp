@@ -0,0 +1,80 @@
+#include "LEADERProtocol.h"
+#include <Arduino.h>
+
+// ==========================================
+// FRAGMENT REASSEMBLY
+// ==========================================
+
+int FrameReassembler::add(const uint8_t *src, const uint8_t *frame, int len,
+                          const uint8_t *&message) {
+  if (_slotCount == 0 || len <= (int)sizeof(LeaderFragmentHeader))
+    return 0; // Without slots (FEATURE_FRAGMENTS), fragments are dropped
+
+  LeaderFragmentHeader header;
+  memcpy(&header, frame, sizeof(header));
+  const uint8_t *chunk = frame + sizeof(header);
+  int size = len - sizeof(header);
+
+  // Reject anything that would not fit a bounded slot
+  if (header.count == 0 || header.count > FRAGMENT_MAX_COUNT ||
+      header.index >= header.count ||
+      header.offset + size > LEADER_MAX_MESSAGE)
+    return 0;
+
+  unsigned long currentMillis = millis();
+  Slot *slot = nullptr;
+  Slot *freeSlot = nullptr;
+  Slot *oldest = nullptr;
+
+  for (uint8_t i = 0; i < _slotCount; i++) {
+    Slot &s = _slots[i];
+    if (s.used && currentMillis - s.started > LEADER_REASSEMBLY_TIMEOUT) {
+      s.used = false; // Expired: a fragment never made it
+      timeouts++;
+    }
+    if (!s.used) {
+      if (!freeSlot)
+        freeSlot = &s;
+      continue;
+    }
+    if (s.msgId == header.msgId && memcmp(s.src, src, 6) == 0) {
+      slot = &s;
+      break;
+    }
+    if (!oldest || s.started < oldest->started)
+      oldest = &s;
+  }
+
+  if (!slot) {
+    if (freeSlot) {
+      slot = freeSlot;
+    } else {
+      slot = oldest;
+      evictions++;
+    }
+    memcpy(slot->src, src, 6);
+    slot->msgId = header.msgId;
+    slot->count = header.count;
+    slot->received = 0;
+    slot->length = 0;
+    slot->started = currentMillis;
+    slot->used = true;
+  }
+
+  if (header.count != slot->count)
+    return 0; // Inconsistent sender, ignore the stray fragment
+
+  memcpy(slot->data + header.offset, chunk, size);
+  slot->received |= 1UL << header.index;
+  if (header.index == header.count - 1)
+    slot->length = header.offset + size;
+
+  uint32_t complete =
+      slot->count == 32 ? 0xFFFFFFFFUL : (1UL << slot->count) - 1;
+  if (slot->received != complete || slot->length == 0)
+    return 0;
+
+  slot->used = false; // Data stays valid until the slot is reused
+  message = slot->data;
+  return slot->length;
+}
@@ -0,0 +1,738 @@
+#ifndef LEADER_PROTOCOL_H
+#define LEADER_PROTOCOL_H
+
+#include <esp_now.h>
+#include <stdint.h>
+#include <string.h>
+
+// ==========================================
+// Message Size Limits
+// ==========================================
+
+/// Payload every ESP-NOW v1 peer accepts.
+#define LEADER_V1_PAYLOAD 250
+
+#ifndef LEADER_MAX_PAYLOAD
+#if defined(ESP_NOW_MAX_DATA_LEN_V2)
+/// Largest radio frame this build can send or receive. ESP-IDF releases with
+/// ESP-NOW v2 raise it to ~1470 bytes; the Leader and Followers negotiate the
+/// size actually used so v1 peers keep working.
+#define LEADER_MAX_PAYLOAD ESP_NOW_MAX_DATA_LEN_V2
+#else
+#define LEADER_MAX_PAYLOAD LEADER_V1_PAYLOAD
+#endif
+#endif
+
+#ifndef LEADER_MAX_MESSAGE
+/// Largest OSC message carried end to end. Anything above one radio frame is
+/// fragmented on send and reassembled on receive.
+#if LEADER_MAX_PAYLOAD > 1024
+#define LEADER_MAX_MESSAGE 2048
+#else
+#define LEADER_MAX_MESSAGE 1024
+#endif
+#endif
+
+#ifndef LEADER_REASSEMBLY_SLOTS
+/// Fragmented messages a Follower may have in flight at once.
+#define LEADER_REASSEMBLY_SLOTS 2
+#endif
+
+#ifndef LEADER_UPLOAD_SLOTS
+/// Fragmented messages a Leader reassembles at once, all nodes shared; never
+/// more than its registry has nodes.
+#define LEADER_UPLOAD_SLOTS 8
+#endif
+
+#ifndef LEADER_REASSEMBLY_TIMEOUT
+/// Milliseconds before an incomplete message is discarded.
+#define LEADER_REASSEMBLY_TIMEOUT 250
+#endif
+
+// ==========================================
+// Reliable Delivery Limits
+// ==========================================
+
+#ifndef LEADER_RELIABLE_SLOTS
+/// Reliable messages a sender may have awaiting acknowledgement (1-8).
+#define LEADER_RELIABLE_SLOTS 4
+#endif
+
+#ifndef LEADER_RELIABLE_MESSAGE
+/// Largest message sent on the reliable lane; longer ones go best-effort.
+#define LEADER_RELIABLE_MESSAGE 128
+#endif
+
+#ifndef LEADER_RELIABLE_RETRIES
+/// Repeats of an unacknowledged message before it is given up.
+#define LEADER_RELIABLE_RETRIES 5
+#endif
+
+#ifndef LEADER_RELIABLE_BACKOFF
+/// Shortest wait before the first repeat, in milliseconds; a slow channel
+/// stretches it (see ReliableTimeout), and each further repeat waits twice
+/// as long.
+#define LEADER_RELIABLE_BACKOFF 4
+#endif
+
+#ifndef LEADER_RELIABLE_PATTERNS
+/// Address patterns each side can mark reliable.
+#define LEADER_RELIABLE_PATTERNS 4
+#endif
+
+// ==========================================
+// Compact Encoding Limits
+// ==========================================
+
+#ifndef LEADER_COMPACT_SCHEMAS
+/// Compact layouts one Follower can send (OSCFollower::addCompact)
+#define LEADER_COMPACT_SCHEMAS 4
+#endif
+
+#ifndef LEADER_COMPACT_TABLE
+/// Compact layouts a Leader can expand, all nodes shared
+#define LEADER_COMPACT_TABLE 16
+#endif
+
+#ifndef LEADER_COMPACT_KEY_INTERVAL
+/// Frames between full keys when deltas are on; a lost frame costs the
+/// deltas after it up to the next key
+#define LEADER_COMPACT_KEY_INTERVAL 8
+#endif
+
+// ==========================================
+// Radio Control Frames
+// ==========================================
+
+/**
+ * Every LEADER-internal radio frame opens with LEADER_CTRL_MAGIC followed by
+ * an opcode. 0xFE can never start an OSC message ('/') or bundle ('#'), so
+ * control traffic is told apart from user payloads with a single byte
+ * compare. The legacy channel hop command (0xFE 0xFE 0xFE [CHANNEL]) keeps
+ * its original layout and occupies opcode 0xFE.
+ */
+static constexpr uint8_t LEADER_CTRL_MAGIC = 0xFE;
+
+enum LeaderCtrlOp : uint8_t {
+  CTRL_BEACON = 0x01,    ///< Leader liveness beacon (hot-standby failover)
+  CTRL_DIRECTORY = 0x02, ///< Registry snapshot chunk (standby mirroring)
+  CTRL_RELAY = 0x03,     ///< Multi-hop relay envelope
+  CTRL_FRAGMENT = 0x04,  ///< One piece of an oversized message
+  CTRL_CAPS = 0x05,      ///< Radio capability announcement
+  CTRL_WAKE = 0x06,      ///< Power-save check-in, opens a receive window
+  CTRL_PEERS = 0x07,     ///< Follower-to-Follower discovery and mirroring
+  CTRL_SLOT = 0x08,      ///< Heartbeat phase and TDMA slot scheduling
+  CTRL_SHARD = 0x09,     ///< Moves a Follower to another shard's Leader
+  CTRL_RELIABLE = 0x0A,  ///< Acknowledged message and its acknowledgement
+  CTRL_COMPACT = 0x0B,   ///< Quantized message or layout negotiation
+  CTRL_HOP = 0xFE,       ///< Legacy channel hop command
+};
+
+/**
+ * @brief Leader liveness beacon, broadcast every beacon interval while
+ * failover or sharding is enabled.
+ *
+ * Followers re-bind to any Leader of their shard announcing a higher epoch,
+ * and ignore the beacons of other shards. holdMs lets the primary announce
+ * a deliberate silence (e.g. a channel scan) so the standby does not mistake
+ * it for a failure.
+ */
+struct __attribute__((packed)) LeaderBeaconFrame {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_BEACON
+  uint8_t channel; ///< Channel the Leader is currently serving
+  uint8_t flags;   ///< Low nibble: shard number (0 = unsharded)
+  uint32_t epoch;  ///< Leadership term, bumped on every takeover
+  uint16_t holdMs; ///< Announced silence before the next beacon (0 = none)
+};
+
+static constexpr uint8_t BEACON_SHARD_MASK = 0x0F;
+
+/**
+ * @brief One registry entry inside a CTRL_DIRECTORY frame.
+ */
+struct __attribute__((packed)) LeaderDirectoryEntry {
+  uint8_t mac[6];
+  uint32_t nodeID;
+};
+
+/**
+ * @brief Header of a registry snapshot chunk. Followed by `count` entries.
+ */
+struct __attribute__((packed)) LeaderDirectoryHeader {
+  uint8_t magic; ///< LEADER_CTRL_MAGIC
+  uint8_t op;    ///< CTRL_DIRECTORY
+  uint8_t first; ///< Index of the first entry in the full registry
+  uint8_t count; ///< Entries carried by this chunk
+  uint8_t total; ///< Entries in the full registry
+};
+
+/**
+ * @brief Envelope wrapping any frame that may travel over relay Followers.
+ *
+ * Downstream envelopes are broadcast by the Leader and re-broadcast by relays
+ * while ttl lasts. Upstream envelopes are unicast hop by hop towards the
+ * Leader. (origin, seq) identifies a frame for duplicate suppression.
+ */
+struct __attribute__((packed)) LeaderRelayHeader {
+  uint8_t magic;     ///< LEADER_CTRL_MAGIC
+  uint8_t op;        ///< CTRL_RELAY
+  uint8_t flags;     ///< RELAY_UPSTREAM for Follower to Leader traffic
+  uint8_t ttl;       ///< Hops this frame may still take
+  uint8_t hops;      ///< Relays traversed so far
+  uint8_t origin[6]; ///< MAC of the node that created the frame
+  uint16_t seq;      ///< Per-origin sequence number
+  uint16_t delay;    ///< Accumulated relay residence time, 10 us units
+};
+
+static constexpr uint8_t RELAY_UPSTREAM = 0x01;
+
+/**
+ * @brief Small LRU of recently seen (origin, seq) pairs.
+ *
+ * Used by relays and the Leader to drop the duplicate copies that flooding
+ * inevitably produces. Linear scan: the cache is small enough that this
+ * beats any hashing on an ESP32.
+ */
+class FrameDedupCache {
+public:
+  /**
+   * @brief Records a frame identity.
+   * @return True if the frame was already seen recently (a duplicate).
+   */
+  bool seen(const uint8_t *origin, uint16_t seq) {
+    uint8_t oldest = 0;
+    for (uint8_t i = 0; i < SIZE; i++) {
+      Entry &e = _entries[i];
+      if (e.used && e.seq == seq && memcmp(e.origin, origin, 6) == 0) {
+        e.stamp = ++_clock;
+        return true;
+      }
+      if (!e.used || e.stamp < _entries[oldest].stamp)
+        oldest = i;
+      if (!e.used)
+        break;
+    }
+
+    Entry &slot = _entries[oldest];
+    memcpy(slot.origin, origin, 6);
+    slot.seq = seq;
+    slot.stamp = ++_clock;
+    slot.used = true;
+    return false;
+  }
+
+private:
+  static constexpr uint8_t SIZE = 16;
+  struct Entry {
+    uint8_t origin[6];
+    uint16_t seq;
+    uint32_t stamp;
+    bool used;
+  };
+  Entry _entries[SIZE] = {};
+  uint32_t _clock = 0;
+};
+
+/**
+ * @brief Capability announcement used to negotiate large ESP-NOW v2 frames.
+ *
+ * Followers unicast theirs to the Leader when they bind and whenever the
+ * Leader asks (CAPS_QUERY). The Leader broadcasts its own with CAPS_QUERY set
+ * when it hears a node it has no capabilities for. Peers that never announce
+ * are treated as ESP-NOW v1 (250 bytes).
+ */
+struct __attribute__((packed)) LeaderCapsFrame {
+  uint8_t magic;       ///< LEADER_CTRL_MAGIC
+  uint8_t op;          ///< CTRL_CAPS
+  uint8_t version;     ///< LEADER_PROTOCOL_VERSION of the sender
+  uint8_t flags;       ///< CAPS_QUERY asks receivers to announce themselves
+  uint16_t maxPayload; ///< Largest frame the sender can receive
+};
+
+static constexpr uint8_t LEADER_PROTOCOL_VERSION = 2;
+static constexpr uint8_t CAPS_QUERY = 0x01;
+
+/**
+ * @brief Check-in of a power-save Follower at the start of a wake window.
+ *
+ * The node listens for windowMs after sending it, then dozes until the next
+ * check-in intervalMs later. The Leader holds unicast traffic for the node
+ * meanwhile and releases it on check-in. intervalMs = 0 leaves power save.
+ */
+struct __attribute__((packed)) LeaderWakeFrame {
+  uint8_t magic;          ///< LEADER_CTRL_MAGIC
+  uint8_t op;             ///< CTRL_WAKE
+  uint16_t intervalMs;    ///< Time between check-ins
+  uint16_t windowMs;      ///< Listening time after this check-in
+  uint16_t awakePermille; ///< Share of time the node's radio was on
+  uint32_t nodeID;        ///< Sender's node ID, as in "/sys/pong"
+};
+
+/**
+ * @brief Header of Follower-to-Follower peering frames.
+ *
+ * Followers that enable peering unicast PEER_ANNOUNCE to the Leader with
+ * their node ID and group mask. The Leader answers by broadcasting
+ * PEER_TABLE chunks listing every peering node, so Followers can add each
+ * other as ESP-NOW peers and talk directly. A Follower that mirrors its
+ * direct sends wraps a copy in PEER_MIRROR, addressed to the Leader and
+ * followed by the original message.
+ */
+struct __attribute__((packed)) LeaderPeerHeader {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_PEERS
+  uint8_t kind;    ///< PEER_ANNOUNCE, PEER_TABLE or PEER_MIRROR
+  uint8_t count;   ///< PEER_TABLE: entries that follow
+  uint32_t id;     ///< ANNOUNCE: sender's ID. MIRROR: destination (0 = group)
+  uint32_t groups; ///< ANNOUNCE: sender's groups. MIRROR: destination group
+};
+
+/**
+ * @brief One peering node inside a PEER_TABLE chunk.
+ */
+struct __attribute__((packed)) LeaderPeerEntry {
+  uint8_t mac[6];
+  uint32_t nodeID;
+  uint32_t groups; ///< Bit n set = member of group n
+};
+
+static constexpr uint8_t PEER_ANNOUNCE = 0x01;
+static constexpr uint8_t PEER_TABLE = 0x02;
+static constexpr uint8_t PEER_MIRROR = 0x03;
+
+/**
+ * @brief Header of slot scheduling frames.
+ *
+ * The Leader broadcasts SLOT_PLAN about once a second: slotCount slots of
+ * slotUs each, and its own clock. Followers without a slot in the current
+ * plan answer with SLOT_REQUEST; the Leader hands slots out in order and
+ * broadcasts them in batched SLOT_ASSIGN frames (header followed by count
+ * LeaderSlotEntry), so no per-node ESP-NOW peer is needed. Every frame
+ * carries leaderUs, from which Followers keep a Leader-relative clock.
+ * A plan with slotCount 0 turns slotting off.
+ */
+struct __attribute__((packed)) LeaderSlotHeader {
+  uint8_t magic;      ///< LEADER_CTRL_MAGIC
+  uint8_t op;         ///< CTRL_SLOT
+  uint8_t kind;       ///< SLOT_PLAN, SLOT_REQUEST or SLOT_ASSIGN
+  uint8_t flags;      ///< SLOT_TDMA
+  uint8_t plan;       ///< Changes with the plan; older slots are void
+  uint8_t count;      ///< SLOT_ASSIGN: entries that follow
+  uint16_t slotCount; ///< 0 = slotting off
+  uint32_t slotUs;    ///< Width of one slot
+  uint32_t leaderUs;  ///< Sender's micros() (Leader frames only)
+};
+
+/**
+ * @brief One slot handed to one node inside SLOT_ASSIGN.
+ */
+struct __attribute__((packed)) LeaderSlotEntry {
+  uint8_t mac[6];
+  uint16_t slot;
+};
+
+static constexpr uint8_t SLOT_PLAN = 0x01;
+static constexpr uint8_t SLOT_REQUEST = 0x02;
+static constexpr uint8_t SLOT_ASSIGN = 0x03;
+
+/// Streams only send inside their node's slot, once per cycle of slots
+static constexpr uint8_t SLOT_TDMA = 0x01;
+
+/**
+ * @brief Sends a Follower to the Leader of another shard.
+ *
+ * Unicast by the Leader the node is bound to. The node unbinds, moves to
+ * channel and binds to the first beacon tagged with shard. If none arrives
+ * in time, it returns to its previous channel and Leader.
+ */
+struct __attribute__((packed)) LeaderShardFrame {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_SHARD
+  uint8_t channel; ///< Channel of the target shard
+  uint8_t shard;   ///< Target shard number, 1-15
+};
+
+/**
+ * @brief Header of reliable-lane frames.
+ *
+ * RELIABLE_DATA is followed by one OSC message whose address the sender
+ * marked reliable. Receivers answer every copy with a LeaderReliableAck and
+ * pass the message on once per (sender, seq). Senders repeat it, with a
+ * doubling delay, until every addressee acknowledged or the retries run
+ * out. The Leader broadcasts its acknowledgements, so they reach relayed
+ * nodes too, and names the node each one is for. A broadcast message sets
+ * spread so its many acknowledgements do not all contend at once.
+ */
+struct __attribute__((packed)) LeaderReliableHeader {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_RELIABLE
+  uint8_t kind;    ///< RELIABLE_DATA or RELIABLE_ACK
+  uint8_t attempt; ///< 0 = first transmission
+  uint16_t seq;    ///< Per-sender message number
+  uint8_t spread;  ///< Window to answer at random within, 100 us units
+};
+
+/**
+ * @brief Acknowledgement of one RELIABLE_DATA frame.
+ */
+struct __attribute__((packed)) LeaderReliableAck {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_RELIABLE
+  uint8_t kind;    ///< RELIABLE_ACK
+  uint8_t attempt; ///< Copy being answered
+  uint16_t seq;    ///< Message acknowledged
+  uint8_t node[6]; ///< MAC of the data's sender
+};
+
+static constexpr uint8_t RELIABLE_DATA = 0x01;
+static constexpr uint8_t RELIABLE_ACK = 0x02;
+
+static_assert(LEADER_RELIABLE_SLOTS >= 1 && LEADER_RELIABLE_SLOTS <= 8,
+              "pending reliable messages are tracked in one byte per node");
+static_assert(LEADER_RELIABLE_MESSAGE + sizeof(LeaderReliableHeader) +
+                      sizeof(LeaderRelayHeader) <=
+                  LEADER_V1_PAYLOAD,
+              "reliable messages must fit one relayed v1 frame");
+
+/**
+ * @brief Header of compact-encoding frames.
+ *
+ * A Follower announces each layout with COMPACT_SCHEMA, followed by an
+ * OSCCompactSchema description, and sends standard OSC until the Leader
+ * answers COMPACT_ACCEPT. From then on matching messages travel as
+ * COMPACT_KEY (every step) or COMPACT_DELTA (changes against frame seq - 1),
+ * and the Leader expands them before the host sees them. COMPACT_REFUSE
+ * (no room) keeps the layout standard; COMPACT_UNKNOWN, sent for data of a
+ * layout the Leader lost, asks for a new announcement.
+ */
+struct __attribute__((packed)) LeaderCompactHeader {
+  uint8_t magic;  ///< LEADER_CTRL_MAGIC
+  uint8_t op;     ///< CTRL_COMPACT
+  uint8_t kind;   ///< COMPACT_SCHEMA, COMPACT_KEY or COMPACT_DELTA
+  uint8_t schema; ///< Sender's layout number
+  uint8_t seq;    ///< Data frames of this layout, counted
+};
+
+/**
+ * @brief The Leader's answer about one layout of one node.
+ */
+struct __attribute__((packed)) LeaderCompactReply {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_COMPACT
+  uint8_t kind;    ///< COMPACT_ACCEPT, COMPACT_REFUSE or COMPACT_UNKNOWN
+  uint8_t schema;  ///< Layout number
+  uint8_t node[6]; ///< MAC of the node it is for
+};
+
+static constexpr uint8_t COMPACT_SCHEMA = 0x01;
+static constexpr uint8_t COMPACT_KEY = 0x02;
+static constexpr uint8_t COMPACT_DELTA = 0x03;
+static constexpr uint8_t COMPACT_ACCEPT = 0x04;
+static constexpr uint8_t COMPACT_REFUSE = 0x05;
+static constexpr uint8_t COMPACT_UNKNOWN = 0x06;
+
+/**
+ * @brief A few OSC address patterns, matched against outgoing messages.
+ *
+ * A pattern ending in '*' matches every address starting with the rest of
+ * it ("/cue*"); any other pattern matches one address exactly.
+ */
+class AddressPatternSet {
+public:
+  static constexpr uint8_t MAX_LENGTH = 31;
+
+  /**
+   * @brief Adds a pattern; adding one twice has no effect.
+   * @return False if it is too long or the set is full.
+   */
+  bool add(const char *pattern) {
+    size_t len = strlen(pattern);
+    if (len == 0 || len > MAX_LENGTH)
+      return false;
+    for (uint8_t i = 0; i < _count; i++)
+      if (strcmp(_patterns[i], pattern) == 0)
+        return true;
+    if (_count >= LEADER_RELIABLE_PATTERNS)
+      return false;
+    memcpy(_patterns[_count++], pattern, len + 1);
+    return true;
+  }
+
+  void clear() { _count = 0; }
+
+  uint8_t count() const { return _count; }
+
+  /**
+   * @brief Tests the address of an OSC message against every pattern.
+   */
+  bool matches(const uint8_t *data, int len) const {
+    if (_count == 0 || len < 4 || data[0] != '/')
+      return false;
+    for (uint8_t i = 0; i < _count; i++) {
+      const char *p = _patterns[i];
+      size_t n = strlen(p);
+      bool prefix = p[n - 1] == '*';
+      if (prefix)
+        n--;
+      if ((int)n >= len || memcmp(data, p, n) != 0)
+        continue;
+      if (prefix || data[n] == '\0')
+        return true;
+    }
+    return false;
+  }
+
+private:
+  char _patterns[LEADER_RELIABLE_PATTERNS][MAX_LENGTH + 1];
+  uint8_t _count = 0;
+};
+
+/**
+ * @brief The most recent N delivery delays, for percentile reports.
+ */
+template <uint8_t N> class LatencySamples {
+public:
+  void add(uint32_t micros) {
+    _samples[_next] = micros;
+    _next = (_next + 1) % N;
+    if (_count < N)
+      _count++;
+  }
+
+  uint8_t count() const { return _count; }
+
+  /**
+   * @brief Sorts a copy of the samples into sorted (N entries).
+   * @return Number of samples.
+   */
+  uint8_t sort(uint32_t *sorted) const {
+    memcpy(sorted, _samples, _count * sizeof(uint32_t));
+    for (int i = 1; i < _count; i++) {
+      uint32_t v = sorted[i];
+      int j = i - 1;
+      while (j >= 0 && sorted[j] > v) {
+        sorted[j + 1] = sorted[j];
+        j--;
+      }
+      sorted[j + 1] = v;
+    }
+    return _count;
+  }
+
+  /**
+   * @brief One percentile (0-100) of the samples, 0 without any.
+   */
+  uint32_t percentile(uint8_t pct) const {
+    uint32_t sorted[N];
+    uint8_t count = sort(sorted);
+    return count ? sorted[(count - 1) * pct / 100] : 0;
+  }
+
+private:
+  uint32_t _samples[N];
+  uint8_t _count = 0;
+  uint8_t _next = 0;
+};
+
+/**
+ * @brief The 16 most recent sequence numbers of one sender, so repeats are
+ * recognised however much other traffic arrived in between.
+ */
+struct SequenceWindow {
+  uint16_t newest;
+  uint16_t bits; ///< Bit n: newest - n arrived; 0 = nothing yet
+
+  void reset() { bits = 0; }
+
+  /**
+   * @brief Records seq, telling whether it had arrived before.
+   */
+  bool seen(uint16_t seq) {
+    int16_t ahead = (int16_t)(seq - newest);
+    if (bits == 0 || ahead > 0 || ahead <= -16) {
+      // Newer, or so far behind that the sender must have restarted
+      bits = ahead > 0 && ahead < 16 ? (uint16_t)(bits << ahead) | 1 : 1;
+      newest = seq;
+      return false;
+    }
+    uint16_t bit = 1 << -ahead;
+    if (bits & bit)
+      return true;
+    bits |= bit;
+    return false;
+  }
+};
+
+/**
+ * @brief Retransmission timeout of the reliable lane.
+ *
+ * LEADER_RELIABLE_BACKOFF, or twice the smoothed acknowledgement delay once
+ * a busy channel makes that longer, doubled for every repeat. Repeating
+ * faster than acknowledgements can come back would only add to the load
+ * that delays them.
+ */
+class ReliableTimeout {
+public:
+  void sample(uint32_t micros) {
+    if (micros > MAX_US)
+      micros = MAX_US;
+    _smoothed += ((int32_t)micros - (int32_t)_smoothed) / 8;
+  }
+
+  /**
+   * @brief Microseconds to wait for the acknowledgement of a copy.
+   */
+  uint32_t after(uint8_t attempt) const {
+    uint32_t base = 2 * _smoothed;
+    if (base < LEADER_RELIABLE_BACKOFF * 1000UL)
+      base = LEADER_RELIABLE_BACKOFF * 1000UL;
+    return base << attempt;
+  }
+
+private:
+  static constexpr uint32_t MAX_US = 100000;
+  uint32_t _smoothed = 0;
+};
+
+/**
+ * @brief Header of one fragment of a message too large for a single frame.
+ *
+ * Fragments carry their byte offset, so senders may pick any chunk size that
+ * fits their link. A message may be split into at most 32 fragments.
+ */
+struct __attribute__((packed)) LeaderFragmentHeader {
+  uint8_t magic;   ///< LEADER_CTRL_MAGIC
+  uint8_t op;      ///< CTRL_FRAGMENT
+  uint16_t msgId;  ///< Per-sender message number
+  uint8_t index;   ///< Fragment number, 0-based
+  uint8_t count;   ///< Fragments making up the message
+  uint16_t offset; ///< Byte offset of this chunk inside the message
+};
+
+static constexpr uint8_t FRAGMENT_MAX_COUNT = 32;
+
+/**
+ * @brief Splits a message into numbered fragments.
+ *
+ * @param data The complete message.
+ * @param len Length of the message (at most LEADER_MAX_MESSAGE).
+ * @param maxFrame Largest radio frame the sink may emit, header included.
+ * @param msgId Message number shared by every fragment.
+ * @param sink Callable `bool(const uint8_t *frame, int len)` transmitting one
+ * fragment; returning false aborts the message.
+ * @return True if every fragment was handed to the sink.
+ */
+template <typename Sink>
+bool fragmentFrame(const uint8_t *data, int len, int maxFrame, uint16_t msgId,
+                   Sink sink) {
+  uint8_t frame[LEADER_MAX_PAYLOAD];
+  if (maxFrame > (int)sizeof(frame))
+    maxFrame = sizeof(frame);
+
+  int chunk = maxFrame - (int)sizeof(LeaderFragmentHeader);
+  if (chunk <= 0 || len <= 0 || len > LEADER_MAX_MESSAGE)
+    return false;
+  int count = (len + chunk - 1) / chunk;
+  if (count > FRAGMENT_MAX_COUNT)
+    return false;
+
+  LeaderFragmentHeader header;
+  header.magic = LEADER_CTRL_MAGIC;
+  header.op = CTRL_FRAGMENT;
+  header.msgId = msgId;
+  header.count = count;
+
+  for (int i = 0; i < count; i++) {
+    int offset = i * chunk;
+    int size = len - offset < chunk ? len - offset : chunk;
+    header.index = i;
+    header.offset = offset;
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), data + offset, size);
+    if (!sink(frame, (int)sizeof(header) + size))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief One partial message of a FrameReassembler.
+ */
+struct LeaderReassemblySlot {
+  uint8_t src[6];
+  uint16_t msgId;
+  uint8_t count;
+  uint32_t received; ///< Bitmask of fragments already stored
+  int length;        ///< Known once the last fragment arrived, else 0
+  unsigned long started;
+  bool used;
+  uint8_t data[LEADER_MAX_MESSAGE];
+};
+
+/**
+ * @brief Bounded reassembly of fragmented messages.
+ *
+ * Holds as many partial messages as it is given slots, keyed by sender and
+ * message number. Partial messages older than LEADER_REASSEMBLY_TIMEOUT are
+ * dropped; when every slot is busy the oldest one is evicted.
+ */
+class FrameReassembler {
+public:
+  /**
+   * @brief Binds caller-owned, zeroed slots.
+   */
+  FrameReassembler(LeaderReassemblySlot *slots, uint8_t slotCount)
+      : _slots(slots), _slotCount(slotCount) {}
+
+  /**
+   * @brief Feeds one fragment frame.
+   *
+   * @param src MAC of the node that produced the message.
+   * @param frame The fragment, header included.
+   * @param len Length of the fragment frame.
+   * @param[out] message Completed message, valid until the next call.
+   * @return Length of the completed message, or 0 while still incomplete.
+   */
+  int add(const uint8_t *src, const uint8_t *frame, int len,
+          const uint8_t *&message);
+
+  uint32_t timeouts = 0;  ///< Partial messages that expired
+  uint32_t evictions = 0; ///< Partial messages pushed out by newer ones
+
+  uint8_t slotCount() const { return _slotCount; }
+
+private:
+  using Slot = LeaderReassemblySlot;
+  Slot *_slots;
+  uint8_t _slotCount;
+};
+
+/**
+ * @brief Tests whether a raw radio frame is a LEADER control frame.
+ */
+inline bool isLeaderControlFrame(const uint8_t *data, int len) {
+  return len >= 2 && data[0] == LEADER_CTRL_MAGIC;
+}
+
+// ==========================================
+// Traffic Capture
+// ==========================================
+
+/**
+ * @brief Header of one captured frame, followed by its bytes.
+ *
+ * A capture dump ("/sys/capture" blobs) is a plain sequence of these records,
+ * oldest first, in the Leader's byte order (little-endian).
+ */
+struct __attribute__((packed)) LeaderCaptureRecord {
+  uint32_t timeUs; ///< Leader micros() when the frame arrived
+  uint16_t len;    ///< Frame bytes following the header
+  uint8_t dir;     ///< CAPTURE_RADIO or CAPTURE_HOST
+  uint8_t mac[6];  ///< Originating node; zero for host frames
+};
+
+static constexpr uint8_t CAPTURE_RADIO = 0x01; ///< Radio to host
+static constexpr uint8_t CAPTURE_HOST = 0x02;  ///< Host to radio
+
+#endif
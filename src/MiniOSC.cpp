@@ -77,12 +77,15 @@ int MiniOSC::extract(const uint8_t *data, int len, const char *targetAddress,
       memcpy(&rawLen, data + offset, 4);
       int32_t blobLen = swap32(rawLen);
       offset += 4;
-      // Store blob length in 'i' and pointer in 's' (union overlaps, so only
-      // the pointer is preserved). Blob data is NOT null-terminated.
+      // Pointer goes in 's' and byte count in 'len'. Blob data is NOT
+      // null-terminated.
+      if (blobLen < 0 || blobLen > len)
+        break;
       int paddedLen = (blobLen + 3) & ~3;
       if (offset + paddedLen > len)
         break;
       outArray[i].s = (const char *)(data + offset);
+      outArray[i].len = blobLen;
       offset += paddedLen;
     } else if (t == 'T') {
       outArray[i].b = true;
@@ -98,10 +101,19 @@ int MiniOSC::extract(const uint8_t *data, int len, const char *targetAddress,
 
 int MiniOSC::pack(uint8_t *buffer, const char *address, OSCValue *inArray,
                   int argCount) {
-  int offset = 0;
+  return pack(buffer, SIZE_MAX, address, inArray, argCount);
+}
+
+int MiniOSC::pack(uint8_t *buffer, size_t bufferSize, const char *address,
+                  OSCValue *inArray, int argCount) {
+  size_t offset = 0;
+  // Every write below claims its padded size first; offset <= bufferSize
+  auto fits = [&](size_t size) { return size <= bufferSize - offset; };
 
   // 1. Address String compilation
-  int addrLen = strlen(address);
+  size_t addrLen = strlen(address);
+  if (!fits((addrLen + 4) & ~(size_t)3))
+    return 0;
   memcpy(buffer + offset, address, addrLen);
   offset += addrLen;
 
@@ -112,6 +124,8 @@ int MiniOSC::pack(uint8_t *buffer, const char *address, OSCValue *inArray,
   }
 
   // 2. Type Tags String compiling sequentially
+  if (argCount < 0 || !fits(((size_t)argCount + 2 + 3) & ~(size_t)3))
+    return 0;
   buffer[offset++] = ',';
   for (int i = 0; i < argCount; i++) {
     buffer[offset++] = inArray[i].type;
@@ -127,26 +141,294 @@ int MiniOSC::pack(uint8_t *buffer, const char *address, OSCValue *inArray,
   for (int i = 0; i < argCount; i++) {
     char t = inArray[i].type;
     if (t == 'i' || t == 'f') {
+      if (!fits(4))
+        return 0;
       // Shift parameters to network byte order before packing natively
       uint32_t netVal = swap32(inArray[i].i);
       memcpy(buffer + offset, &netVal, 4);
       offset += 4;
     } else if (t == 's') {
-      if (inArray[i].s != nullptr) {
-        int strLen = strlen(inArray[i].s);
+      size_t strLen = inArray[i].s != nullptr ? strlen(inArray[i].s) : 0;
+      if (!fits((strLen + 4) & ~(size_t)3))
+        return 0;
+      if (strLen > 0)
         memcpy(buffer + offset, inArray[i].s, strLen);
-        offset += strLen;
-      }
+      offset += strLen;
       buffer[offset++] = '\0';
       while (offset % 4 != 0) {
         buffer[offset++] = '\0';
       }
     } else if (t == 'b') {
-      // Not fully implemented for pack without length + separate pointer
+      // Big-endian byte count, raw bytes, then zero padding to 4
+      int32_t blobLen = inArray[i].s != nullptr ? inArray[i].len : 0;
+      if (blobLen < 0 || !fits(4 + (((size_t)blobLen + 3) & ~(size_t)3)))
+        return 0;
+      uint32_t netLen = swap32(blobLen);
+      memcpy(buffer + offset, &netLen, 4);
+      offset += 4;
+      if (blobLen > 0) {
+        memcpy(buffer + offset, inArray[i].s, blobLen);
+        offset += blobLen;
+      }
+      while (offset % 4 != 0) {
+        buffer[offset++] = '\0';
+      }
     } else if (t == 'T' || t == 'F' || t == 'N' || t == 'I') {
       // No data payload for true/false/null/impulse types
     }
   }
 
-  return offset;
-}
\ No newline at end of file
+  return (int)offset;
+}
+
+bool OSCFrame::begin(uint8_t *slot, size_t capacity, const char *address,
+                     const char *typeTags) {
+  _data = nullptr;
+  _error = true;
+  if (slot == nullptr || address == nullptr || typeTags == nullptr)
+    return false;
+  if (typeTags[0] == ',')
+    typeTags++;
+
+  size_t addrLen = strlen(address);
+  size_t tagCount = strlen(typeTags);
+  size_t addrPadded = (addrLen + 4) & ~(size_t)3;
+  size_t tagsPadded = (tagCount + 2 + 3) & ~(size_t)3; // ',' and '\0'
+  if (addrPadded + tagsPadded > capacity)
+    return false;
+
+  for (size_t i = 0; i < tagCount; i++) {
+    char t = typeTags[i];
+    if (t != 'i' && t != 'f' && t != 's' && t != 'b' && t != 'T' && t != 'F')
+      return false; // Only types that add*() can fill
+  }
+
+  // Zero the last word of each block first so the padding comes for free
+  memset(slot + addrPadded - 4, 0, 4);
+  memcpy(slot, address, addrLen);
+  memset(slot + addrPadded + tagsPadded - 4, 0, 4);
+  slot[addrPadded] = ',';
+  memcpy(slot + addrPadded + 1, typeTags, tagCount);
+
+  _data = slot;
+  _capacity = capacity;
+  _tagStart = addrPadded + 1;
+  _argStart = addrPadded + tagsPadded;
+  rewind();
+  return true;
+}
+
+// ==========================================
+// COMPACT SCHEMAS
+// ==========================================
+
+namespace {
+
+// Steps are packed most significant bit first, across byte boundaries
+struct BitWriter {
+  uint8_t *out;
+  uint32_t acc = 0;
+  uint8_t held = 0; ///< Bits in acc not yet written, under 8
+
+  void put(uint16_t value, uint8_t width) {
+    acc = (acc << width) | value;
+    held += width;
+    while (held >= 8) {
+      held -= 8;
+      *out++ = (uint8_t)(acc >> held);
+    }
+  }
+
+  /// Writes the last partial byte, its unused bits zero
+  void finish() {
+    if (held)
+      *out++ = (uint8_t)(acc << (8 - held));
+    held = 0;
+  }
+};
+
+struct BitReader {
+  const uint8_t *in;
+  uint32_t acc = 0;
+  uint8_t held = 0;
+
+  uint16_t get(uint8_t width) {
+    while (held < width) {
+      acc = (acc << 8) | *in++;
+      held += 8;
+    }
+    held -= width;
+    return (uint16_t)((acc >> held) & ((1UL << width) - 1));
+  }
+};
+
+} // namespace
+
+bool OSCCompactSchema::set(const char *address, const char *typeTags,
+                           float min, float max, uint8_t bits) {
+  _argc = 0;
+  if (address == nullptr || typeTags == nullptr || address[0] != '/' ||
+      !(max > min) || bits < 4 || bits > 16)
+    return false;
+  if (typeTags[0] == ',')
+    typeTags++;
+
+  size_t addrLen = strlen(address);
+  size_t tagCount = strlen(typeTags);
+  if (addrLen > MAX_ADDRESS || tagCount == 0 || tagCount > MAX_ARGS)
+    return false;
+  for (size_t i = 0; i < tagCount; i++)
+    if (typeTags[i] != 'i' && typeTags[i] != 'f')
+      return false;
+
+  memcpy(_address, address, addrLen + 1);
+  memcpy(_tags, typeTags, tagCount + 1);
+  _min = min;
+  _max = max;
+  _bits = bits;
+  _argc = tagCount;
+  return true;
+}
+
+bool OSCCompactSchema::quantize(const uint8_t *data, int len,
+                                uint16_t *steps) const {
+  if (_argc == 0 || len < 4 || data == nullptr)
+    return false;
+
+  // Address and type tags must match exactly, padding included
+  size_t addrLen = strlen(_address);
+  int offset = (addrLen + 4) & ~3;
+  int tagsPadded = (_argc + 5) & ~3;
+  if (len != offset + tagsPadded + 4 * _argc ||
+      memcmp(data, _address, addrLen + 1) != 0 || data[offset] != ',' ||
+      memcmp(data + offset + 1, _tags, _argc + 1) != 0)
+    return false;
+  offset += tagsPadded;
+
+  float scale = _maxStep() / (_max - _min);
+  for (uint8_t i = 0; i < _argc; i++, offset += 4) {
+    uint32_t raw;
+    memcpy(&raw, data + offset, 4);
+    raw = MiniOSC::swap32(raw);
+    float value;
+    if (_tags[i] == 'i')
+      value = (float)(int32_t)raw;
+    else
+      memcpy(&value, &raw, 4);
+
+    float step = (value - _min) * scale + 0.5f;
+    if (!(step > 0)) // NaN lands on the bottom step
+      steps[i] = 0;
+    else if (step >= _maxStep())
+      steps[i] = _maxStep();
+    else
+      steps[i] = (uint16_t)step;
+  }
+  return true;
+}
+
+int OSCCompactSchema::expand(const uint16_t *steps, uint8_t *buffer) const {
+  OSCValue values[MAX_ARGS];
+  float unit = (_max - _min) / _maxStep();
+  for (uint8_t i = 0; i < _argc; i++) {
+    float value = _min + steps[i] * unit;
+    values[i].type = _tags[i];
+    if (_tags[i] == 'f')
+      values[i].f = value;
+    else
+      values[i].i = value < 0 ? -(int32_t)(0.5f - value)
+                              : (int32_t)(value + 0.5f);
+  }
+  return MiniOSC::pack(buffer, _address, values, _argc);
+}
+
+int OSCCompactSchema::packKey(const uint16_t *steps, uint8_t *out) const {
+  BitWriter writer{out};
+  for (uint8_t i = 0; i < _argc; i++)
+    writer.put(steps[i], _bits);
+  writer.finish();
+  return keyBytes();
+}
+
+int OSCCompactSchema::packDelta(const uint16_t *steps,
+                                const uint16_t *previous, uint8_t *out) const {
+  uint8_t width = _bits / 2;
+  int32_t limit = 1L << (width - 1);
+  for (uint8_t i = 0; i < _argc; i++) {
+    int32_t change = (int32_t)steps[i] - previous[i];
+    if (change < -limit || change >= limit)
+      return -1;
+  }
+  BitWriter writer{out};
+  for (uint8_t i = 0; i < _argc; i++)
+    writer.put((uint16_t)(steps[i] - previous[i]) & ((1U << width) - 1),
+               width);
+  writer.finish();
+  return deltaBytes();
+}
+
+bool OSCCompactSchema::unpackKey(const uint8_t *in, int len,
+                                 uint16_t *steps) const {
+  if (_argc == 0 || len < keyBytes())
+    return false;
+  BitReader reader{in};
+  for (uint8_t i = 0; i < _argc; i++)
+    steps[i] = reader.get(_bits);
+  return true;
+}
+
+bool OSCCompactSchema::unpackDelta(const uint8_t *in, int len,
+                                   uint16_t *steps) const {
+  if (_argc == 0 || len < deltaBytes())
+    return false;
+
+  uint8_t width = _bits / 2;
+  uint16_t next[MAX_ARGS];
+  BitReader reader{in};
+  for (uint8_t i = 0; i < _argc; i++) {
+    int32_t change = reader.get(width);
+    if (change & (1L << (width - 1)))
+      change -= 1L << width; // Sign-extend
+    int32_t step = steps[i] + change;
+    if (step < 0 || step > _maxStep())
+      return false;
+    next[i] = step;
+  }
+  memcpy(steps, next, _argc * sizeof(uint16_t));
+  return true;
+}
+
+int OSCCompactSchema::describe(uint8_t *out) const {
+  int offset = 0;
+  out[offset++] = _bits;
+  memcpy(out + offset, &_min, 4);
+  offset += 4;
+  memcpy(out + offset, &_max, 4);
+  offset += 4;
+  memcpy(out + offset, _tags, _argc + 1);
+  offset += _argc + 1;
+  size_t addrLen = strlen(_address);
+  memcpy(out + offset, _address, addrLen + 1);
+  return offset + addrLen + 1;
+}
+
+bool OSCCompactSchema::load(const uint8_t *in, int len) {
+  _argc = 0;
+  if (len < 9 + 2 + 2)
+    return false;
+
+  // Both strings must end inside the description
+  const char *tags = (const char *)in + 9;
+  const char *end = (const char *)in + len;
+  const char *address = (const char *)memchr(tags, '\0', end - tags);
+  if (address == nullptr)
+    return false;
+  address++;
+  if (address >= end || memchr(address, '\0', end - address) == nullptr)
+    return false;
+
+  float min, max;
+  memcpy(&min, in + 1, 4);
+  memcpy(&max, in + 5, 4);
+  return set(address, tags, min, max, in[0]);
+}
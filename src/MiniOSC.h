@@ -13,9 +13,10 @@ struct OSCValue {
   union {
     int32_t i;     ///< Integer interpretation of the value
     float f;       ///< Float interpretation of the value
-    const char *s; ///< String interpretation of the value
+    const char *s; ///< String interpretation of the value, or blob bytes
     bool b;        ///< Boolean interpretation (for true/false)
   };
+  int32_t len; ///< Blob length in bytes ('b' only)
 };
 
 /**
@@ -66,10 +67,246 @@ public:
    * @param inArray Array of OSCValue structures containing the arguments to
    * pack.
    * @param argCount The number of arguments provided in the inArray.
-   * @return The total length of the packed OSC message in bytes.
+   * @return The total length of the packed OSC message in bytes, or 0 if a
+   * blob has a negative length.
    */
   static int pack(uint8_t *buffer, const char *address, OSCValue *inArray,
                   int argCount);
+
+  /**
+   * @brief Packs like pack() above, writing at most bufferSize bytes.
+   *
+   * @return The total length of the packed OSC message in bytes, or 0 if it
+   * does not fit or a blob has a negative length.
+   */
+  static int pack(uint8_t *buffer, size_t bufferSize, const char *address,
+                  OSCValue *inArray, int argCount);
+};
+
+/**
+ * @brief Builds one OSC message in place inside a caller-owned, 4-byte aligned
+ * slot.
+ *
+ * The address and type tags are laid out by begin(), so every argument lands
+ * at its final offset as it is added: no intermediate buffer, no per-byte
+ * virtual calls and no padding pass at the end. The type tags are fixed up
+ * front; each add*() must match the next tag ('T' and 'F' both accept
+ * addBool(), which rewrites the tag). A mismatch or overflow marks the frame
+ * invalid instead of writing past the slot.
+ *
+ * @code
+ * OSCFrame &f = node.beginFrame("/imu", "fffi");
+ * f.addFloat(ax).addFloat(ay).addFloat(az).addInt(stamp);
+ * node.commitFrame(f);
+ * @endcode
+ */
+class OSCFrame {
+public:
+  /**
+   * @brief Writes the address and type tags and prepares for arguments.
+   *
+   * @param slot 4-byte aligned storage the message is built in.
+   * @param capacity Size of the slot in bytes.
+   * @param address The OSC address pattern (e.g., "/sensor/imu").
+   * @param typeTags Argument types, with or without the leading ','.
+   * @return False if the header alone does not fit.
+   */
+  bool begin(uint8_t *slot, size_t capacity, const char *address,
+             const char *typeTags);
+
+  OSCFrame &addInt(int32_t value) {
+    if (_claim('i', 4))
+      _put32((uint32_t)value);
+    return *this;
+  }
+
+  OSCFrame &addFloat(float value) {
+    uint32_t raw;
+    memcpy(&raw, &value, 4);
+    if (_claim('f', 4))
+      _put32(raw);
+    return *this;
+  }
+
+  OSCFrame &addString(const char *value) {
+    if (value == nullptr)
+      value = ""; // As MiniOSC::pack() does
+    size_t len = strlen(value);
+    size_t padded = (len + 4) & ~(size_t)3;
+    if (_claim('s', padded))
+      _putPadded(value, len, padded);
+    return *this;
+  }
+
+  OSCFrame &addBlob(const uint8_t *value, int32_t len) {
+    size_t padded = len > 0 ? ((size_t)len + 3) & ~(size_t)3 : 0;
+    if (len >= 0 && _claim('b', 4 + padded)) {
+      _put32((uint32_t)len);
+      _putPadded(value, len, padded);
+    }
+    return *this;
+  }
+
+  OSCFrame &addBool(bool value) {
+    if (_data && !_error && (_data[_tag] == 'T' || _data[_tag] == 'F'))
+      _data[_tag++] = value ? 'T' : 'F';
+    else
+      _error = true;
+    return *this;
+  }
+
+  /**
+   * @brief True once every declared argument was added without error.
+   */
+  bool ready() const { return _data && !_error && _data[_tag] == '\0'; }
+
+  const uint8_t *data() const { return _data; }
+  size_t length() const { return _length; }
+
+  /**
+   * @brief Rewinds to an empty argument list, keeping address and tags.
+   */
+  void rewind() {
+    _length = _argStart;
+    _tag = _tagStart;
+    _error = _data == nullptr;
+  }
+
+private:
+  uint8_t *_data = nullptr;
+  size_t _capacity = 0;
+  size_t _length = 0;
+  size_t _argStart = 0;
+  size_t _tag = 0; ///< Offset of the next unclaimed type tag
+  size_t _tagStart = 0;
+  bool _error = true;
+
+  bool _claim(char type, size_t bytes) {
+    if (_error || !_data || _data[_tag] != type ||
+        bytes > _capacity - _length) {
+      _error = true;
+      return false;
+    }
+    _tag++;
+    return true;
+  }
+
+  void _put32(uint32_t value) {
+    value = __builtin_bswap32(value); // OSC is big-endian
+    memcpy(_data + _length, &value, 4);
+    _length += 4;
+  }
+
+  void _putPadded(const void *src, size_t len, size_t padded) {
+    if (padded)
+      memset(_data + _length + padded - 4, 0, 4);
+    if (len)
+      memcpy(_data + _length, src, len); // An empty blob may have no bytes
+    _length += padded;
+  }
+};
+
+/**
+ * @brief Quantized layout of one OSC address, for compact radio frames.
+ *
+ * Describes messages with a fixed address and a fixed run of 'i' and 'f'
+ * arguments, all within [min, max]. Each argument travels as a bits-wide
+ * step of that range, packed back to back (a key), or as a signed change
+ * of half that width against the previous message (a delta). Sender and
+ * receiver hold the same schema, so both see the same quantized values;
+ * expand() turns them back into a standard OSC message.
+ *
+ * @code
+ * OSCCompactSchema accel;
+ * accel.set("/imu/accel", "fff", -16, 16, 12); // 5 bytes instead of 32
+ * @endcode
+ */
+class OSCCompactSchema {
+public:
+  static constexpr uint8_t MAX_ARGS = 16;
+  static constexpr uint8_t MAX_ADDRESS = 31;
+  /// Largest description written by describe()
+  static constexpr int MAX_DESCRIPTION = 9 + MAX_ARGS + 1 + MAX_ADDRESS + 1;
+  /// Largest message written by expand()
+  static constexpr int MAX_MESSAGE =
+      ((MAX_ADDRESS + 4) & ~3) + ((MAX_ARGS + 5) & ~3) + 4 * MAX_ARGS;
+
+  /**
+   * @brief Sets the layout.
+   *
+   * @param address The OSC address the schema applies to.
+   * @param typeTags One 'i' or 'f' per argument, with or without ','.
+   * @param min Lowest value carried; anything lower is clamped.
+   * @param max Highest value carried; anything higher is clamped.
+   * @param bits Width of each step, 4 to 16.
+   * @return False (and the schema left empty) if any of them is unusable.
+   */
+  bool set(const char *address, const char *typeTags, float min, float max,
+           uint8_t bits);
+
+  bool valid() const { return _argc > 0; }
+  const char *address() const { return _address; }
+  uint8_t argCount() const { return _argc; }
+
+  /// Bytes of packed steps in a key, and in a delta
+  int keyBytes() const { return (_argc * _bits + 7) / 8; }
+  int deltaBytes() const { return (_argc * (_bits / 2) + 7) / 8; }
+
+  /**
+   * @brief Quantizes a message of this layout into one step per argument.
+   * @return False if the address or type tags differ.
+   */
+  bool quantize(const uint8_t *data, int len, uint16_t *steps) const;
+
+  /**
+   * @brief Writes the standard OSC message the steps stand for.
+   * @return Its length, at most MAX_MESSAGE.
+   */
+  int expand(const uint16_t *steps, uint8_t *buffer) const;
+
+  /**
+   * @brief Packs the steps into keyBytes().
+   */
+  int packKey(const uint16_t *steps, uint8_t *out) const;
+
+  /**
+   * @brief Packs the changes from previous into deltaBytes().
+   * @return -1 if a change does not fit half the step width.
+   */
+  int packDelta(const uint16_t *steps, const uint16_t *previous,
+                uint8_t *out) const;
+
+  /**
+   * @brief Reads the steps of a key.
+   */
+  bool unpackKey(const uint8_t *in, int len, uint16_t *steps) const;
+
+  /**
+   * @brief Applies a delta to steps, which hold the previous message's.
+   * @return False, steps unchanged, if it is short or leaves the range.
+   */
+  bool unpackDelta(const uint8_t *in, int len, uint16_t *steps) const;
+
+  /**
+   * @brief Serializes the layout (little-endian range) for the receiver.
+   * @return Bytes written, at most MAX_DESCRIPTION.
+   */
+  int describe(uint8_t *out) const;
+
+  /**
+   * @brief Loads a layout written by describe().
+   */
+  bool load(const uint8_t *in, int len);
+
+private:
+  char _address[MAX_ADDRESS + 1] = {};
+  char _tags[MAX_ARGS + 1] = {}; ///< Without the ','
+  uint8_t _argc = 0;
+  uint8_t _bits = 0;
+  float _min = 0;
+  float _max = 0;
+
+  uint16_t _maxStep() const { return (uint16_t)((1UL << _bits) - 1); }
 };
 
 #endif
\ No newline at end of file